@@ -29,6 +29,7 @@
 #include "catalog/pg_proc.h"
 #endif
 #include "catalog/pg_trigger.h"
+#include "catalog/pg_type.h"
 #include "commands/defrem.h"
 #include "commands/extension.h"
 #include "commands/trigger.h"
@@ -36,6 +37,7 @@
 #include "distributed/citus_ruleutils.h"
 #include "distributed/colocation_utils.h"
 #include "distributed/commands.h"
+#include "distributed/distributed_planner.h"
 #include "distributed/distribution_column.h"
 #include "distributed/master_metadata_utility.h"
 #include "distributed/master_protocol.h"
@@ -55,6 +57,7 @@
 #include "executor/executor.h"
 #include "executor/spi.h"
 #include "nodes/execnodes.h"
+#include "nodes/makefuncs.h"
 #include "nodes/nodeFuncs.h"
 #include "nodes/pg_list.h"
 #include "parser/parse_expr.h"
@@ -73,6 +76,26 @@
 #include "utils/inval.h"
 
 
+/*
+ * LocalDataCopyDestReceiver forwards the tuples that are read from a local
+ * table to a CitusCopyDestReceiver while the table is being distributed.
+ */
+typedef struct LocalDataCopyDestReceiver
+{
+	/* public DestReceiver interface */
+	DestReceiver pub;
+
+	/* DestReceiver that copies the tuples into the shards */
+	DestReceiver *copyDest;
+
+	/* executor state whose per-tuple memory is reset after every tuple */
+	EState *executorState;
+
+	/* number of tuples copied so far */
+	uint64 rowsCopied;
+} LocalDataCopyDestReceiver;
+
+
 /* Replication model to use when creating distributed tables */
 int ReplicationModel = REPLICATION_MODEL_COORDINATOR;
 
@@ -99,6 +122,14 @@ static void EnsureLocalTableEmptyIfNecessary(Oid relationId, char distributionMe
 											 bool viaDepracatedAPI);
 static bool LocalTableEmpty(Oid tableId);
 static void CopyLocalDataIntoShards(Oid relationId);
+static Query * LocalTableScanQuery(Relation relation);
+static LocalDataCopyDestReceiver * CreateLocalDataCopyDestReceiver(
+	DestReceiver *copyDest, EState *executorState);
+static void LocalDataCopyDestReceiverStartup(DestReceiver *dest, int operation,
+											 TupleDesc inputTupleDescriptor);
+static bool LocalDataCopyDestReceiverReceive(TupleTableSlot *slot, DestReceiver *dest);
+static void LocalDataCopyDestReceiverShutdown(DestReceiver *dest);
+static void LocalDataCopyDestReceiverDestroy(DestReceiver *dest);
 static List * TupleDescColumnNameList(TupleDesc tupleDescriptor);
 static bool RelationUsesIdentityColumns(TupleDesc relationDesc);
 static bool DistributionColumnUsesGeneratedStoredColumn(TupleDesc relationDesc,
@@ -1196,15 +1227,16 @@ RegularTable(Oid relationId)
  *
  * This function uses CitusCopyDestReceiver to invoke the distributed COPY logic.
  * We cannot use a regular COPY here since that cannot read from a table. Instead
- * we read from the table and pass each tuple to the CitusCopyDestReceiver which
- * opens a connection and starts a COPY for each shard placement that will have
- * data.
+ * we run a query on the local table and pass each tuple to the
+ * CitusCopyDestReceiver which opens a connection and starts a COPY for each
+ * shard placement that will have data.
  *
- * We could call the planner and executor here and send the output to the
- * DestReceiver, but we are in a tricky spot here since Citus is already
- * intercepting queries on this table in the planner and executor hooks and we
- * want to read from the local table. To keep it simple, we perform a heap scan
- * directly on the table.
+ * Citus is already intercepting queries on this table in the planner and
+ * executor hooks, so we build the query ourselves and plan it with
+ * CURSOR_OPT_FORCE_LOCAL_PLANNING to read from the local table. Going through
+ * the planner allows postgres to scan large tables using a parallel sequential
+ * scan, such that several processes read the table concurrently while the
+ * tuples are sent to the shards.
  *
  * Any writes on the table that are started during this operation will be handled
  * as distributed queries once the current transaction commits. SELECTs will
@@ -1218,24 +1250,17 @@ static void
 CopyLocalDataIntoShards(Oid distributedRelationId)
 {
 	DestReceiver *copyDest = NULL;
+	LocalDataCopyDestReceiver *localCopyDest = NULL;
 	List *columnNameList = NIL;
 	Relation distributedRelation = NULL;
 	TupleDesc tupleDescriptor = NULL;
 	Var *partitionColumn = NULL;
 	int partitionColumnIndex = INVALID_PARTITION_COLUMN_INDEX;
 	bool stopOnFailure = true;
-
+	Query *localTableQuery = NULL;
+	PlannedStmt *localTablePlan = NULL;
+	int cursorOptions = CURSOR_OPT_PARALLEL_OK | CURSOR_OPT_FORCE_LOCAL_PLANNING;
 	EState *estate = NULL;
-#if PG_VERSION_NUM >= 120000
-	TableScanDesc scan = NULL;
-#else
-	HeapScanDesc scan = NULL;
-#endif
-	HeapTuple tuple = NULL;
-	ExprContext *econtext = NULL;
-	MemoryContext oldContext = NULL;
-	TupleTableSlot *slot = NULL;
-	uint64 rowsCopied = 0;
 
 	/* take an ExclusiveLock to block all operations except SELECT */
 	distributedRelation = heap_open(distributedRelationId, ExclusiveLock);
@@ -1264,7 +1289,6 @@ CopyLocalDataIntoShards(Oid distributedRelationId)
 
 	/* get the table columns */
 	tupleDescriptor = RelationGetDescr(distributedRelation);
-	slot = MakeSingleTupleTableSlotCompat(tupleDescriptor, &TTSOpsHeapTuple);
 	columnNameList = TupleDescColumnNameList(tupleDescriptor);
 
 	/* determine the partition column in the tuple descriptor */
@@ -1274,10 +1298,7 @@ CopyLocalDataIntoShards(Oid distributedRelationId)
 		partitionColumnIndex = partitionColumn->varattno - 1;
 	}
 
-	/* initialise per-tuple memory context */
 	estate = CreateExecutorState();
-	econtext = GetPerTupleExprContext(estate);
-	econtext->ecxt_scantuple = slot;
 
 	copyDest =
 		(DestReceiver *) CreateCitusCopyDestReceiver(distributedRelationId,
@@ -1289,68 +1310,198 @@ CopyLocalDataIntoShards(Oid distributedRelationId)
 	/* initialise state for writing to shards, we'll open connections on demand */
 	copyDest->rStartup(copyDest, 0, tupleDescriptor);
 
-	/* begin reading from local table */
-#if PG_VERSION_NUM >= 120000
-	scan = table_beginscan(distributedRelation, GetActiveSnapshot(), 0, NULL);
-#else
-	scan = heap_beginscan(distributedRelation, GetActiveSnapshot(), 0, NULL);
-#endif
+	localCopyDest = CreateLocalDataCopyDestReceiver(copyDest, estate);
 
-	oldContext = MemoryContextSwitchTo(GetPerTupleMemoryContext(estate));
+	/* read from the local table, possibly using parallel workers */
+	localTableQuery = LocalTableScanQuery(distributedRelation);
+	localTablePlan = pg_plan_query(localTableQuery, cursorOptions, NULL);
 
-	while ((tuple = heap_getnext(scan, ForwardScanDirection)) != NULL)
+	if (IsA(localTablePlan->planTree, Gather))
 	{
-		/* materialize tuple and send it to a shard */
-#if PG_VERSION_NUM >= 120000
-		ExecStoreHeapTuple(tuple, slot, false);
-#else
-		ExecStoreTuple(tuple, slot, InvalidBuffer, false);
-#endif
-		copyDest->receiveSlot(slot, copyDest);
+		ereport(DEBUG1, (errmsg("reading local data using a parallel scan")));
+	}
 
-		/* clear tuple memory */
-		ResetPerTupleExprContext(estate);
+	ExecutePlanIntoDestReceiver(localTablePlan, NULL, (DestReceiver *) localCopyDest);
 
-		/* make sure we roll back on cancellation */
-		CHECK_FOR_INTERRUPTS();
+	if (localCopyDest->rowsCopied % 1000000 != 0)
+	{
+		ereport(DEBUG1, (errmsg("Copied " UINT64_FORMAT " rows",
+								localCopyDest->rowsCopied)));
+	}
 
-		if (rowsCopied == 0)
-		{
-			ereport(NOTICE, (errmsg("Copying data from local table...")));
-		}
+	/* finish writing into the shards */
+	copyDest->rShutdown(copyDest);
+	copyDest->rDestroy(copyDest);
+
+	/* free memory and close the relation */
+	FreeExecutorState(estate);
+	heap_close(distributedRelation, NoLock);
+
+	PopActiveSnapshot();
+}
 
-		rowsCopied++;
 
-		if (rowsCopied % 1000000 == 0)
+/*
+ * LocalTableScanQuery returns a query that reads all rows of the given local
+ * table, including a NULL value for each dropped column, such that the output
+ * tuples match the tuple descriptor of the relation.
+ */
+static Query *
+LocalTableScanQuery(Relation relation)
+{
+	Query *query = makeNode(Query);
+	RangeTblEntry *rangeTableEntry = makeNode(RangeTblEntry);
+	RangeTblRef *rangeTableRef = makeNode(RangeTblRef);
+	TupleDesc tupleDescriptor = RelationGetDescr(relation);
+	List *targetList = NIL;
+	List *columnNameList = NIL;
+	int columnIndex = 0;
+
+	for (columnIndex = 0; columnIndex < tupleDescriptor->natts; columnIndex++)
+	{
+		Form_pg_attribute column = TupleDescAttr(tupleDescriptor, columnIndex);
+		char *columnName = pstrdup(NameStr(column->attname));
+		Expr *columnExpr = NULL;
+		TargetEntry *targetEntry = NULL;
+
+		if (column->attisdropped)
 		{
-			ereport(DEBUG1, (errmsg("Copied " UINT64_FORMAT " rows", rowsCopied)));
+			/* like the parser, use an untyped NULL in place of dropped columns */
+			columnExpr = (Expr *) makeNullConst(INT4OID, -1, InvalidOid);
+			columnName = "";
 		}
+		else
+		{
+			columnExpr = (Expr *) makeVar(1, column->attnum, column->atttypid,
+										  column->atttypmod, column->attcollation, 0);
+		}
+
+		targetEntry = makeTargetEntry(columnExpr, columnIndex + 1, columnName, false);
+
+		targetList = lappend(targetList, targetEntry);
+		columnNameList = lappend(columnNameList, makeString(columnName));
+	}
+
+	/* we already hold an ExclusiveLock, no need to check permissions again */
+	rangeTableEntry->rtekind = RTE_RELATION;
+	rangeTableEntry->relid = RelationGetRelid(relation);
+	rangeTableEntry->relkind = relation->rd_rel->relkind;
+#if PG_VERSION_NUM >= 120000
+	rangeTableEntry->rellockmode = AccessShareLock;
+#endif
+	rangeTableEntry->inh = false;
+	rangeTableEntry->inFromCl = true;
+	rangeTableEntry->eref = makeAlias(RelationGetRelationName(relation),
+									  columnNameList);
+
+	rangeTableRef->rtindex = 1;
+
+	query->commandType = CMD_SELECT;
+	query->querySource = QSRC_ORIGINAL;
+	query->canSetTag = true;
+	query->rtable = list_make1(rangeTableEntry);
+	query->jointree = makeFromExpr(list_make1(rangeTableRef), NULL);
+	query->targetList = targetList;
+
+	return query;
+}
+
+
+/*
+ * CreateLocalDataCopyDestReceiver creates a DestReceiver that forwards the
+ * tuples read from the local table to the given COPY DestReceiver, while
+ * reporting progress and freeing the memory used for each tuple.
+ */
+static LocalDataCopyDestReceiver *
+CreateLocalDataCopyDestReceiver(DestReceiver *copyDest, EState *executorState)
+{
+	LocalDataCopyDestReceiver *localCopyDest =
+		palloc0(sizeof(LocalDataCopyDestReceiver));
+
+	localCopyDest->pub.receiveSlot = LocalDataCopyDestReceiverReceive;
+	localCopyDest->pub.rStartup = LocalDataCopyDestReceiverStartup;
+	localCopyDest->pub.rShutdown = LocalDataCopyDestReceiverShutdown;
+	localCopyDest->pub.rDestroy = LocalDataCopyDestReceiverDestroy;
+	localCopyDest->pub.mydest = DestCopyOut;
+
+	localCopyDest->copyDest = copyDest;
+	localCopyDest->executorState = executorState;
+	localCopyDest->rowsCopied = 0;
+
+	return localCopyDest;
+}
+
+
+/*
+ * LocalDataCopyDestReceiverStartup does nothing, the COPY DestReceiver is
+ * started by the caller using the tuple descriptor of the relation.
+ */
+static void
+LocalDataCopyDestReceiverStartup(DestReceiver *dest, int operation,
+								 TupleDesc inputTupleDescriptor)
+{
+	/* nothing to do */
+}
+
+
+/*
+ * LocalDataCopyDestReceiverReceive sends a tuple read from the local table
+ * to the shards.
+ */
+static bool
+LocalDataCopyDestReceiverReceive(TupleTableSlot *slot, DestReceiver *dest)
+{
+	LocalDataCopyDestReceiver *localCopyDest = (LocalDataCopyDestReceiver *) dest;
+	DestReceiver *copyDest = localCopyDest->copyDest;
+	EState *executorState = localCopyDest->executorState;
+	MemoryContext oldContext =
+		MemoryContextSwitchTo(GetPerTupleMemoryContext(executorState));
+
+	copyDest->receiveSlot(slot, copyDest);
+
+	MemoryContextSwitchTo(oldContext);
+
+	/* clear tuple memory */
+	ResetPerTupleExprContext(executorState);
+
+	/* make sure we roll back on cancellation */
+	CHECK_FOR_INTERRUPTS();
+
+	if (localCopyDest->rowsCopied == 0)
+	{
+		ereport(NOTICE, (errmsg("Copying data from local table...")));
 	}
 
-	if (rowsCopied % 1000000 != 0)
+	localCopyDest->rowsCopied++;
+
+	if (localCopyDest->rowsCopied % 1000000 == 0)
 	{
-		ereport(DEBUG1, (errmsg("Copied " UINT64_FORMAT " rows", rowsCopied)));
+		ereport(DEBUG1, (errmsg("Copied " UINT64_FORMAT " rows",
+								localCopyDest->rowsCopied)));
 	}
 
-	MemoryContextSwitchTo(oldContext);
+	return true;
+}
 
-	/* finish reading from the local table */
-#if PG_VERSION_NUM >= 120000
-	table_endscan(scan);
-#else
-	heap_endscan(scan);
-#endif
 
-	/* finish writing into the shards */
-	copyDest->rShutdown(copyDest);
-	copyDest->rDestroy(copyDest);
+/*
+ * LocalDataCopyDestReceiverShutdown does nothing, the COPY DestReceiver is
+ * shut down by the caller.
+ */
+static void
+LocalDataCopyDestReceiverShutdown(DestReceiver *dest)
+{
+	/* nothing to do */
+}
 
-	/* free memory and close the relation */
-	ExecDropSingleTupleTableSlot(slot);
-	FreeExecutorState(estate);
-	heap_close(distributedRelation, NoLock);
 
-	PopActiveSnapshot();
+/*
+ * LocalDataCopyDestReceiverDestroy frees the DestReceiver.
+ */
+static void
+LocalDataCopyDestReceiverDestroy(DestReceiver *dest)
+{
+	pfree(dest);
 }
 
 
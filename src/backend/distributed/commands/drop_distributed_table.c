@@ -15,6 +15,7 @@
 #include "distributed/master_metadata_utility.h"
 #include "distributed/master_protocol.h"
 #include "distributed/metadata_sync.h"
+#include "distributed/shard_column_ranges.h"
 #include "distributed/worker_transaction.h"
 #include "utils/builtins.h"
 #include "utils/lsyscache.h"
@@ -82,6 +83,7 @@ master_remove_partition_metadata(PG_FUNCTION_ARGS)
 	CheckTableSchemaNameForDrop(relationId, &schemaName, &tableName);
 
 	DeletePartitionRow(relationId);
+	DeleteShardRangeColumns(relationId);
 
 	PG_RETURN_VOID();
 }
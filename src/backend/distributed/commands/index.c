@@ -24,11 +24,16 @@
 #include "distributed/commands.h"
 #include "distributed/commands/utility_hook.h"
 #include "distributed/distributed_planner.h"
+#include "distributed/master_metadata_utility.h"
 #include "distributed/master_protocol.h"
 #include "distributed/metadata_cache.h"
+#include "distributed/multi_executor.h"
 #include "distributed/multi_physical_planner.h"
+#include "distributed/multi_progress.h"
 #include "distributed/resource_lock.h"
+#include "distributed/tuplestore.h"
 #include "distributed/version_compat.h"
+#include "funcapi.h"
 #include "lib/stringinfo.h"
 #include "miscadmin.h"
 #include "nodes/parsenodes.h"
@@ -38,8 +43,33 @@
 #include "utils/lsyscache.h"
 #include "utils/syscache.h"
 
+
+/* magic number that identifies the progress monitors of index builds */
+#define INDEX_BUILD_PROGRESS_MAGIC_NUMBER 1392
+
+
+/*
+ * IndexBuildTask is used to order the tasks of a CREATE INDEX command by the
+ * size of their shard.
+ */
+typedef struct IndexBuildTask
+{
+	Task *task;
+	uint64 shardSize;
+	int taskIndex;
+} IndexBuildTask;
+
+
+/* maximum number of concurrent index builds per worker, 0 means no limit */
+int MaxIndexBuildsPerNode = 0;
+
+
 /* Local functions forward declarations for helper functions */
 static List * CreateIndexTaskList(Oid relationId, IndexStmt *indexStmt);
+static List * SortIndexBuildTaskListBySize(List *taskList);
+static int CompareIndexBuildTasksBySize(const void *leftElement,
+										const void *rightElement);
+static char * TaskProgressStateName(TaskProgressState state);
 static List * CreateReindexTaskList(Oid relationId, ReindexStmt *reindexStmt);
 static void RangeVarCallbackForDropIndex(const RangeVar *rel, Oid relOid, Oid oldRelOid,
 										 void *arg);
@@ -51,6 +81,10 @@ static void ErrorIfUnsupportedDropIndexStmt(DropStmt *dropIndexStatement);
 static List * DropIndexTaskList(Oid relationId, Oid indexId, DropStmt *dropStmt);
 
 
+/* exports for SQL callable functions */
+PG_FUNCTION_INFO_V1(get_index_build_progress);
+
+
 /*
  * This struct defines the state for the callback for drop statements.
  * It is copied as it is from commands/tablecmds.c in Postgres source.
@@ -179,6 +213,7 @@ PlanIndexStmt(IndexStmt *createIndexStatement, const char *createIndexCommand)
 				DDLJob *ddlJob = palloc0(sizeof(DDLJob));
 				ddlJob->targetRelationId = relationId;
 				ddlJob->concurrentIndexCmd = createIndexStatement->concurrent;
+				ddlJob->indexBuildCmd = true;
 				ddlJob->commandString = createIndexCommand;
 				ddlJob->taskList = CreateIndexTaskList(relationId, createIndexStatement);
 
@@ -547,10 +582,265 @@ CreateIndexTaskList(Oid relationId, IndexStmt *indexStmt)
 		resetStringInfo(&ddlString);
 	}
 
+	/* start the longest builds first, such that they do not end up last */
+	taskList = SortIndexBuildTaskListBySize(taskList);
+
 	return taskList;
 }
 
 
+/*
+ * SortIndexBuildTaskListBySize returns the given index build tasks ordered by
+ * the size of their shard as recorded in the metadata, largest first. Tasks of
+ * shards with the same size keep their original order.
+ */
+static List *
+SortIndexBuildTaskListBySize(List *taskList)
+{
+	int taskCount = list_length(taskList);
+	IndexBuildTask *buildTaskArray = NULL;
+	List *sortedTaskList = NIL;
+	ListCell *taskCell = NULL;
+	int taskIndex = 0;
+
+	if (taskCount < 2)
+	{
+		return taskList;
+	}
+
+	buildTaskArray = palloc0(taskCount * sizeof(IndexBuildTask));
+
+	foreach(taskCell, taskList)
+	{
+		Task *task = (Task *) lfirst(taskCell);
+		IndexBuildTask *buildTask = &buildTaskArray[taskIndex];
+
+		buildTask->task = task;
+		buildTask->taskIndex = taskIndex;
+
+		if (task->taskPlacementList != NIL)
+		{
+			ShardPlacement *placement =
+				(ShardPlacement *) linitial(task->taskPlacementList);
+
+			buildTask->shardSize = placement->shardLength;
+		}
+
+		taskIndex++;
+	}
+
+	qsort(buildTaskArray, taskCount, sizeof(IndexBuildTask),
+		  CompareIndexBuildTasksBySize);
+
+	for (taskIndex = 0; taskIndex < taskCount; taskIndex++)
+	{
+		sortedTaskList = lappend(sortedTaskList, buildTaskArray[taskIndex].task);
+	}
+
+	pfree(buildTaskArray);
+
+	return sortedTaskList;
+}
+
+
+/*
+ * CompareIndexBuildTasksBySize is a comparison function for qsort that orders
+ * index build tasks by descending shard size, and by their original position
+ * for shards of the same size.
+ */
+static int
+CompareIndexBuildTasksBySize(const void *leftElement, const void *rightElement)
+{
+	const IndexBuildTask *leftTask = (const IndexBuildTask *) leftElement;
+	const IndexBuildTask *rightTask = (const IndexBuildTask *) rightElement;
+
+	if (leftTask->shardSize > rightTask->shardSize)
+	{
+		return -1;
+	}
+	else if (leftTask->shardSize < rightTask->shardSize)
+	{
+		return 1;
+	}
+
+	return leftTask->taskIndex - rightTask->taskIndex;
+}
+
+
+/*
+ * ExecuteIndexBuildTaskList executes the tasks that build an index on the
+ * shards of the given relation. At most citus.max_index_builds_per_node
+ * indexes are built concurrently on each worker, to avoid exhausting the
+ * memory of the workers when building many indexes at once. The progress of
+ * the individual shards can be followed via get_index_build_progress().
+ */
+void
+ExecuteIndexBuildTaskList(Oid relationId, List *taskList)
+{
+	int targetPoolSize = MaxAdaptiveExecutorPoolSize;
+	int taskCount = list_length(taskList);
+	ProgressMonitorData *monitor = NULL;
+	TaskProgress *progressArray = NULL;
+	ListCell *taskCell = NULL;
+	int taskIndex = 0;
+
+	if (MaxIndexBuildsPerNode > 0 && MaxIndexBuildsPerNode < targetPoolSize)
+	{
+		targetPoolSize = MaxIndexBuildsPerNode;
+
+		ereport(DEBUG3, (errmsg("building at most %d shard indexes concurrently "
+								"per node", targetPoolSize)));
+	}
+
+	if (taskCount > 0)
+	{
+		monitor = CreateProgressMonitor(INDEX_BUILD_PROGRESS_MAGIC_NUMBER, taskCount,
+										sizeof(TaskProgress), relationId);
+	}
+
+	if (monitor == NULL)
+	{
+		/* progress is not tracked, but we can still build the indexes */
+		progressArray = palloc0(taskCount * sizeof(TaskProgress));
+	}
+	else
+	{
+		progressArray = (TaskProgress *) monitor->steps;
+	}
+
+	foreach(taskCell, taskList)
+	{
+		Task *task = (Task *) lfirst(taskCell);
+		TaskProgress *progress = &progressArray[taskIndex];
+
+		progress->shardId = task->anchorShardId;
+		progress->placementCount = list_length(task->taskPlacementList);
+		progress->finishedPlacementCount = 0;
+		progress->state = TASK_PROGRESS_PENDING;
+
+		if (task->taskPlacementList != NIL)
+		{
+			ShardPlacement *placement =
+				(ShardPlacement *) linitial(task->taskPlacementList);
+
+			progress->shardSize = placement->shardLength;
+		}
+
+		taskIndex++;
+	}
+
+	ExecuteUtilityTaskListWithProgress(taskList, targetPoolSize, progressArray);
+
+	/* report the final progress of the shards in the order they were built */
+	for (taskIndex = 0; taskIndex < taskCount; taskIndex++)
+	{
+		TaskProgress *progress = &progressArray[taskIndex];
+
+		ereport(DEBUG3, (errmsg("index build on shard " UINT64_FORMAT " of "
+								UINT64_FORMAT " bytes is %s on %d of %d placements",
+								progress->shardId, progress->shardSize,
+								TaskProgressStateName(progress->state),
+								progress->finishedPlacementCount,
+								progress->placementCount)));
+	}
+
+	if (monitor != NULL)
+	{
+		FinalizeCurrentProgressMonitor();
+	}
+}
+
+
+/*
+ * get_index_build_progress returns the progress of the ongoing distributed
+ * index builds, with a row for each shard.
+ */
+Datum
+get_index_build_progress(PG_FUNCTION_ARGS)
+{
+	TupleDesc tupleDescriptor = NULL;
+	Tuplestorestate *tupleStore = NULL;
+	List *attachedDSMSegments = NIL;
+	List *monitorList = NIL;
+	ListCell *monitorCell = NULL;
+
+	CheckCitusVersion(ERROR);
+
+	tupleStore = SetupTuplestore(fcinfo, &tupleDescriptor);
+	monitorList = ProgressMonitorList(INDEX_BUILD_PROGRESS_MAGIC_NUMBER,
+									  &attachedDSMSegments);
+
+	foreach(monitorCell, monitorList)
+	{
+		ProgressMonitorData *monitor = (ProgressMonitorData *) lfirst(monitorCell);
+		TaskProgress *progressArray = (TaskProgress *) monitor->steps;
+		int stepIndex = 0;
+
+		for (stepIndex = 0; stepIndex < monitor->stepCount; stepIndex++)
+		{
+			TaskProgress *progress = &progressArray[stepIndex];
+			Datum values[6];
+			bool isNulls[6];
+
+			memset(values, 0, sizeof(values));
+			memset(isNulls, false, sizeof(isNulls));
+
+			values[0] = Int32GetDatum(monitor->processId);
+			values[1] = Int64GetDatum(progress->shardId);
+			values[2] = Int64GetDatum(progress->shardSize);
+			values[3] = Int32GetDatum(progress->placementCount);
+			values[4] = Int32GetDatum(progress->finishedPlacementCount);
+			values[5] = CStringGetTextDatum(TaskProgressStateName(progress->state));
+
+			tuplestore_putvalues(tupleStore, tupleDescriptor, values, isNulls);
+		}
+	}
+
+	tuplestore_donestoring(tupleStore);
+
+	DetachFromDSMSegments(attachedDSMSegments);
+
+	return (Datum) 0;
+}
+
+
+/*
+ * TaskProgressStateName returns the name of a task progress state as shown
+ * by get_index_build_progress().
+ */
+static char *
+TaskProgressStateName(TaskProgressState state)
+{
+	switch (state)
+	{
+		case TASK_PROGRESS_PENDING:
+		{
+			return "pending";
+		}
+
+		case TASK_PROGRESS_RUNNING:
+		{
+			return "running";
+		}
+
+		case TASK_PROGRESS_FINISHED:
+		{
+			return "finished";
+		}
+
+		case TASK_PROGRESS_FAILED:
+		{
+			return "failed";
+		}
+
+		default:
+		{
+			return "unknown";
+		}
+	}
+}
+
+
 /*
  * CreateReindexTaskList builds a list of tasks to execute a REINDEX command
  * against a specified distributed table.
@@ -84,6 +84,7 @@
 #include "distributed/remote_commands.h"
 #include "distributed/remote_transaction.h"
 #include "distributed/resource_lock.h"
+#include "distributed/shard_column_ranges.h"
 #include "distributed/shard_pruning.h"
 #include "distributed/version_compat.h"
 #include "distributed/worker_protocol.h"
@@ -2734,7 +2735,9 @@ CitusCopyDestReceiverDestroy(DestReceiver *destReceiver)
 /*
  * IsCopyResultStmt determines whether the given copy statement is a
  * COPY "resultkey" FROM STDIN WITH (format result) statement, which is used
- * to copy query results from the coordinator into workers.
+ * to copy query results from the coordinator into workers, or a
+ * COPY "resultkey" TO STDOUT WITH (format result) statement, which is used
+ * to fetch them from another node.
  */
 bool
 IsCopyResultStmt(CopyStmt *copyStatement)
@@ -2781,13 +2784,21 @@ ProcessCopyStmt(CopyStmt *copyStatement, char *completionTag, const char *queryS
 {
 	/*
 	 * Handle special COPY "resultid" FROM STDIN WITH (format result) commands
-	 * for sending intermediate results to workers.
+	 * for sending intermediate results to workers, and COPY "resultid" TO
+	 * STDOUT WITH (format result) commands for fetching them from workers.
 	 */
 	if (IsCopyResultStmt(copyStatement))
 	{
 		const char *resultId = copyStatement->relation->relname;
 
-		ReceiveQueryResultViaCopy(resultId);
+		if (copyStatement->is_from)
+		{
+			ReceiveQueryResultViaCopy(resultId);
+		}
+		else
+		{
+			SendQueryResultViaCopy(resultId);
+		}
 
 		return NULL;
 	}
@@ -3276,6 +3287,8 @@ GetShardState(uint64 shardId, HTAB *shardStateHash,
 	{
 		InitializeCopyShardState(shardState, connectionStateHash,
 								 shardId, stopOnFailure);
+
+		RecordShardModification(shardId);
 	}
 
 	return shardState;
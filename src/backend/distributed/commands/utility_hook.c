@@ -49,6 +49,7 @@
 #include "distributed/metadata_sync.h"
 #include "distributed/multi_executor.h"
 #include "distributed/resource_lock.h"
+#include "distributed/shared_metadata_cache.h"
 #include "distributed/transmit.h"
 #include "distributed/version_compat.h"
 #include "distributed/worker_transaction.h"
@@ -70,6 +71,7 @@ static int activeDropSchemaOrDBs = 0;
 
 /* Local functions forward declarations for helper functions */
 static void ExecuteDistributedDDLJob(DDLJob *ddlJob);
+static void ExecuteDDLJobTaskList(DDLJob *ddlJob);
 static char * SetSearchPathToCurrentSearchPathCommand(void);
 static char * CurrentSearchPath(void);
 static void PostProcessUtility(Node *parsetree);
@@ -137,9 +139,35 @@ multi_ProcessUtility(PlannedStmt *pstmt,
 		 * that state. Since we never need to intercept transaction statements,
 		 * skip our checks and immediately fall into standard_ProcessUtility.
 		 */
+		TransactionStmt *transactionStmt = NULL;
+
+		if (IsA(parsetree, TransactionStmt))
+		{
+			transactionStmt = (TransactionStmt *) parsetree;
+		}
+
+		/*
+		 * Shard metadata changes of a prepared transaction only become visible
+		 * once it is committed, so remember which prepared transactions changed
+		 * shard metadata.
+		 */
+		if (transactionStmt != NULL && transactionStmt->kind == TRANS_STMT_PREPARE)
+		{
+			RememberPreparedMetadataChanges(transactionStmt->gid);
+		}
+
 		standard_ProcessUtility(pstmt, queryString, context,
 								params, queryEnv, dest, completionTag);
 
+		if (transactionStmt != NULL &&
+			(transactionStmt->kind == TRANS_STMT_COMMIT_PREPARED ||
+			 transactionStmt->kind == TRANS_STMT_ROLLBACK_PREPARED))
+		{
+			bool committed = (transactionStmt->kind == TRANS_STMT_COMMIT_PREPARED);
+
+			PublishPreparedMetadataChanges(transactionStmt->gid, committed);
+		}
+
 		return;
 	}
 
@@ -149,6 +177,17 @@ multi_ProcessUtility(PlannedStmt *pstmt,
 		ErrorIfUnstableCreateOrAlterExtensionStmt(parsetree);
 	}
 
+	/*
+	 * Relation ids might be reused after DROP EXTENSION citus, so the shard
+	 * lists that other backends share should not survive it.
+	 */
+	if (IsA(parsetree, DropStmt) &&
+		((DropStmt *) parsetree)->removeType == OBJECT_EXTENSION &&
+		IsDropCitusStmt(parsetree))
+	{
+		MarkShardMetadataChanged(InvalidOid, INVALID_SHARD_ID);
+	}
+
 	if (!CitusHasBeenLoaded())
 	{
 		/*
@@ -1032,8 +1071,7 @@ ExecuteDistributedDDLJob(DDLJob *ddlJob)
 			SendCommandToWorkers(WORKERS_WITH_METADATA, (char *) ddlJob->commandString);
 		}
 
-		/* use adaptive executor when enabled */
-		ExecuteUtilityTaskListWithoutResults(ddlJob->taskList);
+		ExecuteDDLJobTaskList(ddlJob);
 	}
 	else
 	{
@@ -1044,8 +1082,7 @@ ExecuteDistributedDDLJob(DDLJob *ddlJob)
 
 		PG_TRY();
 		{
-			/* use adaptive executor when enabled */
-			ExecuteUtilityTaskListWithoutResults(ddlJob->taskList);
+			ExecuteDDLJobTaskList(ddlJob);
 
 			if (shouldSyncMetadata)
 			{
@@ -1080,6 +1117,26 @@ ExecuteDistributedDDLJob(DDLJob *ddlJob)
 }
 
 
+/*
+ * ExecuteDDLJobTaskList executes the worker tasks of the given DDLJob. Index
+ * builds get a separate concurrency limit and progress tracking, since they
+ * can take a long time and consume a lot of memory on the workers.
+ */
+static void
+ExecuteDDLJobTaskList(DDLJob *ddlJob)
+{
+	if (ddlJob->indexBuildCmd)
+	{
+		ExecuteIndexBuildTaskList(ddlJob->targetRelationId, ddlJob->taskList);
+	}
+	else
+	{
+		/* use adaptive executor when enabled */
+		ExecuteUtilityTaskListWithoutResults(ddlJob->taskList);
+	}
+}
+
+
 /*
  * SetSearchPathToCurrentSearchPathCommand generates a command which can
  * set the search path to the exact same search path that the issueing node
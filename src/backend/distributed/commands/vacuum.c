@@ -9,21 +9,39 @@
  */
 
 #include "postgres.h"
+#include "miscadmin.h"
 
+#include <math.h>
+
+#include "access/heapam.h"
+#include "access/htup_details.h"
+#include "access/multixact.h"
+#include "access/xact.h"
+#include "catalog/indexing.h"
+#include "catalog/pg_statistic.h"
+#include "catalog/pg_type.h"
 #if PG_VERSION_NUM >= 120000
 #include "commands/defrem.h"
 #endif
 #include "commands/vacuum.h"
 #include "distributed/commands.h"
 #include "distributed/commands/utility_hook.h"
+#include "distributed/master_metadata_utility.h"
 #include "distributed/metadata_cache.h"
 #include "distributed/multi_executor.h"
+#include "distributed/multi_physical_planner.h"
+#include "distributed/pg_dist_partition.h"
 #include "distributed/resource_lock.h"
 #include "distributed/transaction_management.h"
 #include "distributed/version_compat.h"
 #include "storage/lmgr.h"
+#include "utils/array.h"
 #include "utils/builtins.h"
 #include "utils/lsyscache.h"
+#include "utils/rel.h"
+#include "utils/syscache.h"
+#include "utils/tuplestore.h"
+#include "utils/typcache.h"
 
 /*
  * Subset of VacuumParams we care about
@@ -38,6 +56,74 @@ typedef struct CitusVacuumParams
 } CitusVacuumParams;
 
 
+/*
+ * StatisticsValue is a value that appears in the most common values or the
+ * histogram of a shard, together with the number of rows it represents.
+ */
+typedef struct StatisticsValue
+{
+	Datum value;
+	double rowCount;
+} StatisticsValue;
+
+
+/*
+ * DistributedColumnStats accumulates the statistics that ANALYZE computed for
+ * a column on the individual shards of a distributed table.
+ */
+typedef struct DistributedColumnStats
+{
+	int shardCount;
+	double rowCount;
+	double nullCount;
+	double widthSum;
+	double distinctSum;
+	double distinctMax;
+	bool uniqueInAllShards;
+
+	/*
+	 * The most common values and histograms of the shards can only be merged
+	 * for types that have a btree operator class. The type information is
+	 * looked up when the first shard returns them.
+	 */
+	bool typeInfoLoaded;
+	bool mergeValueStats;
+	Oid typeId;
+	Oid collationId;
+	int16 typeLength;
+	bool typeByValue;
+	char typeAlign;
+	Oid arrayInputFunctionId;
+	Oid arrayTypeIoParam;
+	Oid equalityOperatorId;
+	Oid lessThanOperatorId;
+	FmgrInfo *compareFunction;
+
+	List *mostCommonValueList;
+	int mostCommonValueCount;
+	List *histogramValueList;
+	int histogramBoundCount;
+} DistributedColumnStats;
+
+
+/*
+ * StatisticsSlot is a statistics slot of pg_statistic, e.g. the most common
+ * values or the histogram of a column.
+ */
+typedef struct StatisticsSlot
+{
+	int16 kind;
+	Oid operatorId;
+	Oid collationId;
+	ArrayType *numbers;
+	ArrayType *values;
+} StatisticsSlot;
+
+
+/* whether to merge the statistics of the shards into the distributed table */
+bool EnableDistributedAnalyze = false;
+
+
 /* Local functions forward declarations for processing distributed table commands */
 static bool IsDistributedVacuumStmt(int vacuumOptions, List *vacuumRelationIdList);
 static List * VacuumTaskList(Oid relationId, CitusVacuumParams vacuumParams,
@@ -47,6 +133,32 @@ static char * DeparseVacuumColumnNames(List *columnNameList);
 static List * VacuumColumnList(VacuumStmt *vacuumStmt, int relationIndex);
 static List * ExtractVacuumTargetRels(VacuumStmt *vacuumStmt);
 static CitusVacuumParams VacuumStmtParams(VacuumStmt *vacstmt);
+static void UpdateDistributedStatistics(Oid relationId);
+static List * ShardStatisticsTaskList(Oid relationId);
+static float4 MergedDistinctCount(DistributedColumnStats *columnStats,
+								  bool disjointValues);
+static bool LoadColumnTypeInfo(DistributedColumnStats *columnStats, Oid relationId,
+							   AttrNumber attributeNumber);
+static void AddShardValueStatistics(DistributedColumnStats *columnStats,
+									TupleTableSlot *slot, double shardRowCount,
+									double nonNullRowCount);
+static Datum * ParseStatisticsValues(DistributedColumnStats *columnStats,
+									 char *valuesString, int *valueCount);
+static bool MergedMostCommonValues(DistributedColumnStats *columnStats,
+								   StatisticsSlot *statisticsSlot);
+static bool MergedHistogram(DistributedColumnStats *columnStats,
+							StatisticsSlot *statisticsSlot);
+static StatisticsValue ** SortedStatisticsValues(DistributedColumnStats *columnStats,
+												 List *valueList);
+static int CompareStatisticsValues(const void *leftElement, const void *rightElement,
+								   void *arg);
+static int CompareStatisticsValueRowCounts(const void *leftElement,
+										   const void *rightElement, void *arg);
+static void UpdateRelationStatistics(Oid relationId, double rowCount,
+									 double pageCount);
+static void UpdateColumnStatistics(Oid relationId, AttrNumber attributeNumber,
+								   float4 nullFraction, int32 width, float4 distinct,
+								   StatisticsSlot *statisticsSlotArray, int slotCount);
 
 /*
  * ProcessVacuumStmt processes vacuum statements that may need propagation to
@@ -114,6 +226,11 @@ ProcessVacuumStmt(VacuumStmt *vacuumStmt, const char *vacuumCommand)
 			/* use adaptive executor when enabled */
 			ExecuteUtilityTaskListWithoutResults(taskList);
 			executedVacuumCount++;
+
+			if (EnableDistributedAnalyze && (vacuumParams.options & VACOPT_ANALYZE) != 0)
+			{
+				UpdateDistributedStatistics(relationId);
+			}
 		}
 		relationIndex++;
 	}
@@ -245,6 +362,789 @@ VacuumTaskList(Oid relationId, CitusVacuumParams vacuumParams, List *vacuumColum
 }
 
 
+/*
+ * UpdateDistributedStatistics fetches the statistics that ANALYZE computed on
+ * the shards of the given distributed table, and merges them into statistics
+ * for the distributed table itself. The row and page counts are stored in
+ * pg_class and the null fraction, width, number of distinct values, most
+ * common values and histograms of the columns in pg_statistic, such that the
+ * coordinator planner can use them when planning queries that involve the
+ * distributed table.
+ */
+static void
+UpdateDistributedStatistics(Oid relationId)
+{
+	DistTableCacheEntry *cacheEntry = DistributedTableCacheEntry(relationId);
+	char partitionMethod = cacheEntry->partitionMethod;
+	Var *partitionColumn = cacheEntry->partitionColumn;
+	AttrNumber columnCount = get_relnatts(relationId);
+	DistributedColumnStats *columnStatsArray =
+		palloc0((columnCount + 1) * sizeof(DistributedColumnStats));
+	List *taskList = ShardStatisticsTaskList(relationId);
+	TupleDesc resultDescriptor = NULL;
+	Tuplestorestate *resultStore = NULL;
+	TupleTableSlot *slot = NULL;
+	double relationRowCount = 0.0;
+	double relationPageCount = 0.0;
+	AttrNumber attributeNumber = 0;
+	bool randomAccess = false;
+	bool interTransactions = false;
+	bool hasReturning = false;
+
+	if (taskList == NIL)
+	{
+		return;
+	}
+
+	/*
+	 * Each task returns a row with a NULL column name for the shard itself,
+	 * followed by a row for each of the analyzed columns.
+	 */
+#if PG_VERSION_NUM >= 120000
+	resultDescriptor = CreateTemplateTupleDesc(9);
+#else
+	resultDescriptor = CreateTemplateTupleDesc(9, false);
+#endif
+	TupleDescInitEntry(resultDescriptor, (AttrNumber) 1, "attname", TEXTOID, -1, 0);
+	TupleDescInitEntry(resultDescriptor, (AttrNumber) 2, "reltuples", FLOAT8OID, -1, 0);
+	TupleDescInitEntry(resultDescriptor, (AttrNumber) 3, "relpages", FLOAT8OID, -1, 0);
+	TupleDescInitEntry(resultDescriptor, (AttrNumber) 4, "null_frac", FLOAT8OID, -1, 0);
+	TupleDescInitEntry(resultDescriptor, (AttrNumber) 5, "avg_width", INT4OID, -1, 0);
+	TupleDescInitEntry(resultDescriptor, (AttrNumber) 6, "n_distinct", FLOAT8OID, -1,
+					   0);
+	TupleDescInitEntry(resultDescriptor, (AttrNumber) 7, "most_common_vals", TEXTOID,
+					   -1, 0);
+	TupleDescInitEntry(resultDescriptor, (AttrNumber) 8, "most_common_freqs",
+					   FLOAT4ARRAYOID, -1, 0);
+	TupleDescInitEntry(resultDescriptor, (AttrNumber) 9, "histogram_bounds", TEXTOID,
+					   -1, 0);
+
+	resultStore = tuplestore_begin_heap(randomAccess, interTransactions, work_mem);
+
+	ExecuteTaskListExtended(ROW_MODIFY_READONLY, taskList, resultDescriptor,
+							resultStore, hasReturning, MaxAdaptiveExecutorPoolSize);
+
+	slot = MakeSingleTupleTableSlotCompat(resultDescriptor, &TTSOpsMinimalTuple);
+
+	while (tuplestore_gettupleslot(resultStore, true, false, slot))
+	{
+		bool isNull = false;
+		Datum columnNameDatum = slot_getattr(slot, 1, &isNull);
+		bool isShardRow = isNull;
+		double shardRowCount = DatumGetFloat8(slot_getattr(slot, 2, &isNull));
+		double shardPageCount = DatumGetFloat8(slot_getattr(slot, 3, &isNull));
+		DistributedColumnStats *columnStats = NULL;
+		double nullFraction = 0.0;
+		double nonNullRowCount = 0.0;
+		double distinct = 0.0;
+		int32 width = 0;
+
+		if (isShardRow)
+		{
+			relationRowCount += shardRowCount;
+			relationPageCount += shardPageCount;
+
+			ExecClearTuple(slot);
+			continue;
+		}
+
+		attributeNumber = get_attnum(relationId, TextDatumGetCString(columnNameDatum));
+		if (attributeNumber <= 0 || attributeNumber > columnCount)
+		{
+			/* column was dropped concurrently */
+			ExecClearTuple(slot);
+			continue;
+		}
+
+		nullFraction = DatumGetFloat8(slot_getattr(slot, 4, &isNull));
+		width = DatumGetInt32(slot_getattr(slot, 5, &isNull));
+		distinct = DatumGetFloat8(slot_getattr(slot, 6, &isNull));
+		nonNullRowCount = (1.0 - nullFraction) * shardRowCount;
+
+		/* a negative n_distinct is a fraction of the number of rows */
+		if (distinct < 0)
+		{
+			distinct = -distinct * shardRowCount;
+		}
+
+		columnStats = &columnStatsArray[attributeNumber];
+		columnStats->uniqueInAllShards = (columnStats->shardCount == 0 ||
+										  columnStats->uniqueInAllShards) &&
+										 distinct >= nonNullRowCount - 0.5;
+		columnStats->shardCount++;
+		columnStats->rowCount += shardRowCount;
+		columnStats->nullCount += nullFraction * shardRowCount;
+		columnStats->widthSum += width * nonNullRowCount;
+		columnStats->distinctSum += distinct;
+		columnStats->distinctMax = Max(columnStats->distinctMax, distinct);
+
+		if (LoadColumnTypeInfo(columnStats, relationId, attributeNumber))
+		{
+			AddShardValueStatistics(columnStats, slot, shardRowCount, nonNullRowCount);
+		}
+
+		ExecClearTuple(slot);
+	}
+
+	ExecDropSingleTupleTableSlot(slot);
+	tuplestore_end(resultStore);
+
+	UpdateRelationStatistics(relationId, relationRowCount, relationPageCount);
+
+	for (attributeNumber = 1; attributeNumber <= columnCount; attributeNumber++)
+	{
+		DistributedColumnStats *columnStats = &columnStatsArray[attributeNumber];
+		double nonNullRowCount = 0.0;
+		float4 nullFraction = 0.0;
+		int32 width = 0;
+		float4 distinct = 0.0;
+		bool disjointValues = false;
+		StatisticsSlot statisticsSlotArray[2];
+		int slotCount = 0;
+
+		if (columnStats->shardCount == 0 || columnStats->rowCount <= 0)
+		{
+			continue;
+		}
+
+		/*
+		 * Hash and range distributed tables have disjoint ranges of values of
+		 * the distribution column in each shard.
+		 */
+		disjointValues = partitionColumn != NULL &&
+						 partitionColumn->varattno == attributeNumber &&
+						 (partitionMethod == DISTRIBUTE_BY_HASH ||
+						  partitionMethod == DISTRIBUTE_BY_RANGE);
+
+		nonNullRowCount = columnStats->rowCount - columnStats->nullCount;
+		nullFraction = (float4) (columnStats->nullCount / columnStats->rowCount);
+
+		if (nonNullRowCount > 0)
+		{
+			width = (int32) rint(columnStats->widthSum / nonNullRowCount);
+		}
+
+		distinct = MergedDistinctCount(columnStats, disjointValues);
+
+		if (MergedMostCommonValues(columnStats, &statisticsSlotArray[slotCount]))
+		{
+			slotCount++;
+		}
+
+		if (MergedHistogram(columnStats, &statisticsSlotArray[slotCount]))
+		{
+			slotCount++;
+		}
+
+		UpdateColumnStatistics(relationId, attributeNumber, nullFraction, width,
+							   distinct, statisticsSlotArray, slotCount);
+	}
+
+	CommandCounterIncrement();
+}
+
+
+/*
+ * ShardStatisticsTaskList returns a list of tasks that read the statistics of
+ * each shard of the given distributed table from its first placement.
+ */
+static List *
+ShardStatisticsTaskList(Oid relationId)
+{
+	List *taskList = NIL;
+	List *shardIntervalList = LoadShardIntervalList(relationId);
+	ListCell *shardIntervalCell = NULL;
+	char *schemaName = get_namespace_name(get_rel_namespace(relationId));
+	char *tableName = get_rel_name(relationId);
+	uint32 taskId = 1;
+
+	foreach(shardIntervalCell, shardIntervalList)
+	{
+		ShardInterval *shardInterval = (ShardInterval *) lfirst(shardIntervalCell);
+		uint64 shardId = shardInterval->shardId;
+		List *placementList = FinalizedShardPlacementList(shardId);
+		StringInfo queryString = makeStringInfo();
+		char *shardName = pstrdup(tableName);
+		char *qualifiedShardName = NULL;
+		Task *task = NULL;
+
+		if (placementList == NIL)
+		{
+			continue;
+		}
+
+		AppendShardIdToName(&shardName, shardId);
+		qualifiedShardName = quote_qualified_identifier(schemaName, shardName);
+
+		appendStringInfo(queryString,
+						 "SELECT NULL::text, reltuples::float8, relpages::float8, "
+						 "NULL::float8, NULL::int4, NULL::float8, NULL::text, "
+						 "NULL::float4[], NULL::text "
+						 "FROM pg_class WHERE oid = %s::regclass "
+						 "UNION ALL "
+						 "SELECT s.attname::text, c.reltuples::float8, "
+						 "c.relpages::float8, s.null_frac::float8, "
+						 "s.avg_width::int4, s.n_distinct::float8, "
+						 "s.most_common_vals::text, s.most_common_freqs, "
+						 "s.histogram_bounds::text "
+						 "FROM pg_class c JOIN pg_stats s ON (NOT s.inherited AND "
+						 "s.schemaname = %s AND s.tablename = %s) "
+						 "WHERE c.oid = %s::regclass",
+						 quote_literal_cstr(qualifiedShardName),
+						 quote_literal_cstr(schemaName),
+						 quote_literal_cstr(shardName),
+						 quote_literal_cstr(qualifiedShardName));
+
+		task = CreateBasicTask(INVALID_JOB_ID, taskId++, SQL_TASK, queryString->data);
+		task->anchorShardId = shardId;
+		task->taskPlacementList = list_make1(linitial(placementList));
+
+		taskList = lappend(taskList, task);
+	}
+
+	return taskList;
+}
+
+
+/*
+ * MergedDistinctCount estimates the number of distinct values of a column in
+ * the distributed table from the number of distinct values in the shards, and
+ * returns it in the format of pg_statistic.stadistinct.
+ *
+ * If the shards have disjoint values, or the column is unique in every shard
+ * (as is typical for generated keys), the counts of the shards are added up.
+ * Otherwise, we assume that the shards mostly contain the same values and use
+ * the largest count.
+ */
+static float4
+MergedDistinctCount(DistributedColumnStats *columnStats, bool disjointValues)
+{
+	double rowCount = columnStats->rowCount;
+	double nonNullRowCount = rowCount - columnStats->nullCount;
+	double distinct = columnStats->distinctMax;
+
+	if (disjointValues || columnStats->uniqueInAllShards)
+	{
+		distinct = columnStats->distinctSum;
+	}
+
+	distinct = Min(distinct, nonNullRowCount);
+
+	if (distinct >= nonNullRowCount && nonNullRowCount > 0)
+	{
+		/* unique column, see compute_distinct_stats() in analyze.c */
+		return (float4) (-1.0 * nonNullRowCount / rowCount);
+	}
+
+	/* like ANALYZE, assume the count scales with the table if it is large */
+	if (distinct > 0.1 * rowCount)
+	{
+		return (float4) Max(-distinct / rowCount, -1.0);
+	}
+
+	return (float4) floor(distinct + 0.5);
+}
+
+
+/*
+ * LoadColumnTypeInfo looks up the type information that is needed to merge the
+ * most common values and histograms of the given column, and returns whether
+ * they can be merged. That requires a default btree operator class, and we
+ * skip array types whose text representation we cannot parse unambiguously.
+ */
+static bool
+LoadColumnTypeInfo(DistributedColumnStats *columnStats, Oid relationId,
+				   AttrNumber attributeNumber)
+{
+	TypeCacheEntry *typeEntry = NULL;
+	Oid arrayTypeId = InvalidOid;
+	int32 typeModifier = -1;
+
+	if (columnStats->typeInfoLoaded)
+	{
+		return columnStats->mergeValueStats;
+	}
+
+	columnStats->typeInfoLoaded = true;
+	columnStats->mergeValueStats = false;
+
+	get_atttypetypmodcoll(relationId, attributeNumber, &columnStats->typeId,
+						  &typeModifier, &columnStats->collationId);
+
+	arrayTypeId = get_array_type(columnStats->typeId);
+	if (!OidIsValid(arrayTypeId) || type_is_array(columnStats->typeId))
+	{
+		return false;
+	}
+
+	typeEntry = lookup_type_cache(columnStats->typeId,
+								  TYPECACHE_EQ_OPR | TYPECACHE_LT_OPR |
+								  TYPECACHE_CMP_PROC_FINFO);
+	if (!OidIsValid(typeEntry->eq_opr) || !OidIsValid(typeEntry->lt_opr) ||
+		!OidIsValid(typeEntry->cmp_proc_finfo.fn_oid))
+	{
+		return false;
+	}
+
+	get_typlenbyvalalign(columnStats->typeId, &columnStats->typeLength,
+						 &columnStats->typeByValue, &columnStats->typeAlign);
+	getTypeInputInfo(arrayTypeId, &columnStats->arrayInputFunctionId,
+					 &columnStats->arrayTypeIoParam);
+
+	columnStats->equalityOperatorId = typeEntry->eq_opr;
+	columnStats->lessThanOperatorId = typeEntry->lt_opr;
+	columnStats->compareFunction = &typeEntry->cmp_proc_finfo;
+	columnStats->mergeValueStats = true;
+
+	return true;
+}
+
+
+/*
+ * AddShardValueStatistics adds the most common values and the histogram bounds
+ * of a column in a shard, as read from pg_stats, to the column statistics.
+ * Each value is annotated with the number of rows of the shard it represents,
+ * so that the statistics of shards of different sizes can be combined.
+ */
+static void
+AddShardValueStatistics(DistributedColumnStats *columnStats, TupleTableSlot *slot,
+						double shardRowCount, double nonNullRowCount)
+{
+	bool isNull = false;
+	Datum mostCommonValuesDatum = slot_getattr(slot, 7, &isNull);
+	Datum histogramDatum = 0;
+	double histogramRowCount = nonNullRowCount;
+
+	if (!isNull)
+	{
+		char *mostCommonValuesString = TextDatumGetCString(mostCommonValuesDatum);
+		ArrayType *frequencyArray = DatumGetArrayTypeP(slot_getattr(slot, 8, &isNull));
+		Datum *valueArray = NULL;
+		Datum *frequencyDatumArray = NULL;
+		int valueCount = 0;
+		int frequencyCount = 0;
+		int valueIndex = 0;
+
+		valueArray = ParseStatisticsValues(columnStats, mostCommonValuesString,
+										   &valueCount);
+		deconstruct_array(frequencyArray, FLOAT4OID, sizeof(float4), FLOAT4PASSBYVAL,
+						  'i', &frequencyDatumArray, NULL, &frequencyCount);
+
+		for (valueIndex = 0; valueIndex < Min(valueCount, frequencyCount); valueIndex++)
+		{
+			StatisticsValue *statisticsValue = palloc0(sizeof(StatisticsValue));
+			double frequency = DatumGetFloat4(frequencyDatumArray[valueIndex]);
+
+			statisticsValue->value = valueArray[valueIndex];
+			statisticsValue->rowCount = frequency * shardRowCount;
+
+			/* the histogram only covers the values that are not in the list */
+			histogramRowCount -= statisticsValue->rowCount;
+
+			columnStats->mostCommonValueList =
+				lappend(columnStats->mostCommonValueList, statisticsValue);
+		}
+
+		columnStats->mostCommonValueCount = Max(columnStats->mostCommonValueCount,
+												valueCount);
+	}
+
+	histogramDatum = slot_getattr(slot, 9, &isNull);
+	if (!isNull)
+	{
+		char *histogramString = TextDatumGetCString(histogramDatum);
+		Datum *boundArray = NULL;
+		int boundCount = 0;
+		int boundIndex = 0;
+		double bucketRowCount = 0.0;
+
+		boundArray = ParseStatisticsValues(columnStats, histogramString, &boundCount);
+		if (boundCount < 2)
+		{
+			return;
+		}
+
+		/*
+		 * The bounds divide the values of the shard into buckets with an equal
+		 * number of rows. Attributing the rows of each bucket to its upper
+		 * bound lets us estimate the number of rows below any value by adding
+		 * up the row counts of the bounds of all shards.
+		 */
+		bucketRowCount = Max(histogramRowCount, 0.0) / (boundCount - 1);
+
+		for (boundIndex = 0; boundIndex < boundCount; boundIndex++)
+		{
+			StatisticsValue *statisticsValue = palloc0(sizeof(StatisticsValue));
+
+			statisticsValue->value = boundArray[boundIndex];
+			statisticsValue->rowCount = (boundIndex == 0) ? 0.0 : bucketRowCount;
+
+			columnStats->histogramValueList =
+				lappend(columnStats->histogramValueList, statisticsValue);
+		}
+
+		columnStats->histogramBoundCount = Max(columnStats->histogramBoundCount,
+											   boundCount);
+	}
+}
+
+
+/*
+ * ParseStatisticsValues parses the text representation of an anyarray column
+ * of pg_stats into an array of values of the column type.
+ */
+static Datum *
+ParseStatisticsValues(DistributedColumnStats *columnStats, char *valuesString,
+					  int *valueCount)
+{
+	Datum *valueArray = NULL;
+	Datum arrayDatum = OidInputFunctionCall(columnStats->arrayInputFunctionId,
+											valuesString,
+											columnStats->arrayTypeIoParam, -1);
+
+	deconstruct_array(DatumGetArrayTypeP(arrayDatum), columnStats->typeId,
+					  columnStats->typeLength, columnStats->typeByValue,
+					  columnStats->typeAlign, &valueArray, NULL, valueCount);
+
+	return valueArray;
+}
+
+
+/*
+ * MergedMostCommonValues merges the most common values of the shards into the
+ * most common values of the distributed table. The row counts of a value are
+ * added up across the shards, and the values with the highest row counts are
+ * kept, as many as the longest list of any shard. A value that is common in
+ * one shard, but not in the others, is undercounted, since the other shards do
+ * not report how often it appears. The function returns false if there are no
+ * most common values to store.
+ */
+static bool
+MergedMostCommonValues(DistributedColumnStats *columnStats,
+					   StatisticsSlot *statisticsSlot)
+{
+	StatisticsValue **sortedValueArray = NULL;
+	StatisticsValue **mergedValueArray = NULL;
+	int sortedValueCount = list_length(columnStats->mostCommonValueList);
+	int mergedValueCount = 0;
+	int valueIndex = 0;
+	Datum *valueArray = NULL;
+	Datum *frequencyArray = NULL;
+
+	if (sortedValueCount == 0)
+	{
+		return false;
+	}
+
+	/* combine the row counts of equal values */
+	sortedValueArray = SortedStatisticsValues(columnStats,
+											  columnStats->mostCommonValueList);
+	mergedValueArray = palloc0(sortedValueCount * sizeof(StatisticsValue *));
+
+	for (valueIndex = 0; valueIndex < sortedValueCount; valueIndex++)
+	{
+		StatisticsValue *statisticsValue = sortedValueArray[valueIndex];
+
+		if (mergedValueCount > 0 &&
+			CompareStatisticsValues(&mergedValueArray[mergedValueCount - 1],
+									&statisticsValue, columnStats) == 0)
+		{
+			mergedValueArray[mergedValueCount - 1]->rowCount +=
+				statisticsValue->rowCount;
+		}
+		else
+		{
+			mergedValueArray[mergedValueCount++] = statisticsValue;
+		}
+	}
+
+	/* keep the values with the highest row counts */
+	qsort_arg(mergedValueArray, mergedValueCount, sizeof(StatisticsValue *),
+			  CompareStatisticsValueRowCounts, columnStats);
+
+	mergedValueCount = Min(mergedValueCount, columnStats->mostCommonValueCount);
+
+	valueArray = palloc0(mergedValueCount * sizeof(Datum));
+	frequencyArray = palloc0(mergedValueCount * sizeof(Datum));
+
+	for (valueIndex = 0; valueIndex < mergedValueCount; valueIndex++)
+	{
+		StatisticsValue *statisticsValue = mergedValueArray[valueIndex];
+		double frequency = statisticsValue->rowCount / columnStats->rowCount;
+
+		valueArray[valueIndex] = statisticsValue->value;
+		frequencyArray[valueIndex] = Float4GetDatum((float4) frequency);
+	}
+
+	statisticsSlot->kind = STATISTIC_KIND_MCV;
+	statisticsSlot->operatorId = columnStats->equalityOperatorId;
+	statisticsSlot->collationId = columnStats->collationId;
+	statisticsSlot->numbers = construct_array(frequencyArray, mergedValueCount,
+											  FLOAT4OID, sizeof(float4),
+											  FLOAT4PASSBYVAL, 'i');
+	statisticsSlot->values = construct_array(valueArray, mergedValueCount,
+											 columnStats->typeId,
+											 columnStats->typeLength,
+											 columnStats->typeByValue,
+											 columnStats->typeAlign);
+
+	return true;
+}
+
+
+/*
+ * MergedHistogram merges the histograms of the shards into a histogram of the
+ * distributed table. The bounds of all shards are sorted, and the number of
+ * rows below each bound is estimated by adding up the row counts that
+ * AddShardValueStatistics attributed to the bounds. The merged histogram
+ * picks the bounds that divide the rows into equally sized buckets, using as
+ * many bounds as the largest histogram of any shard. The function returns
+ * false if there is no histogram to store.
+ */
+static bool
+MergedHistogram(DistributedColumnStats *columnStats, StatisticsSlot *statisticsSlot)
+{
+	StatisticsValue **sortedValueArray = NULL;
+	int sortedValueCount = list_length(columnStats->histogramValueList);
+	int targetBoundCount = columnStats->histogramBoundCount;
+	Datum *boundArray = NULL;
+	int boundCount = 0;
+	int boundIndex = 0;
+	int valueIndex = 0;
+	double totalRowCount = 0.0;
+	double cumulativeRowCount = 0.0;
+
+	if (sortedValueCount < 2 || targetBoundCount < 2)
+	{
+		return false;
+	}
+
+	sortedValueArray = SortedStatisticsValues(columnStats,
+											  columnStats->histogramValueList);
+
+	for (valueIndex = 0; valueIndex < sortedValueCount; valueIndex++)
+	{
+		totalRowCount += sortedValueArray[valueIndex]->rowCount;
+	}
+
+	boundArray = palloc0(targetBoundCount * sizeof(Datum));
+
+	/* the lowest and highest bounds of all shards are always kept */
+	boundArray[boundCount++] = sortedValueArray[0]->value;
+	valueIndex = 0;
+	cumulativeRowCount = sortedValueArray[0]->rowCount;
+
+	for (boundIndex = 1; boundIndex < targetBoundCount - 1; boundIndex++)
+	{
+		double targetRowCount = totalRowCount * boundIndex / (targetBoundCount - 1);
+
+		/* advance to the first bound that has at least the target row count below */
+		while (valueIndex < sortedValueCount - 2 &&
+			   cumulativeRowCount + sortedValueArray[valueIndex + 1]->rowCount <
+			   targetRowCount)
+		{
+			valueIndex++;
+			cumulativeRowCount += sortedValueArray[valueIndex]->rowCount;
+		}
+
+		if (valueIndex < sortedValueCount - 2)
+		{
+			valueIndex++;
+			cumulativeRowCount += sortedValueArray[valueIndex]->rowCount;
+			boundArray[boundCount++] = sortedValueArray[valueIndex]->value;
+		}
+	}
+
+	boundArray[boundCount++] = sortedValueArray[sortedValueCount - 1]->value;
+
+	statisticsSlot->kind = STATISTIC_KIND_HISTOGRAM;
+	statisticsSlot->operatorId = columnStats->lessThanOperatorId;
+	statisticsSlot->collationId = columnStats->collationId;
+	statisticsSlot->numbers = NULL;
+	statisticsSlot->values = construct_array(boundArray, boundCount,
+											 columnStats->typeId,
+											 columnStats->typeLength,
+											 columnStats->typeByValue,
+											 columnStats->typeAlign);
+
+	return true;
+}
+
+
+/*
+ * SortedStatisticsValues returns the values in the given list as an array that
+ * is sorted by the default btree operator class of the column type.
+ */
+static StatisticsValue **
+SortedStatisticsValues(DistributedColumnStats *columnStats, List *valueList)
+{
+	StatisticsValue **valueArray = palloc0(list_length(valueList) *
+										   sizeof(StatisticsValue *));
+	ListCell *valueCell = NULL;
+	int valueIndex = 0;
+
+	foreach(valueCell, valueList)
+	{
+		valueArray[valueIndex++] = (StatisticsValue *) lfirst(valueCell);
+	}
+
+	qsort_arg(valueArray, valueIndex, sizeof(StatisticsValue *),
+			  CompareStatisticsValues, columnStats);
+
+	return valueArray;
+}
+
+
+/*
+ * CompareStatisticsValues compares two StatisticsValue pointers by their values,
+ * using the comparison function of the column type.
+ */
+static int
+CompareStatisticsValues(const void *leftElement, const void *rightElement, void *arg)
+{
+	DistributedColumnStats *columnStats = (DistributedColumnStats *) arg;
+	StatisticsValue *leftValue = *((StatisticsValue **) leftElement);
+	StatisticsValue *rightValue = *((StatisticsValue **) rightElement);
+	Datum comparison = FunctionCall2Coll(columnStats->compareFunction,
+										 columnStats->collationId,
+										 leftValue->value, rightValue->value);
+
+	return DatumGetInt32(comparison);
+}
+
+
+/*
+ * CompareStatisticsValueRowCounts compares two StatisticsValue pointers such
+ * that the one with the higher row count comes first. Values with the same row
+ * count are ordered by their values, to keep the order deterministic.
+ */
+static int
+CompareStatisticsValueRowCounts(const void *leftElement, const void *rightElement,
+								void *arg)
+{
+	StatisticsValue *leftValue = *((StatisticsValue **) leftElement);
+	StatisticsValue *rightValue = *((StatisticsValue **) rightElement);
+
+	if (leftValue->rowCount > rightValue->rowCount)
+	{
+		return -1;
+	}
+	else if (leftValue->rowCount < rightValue->rowCount)
+	{
+		return 1;
+	}
+
+	return CompareStatisticsValues(leftElement, rightElement, arg);
+}
+
+
+/*
+ * UpdateRelationStatistics stores the number of rows and pages of a distributed
+ * table in its pg_class entry on the coordinator, the same way ANALYZE does.
+ */
+static void
+UpdateRelationStatistics(Oid relationId, double rowCount, double pageCount)
+{
+	Relation relation = relation_open(relationId, NoLock);
+	BlockNumber relationPages = (BlockNumber) Min(pageCount, (double) MaxBlockNumber);
+	BlockNumber allVisiblePages = 0;
+	bool inOuterTransaction = true;
+
+	vac_update_relstats(relation, relationPages, rowCount, allVisiblePages,
+						relation->rd_rel->relhasindex, InvalidTransactionId,
+						InvalidMultiXactId, inOuterTransaction);
+
+	relation_close(relation, NoLock);
+}
+
+
+/*
+ * UpdateColumnStatistics stores the given statistics for a column of a
+ * distributed table in pg_statistic. The given statistics slots are stored in
+ * order, and the remaining slots are cleared.
+ */
+static void
+UpdateColumnStatistics(Oid relationId, AttrNumber attributeNumber,
+					   float4 nullFraction, int32 width, float4 distinct,
+					   StatisticsSlot *statisticsSlotArray, int slotCount)
+{
+	Relation pgStatistic = heap_open(StatisticRelationId, RowExclusiveLock);
+	TupleDesc tupleDescriptor = RelationGetDescr(pgStatistic);
+	Datum values[Natts_pg_statistic];
+	bool isNulls[Natts_pg_statistic];
+	bool replace[Natts_pg_statistic];
+	HeapTuple oldTuple = NULL;
+	HeapTuple newTuple = NULL;
+	int slotIndex = 0;
+
+	memset(values, 0, sizeof(values));
+	memset(isNulls, false, sizeof(isNulls));
+	memset(replace, true, sizeof(replace));
+
+	values[Anum_pg_statistic_starelid - 1] = ObjectIdGetDatum(relationId);
+	values[Anum_pg_statistic_staattnum - 1] = Int16GetDatum(attributeNumber);
+	values[Anum_pg_statistic_stainherit - 1] = BoolGetDatum(false);
+	values[Anum_pg_statistic_stanullfrac - 1] = Float4GetDatum(nullFraction);
+	values[Anum_pg_statistic_stawidth - 1] = Int32GetDatum(width);
+	values[Anum_pg_statistic_stadistinct - 1] = Float4GetDatum(distinct);
+
+	for (slotIndex = 0; slotIndex < STATISTIC_NUM_SLOTS; slotIndex++)
+	{
+		values[Anum_pg_statistic_stakind1 - 1 + slotIndex] = Int16GetDatum(0);
+		values[Anum_pg_statistic_staop1 - 1 + slotIndex] = ObjectIdGetDatum(InvalidOid);
+#if PG_VERSION_NUM >= 120000
+		values[Anum_pg_statistic_stacoll1 - 1 + slotIndex] =
+			ObjectIdGetDatum(InvalidOid);
+#endif
+		isNulls[Anum_pg_statistic_stanumbers1 - 1 + slotIndex] = true;
+		isNulls[Anum_pg_statistic_stavalues1 - 1 + slotIndex] = true;
+	}
+
+	for (slotIndex = 0; slotIndex < slotCount; slotIndex++)
+	{
+		StatisticsSlot *statisticsSlot = &statisticsSlotArray[slotIndex];
+
+		values[Anum_pg_statistic_stakind1 - 1 + slotIndex] =
+			Int16GetDatum(statisticsSlot->kind);
+		values[Anum_pg_statistic_staop1 - 1 + slotIndex] =
+			ObjectIdGetDatum(statisticsSlot->operatorId);
+#if PG_VERSION_NUM >= 120000
+		values[Anum_pg_statistic_stacoll1 - 1 + slotIndex] =
+			ObjectIdGetDatum(statisticsSlot->collationId);
+#endif
+
+		if (statisticsSlot->numbers != NULL)
+		{
+			values[Anum_pg_statistic_stanumbers1 - 1 + slotIndex] =
+				PointerGetDatum(statisticsSlot->numbers);
+			isNulls[Anum_pg_statistic_stanumbers1 - 1 + slotIndex] = false;
+		}
+
+		values[Anum_pg_statistic_stavalues1 - 1 + slotIndex] =
+			PointerGetDatum(statisticsSlot->values);
+		isNulls[Anum_pg_statistic_stavalues1 - 1 + slotIndex] = false;
+	}
+
+	oldTuple = SearchSysCache3(STATRELATTINH, ObjectIdGetDatum(relationId),
+							   Int16GetDatum(attributeNumber), BoolGetDatum(false));
+	if (HeapTupleIsValid(oldTuple))
+	{
+		newTuple = heap_modify_tuple(oldTuple, tupleDescriptor, values, isNulls,
+									 replace);
+		ReleaseSysCache(oldTuple);
+		CatalogTupleUpdate(pgStatistic, &newTuple->t_self, newTuple);
+	}
+	else
+	{
+		newTuple = heap_form_tuple(tupleDescriptor, values, isNulls);
+		CatalogTupleInsert(pgStatistic, newTuple);
+	}
+
+	heap_freetuple(newTuple);
+	heap_close(pgStatistic, RowExclusiveLock);
+}
+
+
 /*
  * DeparseVacuumStmtPrefix returns a StringInfo appropriate for use as a prefix
  * during distributed execution of a VACUUM or ANALYZE statement. Callers may
@@ -110,7 +110,9 @@
  * which indicates that we should use at most one connection per node, but
  * can run tasks in parallel across nodes. This is used when there are
  * writes to a reference table that has foreign keys from a distributed
- * table.
+ * table. In that mode, citus.sequential_command_batch_size allows the
+ * commands of several modify tasks to be sent over a connection in a
+ * single round trip, after which their results are read in order.
  *
  * Execution finishes when all tasks are done, the query errors out, or
  * the user cancels the query.
@@ -145,11 +147,13 @@
 #include "distributed/relation_access_tracking.h"
 #include "distributed/remote_commands.h"
 #include "distributed/resource_lock.h"
+#include "distributed/shard_column_ranges.h"
 #include "distributed/subplan_execution.h"
 #include "distributed/transaction_management.h"
 #include "distributed/worker_protocol.h"
 #include "distributed/version_compat.h"
 #include "lib/ilist.h"
+#include "lib/stringinfo.h"
 #include "storage/fd.h"
 #include "storage/latch.h"
 #include "utils/int8.h"
@@ -247,6 +251,12 @@ typedef struct DistributedExecution
 	 */
 	bool isTransaction;
 
+	/*
+	 * Flag to indicate whether several commands can be sent over a
+	 * connection in a single round trip.
+	 */
+	bool batchCommands;
+
 	/* indicates whether distributed execution has failed */
 	bool failed;
 
@@ -277,6 +287,9 @@ typedef struct DistributedExecution
 	 */
 	AttInMetadata *attributeInputMetadata;
 	char **columnArray;
+
+	/* progress of the tasks in task list order, updated during execution if set */
+	TaskProgress *taskProgressArray;
 } DistributedExecution;
 
 /*
@@ -405,6 +418,12 @@ typedef struct WorkerSession
 	/* task the worker should work on or NULL */
 	struct TaskPlacementExecution *currentTask;
 
+	/*
+	 * Tasks whose commands were sent after the command of currentTask in the
+	 * same round trip, in the order in which their results will arrive.
+	 */
+	List *batchedTaskList;
+
 	/*
 	 * The number of commands sent to the worker over the session. Excludes
 	 * distributed transaction related commands such as BEGIN/COMMIT etc.
@@ -472,6 +491,9 @@ typedef struct ShardCommandExecution
 	bool gotResults;
 
 	TaskExecutionState executionState;
+
+	/* progress of the task, or NULL if the caller does not track progress */
+	TaskProgress *progress;
 } ShardCommandExecution;
 
 /*
@@ -532,6 +554,9 @@ int MaxAdaptiveExecutorPoolSize = 16;
 /* GUC, number of ms to wait between opening connections to the same worker */
 int ExecutorSlowStartInterval = 10;
 
+/* GUC, number of commands to send over a connection at once in sequential mode */
+int SequentialCommandBatchSize = 1;
+
 
 /* local functions */
 static DistributedExecution * CreateDistributedExecution(RowModifyLevel modLevel,
@@ -556,6 +581,7 @@ static void AdjustDistributedExecutionAfterLocalExecution(DistributedExecution *
 														  execution);
 static bool DistributedExecutionModifiesDatabase(DistributedExecution *execution);
 static bool TaskListModifiesDatabase(RowModifyLevel modLevel, List *taskList);
+static bool ShouldBatchCommands(DistributedExecution *execution, List *taskList);
 static bool DistributedExecutionRequiresRollback(DistributedExecution *execution);
 static bool TaskListRequires2PC(List *taskList);
 static bool SelectForUpdateOnReferenceTable(RowModifyLevel modLevel, List *taskList);
@@ -579,6 +605,8 @@ static TaskPlacementExecution * PopAssignedPlacementExecution(WorkerSession *ses
 static TaskPlacementExecution * PopUnassignedPlacementExecution(WorkerPool *workerPool);
 static bool StartPlacementExecutionOnSession(TaskPlacementExecution *placementExecution,
 											 WorkerSession *session);
+static char * AddBatchedCommands(WorkerSession *session, char *queryString);
+static char * TaskQueryStringForPlacement(Task *task, int placementIndex);
 static void ConnectionStateMachine(WorkerSession *session);
 static void Activate2PCIfModifyingTransactionExpandsToNewNode(WorkerSession *session);
 static bool TransactionModifiedDistributedTable(DistributedExecution *execution);
@@ -636,6 +664,12 @@ AdaptiveExecutor(CitusScanState *scanState)
 
 	ExecuteSubPlans(distributedPlan);
 
+	if (distributedPlan->modLevel == ROW_MODIFY_READONLY)
+	{
+		/* skip shards that cannot match based on the tracked column ranges */
+		taskList = PruneTaskListByShardColumnRanges(job, taskList);
+	}
+
 	if (MultiShardConnectionType == SEQUENTIAL_CONNECTION)
 	{
 		/* defer decision after ExecuteSubPlans() */
@@ -808,6 +842,42 @@ ExecuteTaskListExtended(RowModifyLevel modLevel, List *taskList,
 }
 
 
+/*
+ * ExecuteUtilityTaskListWithProgress executes the given utility tasks with at
+ * most targetPoolSize connections per worker, and keeps taskProgressArray
+ * up-to-date while doing so. The array should have an element for each task,
+ * in task list order, and typically lives in a progress monitor such that
+ * other backends can follow the execution.
+ */
+void
+ExecuteUtilityTaskListWithProgress(List *taskList, int targetPoolSize,
+								   TaskProgress *taskProgressArray)
+{
+	DistributedExecution *execution = NULL;
+	TupleDesc tupleDescriptor = NULL;
+	Tuplestorestate *tupleStore = NULL;
+	ParamListInfo paramListInfo = NULL;
+	bool hasReturning = false;
+
+	ErrorIfLocalExecutionHappened();
+
+	if (MultiShardConnectionType == SEQUENTIAL_CONNECTION)
+	{
+		targetPoolSize = 1;
+	}
+
+	execution =
+		CreateDistributedExecution(ROW_MODIFY_NONE, taskList, hasReturning,
+								   paramListInfo, tupleDescriptor, tupleStore,
+								   targetPoolSize);
+	execution->taskProgressArray = taskProgressArray;
+
+	StartDistributedExecution(execution);
+	RunDistributedExecution(execution);
+	FinishDistributedExecution(execution);
+}
+
+
 /*
  * CreateDistributedExecution creates a distributed execution data structure for
  * a distributed plan.
@@ -846,6 +916,12 @@ CreateDistributedExecution(RowModifyLevel modLevel, List *taskList, bool hasRetu
 	execution->connectionSetChanged = false;
 	execution->waitFlagsChanged = false;
 
+	if (modLevel != ROW_MODIFY_READONLY)
+	{
+		/* the shards that we write to might get values outside their ranges */
+		RecordTaskListShardModifications(taskList);
+	}
+
 	/* allocate execution specific data once, on the ExecutorState memory context */
 	if (tupleDescriptor != NULL)
 	{
@@ -897,7 +973,7 @@ StartDistributedExecution(DistributedExecution *execution)
 		{
 			BeginOrContinueCoordinatedTransaction();
 
-			if (TaskListRequires2PC(taskList) || LocalExecutionHappened)
+			if (TaskListRequires2PC(taskList))
 			{
 				/*
 				 * Although using two phase commit protocol is an independent decision than
@@ -909,6 +985,18 @@ StartDistributedExecution(DistributedExecution *execution)
 
 				execution->errorOnAnyFailure = true;
 			}
+			else if (LocalExecutionHappened)
+			{
+				/*
+				 * Local execution by itself does not need 2PC, it only expands the
+				 * transaction to more connections. Hence, the transaction may still
+				 * commit with 1PC if a single connection ends up modifying data, see
+				 * citus.prefer_one_phase_commit.
+				 */
+				CoordinatedTransactionShouldUse2PC();
+
+				execution->errorOnAnyFailure = true;
+			}
 			else if (MultiShardCommitProtocol != COMMIT_PROTOCOL_2PC &&
 					 list_length(taskList) > 1 &&
 					 DistributedExecutionModifiesDatabase(execution))
@@ -947,6 +1035,12 @@ StartDistributedExecution(DistributedExecution *execution)
 	 */
 	execution->isTransaction = InCoordinatedTransaction();
 
+	/*
+	 * In sequential mode, we can send the commands of multiple tasks over the
+	 * connection to a node before reading the results.
+	 */
+	execution->batchCommands = ShouldBatchCommands(execution, taskList);
+
 	/*
 	 * We should not record parallel access if the target pool size is less than 2.
 	 * The reason is that we define parallel access as at least two connections
@@ -1016,6 +1110,49 @@ TaskListModifiesDatabase(RowModifyLevel modLevel, List *taskList)
 }
 
 
+/*
+ * ShouldBatchCommands returns whether the execution can send the commands of
+ * several tasks over a connection in a single round trip, which
+ * citus.sequential_command_batch_size enables for modifications in sequential
+ * mode. The commands are concatenated into a single query string, so they
+ * cannot have parameters, and they need to run in a transaction block such
+ * that a failing command rolls back the commands before it.
+ *
+ * The result of each statement in the batch is attributed to the next task,
+ * which is only correct if every task consists of a single statement, as is
+ * the case for the deparsed queries of modify tasks.
+ */
+static bool
+ShouldBatchCommands(DistributedExecution *execution, List *taskList)
+{
+	ListCell *taskCell = NULL;
+
+	if (SequentialCommandBatchSize <= 1 ||
+		MultiShardConnectionType != SEQUENTIAL_CONNECTION)
+	{
+		return false;
+	}
+
+	if (!execution->isTransaction || execution->paramListInfo != NULL ||
+		execution->hasReturning || execution->modLevel == ROW_MODIFY_READONLY)
+	{
+		return false;
+	}
+
+	foreach(taskCell, taskList)
+	{
+		Task *task = (Task *) lfirst(taskCell);
+
+		if (task->taskType != MODIFY_TASK || task->queryString == NULL)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
 /*
  * DistributedExecutionRequiresRollback returns true if the distributed
  * execution should start a CoordinatedTransaction. In other words, if the
@@ -1437,6 +1574,7 @@ AssignTasksToConnections(DistributedExecution *execution)
 
 	ListCell *taskCell = NULL;
 	ListCell *sessionCell = NULL;
+	int taskIndex = 0;
 
 	foreach(taskCell, taskList)
 	{
@@ -1460,6 +1598,13 @@ AssignTasksToConnections(DistributedExecution *execution)
 												sizeof(TaskPlacementExecution *));
 		shardCommandExecution->placementExecutionCount = placementExecutionCount;
 
+		if (execution->taskProgressArray != NULL)
+		{
+			shardCommandExecution->progress = &execution->taskProgressArray[taskIndex];
+		}
+
+		taskIndex++;
+
 		shardCommandExecution->expectResults =
 			(hasReturning && !task->partiallyLocalOrRemote) ||
 			modLevel == ROW_MODIFY_READONLY;
@@ -1730,6 +1875,7 @@ FindOrCreateWorkerSession(WorkerPool *workerPool, MultiConnection *connection)
 	session->connection = connection;
 	session->workerPool = workerPool;
 	session->commandsSent = 0;
+	session->batchedTaskList = NIL;
 	dlist_init(&session->pendingTaskQueue);
 	dlist_init(&session->readyTaskQueue);
 
@@ -2564,7 +2710,7 @@ Activate2PCIfModifyingTransactionExpandsToNewNode(WorkerSession *session)
 		 * just opened, which means we're now going to make modifications
 		 * over multiple connections. Activate 2PC!
 		 */
-		CoordinatedTransactionUse2PC();
+		CoordinatedTransactionShouldUse2PC();
 	}
 }
 
@@ -2764,6 +2910,28 @@ TransactionStateMachine(WorkerSession *session)
 				}
 
 				shardCommandExecution->gotResults = true;
+
+				if (session->batchedTaskList != NIL)
+				{
+					/*
+					 * The results of the next batched command follow the results
+					 * of the current one, so we can finish the current task
+					 * without waiting for the end of the response.
+					 */
+					MarkRemoteTransactionCritical(connection);
+
+					session->currentTask = linitial(session->batchedTaskList);
+					session->batchedTaskList =
+						list_delete_first(session->batchedTaskList);
+
+					PlacementExecutionDone(placementExecution, true);
+
+					/* wake up WaitEventSetWait, the results might already be read */
+					UpdateConnectionWaitFlags(session,
+											  WL_SOCKET_READABLE | WL_SOCKET_WRITEABLE);
+					break;
+				}
+
 				transaction->transactionState = REMOTE_TRANS_CLEARING_RESULTS;
 				break;
 			}
@@ -2961,7 +3129,8 @@ StartPlacementExecutionOnSession(TaskPlacementExecution *placementExecution,
 	Task *task = shardCommandExecution->task;
 	ShardPlacement *taskPlacement = placementExecution->shardPlacement;
 	List *placementAccessList = PlacementAccessListForTask(task, taskPlacement);
-	char *queryString = task->queryString;
+	char *queryString =
+		TaskQueryStringForPlacement(task, placementExecution->placementExecutionIndex);
 	int querySent = 0;
 	int singleRowMode = 0;
 
@@ -2985,6 +3154,11 @@ StartPlacementExecutionOnSession(TaskPlacementExecution *placementExecution,
 	session->currentTask = placementExecution;
 	placementExecution->executionState = PLACEMENT_EXECUTION_RUNNING;
 
+	if (shardCommandExecution->progress != NULL)
+	{
+		shardCommandExecution->progress->state = TASK_PROGRESS_RUNNING;
+	}
+
 	if (paramListInfo != NULL)
 	{
 		int parameterCount = paramListInfo->numParams;
@@ -3001,6 +3175,11 @@ StartPlacementExecutionOnSession(TaskPlacementExecution *placementExecution,
 	}
 	else
 	{
+		if (execution->batchCommands)
+		{
+			queryString = AddBatchedCommands(session, queryString);
+		}
+
 		querySent = SendRemoteCommand(connection, queryString);
 	}
 
@@ -3021,6 +3200,98 @@ StartPlacementExecutionOnSession(TaskPlacementExecution *placementExecution,
 }
 
 
+/*
+ * AddBatchedCommands pops up to citus.sequential_command_batch_size - 1 more
+ * placement executions that are ready to run on the session and returns the
+ * given query string followed by their commands, such that all of them are
+ * sent to the worker in a single round trip. The placement executions are
+ * kept in the batchedTaskList of the session and TransactionStateMachine
+ * finishes them in order as their results arrive.
+ */
+static char *
+AddBatchedCommands(WorkerSession *session, char *queryString)
+{
+	WorkerPool *workerPool = session->workerPool;
+	MultiConnection *connection = session->connection;
+	StringInfo batchedQueryString = NULL;
+
+	Assert(session->batchedTaskList == NIL);
+
+	while (list_length(session->batchedTaskList) + 1 < SequentialCommandBatchSize)
+	{
+		TaskPlacementExecution *placementExecution = PopPlacementExecution(session);
+		ShardCommandExecution *shardCommandExecution = NULL;
+		Task *task = NULL;
+		List *placementAccessList = NIL;
+		int placementIndex = 0;
+
+		if (placementExecution == NULL)
+		{
+			/* no more tasks are ready to be executed on this session */
+			break;
+		}
+
+		shardCommandExecution = placementExecution->shardCommandExecution;
+		task = shardCommandExecution->task;
+		placementIndex = placementExecution->placementExecutionIndex;
+		placementAccessList =
+			PlacementAccessListForTask(task, placementExecution->shardPlacement);
+
+		/* same bookkeeping as StartPlacementExecutionOnSession */
+		AssignPlacementListToConnection(placementAccessList, connection);
+
+		session->commandsSent++;
+		placementExecution->executionState = PLACEMENT_EXECUTION_RUNNING;
+
+		if (shardCommandExecution->progress != NULL)
+		{
+			shardCommandExecution->progress->state = TASK_PROGRESS_RUNNING;
+		}
+
+		if (batchedQueryString == NULL)
+		{
+			batchedQueryString = makeStringInfo();
+			appendStringInfoString(batchedQueryString, queryString);
+		}
+
+		appendStringInfo(batchedQueryString, "; %s",
+						 TaskQueryStringForPlacement(task, placementIndex));
+
+		session->batchedTaskList = lappend(session->batchedTaskList,
+										   placementExecution);
+	}
+
+	if (batchedQueryString == NULL)
+	{
+		return queryString;
+	}
+
+	ereport(DEBUG4, (errmsg("sending %d commands to %s:%d in a single round trip",
+							list_length(session->batchedTaskList) + 1,
+							workerPool->nodeName, workerPool->nodePort)));
+
+	return batchedQueryString->data;
+}
+
+
+/*
+ * TaskQueryStringForPlacement returns the query string that should be sent to
+ * the placement with the given index in the placement list of the task.
+ */
+static char *
+TaskQueryStringForPlacement(Task *task, int placementIndex)
+{
+	if (task->perPlacementQueryStrings != NIL)
+	{
+		Assert(list_length(task->perPlacementQueryStrings) > placementIndex);
+
+		return strVal(list_nth(task->perPlacementQueryStrings, placementIndex));
+	}
+
+	return task->queryString;
+}
+
+
 /*
  * ReceiveResults reads the result of a command or query and writes returned
  * rows to the tuple store of the scan state. It returns whether fetching results
@@ -3272,6 +3543,7 @@ WorkerSessionFailed(WorkerSession *session)
 {
 	TaskPlacementExecution *placementExecution = session->currentTask;
 	bool succeeded = false;
+	ListCell *taskCell = NULL;
 	dlist_iter iter;
 
 	if (placementExecution != NULL)
@@ -3280,6 +3552,15 @@ WorkerSessionFailed(WorkerSession *session)
 		PlacementExecutionDone(placementExecution, succeeded);
 	}
 
+	foreach(taskCell, session->batchedTaskList)
+	{
+		placementExecution = (TaskPlacementExecution *) lfirst(taskCell);
+
+		PlacementExecutionDone(placementExecution, succeeded);
+	}
+
+	session->batchedTaskList = NIL;
+
 	dlist_foreach(iter, &session->pendingTaskQueue)
 	{
 		placementExecution =
@@ -3319,6 +3600,11 @@ PlacementExecutionDone(TaskPlacementExecution *placementExecution, bool succeede
 	if (succeeded)
 	{
 		placementExecution->executionState = PLACEMENT_EXECUTION_FINISHED;
+
+		if (shardCommandExecution->progress != NULL)
+		{
+			shardCommandExecution->progress->finishedPlacementCount++;
+		}
 	}
 	else
 	{
@@ -3367,12 +3653,23 @@ PlacementExecutionDone(TaskPlacementExecution *placementExecution, bool succeede
 	if (newExecutionState == TASK_EXECUTION_FINISHED)
 	{
 		execution->unfinishedTaskCount--;
+
+		if (shardCommandExecution->progress != NULL)
+		{
+			shardCommandExecution->progress->state = TASK_PROGRESS_FINISHED;
+		}
+
 		return;
 	}
 	else if (newExecutionState == TASK_EXECUTION_FAILED)
 	{
 		execution->unfinishedTaskCount--;
 
+		if (shardCommandExecution->progress != NULL)
+		{
+			shardCommandExecution->progress->state = TASK_PROGRESS_FAILED;
+		}
+
 		/*
 		 * Even if a single task execution fails, there is no way to
 		 * successfully finish the execution.
@@ -19,6 +19,7 @@
 #include "distributed/distributed_execution_locks.h"
 #include "distributed/insert_select_executor.h"
 #include "distributed/insert_select_planner.h"
+#include "distributed/local_plan_cache.h"
 #include "distributed/multi_executor.h"
 #include "distributed/multi_server_executor.h"
 #include "distributed/multi_router_planner.h"
@@ -42,6 +43,7 @@ static void CitusBeginScan(CustomScanState *node, EState *estate, int eflags);
 static void CitusModifyBeginScan(CustomScanState *node, EState *estate, int eflags);
 static void CitusEndScan(CustomScanState *node);
 static void CitusReScan(CustomScanState *node);
+static DistributedPlan * CopyDistributedPlanWithoutCache(DistributedPlan *distributedPlan);
 
 
 /* create custom scan methods for all executors */
@@ -134,6 +136,19 @@ CitusBeginScan(CustomScanState *node, EState *estate, int eflags)
 	if (distributedPlan->modLevel == ROW_MODIFY_READONLY ||
 		distributedPlan->insertSelectSubquery != NULL)
 	{
+		Job *workerJob = distributedPlan->workerJob;
+
+		if (scanState->executorType == MULTI_EXECUTOR_ADAPTIVE &&
+			IsLocalPlanCachingSupported(workerJob, distributedPlan))
+		{
+			Task *task = (Task *) linitial(workerJob->taskList);
+
+			CacheLocalPlanForShardQuery(task, distributedPlan,
+										estate->es_param_list_info);
+		}
+
+		distributedPlan->numberOfTimesExecuted++;
+
 		/* no more action required */
 		return;
 	}
@@ -179,6 +194,7 @@ static void
 CitusModifyBeginScan(CustomScanState *node, EState *estate, int eflags)
 {
 	CitusScanState *scanState = (CitusScanState *) node;
+	DistributedPlan *originalDistributedPlan = scanState->distributedPlan;
 	DistributedPlan *distributedPlan = NULL;
 	Job *workerJob = NULL;
 	Query *jobQuery = NULL;
@@ -189,7 +205,8 @@ CitusModifyBeginScan(CustomScanState *node, EState *estate, int eflags)
 	 * executions of a prepared statement. Instead we create a deep copy that we only
 	 * use for the current execution.
 	 */
-	distributedPlan = scanState->distributedPlan = copyObject(scanState->distributedPlan);
+	distributedPlan = CopyDistributedPlanWithoutCache(originalDistributedPlan);
+	scanState->distributedPlan = distributedPlan;
 
 	workerJob = distributedPlan->workerJob;
 	jobQuery = workerJob->jobQuery;
@@ -240,6 +257,61 @@ CitusModifyBeginScan(CustomScanState *node, EState *estate, int eflags)
 
 	/* modify tasks are always assigned using first-replica policy */
 	workerJob->taskList = FirstReplicaAssignTaskList(taskList);
+
+	/*
+	 * The local plans are cached in the original distributed plan, such that
+	 * the next executions of the same plan can use them as well.
+	 */
+	if (scanState->executorType == MULTI_EXECUTOR_ADAPTIVE &&
+		IsLocalPlanCachingSupported(workerJob, originalDistributedPlan))
+	{
+		Task *task = (Task *) linitial(workerJob->taskList);
+
+		CacheLocalPlanForShardQuery(task, originalDistributedPlan,
+									estate->es_param_list_info);
+	}
+
+	if (originalDistributedPlan->workerJob != NULL)
+	{
+		workerJob->localPlannedStatements =
+			originalDistributedPlan->workerJob->localPlannedStatements;
+	}
+
+	/*
+	 * In case of a prepared statement, we see the same distributed plan again
+	 * on the next execution, with a higher counter.
+	 */
+	originalDistributedPlan->numberOfTimesExecuted++;
+}
+
+
+/*
+ * CopyDistributedPlanWithoutCache is a helper function which copies the
+ * distributedPlan into the current memory context. The local plans cached in
+ * the worker job are not copied, since they can be large and are only read
+ * during the execution.
+ */
+static DistributedPlan *
+CopyDistributedPlanWithoutCache(DistributedPlan *distributedPlan)
+{
+	Job *workerJob = distributedPlan->workerJob;
+	List *localPlannedStatements = NIL;
+	DistributedPlan *distributedPlanCopy = NULL;
+
+	if (workerJob != NULL)
+	{
+		localPlannedStatements = workerJob->localPlannedStatements;
+		workerJob->localPlannedStatements = NIL;
+	}
+
+	distributedPlanCopy = copyObject(distributedPlan);
+
+	if (workerJob != NULL)
+	{
+		workerJob->localPlannedStatements = localPlannedStatements;
+	}
+
+	return distributedPlanCopy;
 }
 
 
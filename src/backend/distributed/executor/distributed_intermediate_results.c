@@ -0,0 +1,481 @@
+/*-------------------------------------------------------------------------
+ *
+ * distributed_intermediate_results.c
+ *   Functions for reading and writing distributed intermediate results.
+ *
+ * Copyright (c) Citus Data, Inc.
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+#include "funcapi.h"
+#include "miscadmin.h"
+
+#include "access/htup_details.h"
+#include "catalog/pg_type.h"
+#include "distributed/intermediate_results.h"
+#include "distributed/master_metadata_utility.h"
+#include "distributed/metadata_cache.h"
+#include "distributed/multi_executor.h"
+#include "distributed/multi_physical_planner.h"
+#include "distributed/pg_dist_partition.h"
+#include "distributed/resource_lock.h"
+#include "distributed/transaction_management.h"
+#include "distributed/tuplestore.h"
+#include "distributed/version_compat.h"
+#include "lib/stringinfo.h"
+#include "utils/builtins.h"
+#include "utils/lsyscache.h"
+
+
+/*
+ * DistributedResultFragment represents a fragment of a distributed result,
+ * which is an intermediate result on a single worker that contains the rows
+ * of a single task for a single target shard.
+ */
+typedef struct DistributedResultFragment
+{
+	/* result ID of the fragment on the worker */
+	char *resultId;
+
+	/* location of the fragment */
+	char *nodeName;
+	uint32 nodePort;
+
+	/* index of the target shard the rows in the fragment belong to */
+	int targetShardIndex;
+} DistributedResultFragment;
+
+
+/*
+ * NodeToNodeFragmentsTransfer is a set of fragments that need to be fetched
+ * from one worker to another.
+ */
+typedef struct NodeToNodeFragmentsTransfer
+{
+	char *sourceNodeName;
+	uint32 sourceNodePort;
+
+	/* a placement on the target node, used for connection management */
+	ShardPlacement *targetPlacement;
+
+	List *resultIdList;
+} NodeToNodeFragmentsTransfer;
+
+
+static List * PartitionTaskListResults(char *resultIdPrefix, List *selectTaskList,
+									   int partitionColumnIndex,
+									   DistTableCacheEntry *targetRelation);
+static void ShardMinMaxValueArrays(DistTableCacheEntry *targetRelation,
+								   StringInfo minValuesString,
+								   StringInfo maxValuesString);
+static void AppendShardValueArray(StringInfo arrayString, Datum *valueArray,
+								  bool *valueIsNullArray, int valueCount,
+								  Oid valueTypeId);
+static Task * WrapTaskInPartitionQuery(Task *selectTask, int taskIndex,
+									   char *resultIdPrefix, int partitionColumnIndex,
+									   DistTableCacheEntry *targetRelation,
+									   char *minValuesString, char *maxValuesString);
+static List * ColocationTransfers(List *fragmentList, List **shardPlacementLists);
+static Task * FragmentTransferTask(NodeToNodeFragmentsTransfer *transfer);
+
+
+/*
+ * RedistributeTaskListResults partitions the results of the given select
+ * tasks on the workers according to the shard ranges of the target relation,
+ * and then moves the partitions to the workers that hold the corresponding
+ * target shard placements. The data is fetched directly between the workers,
+ * the coordinator only orchestrates the transfers.
+ *
+ * The function returns an array of lists of result IDs, indexed by target
+ * shard index. Each list contains the result IDs that should be read to
+ * construct the rows belonging to that shard. The lists of shards that do
+ * not receive any rows are NIL.
+ */
+List **
+RedistributeTaskListResults(char *resultIdPrefix, List *selectTaskList,
+							int partitionColumnIndex,
+							DistTableCacheEntry *targetRelation)
+{
+	int shardCount = targetRelation->shardIntervalArrayLength;
+	List **shardResultIdList = palloc0(shardCount * sizeof(List *));
+	List **shardPlacementLists = palloc0(shardCount * sizeof(List *));
+	List *fragmentList = NIL;
+	List *transferList = NIL;
+	List *fetchTaskList = NIL;
+	ListCell *fragmentCell = NULL;
+	ListCell *transferCell = NULL;
+	int shardIndex = 0;
+
+	/*
+	 * Intermediate results are only visible to backends that are part of the
+	 * same distributed transaction, so make sure we have one before sending
+	 * any commands.
+	 */
+	BeginOrContinueCoordinatedTransaction();
+
+	fragmentList = PartitionTaskListResults(resultIdPrefix, selectTaskList,
+											partitionColumnIndex, targetRelation);
+
+	for (shardIndex = 0; shardIndex < shardCount; shardIndex++)
+	{
+		ShardInterval *shardInterval =
+			targetRelation->sortedShardIntervalArray[shardIndex];
+		uint64 shardId = shardInterval->shardId;
+
+		LockShardDistributionMetadata(shardId, ShareLock);
+		shardPlacementLists[shardIndex] = FinalizedShardPlacementList(shardId);
+	}
+
+	transferList = ColocationTransfers(fragmentList, shardPlacementLists);
+	foreach(transferCell, transferList)
+	{
+		NodeToNodeFragmentsTransfer *transfer =
+			(NodeToNodeFragmentsTransfer *) lfirst(transferCell);
+
+		fetchTaskList = lappend(fetchTaskList, FragmentTransferTask(transfer));
+	}
+
+	if (fetchTaskList != NIL)
+	{
+		ExecuteTaskList(ROW_MODIFY_NONE, fetchTaskList, MaxAdaptiveExecutorPoolSize);
+	}
+
+	foreach(fragmentCell, fragmentList)
+	{
+		DistributedResultFragment *fragment =
+			(DistributedResultFragment *) lfirst(fragmentCell);
+		int targetShardIndex = fragment->targetShardIndex;
+
+		shardResultIdList[targetShardIndex] =
+			lappend(shardResultIdList[targetShardIndex], fragment->resultId);
+	}
+
+	return shardResultIdList;
+}
+
+
+/*
+ * PartitionTaskListResults wraps each of the select tasks in a call to
+ * worker_partition_query_result(), executes the wrapped tasks, and returns
+ * the list of non-empty fragments that were written on the workers.
+ */
+static List *
+PartitionTaskListResults(char *resultIdPrefix, List *selectTaskList,
+						 int partitionColumnIndex,
+						 DistTableCacheEntry *targetRelation)
+{
+	StringInfo minValuesString = makeStringInfo();
+	StringInfo maxValuesString = makeStringInfo();
+	List *wrappedTaskList = NIL;
+	List *fragmentList = NIL;
+	ListCell *taskCell = NULL;
+	TupleDesc resultDescriptor = NULL;
+	Tuplestorestate *resultStore = NULL;
+	TupleTableSlot *slot = NULL;
+	int taskIndex = 0;
+	bool randomAccess = false;
+	bool interTransactions = false;
+	bool hasReturning = false;
+
+	ShardMinMaxValueArrays(targetRelation, minValuesString, maxValuesString);
+
+	foreach(taskCell, selectTaskList)
+	{
+		Task *selectTask = (Task *) lfirst(taskCell);
+		Task *wrappedTask = WrapTaskInPartitionQuery(selectTask, taskIndex,
+													 resultIdPrefix,
+													 partitionColumnIndex,
+													 targetRelation,
+													 minValuesString->data,
+													 maxValuesString->data);
+
+		wrappedTaskList = lappend(wrappedTaskList, wrappedTask);
+		taskIndex++;
+	}
+
+	/*
+	 * Each wrapped task returns (task_index, placement_index, partition_index,
+	 * rows_written), where placement_index is the placement it ran on.
+	 */
+#if PG_VERSION_NUM >= 120000
+	resultDescriptor = CreateTemplateTupleDesc(4);
+#else
+	resultDescriptor = CreateTemplateTupleDesc(4, false);
+#endif
+	TupleDescInitEntry(resultDescriptor, (AttrNumber) 1, "task_index", INT4OID, -1, 0);
+	TupleDescInitEntry(resultDescriptor, (AttrNumber) 2, "placement_index", INT4OID,
+					   -1, 0);
+	TupleDescInitEntry(resultDescriptor, (AttrNumber) 3, "partition_index", INT4OID,
+					   -1, 0);
+	TupleDescInitEntry(resultDescriptor, (AttrNumber) 4, "rows_written", INT8OID, -1,
+					   0);
+
+	resultStore = tuplestore_begin_heap(randomAccess, interTransactions, work_mem);
+
+	ExecuteTaskListExtended(ROW_MODIFY_READONLY, wrappedTaskList, resultDescriptor,
+							resultStore, hasReturning, MaxAdaptiveExecutorPoolSize);
+
+	slot = MakeSingleTupleTableSlotCompat(resultDescriptor, &TTSOpsMinimalTuple);
+
+	while (tuplestore_gettupleslot(resultStore, true, false, slot))
+	{
+		bool isNull = false;
+		int resultTaskIndex = DatumGetInt32(slot_getattr(slot, 1, &isNull));
+		int placementIndex = DatumGetInt32(slot_getattr(slot, 2, &isNull));
+		int partitionIndex = DatumGetInt32(slot_getattr(slot, 3, &isNull));
+		Task *wrappedTask = (Task *) list_nth(wrappedTaskList, resultTaskIndex);
+		ShardPlacement *placement =
+			(ShardPlacement *) list_nth(wrappedTask->taskPlacementList, placementIndex);
+		DistributedResultFragment *fragment =
+			palloc0(sizeof(DistributedResultFragment));
+		StringInfo resultId = makeStringInfo();
+
+		appendStringInfo(resultId, "%s_%d_%d", resultIdPrefix, wrappedTask->taskId,
+						 partitionIndex);
+
+		fragment->resultId = resultId->data;
+		fragment->nodeName = placement->nodeName;
+		fragment->nodePort = placement->nodePort;
+		fragment->targetShardIndex = partitionIndex;
+
+		fragmentList = lappend(fragmentList, fragment);
+
+		ExecClearTuple(slot);
+	}
+
+	ExecDropSingleTupleTableSlot(slot);
+	tuplestore_end(resultStore);
+
+	return fragmentList;
+}
+
+
+/*
+ * ShardMinMaxValueArrays writes text[] literals that contain the min and max
+ * values of the shards of the target relation into the given strings.
+ */
+static void
+ShardMinMaxValueArrays(DistTableCacheEntry *targetRelation,
+					   StringInfo minValuesString, StringInfo maxValuesString)
+{
+	int shardCount = targetRelation->shardIntervalArrayLength;
+	Datum *minValues = palloc0(shardCount * sizeof(Datum));
+	bool *minValueNulls = palloc0(shardCount * sizeof(bool));
+	Datum *maxValues = palloc0(shardCount * sizeof(Datum));
+	bool *maxValueNulls = palloc0(shardCount * sizeof(bool));
+	Oid valueTypeId = InvalidOid;
+	int shardIndex = 0;
+
+	for (shardIndex = 0; shardIndex < shardCount; shardIndex++)
+	{
+		ShardInterval *shardInterval =
+			targetRelation->sortedShardIntervalArray[shardIndex];
+
+		minValues[shardIndex] = shardInterval->minValue;
+		minValueNulls[shardIndex] = !shardInterval->minValueExists;
+		maxValues[shardIndex] = shardInterval->maxValue;
+		maxValueNulls[shardIndex] = !shardInterval->maxValueExists;
+
+		valueTypeId = shardInterval->valueTypeId;
+	}
+
+	AppendShardValueArray(minValuesString, minValues, minValueNulls, shardCount,
+						  valueTypeId);
+	AppendShardValueArray(maxValuesString, maxValues, maxValueNulls, shardCount,
+						  valueTypeId);
+}
+
+
+/*
+ * AppendShardValueArray appends an ARRAY[...]::text[] expression that contains
+ * the text representations of the given values to arrayString.
+ */
+static void
+AppendShardValueArray(StringInfo arrayString, Datum *valueArray, bool *valueIsNullArray,
+					  int valueCount, Oid valueTypeId)
+{
+	Oid outputFunctionId = InvalidOid;
+	bool typeVarLength = false;
+	int valueIndex = 0;
+
+	getTypeOutputInfo(valueTypeId, &outputFunctionId, &typeVarLength);
+
+	appendStringInfoString(arrayString, "ARRAY[");
+
+	for (valueIndex = 0; valueIndex < valueCount; valueIndex++)
+	{
+		if (valueIndex > 0)
+		{
+			appendStringInfoString(arrayString, ",");
+		}
+
+		if (valueIsNullArray[valueIndex])
+		{
+			appendStringInfoString(arrayString, "NULL");
+		}
+		else
+		{
+			char *valueString = OidOutputFunctionCall(outputFunctionId,
+													  valueArray[valueIndex]);
+
+			appendStringInfoString(arrayString, quote_literal_cstr(valueString));
+		}
+	}
+
+	appendStringInfoString(arrayString, "]::text[]");
+}
+
+
+/*
+ * WrapTaskInPartitionQuery returns a copy of the given select task that
+ * writes its results into partitioned intermediate results on the worker
+ * by calling worker_partition_query_result(). The task keeps all placements
+ * of the select task, and the query sent to each placement returns the index
+ * of that placement, such that we know where the results end up.
+ */
+static Task *
+WrapTaskInPartitionQuery(Task *selectTask, int taskIndex, char *resultIdPrefix,
+						 int partitionColumnIndex, DistTableCacheEntry *targetRelation,
+						 char *minValuesString, char *maxValuesString)
+{
+	Task *wrappedTask = copyObject(selectTask);
+	StringInfo taskPrefix = makeStringInfo();
+	List *perPlacementQueryStrings = NIL;
+	int placementIndex = 0;
+	int placementCount = list_length(selectTask->taskPlacementList);
+	const char *partitionMethodString =
+		targetRelation->partitionMethod == DISTRIBUTE_BY_HASH ? "hash" : "range";
+
+	appendStringInfo(taskPrefix, "%s_%d", resultIdPrefix, selectTask->taskId);
+
+	for (placementIndex = 0; placementIndex < placementCount; placementIndex++)
+	{
+		StringInfo wrappedQuery = makeStringInfo();
+
+		appendStringInfo(wrappedQuery,
+						 "SELECT %d, %d, partition_index, rows_written "
+						 "FROM worker_partition_query_result(%s, %s, %d, %s, %s, %s)",
+						 taskIndex, placementIndex,
+						 quote_literal_cstr(taskPrefix->data),
+						 quote_literal_cstr(selectTask->queryString),
+						 partitionColumnIndex,
+						 quote_literal_cstr(partitionMethodString),
+						 minValuesString, maxValuesString);
+
+		perPlacementQueryStrings = lappend(perPlacementQueryStrings,
+										   makeString(wrappedQuery->data));
+	}
+
+	wrappedTask->queryString = strVal(linitial(perPlacementQueryStrings));
+	wrappedTask->perPlacementQueryStrings = perPlacementQueryStrings;
+
+	return wrappedTask;
+}
+
+
+/*
+ * ColocationTransfers groups the fragments that need to be moved to the
+ * placements of their target shard by source and target node.
+ */
+static List *
+ColocationTransfers(List *fragmentList, List **shardPlacementLists)
+{
+	List *transferList = NIL;
+	ListCell *fragmentCell = NULL;
+
+	foreach(fragmentCell, fragmentList)
+	{
+		DistributedResultFragment *fragment =
+			(DistributedResultFragment *) lfirst(fragmentCell);
+		List *placementList = shardPlacementLists[fragment->targetShardIndex];
+		ListCell *placementCell = NULL;
+
+		foreach(placementCell, placementList)
+		{
+			ShardPlacement *placement = (ShardPlacement *) lfirst(placementCell);
+			NodeToNodeFragmentsTransfer *transfer = NULL;
+			ListCell *transferCell = NULL;
+
+			/* fragments that are already in the right place need no transfer */
+			if (strcmp(placement->nodeName, fragment->nodeName) == 0 &&
+				placement->nodePort == fragment->nodePort)
+			{
+				continue;
+			}
+
+			foreach(transferCell, transferList)
+			{
+				NodeToNodeFragmentsTransfer *existingTransfer =
+					(NodeToNodeFragmentsTransfer *) lfirst(transferCell);
+
+				if (strcmp(existingTransfer->sourceNodeName, fragment->nodeName) == 0 &&
+					existingTransfer->sourceNodePort == fragment->nodePort &&
+					strcmp(existingTransfer->targetPlacement->nodeName,
+						   placement->nodeName) == 0 &&
+					existingTransfer->targetPlacement->nodePort == placement->nodePort)
+				{
+					transfer = existingTransfer;
+					break;
+				}
+			}
+
+			if (transfer == NULL)
+			{
+				transfer = palloc0(sizeof(NodeToNodeFragmentsTransfer));
+				transfer->sourceNodeName = fragment->nodeName;
+				transfer->sourceNodePort = fragment->nodePort;
+				transfer->targetPlacement = placement;
+
+				transferList = lappend(transferList, transfer);
+			}
+
+			transfer->resultIdList = lappend(transfer->resultIdList,
+											 fragment->resultId);
+		}
+	}
+
+	return transferList;
+}
+
+
+/*
+ * FragmentTransferTask returns a task that fetches the fragments of the
+ * given transfer from the source node into the target node.
+ */
+static Task *
+FragmentTransferTask(NodeToNodeFragmentsTransfer *transfer)
+{
+	StringInfo queryString = makeStringInfo();
+	ListCell *resultIdCell = NULL;
+	bool firstResultId = true;
+	Task *fetchTask = NULL;
+	static uint32 fetchTaskId = 0;
+
+	appendStringInfoString(queryString,
+						   "SELECT bytes FROM fetch_intermediate_results(ARRAY[");
+
+	foreach(resultIdCell, transfer->resultIdList)
+	{
+		char *resultId = (char *) lfirst(resultIdCell);
+
+		if (!firstResultId)
+		{
+			appendStringInfoString(queryString, ",");
+		}
+
+		appendStringInfoString(queryString, quote_literal_cstr(resultId));
+		firstResultId = false;
+	}
+
+	appendStringInfo(queryString, "]::text[], %s, %d) bytes",
+					 quote_literal_cstr(transfer->sourceNodeName),
+					 transfer->sourceNodePort);
+
+	fetchTask = CreateBasicTask(INVALID_JOB_ID, ++fetchTaskId, SQL_TASK,
+								queryString->data);
+	fetchTask->anchorShardId = transfer->targetPlacement->shardId;
+	fetchTask->taskPlacementList = list_make1(transfer->targetPlacement);
+
+	return fetchTask;
+}
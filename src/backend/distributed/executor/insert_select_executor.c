@@ -11,17 +11,23 @@
 #include "postgres.h"
 #include "miscadmin.h"
 
+#include "distributed/citus_custom_scan.h"
 #include "distributed/commands/multi_copy.h"
 #include "distributed/distributed_execution_locks.h"
 #include "distributed/insert_select_executor.h"
 #include "distributed/insert_select_planner.h"
+#include "distributed/intermediate_results.h"
 #include "distributed/local_executor.h"
+#include "distributed/master_metadata_utility.h"
 #include "distributed/multi_executor.h"
 #include "distributed/multi_partitioning_utils.h"
 #include "distributed/multi_physical_planner.h"
+#include "distributed/multi_router_planner.h"
 #include "distributed/distributed_planner.h"
 #include "distributed/relation_access_tracking.h"
+#include "distributed/relay_utility.h"
 #include "distributed/resource_lock.h"
+#include "distributed/subplan_execution.h"
 #include "distributed/transaction_management.h"
 #include "executor/executor.h"
 #include "nodes/execnodes.h"
@@ -33,11 +39,15 @@
 #include "parser/parsetree.h"
 #include "tcop/pquery.h"
 #include "tcop/tcopprot.h"
+#include "utils/builtins.h"
 #include "utils/lsyscache.h"
 #include "utils/portal.h"
 #include "utils/snapmgr.h"
 
 
+/* controlled via GUC, whether to repartition INSERT..SELECT results on workers */
+bool EnableRepartitionedInsertSelect = false;
+
 /* depth of current insert/select executor. */
 static int insertSelectExecutorLevel = 0;
 
@@ -51,6 +61,17 @@ static HTAB * ExecuteSelectIntoColocatedIntermediateResults(Oid targetRelationId
 															EState *executorState,
 															char *
 															intermediateResultIdPrefix);
+static bool IsRedistributablePlan(Plan *selectPlan, Oid targetRelationId,
+								  int partitionColumnIndex, int insertColumnCount,
+								  ParamListInfo paramListInfo);
+static void ExecutePlanIntoRelationRepartitioned(PlannedStmt *selectPlan,
+												 Oid targetRelationId,
+												 List *columnNameList,
+												 int partitionColumnIndex,
+												 EState *executorState);
+static Task * RepartitionedInsertTask(ShardInterval *shardInterval, uint32 taskId,
+									  List *columnNameList, List *selectTargetList,
+									  List *resultIdList, bool useBinaryFormat);
 static List * BuildColumnNameListFromTargetList(Oid targetRelationId,
 												List *insertTargetList);
 static int PartitionColumnIndexFromColumnList(Oid relationId, List *columnNameList);
@@ -287,11 +308,6 @@ ExecuteSelectIntoRelation(Oid targetRelationId, List *insertTargetList,
 	partitionColumnIndex = PartitionColumnIndexFromColumnList(targetRelationId,
 															  columnNameList);
 
-	/* set up a DestReceiver that copies into the distributed table */
-	copyDest = CreateCitusCopyDestReceiver(targetRelationId, columnNameList,
-										   partitionColumnIndex, executorState,
-										   stopOnFailure, NULL);
-
 	/*
 	 * Make a copy of the query, since ExecuteQueryIntoDestReceiver may scribble on it
 	 * and we want it to be replanned every time if it is stored in a prepared
@@ -299,6 +315,46 @@ ExecuteSelectIntoRelation(Oid targetRelationId, List *insertTargetList,
 	 */
 	queryCopy = copyObject(selectQuery);
 
+	if (EnableRepartitionedInsertSelect)
+	{
+		/*
+		 * Plan the SELECT first to see whether its results can be partitioned
+		 * on the workers and moved to the target shards directly, without
+		 * passing through the coordinator.
+		 */
+		PlannedStmt *selectPlan = pg_plan_query(queryCopy, CURSOR_OPT_PARALLEL_OK,
+												paramListInfo);
+
+		if (IsRedistributablePlan(selectPlan->planTree, targetRelationId,
+								  partitionColumnIndex, list_length(columnNameList),
+								  paramListInfo))
+		{
+			ExecutePlanIntoRelationRepartitioned(selectPlan, targetRelationId,
+												 columnNameList, partitionColumnIndex,
+												 executorState);
+		}
+		else
+		{
+			copyDest = CreateCitusCopyDestReceiver(targetRelationId, columnNameList,
+												   partitionColumnIndex, executorState,
+												   stopOnFailure, NULL);
+
+			ExecutePlanIntoDestReceiver(selectPlan, paramListInfo,
+										(DestReceiver *) copyDest);
+
+			executorState->es_processed = copyDest->tuplesSent;
+		}
+
+		XactModificationLevel = XACT_MODIFICATION_DATA;
+
+		return;
+	}
+
+	/* set up a DestReceiver that copies into the distributed table */
+	copyDest = CreateCitusCopyDestReceiver(targetRelationId, columnNameList,
+										   partitionColumnIndex, executorState,
+										   stopOnFailure, NULL);
+
 	ExecuteQueryIntoDestReceiver(queryCopy, paramListInfo, (DestReceiver *) copyDest);
 
 	executorState->es_processed = copyDest->tuplesSent;
@@ -307,6 +363,277 @@ ExecuteSelectIntoRelation(Oid targetRelationId, List *insertTargetList,
 }
 
 
+/*
+ * IsRedistributablePlan returns whether the results of the given SELECT plan
+ * can be partitioned on the workers and inserted into the target relation
+ * without passing through the coordinator. This is the case when the plan
+ * is a distributed plan whose tasks return exactly the rows that are to be
+ * inserted, i.e. no merge step is needed on the coordinator.
+ */
+static bool
+IsRedistributablePlan(Plan *selectPlan, Oid targetRelationId, int partitionColumnIndex,
+					  int insertColumnCount, ParamListInfo paramListInfo)
+{
+	DistributedPlan *distSelectPlan = NULL;
+	DistTableCacheEntry *targetCacheEntry = NULL;
+	Job *workerJob = NULL;
+	ListCell *targetEntryCell = NULL;
+	int outputColumnCount = 0;
+	Oid partitionColumnType = InvalidOid;
+
+	/* parameters would have to be sent along with the wrapped task queries */
+	if (paramListInfo != NULL)
+	{
+		return false;
+	}
+
+	if (!IsCitusCustomScan(selectPlan))
+	{
+		return false;
+	}
+
+	distSelectPlan = GetDistributedPlan((CustomScan *) selectPlan);
+	workerJob = distSelectPlan->workerJob;
+	if (workerJob == NULL || workerJob->taskList == NIL ||
+		workerJob->dependedJobList != NIL || workerJob->requiresMasterEvaluation ||
+		workerJob->deferredPruning || distSelectPlan->modLevel != ROW_MODIFY_READONLY)
+	{
+		return false;
+	}
+
+	/* the workers should produce the columns that are inserted, in order */
+	foreach(targetEntryCell, selectPlan->targetlist)
+	{
+		TargetEntry *targetEntry = (TargetEntry *) lfirst(targetEntryCell);
+		Var *column = NULL;
+
+		if (targetEntry->resjunk)
+		{
+			continue;
+		}
+
+		if (!IsA(targetEntry->expr, Var))
+		{
+			return false;
+		}
+
+		column = (Var *) targetEntry->expr;
+		outputColumnCount++;
+
+		if (column->varattno != outputColumnCount)
+		{
+			return false;
+		}
+
+		if (outputColumnCount - 1 == partitionColumnIndex)
+		{
+			partitionColumnType = column->vartype;
+		}
+	}
+
+	if (outputColumnCount != insertColumnCount ||
+		ExecCleanTargetListLength(workerJob->jobQuery->targetList) != insertColumnCount)
+	{
+		return false;
+	}
+
+	targetCacheEntry = DistributedTableCacheEntry(targetRelationId);
+	if (targetCacheEntry->partitionMethod != DISTRIBUTE_BY_HASH &&
+		targetCacheEntry->partitionMethod != DISTRIBUTE_BY_RANGE)
+	{
+		return false;
+	}
+
+	if (targetCacheEntry->hasUninitializedShardInterval ||
+		targetCacheEntry->hasOverlappingShardInterval ||
+		targetCacheEntry->shardIntervalArrayLength == 0)
+	{
+		return false;
+	}
+
+	/* rows are partitioned on the workers using the type of the select column */
+	if (partitionColumnIndex == -1 ||
+		partitionColumnType != targetCacheEntry->partitionColumn->vartype)
+	{
+		return false;
+	}
+
+	return true;
+}
+
+
+/*
+ * ExecutePlanIntoRelationRepartitioned executes the tasks of the given
+ * distributed SELECT plan such that each worker partitions its results by
+ * the shard ranges of the target relation, moves the partitions to the
+ * workers holding the target shard placements, and finally inserts them
+ * into the shards from the local intermediate results.
+ */
+static void
+ExecutePlanIntoRelationRepartitioned(PlannedStmt *selectPlan, Oid targetRelationId,
+									 List *columnNameList, int partitionColumnIndex,
+									 EState *executorState)
+{
+	DistributedPlan *distSelectPlan =
+		GetDistributedPlan((CustomScan *) selectPlan->planTree);
+	Job *selectJob = distSelectPlan->workerJob;
+	DistTableCacheEntry *targetCacheEntry = DistributedTableCacheEntry(targetRelationId);
+	int shardCount = targetCacheEntry->shardIntervalArrayLength;
+	char *resultIdPrefix = InsertSelectResultIdPrefix(distSelectPlan->planId);
+	List *selectTargetList = NIL;
+	List **shardResultIdList = NULL;
+	List *insertTaskList = NIL;
+	ListCell *targetEntryCell = NULL;
+	bool useBinaryFormat = true;
+	uint32 taskId = 1;
+	int shardIndex = 0;
+
+	ereport(DEBUG1, (errmsg("performing repartitioned INSERT ... SELECT")));
+
+	foreach(targetEntryCell, selectPlan->planTree->targetlist)
+	{
+		TargetEntry *targetEntry = (TargetEntry *) lfirst(targetEntryCell);
+
+		if (targetEntry->resjunk)
+		{
+			continue;
+		}
+
+		if (!CanUseBinaryCopyFormatForType(exprType((Node *) targetEntry->expr)))
+		{
+			useBinaryFormat = false;
+		}
+
+		selectTargetList = lappend(selectTargetList, targetEntry);
+	}
+
+	LockPartitionsInRelationList(distSelectPlan->relationIdList, AccessShareLock);
+
+	ExecuteSubPlans(distSelectPlan);
+
+	shardResultIdList = RedistributeTaskListResults(resultIdPrefix,
+													selectJob->taskList,
+													partitionColumnIndex,
+													targetCacheEntry);
+
+	for (shardIndex = 0; shardIndex < shardCount; shardIndex++)
+	{
+		ShardInterval *shardInterval =
+			targetCacheEntry->sortedShardIntervalArray[shardIndex];
+		List *resultIdList = shardResultIdList[shardIndex];
+		Task *insertTask = NULL;
+
+		/* shards that receive no rows need no INSERT */
+		if (resultIdList == NIL)
+		{
+			continue;
+		}
+
+		insertTask = RepartitionedInsertTask(shardInterval, taskId, columnNameList,
+											 selectTargetList, resultIdList,
+											 useBinaryFormat);
+		insertTask->replicationModel = targetCacheEntry->replicationModel;
+
+		insertTaskList = lappend(insertTaskList, insertTask);
+		taskId++;
+	}
+
+	if (insertTaskList != NIL)
+	{
+		executorState->es_processed =
+			ExecuteTaskList(ROW_MODIFY_COMMUTATIVE, insertTaskList,
+							MaxAdaptiveExecutorPoolSize);
+	}
+}
+
+
+/*
+ * RepartitionedInsertTask returns a task that inserts the rows of the given
+ * intermediate results, which are expected to be present on the nodes of
+ * the shard placements, into the given shard.
+ */
+static Task *
+RepartitionedInsertTask(ShardInterval *shardInterval, uint32 taskId,
+						List *columnNameList, List *selectTargetList,
+						List *resultIdList, bool useBinaryFormat)
+{
+	Oid relationId = shardInterval->relationId;
+	uint64 shardId = shardInterval->shardId;
+	char *schemaName = get_namespace_name(get_rel_namespace(relationId));
+	char *shardName = get_rel_name(relationId);
+	StringInfo queryString = makeStringInfo();
+	ListCell *columnNameCell = NULL;
+	ListCell *resultIdCell = NULL;
+	ListCell *targetEntryCell = NULL;
+	RelationShard *relationShard = NULL;
+	Task *insertTask = NULL;
+	bool firstEntry = true;
+
+	AppendShardIdToName(&shardName, shardId);
+
+	appendStringInfo(queryString, "INSERT INTO %s AS %s (",
+					 quote_qualified_identifier(schemaName, shardName),
+					 CITUS_TABLE_ALIAS);
+
+	foreach(columnNameCell, columnNameList)
+	{
+		char *columnName = (char *) lfirst(columnNameCell);
+
+		appendStringInfo(queryString, "%s%s", firstEntry ? "" : ", ",
+						 quote_identifier(columnName));
+		firstEntry = false;
+	}
+
+	appendStringInfoString(queryString,
+						   ") SELECT * FROM read_intermediate_results(ARRAY[");
+
+	firstEntry = true;
+	foreach(resultIdCell, resultIdList)
+	{
+		char *resultId = (char *) lfirst(resultIdCell);
+
+		appendStringInfo(queryString, "%s%s", firstEntry ? "" : ", ",
+						 quote_literal_cstr(resultId));
+		firstEntry = false;
+	}
+
+	appendStringInfo(queryString, "]::text[], %s::citus_copy_format) "
+								  "intermediate_result (",
+					 useBinaryFormat ? "'binary'" : "'text'");
+
+	firstEntry = true;
+	forboth(columnNameCell, columnNameList, targetEntryCell, selectTargetList)
+	{
+		char *columnName = (char *) lfirst(columnNameCell);
+		TargetEntry *targetEntry = (TargetEntry *) lfirst(targetEntryCell);
+		Node *columnExpr = (Node *) targetEntry->expr;
+
+		appendStringInfo(queryString, "%s%s %s", firstEntry ? "" : ", ",
+						 quote_identifier(columnName),
+						 format_type_with_typemod(exprType(columnExpr),
+												  exprTypmod(columnExpr)));
+		firstEntry = false;
+	}
+
+	appendStringInfoString(queryString, ")");
+
+	ereport(DEBUG2, (errmsg("distributed statement: %s", queryString->data)));
+
+	LockShardDistributionMetadata(shardId, ShareLock);
+
+	relationShard = CitusMakeNode(RelationShard);
+	relationShard->relationId = relationId;
+	relationShard->shardId = shardId;
+
+	insertTask = CreateBasicTask(INVALID_JOB_ID, taskId, MODIFY_TASK, queryString->data);
+	insertTask->anchorShardId = shardId;
+	insertTask->taskPlacementList = FinalizedShardPlacementList(shardId);
+	insertTask->relationShardList = list_make1(relationShard);
+
+	return insertTask;
+}
+
+
 /*
  * BuildColumnNameListForCopyStatement build the column name list given the insert
  * target list.
@@ -25,6 +25,7 @@
 #include "distributed/metadata_cache.h"
 #include "distributed/multi_executor.h"
 #include "distributed/remote_commands.h"
+#include "distributed/remote_transaction.h"
 #include "distributed/transmit.h"
 #include "distributed/transaction_identifier.h"
 #include "distributed/tuplestore.h"
@@ -34,7 +35,9 @@
 #include "nodes/parsenodes.h"
 #include "nodes/primnodes.h"
 #include "storage/fd.h"
+#include "storage/latch.h"
 #include "tcop/tcopprot.h"
+#include "utils/array.h"
 #include "utils/builtins.h"
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
@@ -75,6 +78,9 @@ typedef struct RemoteFileDestReceiver
 
 	/* number of tuples sent */
 	uint64 tuplesSent;
+
+	/* number of bytes of tuple data sent */
+	uint64 bytesSent;
 } RemoteFileDestReceiver;
 
 
@@ -92,12 +98,20 @@ static void RemoteFileDestReceiverDestroy(DestReceiver *destReceiver);
 static char * CreateIntermediateResultsDirectory(void);
 static char * IntermediateResultsDirectory(void);
 static char * QueryResultFileName(const char *resultId);
+static void ReadIntermediateResultsIntoFuncOutput(FunctionCallInfo fcinfo,
+												  char *copyFormat,
+												  Datum *resultIdArray,
+												  int resultCount);
+static uint64 FetchRemoteIntermediateResult(MultiConnection *connection,
+											char *resultId);
 
 
 /* exports for SQL callable functions */
 PG_FUNCTION_INFO_V1(read_intermediate_result);
+PG_FUNCTION_INFO_V1(read_intermediate_results);
 PG_FUNCTION_INFO_V1(broadcast_intermediate_result);
 PG_FUNCTION_INFO_V1(create_intermediate_result);
+PG_FUNCTION_INFO_V1(fetch_intermediate_results);
 
 
 /*
@@ -402,6 +416,7 @@ RemoteFileDestReceiverReceive(TupleTableSlot *slot, DestReceiver *dest)
 	MemoryContextSwitchTo(oldContext);
 
 	resultDest->tuplesSent++;
+	resultDest->bytesSent += copyData->len;
 
 	ResetPerTupleExprContext(executorState);
 
@@ -491,6 +506,19 @@ SendCopyDataOverConnection(StringInfo dataBuffer, MultiConnection *connection)
 }
 
 
+/*
+ * RemoteFileDestReceiverBytesSent returns the number of bytes of tuple data
+ * that the given RemoteFileDestReceiver sent so far.
+ */
+uint64
+RemoteFileDestReceiverBytesSent(DestReceiver *destReceiver)
+{
+	RemoteFileDestReceiver *resultDest = (RemoteFileDestReceiver *) destReceiver;
+
+	return resultDest->bytesSent;
+}
+
+
 /*
  * RemoteFileDestReceiverDestroy frees memory allocated as part of the
  * RemoteFileDestReceiver and closes file descriptors.
@@ -536,6 +564,20 @@ ReceiveQueryResultViaCopy(const char *resultId)
 }
 
 
+/*
+ * SendQueryResultViaCopy is called when a COPY "resultid" TO STDOUT
+ * WITH (format result) command is received from the client. The
+ * contents of the file are sent directly to the client.
+ */
+void
+SendQueryResultViaCopy(const char *resultId)
+{
+	const char *resultFileName = QueryResultFileName(resultId);
+
+	SendRegularFile(resultFileName);
+}
+
+
 /*
  * CreateIntermediateResultsDirectory creates the intermediate result
  * directory for the current transaction if it does not exist and ensures
@@ -704,34 +746,253 @@ IntermediateResultSize(char *resultId)
 Datum
 read_intermediate_result(PG_FUNCTION_ARGS)
 {
-	text *resultIdText = PG_GETARG_TEXT_P(0);
-	char *resultIdString = text_to_cstring(resultIdText);
+	Datum resultId = PG_GETARG_DATUM(0);
 	Datum copyFormatOidDatum = PG_GETARG_DATUM(1);
 	Datum copyFormatLabelDatum = DirectFunctionCall1(enum_out, copyFormatOidDatum);
 	char *copyFormatLabel = DatumGetCString(copyFormatLabelDatum);
 
-	char *resultFileName = NULL;
-	struct stat fileStat;
-	int statOK = 0;
+	CheckCitusVersion(ERROR);
+
+	ReadIntermediateResultsIntoFuncOutput(fcinfo, copyFormatLabel, &resultId, 1);
 
-	Tuplestorestate *tupstore = NULL;
+	return (Datum) 0;
+}
+
+
+/*
+ * read_intermediate_results is a UDF that returns a set of COPY-formatted
+ * intermediate result files as a set of records. The files are parsed
+ * according to the columns definition list specified by the user, e.g.:
+ *
+ * SELECT * FROM read_intermediate_results(ARRAY['foo', 'bar'], 'csv') AS (a int, b int)
+ *
+ * The files are read from the directory returned by IntermediateResultsDirectory,
+ * which includes the user ID. All files must use the same copy format.
+ */
+Datum
+read_intermediate_results(PG_FUNCTION_ARGS)
+{
+	ArrayType *resultIdObject = PG_GETARG_ARRAYTYPE_P(0);
+	Datum *resultIdArray = DeconstructArrayObject(resultIdObject);
+	int32 resultCount = ArrayObjectCount(resultIdObject);
+	Datum copyFormatOidDatum = PG_GETARG_DATUM(1);
+	Datum copyFormatLabelDatum = DirectFunctionCall1(enum_out, copyFormatOidDatum);
+	char *copyFormatLabel = DatumGetCString(copyFormatLabelDatum);
+
+	CheckCitusVersion(ERROR);
+
+	ReadIntermediateResultsIntoFuncOutput(fcinfo, copyFormatLabel,
+										  resultIdArray, resultCount);
+
+	return (Datum) 0;
+}
+
+
+/*
+ * ReadIntermediateResultsIntoFuncOutput reads the given result files and
+ * stores them at the function's output tuple store. Errors out if any of
+ * the result files does not exist.
+ */
+static void
+ReadIntermediateResultsIntoFuncOutput(FunctionCallInfo fcinfo, char *copyFormat,
+									  Datum *resultIdArray, int resultCount)
+{
 	TupleDesc tupleDescriptor = NULL;
+	Tuplestorestate *tupleStore = SetupTuplestore(fcinfo, &tupleDescriptor);
+	int resultIndex = 0;
+
+	for (resultIndex = 0; resultIndex < resultCount; resultIndex++)
+	{
+		char *resultId = TextDatumGetCString(resultIdArray[resultIndex]);
+		char *resultFileName = QueryResultFileName(resultId);
+		struct stat fileStat;
+		int statOK = 0;
+
+		statOK = stat(resultFileName, &fileStat);
+		if (statOK != 0)
+		{
+			ereport(ERROR, (errcode_for_file_access(),
+							errmsg("result \"%s\" does not exist", resultId)));
+		}
+
+		ReadFileIntoTupleStore(resultFileName, copyFormat, tupleDescriptor, tupleStore);
+	}
+
+	tuplestore_donestoring(tupleStore);
+}
+
+
+/*
+ * fetch_intermediate_results fetches a set of intermediate results defined in
+ * an array of result IDs from a remote node and writes them to local
+ * intermediate result files in the directory of the current distributed
+ * transaction. It returns the total number of bytes fetched.
+ *
+ * This is used to move partitions of a result between worker nodes directly,
+ * without passing the data through the coordinator.
+ */
+Datum
+fetch_intermediate_results(PG_FUNCTION_ARGS)
+{
+	ArrayType *resultIdObject = PG_GETARG_ARRAYTYPE_P(0);
+	Datum *resultIdArray = DeconstructArrayObject(resultIdObject);
+	int32 resultCount = ArrayObjectCount(resultIdObject);
+	text *remoteHostText = PG_GETARG_TEXT_P(1);
+	char *remoteHost = text_to_cstring(remoteHostText);
+	int remotePort = PG_GETARG_INT32(2);
+	int connectionFlags = FORCE_NEW_CONNECTION;
+	MultiConnection *connection = NULL;
+	DistributedTransactionId *transactionId = NULL;
+	uint64 totalBytesWritten = 0;
+	int resultIndex = 0;
 
 	CheckCitusVersion(ERROR);
 
-	resultFileName = QueryResultFileName(resultIdString);
-	statOK = stat(resultFileName, &fileStat);
-	if (statOK != 0)
+	if (resultCount == 0)
 	{
-		ereport(ERROR, (errcode_for_file_access(),
-						errmsg("result \"%s\" does not exist", resultIdString)));
+		PG_RETURN_INT64(0);
 	}
 
-	tupstore = SetupTuplestore(fcinfo, &tupleDescriptor);
+	/*
+	 * The results are looked up in the directory of the distributed
+	 * transaction on the remote node, so the fetch has to happen as part of
+	 * the same distributed transaction.
+	 */
+	transactionId = GetCurrentDistributedTransactionId();
+	if (transactionId->transactionNumber == 0)
+	{
+		ereport(ERROR, (errmsg("fetch_intermediate_results can only be used in a "
+							   "distributed transaction")));
+	}
 
-	ReadFileIntoTupleStore(resultFileName, copyFormatLabel, tupleDescriptor, tupstore);
+	/* make sure the directory exists */
+	CreateIntermediateResultsDirectory();
 
-	tuplestore_donestoring(tupstore);
+	connection = GetNodeConnection(connectionFlags, remoteHost, remotePort);
+	if (PQstatus(connection->pgConn) != CONNECTION_OK)
+	{
+		ReportConnectionError(connection, ERROR);
+	}
 
-	return (Datum) 0;
+	/* assigns the distributed transaction ID of this node on the remote node */
+	RemoteTransactionBegin(connection);
+
+	for (resultIndex = 0; resultIndex < resultCount; resultIndex++)
+	{
+		char *resultId = TextDatumGetCString(resultIdArray[resultIndex]);
+
+		totalBytesWritten += FetchRemoteIntermediateResult(connection, resultId);
+	}
+
+	RemoteTransactionCommit(connection);
+	CloseConnection(connection);
+
+	PG_RETURN_INT64(totalBytesWritten);
+}
+
+
+/*
+ * FetchRemoteIntermediateResult fetches a single intermediate result over the
+ * given connection with a COPY "resultid" TO STDOUT WITH (format result)
+ * command and writes it to a local file with the same result ID. It returns
+ * the number of bytes written.
+ */
+static uint64
+FetchRemoteIntermediateResult(MultiConnection *connection, char *resultId)
+{
+	PGconn *pgConn = connection->pgConn;
+	int socket = PQsocket(pgConn);
+	bool raiseInterrupts = true;
+	StringInfo copyCommand = makeStringInfo();
+	char *localFileName = QueryResultFileName(resultId);
+	const int fileFlags = (O_APPEND | O_CREAT | O_RDWR | O_TRUNC | PG_BINARY);
+	const int fileMode = (S_IRUSR | S_IWUSR);
+	FileCompat fileCompat;
+	PGresult *result = NULL;
+	uint64 totalBytesWritten = 0;
+
+	appendStringInfo(copyCommand, "COPY \"%s\" TO STDOUT WITH (format result)",
+					 resultId);
+
+	if (!SendRemoteCommand(connection, copyCommand->data))
+	{
+		ReportConnectionError(connection, ERROR);
+	}
+
+	result = GetRemoteCommandResult(connection, raiseInterrupts);
+	if (PQresultStatus(result) != PGRES_COPY_OUT)
+	{
+		ReportResultError(connection, result, ERROR);
+	}
+
+	PQclear(result);
+
+	fileCompat = FileCompatFromFileStart(FileOpenForTransmit(localFileName, fileFlags,
+															 fileMode));
+
+	while (true)
+	{
+		char *receiveBuffer = NULL;
+		int receiveLength = PQgetCopyData(pgConn, &receiveBuffer, true);
+
+		if (receiveLength > 0)
+		{
+			int bytesWritten = FileWriteCompat(&fileCompat, receiveBuffer,
+											   receiveLength, PG_WAIT_IO);
+			PQfreemem(receiveBuffer);
+
+			if (bytesWritten != receiveLength)
+			{
+				ereport(ERROR, (errcode_for_file_access(),
+								errmsg("could not append to file: %m")));
+			}
+
+			totalBytesWritten += receiveLength;
+		}
+		else if (receiveLength == 0)
+		{
+			/* no data available yet, wait for the socket to become readable */
+			int waitFlags = WL_SOCKET_READABLE | WL_LATCH_SET | WL_POSTMASTER_DEATH;
+			int rc = WaitLatchOrSocket(MyLatch, waitFlags, socket, 0,
+									   PG_WAIT_EXTENSION);
+
+			if (rc & WL_POSTMASTER_DEATH)
+			{
+				ereport(ERROR, (errmsg("postmaster was shut down, exiting")));
+			}
+
+			if (rc & WL_LATCH_SET)
+			{
+				ResetLatch(MyLatch);
+				CHECK_FOR_INTERRUPTS();
+			}
+
+			if (PQconsumeInput(pgConn) == 0)
+			{
+				ReportConnectionError(connection, ERROR);
+			}
+		}
+		else if (receiveLength == -1)
+		{
+			/* the COPY is done */
+			break;
+		}
+		else
+		{
+			ReportConnectionError(connection, ERROR);
+		}
+	}
+
+	FileClose(fileCompat.fd);
+
+	result = GetRemoteCommandResult(connection, raiseInterrupts);
+	if (PQresultStatus(result) != PGRES_COMMAND_OK)
+	{
+		ReportResultError(connection, result, ERROR);
+	}
+
+	PQclear(result);
+	ForgetResults(connection);
+
+	return totalBytesWritten;
 }
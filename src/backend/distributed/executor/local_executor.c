@@ -56,9 +56,23 @@
  *		Note that for read-only queries, after the local execution, there is no need to
  *		kick in adaptive executor.
  *
+ *  When citus.enable_partial_local_execution is set, the executor keeps track of
+ *  the shards that have been executed locally in the transaction (together with
+ *  their co-located shards). After the first local execution, only the tasks on
+ *  those shards are executed locally, and the tasks on the remaining local shards
+ *  are handed over to the adaptive executor along with the remote tasks, so that
+ *  they are executed in parallel over connections to this node. Since those shards
+ *  have not been touched by this backend, the transaction visibility rules still
+ *  hold. If a reference table has been accessed locally, we fall back to executing
+ *  all the local tasks locally, because the foreign keys to reference tables could
+ *  otherwise lead to self-deadlocks between this backend and the connections.
+ *
  *  There are also few limitations/trade-offs that is worth mentioning. First, the
  *  local execution on multiple shards might be slow because the execution has to
- *  happen one task at a time (e.g., no parallelism). Second, if a transaction
+ *  happen one task at a time (e.g., no parallelism). A PostgreSQL backend cannot
+ *  execute multiple queries concurrently, so the only way to parallelize local
+ *  tasks is to use connections to the local node, which is what the adaptive
+ *  executor does when local execution is not used. Second, if a transaction
  *  block/CTE starts with a multi-shard command, we do not use local query execution
  *  since local execution is sequential. Basically, we do not want to lose parallelism
  *  across local tasks by switching to local execution. Third, the local execution
@@ -73,8 +87,11 @@
 #include "miscadmin.h"
 
 #include "distributed/citus_custom_scan.h"
+#include "distributed/colocation_utils.h"
 #include "distributed/local_executor.h"
+#include "distributed/local_plan_cache.h"
 #include "distributed/multi_executor.h"
+#include "distributed/master_metadata_utility.h"
 #include "distributed/metadata_cache.h"
 #include "distributed/relation_access_tracking.h"
 #include "distributed/remote_commands.h" /* to access LogRemoteCommands */
@@ -87,15 +104,34 @@
 #include "optimizer/planner.h"
 #endif
 #include "nodes/params.h"
+#include "utils/hsearch.h"
+#include "utils/memutils.h"
 #include "utils/snapmgr.h"
 
 
 /* controlled via a GUC */
 bool EnableLocalExecution = true;
 bool LogLocalCommands = false;
+bool EnablePartialLocalExecution = false;
 
 bool LocalExecutionHappened = false;
 
+/*
+ * LocallyAccessedShardHash keeps the shards (and their co-located shards) that
+ * have been accessed via local execution in the current transaction. The hash
+ * lives in TopTransactionContext and is reset via ResetLocalExecutionState().
+ */
+static HTAB *LocallyAccessedShardHash = NULL;
+static bool LocallyAccessedReferenceTable = false;
+
+/*
+ * PartialLocalExecutionInTransaction is the value of
+ * citus.enable_partial_local_execution at the first local execution of the
+ * transaction. Changing the GUC afterwards has no effect until the end of the
+ * transaction, since the shards accessed so far would not have been recorded.
+ */
+static bool PartialLocalExecutionInTransaction = false;
+
 
 static void SplitLocalAndRemotePlacements(List *taskPlacementList,
 										  List **localTaskPlacementList,
@@ -103,6 +139,9 @@ static void SplitLocalAndRemotePlacements(List *taskPlacementList,
 static uint64 ExecuteLocalTaskPlan(CitusScanState *scanState, PlannedStmt *taskPlan,
 								   char *queryString);
 static bool TaskAccessesLocalNode(Task *task);
+static void RecordLocallyAccessedShards(Task *task);
+static void RecordLocallyAccessedShard(uint64 shardId);
+static bool TaskAccessesLocallyAccessedShard(Task *task);
 static void LogLocalCommand(const char *command);
 
 static void ExtractParametersForLocalExecution(ParamListInfo paramListInfo,
@@ -121,6 +160,7 @@ static void ExtractParametersForLocalExecution(ParamListInfo paramListInfo,
 uint64
 ExecuteLocalTaskList(CitusScanState *scanState, List *taskList)
 {
+	DistributedPlan *distributedPlan = scanState->distributedPlan;
 	EState *executorState = ScanStateGetExecutorState(scanState);
 	ParamListInfo paramListInfo = copyParamList(executorState->es_param_list_info);
 	int numParams = 0;
@@ -138,35 +178,59 @@ ExecuteLocalTaskList(CitusScanState *scanState, List *taskList)
 		numParams = paramListInfo->numParams;
 	}
 
+	if (!LocalExecutionHappened)
+	{
+		PartialLocalExecutionInTransaction = EnablePartialLocalExecution;
+	}
+
 	foreach(taskCell, taskList)
 	{
 		Task *task = (Task *) lfirst(taskCell);
 
-		PlannedStmt *localPlan = NULL;
-		int cursorOptions = 0;
 		const char *shardQueryString = task->queryString;
-		Query *shardQuery = ParseQueryString(shardQueryString, parameterTypes, numParams);
+		PlannedStmt *localPlan = GetCachedLocalPlan(task, distributedPlan);
 
-		/*
-		 * We should not consider using CURSOR_OPT_FORCE_DISTRIBUTED in case of
-		 * intermediate results in the query. That'd trigger ExecuteLocalTaskPlan()
-		 * go through the distributed executor, which we do not want since the
-		 * query is already known to be local.
-		 */
-		cursorOptions = 0;
+		if (localPlan != NULL)
+		{
+			/*
+			 * The cached plan has been planned in an earlier execution, so we
+			 * should lock the relations ourselves. Locking might process the
+			 * invalidations, hence check whether the plan is still valid.
+			 */
+			AcquireLocalPlanLocks(localPlan);
 
-		/*
-		 * Altough the shardQuery is local to this node, we prefer planner()
-		 * over standard_planner(). The primary reason for that is Citus itself
-		 * is not very tolarent standard_planner() calls that doesn't go through
-		 * distributed_planner() because of the way that restriction hooks are
-		 * implemented. So, let planner to call distributed_planner() which
-		 * eventually calls standard_planner().
-		 */
-		localPlan = planner(shardQuery, cursorOptions, paramListInfo);
+			localPlan = GetCachedLocalPlan(task, distributedPlan);
+		}
+
+		if (localPlan == NULL)
+		{
+			int cursorOptions = 0;
+			Query *shardQuery = ParseQueryString(shardQueryString, parameterTypes,
+												 numParams);
+
+			/*
+			 * We should not consider using CURSOR_OPT_FORCE_DISTRIBUTED in case of
+			 * intermediate results in the query. That'd trigger ExecuteLocalTaskPlan()
+			 * go through the distributed executor, which we do not want since the
+			 * query is already known to be local.
+			 */
+			cursorOptions = 0;
+
+			/*
+			 * Altough the shardQuery is local to this node, we prefer planner()
+			 * over standard_planner(). The primary reason for that is Citus itself
+			 * is not very tolarent standard_planner() calls that doesn't go through
+			 * distributed_planner() because of the way that restriction hooks are
+			 * implemented. So, let planner to call distributed_planner() which
+			 * eventually calls standard_planner().
+			 */
+			localPlan = planner(shardQuery, cursorOptions, paramListInfo);
+		}
 
 		LogLocalCommand(shardQueryString);
 
+		RecordLocallyAccessedShards(task);
+
 		totalRowsProcessed +=
 			ExecuteLocalTaskPlan(scanState, localPlan, task->queryString);
 	}
@@ -200,12 +264,20 @@ ExtractParametersForLocalExecution(ParamListInfo paramListInfo, Oid **parameterT
  * (e.g., reference tables) where a single task ends in two seperate tasks
  * and the local task is added to localTaskList and the remanings to the
  * remoteTaskList.
+ *
+ * When partial local execution is enabled and local execution has already
+ * happened in the transaction, the single placement tasks on the local node
+ * that access shards which have not been accessed locally are added to the
+ * remoteTaskList, such that they can be executed in parallel.
  */
 void
 ExtractLocalAndRemoteTasks(bool readOnly, List *taskList, List **localTaskList,
 						   List **remoteTaskList)
 {
 	ListCell *taskCell = NULL;
+	bool onlyLocallyAccessedShards = PartialLocalExecutionInTransaction &&
+									 LocalExecutionHappened &&
+									 !LocallyAccessedReferenceTable;
 
 	*remoteTaskList = NIL;
 	*localTaskList = NIL;
@@ -234,6 +306,16 @@ ExtractLocalAndRemoteTasks(bool readOnly, List *taskList, List **localTaskList,
 			{
 				*remoteTaskList = lappend(*remoteTaskList, task);
 			}
+			else if (onlyLocallyAccessedShards &&
+					 !TaskAccessesLocallyAccessedShard(task))
+			{
+				/*
+				 * None of the shards that the task accesses have been touched by
+				 * this backend, so it is safe to let the adaptive executor execute
+				 * the task over a connection in parallel to the others.
+				 */
+				*remoteTaskList = lappend(*remoteTaskList, task);
+			}
 			else
 			{
 				*localTaskList = lappend(*localTaskList, task);
@@ -386,9 +468,9 @@ ShouldExecuteTasksLocally(List *taskList)
 		Assert(IsMultiStatementTransaction() || InCoordinatedTransaction());
 
 		/*
-		 * TODO: A future improvement could be to keep track of which placements
-		 * have been locally executed. At this point, only use local execution for
-		 * those placements. That'd help to benefit more from parallelism.
+		 * With citus.enable_partial_local_execution, ExtractLocalAndRemoteTasks()
+		 * only keeps the tasks on the locally accessed shards as local tasks, the
+		 * rest is executed in parallel by the adaptive executor.
 		 */
 
 		return true;
@@ -457,6 +539,142 @@ TaskAccessesLocalNode(Task *task)
 }
 
 
+/*
+ * RecordLocallyAccessedShards records the shards that the task accesses as
+ * locally accessed in the current transaction. It is a no-op unless partial
+ * local execution was enabled at the first local execution of the transaction.
+ */
+static void
+RecordLocallyAccessedShards(Task *task)
+{
+	ListCell *relationShardCell = NULL;
+
+	if (!PartialLocalExecutionInTransaction)
+	{
+		return;
+	}
+
+	if (task->anchorShardId != INVALID_SHARD_ID)
+	{
+		RecordLocallyAccessedShard(task->anchorShardId);
+	}
+
+	foreach(relationShardCell, task->relationShardList)
+	{
+		RelationShard *relationShard = (RelationShard *) lfirst(relationShardCell);
+
+		if (relationShard->shardId != INVALID_SHARD_ID)
+		{
+			RecordLocallyAccessedShard(relationShard->shardId);
+		}
+	}
+}
+
+
+/*
+ * RecordLocallyAccessedShard adds the given shard and its co-located shards to
+ * LocallyAccessedShardHash. The co-located shards are also recorded because
+ * foreign keys between co-located tables are enforced on the co-located shards,
+ * which should therefore be accessed by the same backend.
+ */
+static void
+RecordLocallyAccessedShard(uint64 shardId)
+{
+	ShardInterval *shardInterval = NULL;
+	List *colocatedShardList = NIL;
+	ListCell *colocatedShardCell = NULL;
+
+	if (ReferenceTableShardId(shardId))
+	{
+		LocallyAccessedReferenceTable = true;
+		return;
+	}
+
+	if (LocallyAccessedShardHash == NULL)
+	{
+		HASHCTL info;
+		int hashFlags = (HASH_ELEM | HASH_CONTEXT | HASH_BLOBS);
+
+		memset(&info, 0, sizeof(info));
+		info.keysize = sizeof(uint64);
+		info.entrysize = sizeof(uint64);
+		info.hcxt = TopTransactionContext;
+
+		LocallyAccessedShardHash = hash_create("Locally Accessed Shard Hash", 32,
+											   &info, hashFlags);
+	}
+	else if (hash_search(LocallyAccessedShardHash, &shardId, HASH_FIND, NULL) != NULL)
+	{
+		/* the shard and its co-located shards are already recorded */
+		return;
+	}
+
+	shardInterval = LoadShardInterval(shardId);
+	colocatedShardList = ColocatedShardIntervalList(shardInterval);
+
+	foreach(colocatedShardCell, colocatedShardList)
+	{
+		ShardInterval *colocatedShard = (ShardInterval *) lfirst(colocatedShardCell);
+		uint64 colocatedShardId = colocatedShard->shardId;
+
+		hash_search(LocallyAccessedShardHash, &colocatedShardId, HASH_ENTER, NULL);
+	}
+}
+
+
+/*
+ * TaskAccessesLocallyAccessedShard returns true if any of the shards that the
+ * task accesses has already been accessed via local execution in the current
+ * transaction.
+ */
+static bool
+TaskAccessesLocallyAccessedShard(Task *task)
+{
+	ListCell *relationShardCell = NULL;
+
+	if (LocallyAccessedShardHash == NULL)
+	{
+		return false;
+	}
+
+	if (task->anchorShardId != INVALID_SHARD_ID &&
+		hash_search(LocallyAccessedShardHash, &task->anchorShardId, HASH_FIND,
+					NULL) != NULL)
+	{
+		return true;
+	}
+
+	foreach(relationShardCell, task->relationShardList)
+	{
+		RelationShard *relationShard = (RelationShard *) lfirst(relationShardCell);
+
+		if (hash_search(LocallyAccessedShardHash, &relationShard->shardId, HASH_FIND,
+						NULL) != NULL)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+
+/*
+ * ResetLocalExecutionState resets the local execution state of the transaction,
+ * it is called at the end of each transaction.
+ */
+void
+ResetLocalExecutionState(void)
+{
+	LocalExecutionHappened = false;
+
+	/* the hash is allocated in TopTransactionContext, which goes away as well */
+	LocallyAccessedShardHash = NULL;
+	LocallyAccessedReferenceTable = false;
+	PartialLocalExecutionInTransaction = false;
+}
+
+
 /*
  * ErrorIfLocalExecutionHappened() errors out if a local query has already been executed
  * in the same transaction.
@@ -0,0 +1,344 @@
+/*-------------------------------------------------------------------------
+ *
+ * local_plan_cache.c
+ *
+ * Local plan cache for the local executor. When a distributed plan with a
+ * single local task is executed repeatedly (e.g., a prepared statement), we
+ * cache the local PlannedStmt of the shard query in the Job of the plan, and
+ * skip parsing and planning the shard query on the subsequent executions.
+ *
+ * The cached plans are kept in the memory context of the distributed plan,
+ * so they go away together with the (cached) distributed plan. Any relcache
+ * or function invalidation makes the cached local plans stale, in which case
+ * they are replanned on the next execution. Since the local plan might depend
+ * on the current role (e.g., row level security policies), the role and the
+ * row_security setting are part of the cache key.
+ *
+ * Copyright (c) 2019, Citus Data, Inc.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "miscadmin.h"
+
+#include "distributed/local_executor.h"
+#include "distributed/local_plan_cache.h"
+#include "distributed/metadata_cache.h"
+#include "distributed/multi_executor.h"
+#include "distributed/multi_physical_planner.h"
+#if PG_VERSION_NUM >= 120000
+#include "optimizer/optimizer.h"
+#else
+#include "optimizer/planner.h"
+#include "optimizer/prep.h"
+#endif
+#include "storage/lmgr.h"
+#include "utils/inval.h"
+#include "utils/memutils.h"
+#include "utils/rls.h"
+#include "utils/syscache.h"
+
+
+/*
+ * LocalPlanCacheGeneration is incremented on each relcache or function
+ * invalidation, cached local plans of older generations are considered stale.
+ */
+static uint64 LocalPlanCacheGeneration = 0;
+static bool LocalPlanCacheCallbacksRegistered = false;
+
+
+static void RegisterLocalPlanCacheCallbacks(void);
+static void InvalidateLocalPlanCacheRelcacheCallback(Datum argument, Oid relationId);
+static void InvalidateLocalPlanCacheSyscacheCallback(Datum argument, int cacheId,
+													 uint32 hashValue);
+static LocalPlannedStatement * FindLocalPlannedStatement(Job *workerJob, Task *task);
+
+
+/*
+ * IsLocalPlanCachingSupported returns true if the local plan of the single task
+ * of the given job can be cached in the job. We only cache plans that are being
+ * reused (e.g., prepared statements), since planning the shard query without
+ * the parameter values is a waste for one-off queries. The task's query string
+ * should not change across executions (e.g., no master evaluation), and the task
+ * should only have a placement on the local node.
+ */
+bool
+IsLocalPlanCachingSupported(Job *workerJob, DistributedPlan *originalDistributedPlan)
+{
+	Task *task = NULL;
+	ShardPlacement *taskPlacement = NULL;
+
+	if (!EnableLocalExecution || workerJob == NULL)
+	{
+		return false;
+	}
+
+	if (originalDistributedPlan->numberOfTimesExecuted < 1)
+	{
+		/* only cache if the plan is being reused, e.g., a prepared statement */
+		return false;
+	}
+
+	if (list_length(workerJob->taskList) != 1 || workerJob->requiresMasterEvaluation ||
+		workerJob->deferredPruning)
+	{
+		return false;
+	}
+
+	if (originalDistributedPlan->subPlanList != NIL)
+	{
+		/* the intermediate results are re-created on every execution */
+		return false;
+	}
+
+	task = (Task *) linitial(workerJob->taskList);
+	if (task->taskType != ROUTER_TASK && task->taskType != MODIFY_TASK)
+	{
+		return false;
+	}
+
+	if (task->anchorShardId == INVALID_SHARD_ID || task->queryString == NULL ||
+		list_length(task->taskPlacementList) != 1)
+	{
+		return false;
+	}
+
+	taskPlacement = (ShardPlacement *) linitial(task->taskPlacementList);
+	if (taskPlacement->groupId != GetLocalGroupId())
+	{
+		return false;
+	}
+
+	/* no need to plan if the task is not going to be executed locally */
+	return ShouldExecuteTasksLocally(workerJob->taskList);
+}
+
+
+/*
+ * CacheLocalPlanForShardQuery plans the query of the given task and caches the
+ * local plan in the worker job of the original distributed plan, unless there is
+ * already a valid plan in the cache. The shard query is planned without the
+ * parameter values, such that the plan can be reused with any parameters.
+ */
+void
+CacheLocalPlanForShardQuery(Task *task, DistributedPlan *originalDistributedPlan,
+							ParamListInfo paramListInfo)
+{
+	Job *workerJob = originalDistributedPlan->workerJob;
+	MemoryContext planContext = GetMemoryChunkContext(originalDistributedPlan);
+	MemoryContext localPlanContext = NULL;
+	MemoryContext oldContext = NULL;
+	LocalPlannedStatement *localPlannedStatement = NULL;
+	Oid *parameterTypes = NULL;
+	int numParams = 0;
+	Query *shardQuery = NULL;
+	PlannedStmt *localPlan = NULL;
+
+	RegisterLocalPlanCacheCallbacks();
+
+	localPlannedStatement = FindLocalPlannedStatement(workerJob, task);
+	if (localPlannedStatement != NULL)
+	{
+		if (localPlannedStatement->cacheGeneration == LocalPlanCacheGeneration &&
+			strcmp(localPlannedStatement->queryString, task->queryString) == 0)
+		{
+			/* we already have a valid plan */
+			return;
+		}
+
+		/* the plan is stale, throw it away */
+		workerJob->localPlannedStatements =
+			list_delete_ptr(workerJob->localPlannedStatements, localPlannedStatement);
+
+		localPlanContext = GetMemoryChunkContext(localPlannedStatement);
+		if (MemoryContextGetParent(localPlanContext) == planContext)
+		{
+			MemoryContextDelete(localPlanContext);
+		}
+	}
+
+	if (paramListInfo != NULL)
+	{
+		const char **parameterValues = NULL;
+
+		ExtractParametersFromParamList(paramListInfo, &parameterTypes,
+									   &parameterValues, true);
+		numParams = paramListInfo->numParams;
+	}
+
+	/* see the comments in ExecuteLocalTaskList() on why we use planner() */
+	shardQuery = ParseQueryString(task->queryString, parameterTypes, numParams);
+	localPlan = planner(shardQuery, 0, NULL);
+
+	localPlanContext = AllocSetContextCreate(planContext, "Local Plan Context",
+											 ALLOCSET_SMALL_SIZES);
+
+	oldContext = MemoryContextSwitchTo(localPlanContext);
+
+	localPlannedStatement = CitusMakeNode(LocalPlannedStatement);
+	localPlannedStatement->shardId = task->anchorShardId;
+	localPlannedStatement->localGroupId = GetLocalGroupId();
+	localPlannedStatement->queryString = pstrdup(task->queryString);
+	localPlannedStatement->userId = GetUserId();
+	localPlannedStatement->rowSecurity = row_security;
+	localPlannedStatement->cacheGeneration = LocalPlanCacheGeneration;
+	localPlannedStatement->localPlan = copyObject(localPlan);
+
+	MemoryContextSwitchTo(planContext);
+
+	workerJob->localPlannedStatements =
+		lappend(workerJob->localPlannedStatements, localPlannedStatement);
+
+	MemoryContextSwitchTo(oldContext);
+}
+
+
+/*
+ * GetCachedLocalPlan returns the cached local plan for the given task if there
+ * is a valid one in the worker job of the distributed plan, and NULL otherwise.
+ */
+PlannedStmt *
+GetCachedLocalPlan(Task *task, DistributedPlan *distributedPlan)
+{
+	LocalPlannedStatement *localPlannedStatement = NULL;
+
+	if (distributedPlan->workerJob == NULL || task->queryString == NULL)
+	{
+		return NULL;
+	}
+
+	localPlannedStatement = FindLocalPlannedStatement(distributedPlan->workerJob, task);
+	if (localPlannedStatement == NULL ||
+		localPlannedStatement->cacheGeneration != LocalPlanCacheGeneration ||
+		strcmp(localPlannedStatement->queryString, task->queryString) != 0)
+	{
+		return NULL;
+	}
+
+	return localPlannedStatement->localPlan;
+}
+
+
+/*
+ * AcquireLocalPlanLocks acquires the locks on the relations of the given cached
+ * local plan, in the same way PostgreSQL does for its cached plans. Note that
+ * acquiring the locks might process invalidation messages, so the callers
+ * should re-check the validity of the plan afterwards.
+ */
+void
+AcquireLocalPlanLocks(PlannedStmt *localPlan)
+{
+	ListCell *rangeTableCell = NULL;
+	Index rangeTableIndex = 0;
+
+	foreach(rangeTableCell, localPlan->rtable)
+	{
+		RangeTblEntry *rangeTableEntry = (RangeTblEntry *) lfirst(rangeTableCell);
+		LOCKMODE lockMode = AccessShareLock;
+
+		rangeTableIndex++;
+
+		if (rangeTableEntry->rtekind != RTE_RELATION)
+		{
+			continue;
+		}
+
+#if PG_VERSION_NUM >= 120000
+		lockMode = rangeTableEntry->rellockmode;
+#else
+		if (list_member_int(localPlan->resultRelations, rangeTableIndex) ||
+			list_member_int(localPlan->nonleafResultRelations, rangeTableIndex))
+		{
+			lockMode = RowExclusiveLock;
+		}
+		else
+		{
+			PlanRowMark *rowMark = get_plan_rowmark(localPlan->rowMarks,
+													rangeTableIndex);
+
+			if (rowMark != NULL && RowMarkRequiresRowShareLock(rowMark->markType))
+			{
+				lockMode = RowShareLock;
+			}
+		}
+#endif
+
+		LockRelationOid(rangeTableEntry->relid, lockMode);
+	}
+}
+
+
+/*
+ * FindLocalPlannedStatement returns the cached local plan entry for the anchor
+ * shard of the task on this node for the current role and row_security setting,
+ * regardless of its validity.
+ */
+static LocalPlannedStatement *
+FindLocalPlannedStatement(Job *workerJob, Task *task)
+{
+	ListCell *localPlanCell = NULL;
+	int32 localGroupId = GetLocalGroupId();
+	Oid userId = GetUserId();
+
+	foreach(localPlanCell, workerJob->localPlannedStatements)
+	{
+		LocalPlannedStatement *localPlannedStatement =
+			(LocalPlannedStatement *) lfirst(localPlanCell);
+
+		if (localPlannedStatement->shardId == task->anchorShardId &&
+			localPlannedStatement->localGroupId == localGroupId &&
+			localPlannedStatement->userId == userId &&
+			localPlannedStatement->rowSecurity == row_security)
+		{
+			return localPlannedStatement;
+		}
+	}
+
+	return NULL;
+}
+
+
+/*
+ * RegisterLocalPlanCacheCallbacks registers the invalidation callbacks of the
+ * local plan cache, once per backend.
+ */
+static void
+RegisterLocalPlanCacheCallbacks(void)
+{
+	if (LocalPlanCacheCallbacksRegistered)
+	{
+		return;
+	}
+
+	CacheRegisterRelcacheCallback(InvalidateLocalPlanCacheRelcacheCallback,
+								  (Datum) 0);
+	CacheRegisterSyscacheCallback(PROCOID, InvalidateLocalPlanCacheSyscacheCallback,
+								  (Datum) 0);
+
+	LocalPlanCacheCallbacksRegistered = true;
+}
+
+
+/*
+ * InvalidateLocalPlanCacheRelcacheCallback makes all the cached local plans
+ * stale. We do not keep track of the relations that each plan depends on, since
+ * relcache invalidations are rare compared to the executions of cached plans.
+ */
+static void
+InvalidateLocalPlanCacheRelcacheCallback(Datum argument, Oid relationId)
+{
+	LocalPlanCacheGeneration++;
+}
+
+
+/*
+ * InvalidateLocalPlanCacheSyscacheCallback makes all the cached local plans
+ * stale when a function changes, since the plans might have inlined it.
+ */
+static void
+InvalidateLocalPlanCacheSyscacheCallback(Datum argument, int cacheId, uint32 hashValue)
+{
+	LocalPlanCacheGeneration++;
+}
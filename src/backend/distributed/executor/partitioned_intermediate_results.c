@@ -0,0 +1,478 @@
+/*-------------------------------------------------------------------------
+ *
+ * partitioned_intermediate_results.c
+ *   Functions for writing partitioned intermediate results.
+ *
+ * Copyright (c) Citus Data, Inc.
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+#include "funcapi.h"
+#include "miscadmin.h"
+
+#include "access/hash.h"
+#include "access/nbtree.h"
+#include "catalog/pg_am.h"
+#include "catalog/pg_type.h"
+#include "distributed/intermediate_results.h"
+#include "distributed/metadata_cache.h"
+#include "distributed/multi_executor.h"
+#include "distributed/pg_dist_partition.h"
+#include "distributed/shardinterval_utils.h"
+#include "distributed/tuplestore.h"
+#include "distributed/worker_protocol.h"
+#include "nodes/makefuncs.h"
+#include "nodes/parsenodes.h"
+#include "utils/array.h"
+#include "utils/builtins.h"
+#include "utils/lsyscache.h"
+#include "utils/memutils.h"
+
+
+/*
+ * PartitionedResultDestReceiver is used for streaming the results of a query
+ * into a set of local intermediate result files, one per partition. The
+ * partition of a tuple is determined by its partition column value, using
+ * the shard ranges of a target table.
+ */
+typedef struct PartitionedResultDestReceiver
+{
+	/* public DestReceiver interface */
+	DestReceiver pub;
+
+	/* prefix of the result IDs, the partition index is appended to it */
+	char *resultIdPrefix;
+
+	/* index of the partition column in the tuples */
+	int partitionColumnIndex;
+
+	/* partition method and text representations of the partition ranges */
+	char partitionMethod;
+	ArrayType *minValuesArray;
+	ArrayType *maxValuesArray;
+
+	/* partition ranges in the form used for shard pruning, set on startup */
+	DistTableCacheEntry *shardSearchInfo;
+
+	/* collation to use for hashing the partition column */
+	Oid partitionColumnCollation;
+
+	/* EState for per-tuple memory allocation */
+	EState *executorState;
+
+	/* MemoryContext for DestReceiver session */
+	MemoryContext memoryContext;
+
+	/* descriptor of the tuples that are written */
+	TupleDesc tupleDescriptor;
+
+	/* file receivers of the partitions, started on their first tuple */
+	int partitionCount;
+	DestReceiver **partitionDestReceivers;
+	uint64 *partitionRowCounts;
+} PartitionedResultDestReceiver;
+
+
+static DestReceiver * CreatePartitionedResultDestReceiver(char *resultIdPrefix,
+														  int partitionColumnIndex,
+														  char partitionMethod,
+														  ArrayType *minValuesArray,
+														  ArrayType *maxValuesArray,
+														  EState *executorState);
+static void PartitionedResultDestReceiverStartup(DestReceiver *dest, int operation,
+												 TupleDesc inputTupleDescriptor);
+static bool PartitionedResultDestReceiverReceive(TupleTableSlot *slot,
+												 DestReceiver *dest);
+static void PartitionedResultDestReceiverShutdown(DestReceiver *destReceiver);
+static void PartitionedResultDestReceiverDestroy(DestReceiver *destReceiver);
+static DistTableCacheEntry * QueryTupleShardSearchInfo(ArrayType *minValuesArray,
+													   ArrayType *maxValuesArray,
+													   char partitionMethod,
+													   Oid partitionColumnType);
+static char LookupPartitionMethod(Oid partitionMethodOid);
+
+
+/* exports for SQL callable functions */
+PG_FUNCTION_INFO_V1(worker_partition_query_result);
+
+
+/*
+ * worker_partition_query_result executes a query and writes its results into
+ * a set of local intermediate result files, one for each of the given
+ * partition ranges. The result ID of a partition is the given prefix followed
+ * by an underscore and the index of the partition.
+ *
+ * The partition ranges are given as text representations of the shard min and
+ * max values of the target table, in the order of its sorted shard intervals.
+ * For hash partitioning, the ranges are hash token ranges and the partition
+ * column value is hashed with the hash function of its type.
+ *
+ * The function returns the partition index, number of rows and number of
+ * bytes written for each partition that received at least one row. No files
+ * are created for empty partitions.
+ */
+Datum
+worker_partition_query_result(PG_FUNCTION_ARGS)
+{
+	text *resultIdPrefixText = PG_GETARG_TEXT_P(0);
+	char *resultIdPrefix = text_to_cstring(resultIdPrefixText);
+	text *queryText = PG_GETARG_TEXT_P(1);
+	char *queryString = text_to_cstring(queryText);
+	int partitionColumnIndex = PG_GETARG_INT32(2);
+	Oid partitionMethodOid = PG_GETARG_OID(3);
+	ArrayType *minValuesArray = PG_GETARG_ARRAYTYPE_P(4);
+	ArrayType *maxValuesArray = PG_GETARG_ARRAYTYPE_P(5);
+	char partitionMethod = 0;
+	Query *query = NULL;
+	EState *estate = NULL;
+	PartitionedResultDestReceiver *resultDest = NULL;
+	ParamListInfo paramListInfo = NULL;
+	Tuplestorestate *tupleStore = NULL;
+	TupleDesc returnTupleDesc = NULL;
+	int partitionIndex = 0;
+
+	CheckCitusVersion(ERROR);
+
+	partitionMethod = LookupPartitionMethod(partitionMethodOid);
+
+	if (ArrayObjectCount(minValuesArray) != ArrayObjectCount(maxValuesArray))
+	{
+		ereport(ERROR, (errmsg("min values and max values must have the same "
+							   "number of elements")));
+	}
+
+	query = ParseQueryString(queryString, NULL, 0);
+	if (query->commandType != CMD_SELECT)
+	{
+		ereport(ERROR, (errmsg("query must be a SELECT query")));
+	}
+
+	estate = CreateExecutorState();
+	resultDest = (PartitionedResultDestReceiver *)
+				 CreatePartitionedResultDestReceiver(resultIdPrefix, partitionColumnIndex,
+													 partitionMethod, minValuesArray,
+													 maxValuesArray, estate);
+
+	ExecuteQueryIntoDestReceiver(query, paramListInfo, (DestReceiver *) resultDest);
+
+	tupleStore = SetupTuplestore(fcinfo, &returnTupleDesc);
+
+	for (partitionIndex = 0; partitionIndex < resultDest->partitionCount;
+		 partitionIndex++)
+	{
+		DestReceiver *partitionDest = resultDest->partitionDestReceivers[partitionIndex];
+		Datum values[3];
+		bool nulls[3];
+
+		if (partitionDest == NULL)
+		{
+			continue;
+		}
+
+		memset(values, 0, sizeof(values));
+		memset(nulls, 0, sizeof(nulls));
+
+		values[0] = Int32GetDatum(partitionIndex);
+		values[1] = UInt64GetDatum(resultDest->partitionRowCounts[partitionIndex]);
+		values[2] = UInt64GetDatum(RemoteFileDestReceiverBytesSent(partitionDest));
+
+		tuplestore_putvalues(tupleStore, returnTupleDesc, values, nulls);
+	}
+
+	tuplestore_donestoring(tupleStore);
+
+	resultDest->pub.rDestroy((DestReceiver *) resultDest);
+	FreeExecutorState(estate);
+
+	return (Datum) 0;
+}
+
+
+/*
+ * CreatePartitionedResultDestReceiver creates a DestReceiver that writes the
+ * tuples it receives into per-partition local intermediate result files.
+ */
+static DestReceiver *
+CreatePartitionedResultDestReceiver(char *resultIdPrefix, int partitionColumnIndex,
+									char partitionMethod, ArrayType *minValuesArray,
+									ArrayType *maxValuesArray, EState *executorState)
+{
+	PartitionedResultDestReceiver *resultDest =
+		palloc0(sizeof(PartitionedResultDestReceiver));
+	int partitionCount = ArrayObjectCount(minValuesArray);
+
+	/* set up the DestReceiver function pointers */
+	resultDest->pub.receiveSlot = PartitionedResultDestReceiverReceive;
+	resultDest->pub.rStartup = PartitionedResultDestReceiverStartup;
+	resultDest->pub.rShutdown = PartitionedResultDestReceiverShutdown;
+	resultDest->pub.rDestroy = PartitionedResultDestReceiverDestroy;
+	resultDest->pub.mydest = DestCopyOut;
+
+	resultDest->resultIdPrefix = resultIdPrefix;
+	resultDest->partitionColumnIndex = partitionColumnIndex;
+	resultDest->partitionMethod = partitionMethod;
+	resultDest->minValuesArray = minValuesArray;
+	resultDest->maxValuesArray = maxValuesArray;
+	resultDest->executorState = executorState;
+	resultDest->memoryContext = CurrentMemoryContext;
+
+	resultDest->partitionCount = partitionCount;
+	resultDest->partitionDestReceivers = palloc0(partitionCount * sizeof(DestReceiver *));
+	resultDest->partitionRowCounts = palloc0(partitionCount * sizeof(uint64));
+
+	return (DestReceiver *) resultDest;
+}
+
+
+/*
+ * PartitionedResultDestReceiverStartup implements the rStartup interface of
+ * PartitionedResultDestReceiver. Now that the type of the partition column is
+ * known, it converts the partition ranges into shard intervals for pruning.
+ */
+static void
+PartitionedResultDestReceiverStartup(DestReceiver *dest, int operation,
+									 TupleDesc inputTupleDescriptor)
+{
+	PartitionedResultDestReceiver *resultDest = (PartitionedResultDestReceiver *) dest;
+	int partitionColumnIndex = resultDest->partitionColumnIndex;
+	Form_pg_attribute partitionColumnAttr = NULL;
+
+	if (partitionColumnIndex < 0 || partitionColumnIndex >= inputTupleDescriptor->natts)
+	{
+		ereport(ERROR, (errmsg("partition column index must be between 0 and %d",
+							   inputTupleDescriptor->natts - 1)));
+	}
+
+	partitionColumnAttr = TupleDescAttr(inputTupleDescriptor, partitionColumnIndex);
+
+	resultDest->tupleDescriptor = inputTupleDescriptor;
+	resultDest->partitionColumnCollation = partitionColumnAttr->attcollation;
+	resultDest->shardSearchInfo =
+		QueryTupleShardSearchInfo(resultDest->minValuesArray,
+								  resultDest->maxValuesArray,
+								  resultDest->partitionMethod,
+								  partitionColumnAttr->atttypid);
+}
+
+
+/*
+ * PartitionedResultDestReceiverReceive implements the receiveSlot function of
+ * PartitionedResultDestReceiver. It finds the partition of the tuple and
+ * passes the tuple on to the file receiver of that partition.
+ */
+static bool
+PartitionedResultDestReceiverReceive(TupleTableSlot *slot, DestReceiver *dest)
+{
+	PartitionedResultDestReceiver *resultDest = (PartitionedResultDestReceiver *) dest;
+	DistTableCacheEntry *shardSearchInfo = resultDest->shardSearchInfo;
+	int partitionColumnIndex = resultDest->partitionColumnIndex;
+	DestReceiver *partitionDest = NULL;
+	Datum partitionColumnValue = 0;
+	int partitionIndex = INVALID_SHARD_INDEX;
+
+	EState *executorState = resultDest->executorState;
+	MemoryContext executorTupleContext = GetPerTupleMemoryContext(executorState);
+	MemoryContext oldContext = MemoryContextSwitchTo(executorTupleContext);
+
+	slot_getallattrs(slot);
+
+	if (slot->tts_isnull[partitionColumnIndex])
+	{
+		ereport(ERROR, (errcode(ERRCODE_NULL_VALUE_NOT_ALLOWED),
+						errmsg("the partition column value cannot be NULL")));
+	}
+
+	partitionColumnValue = slot->tts_values[partitionColumnIndex];
+
+	if (shardSearchInfo->partitionMethod == DISTRIBUTE_BY_HASH)
+	{
+		partitionColumnValue = FunctionCall1Coll(shardSearchInfo->hashFunction,
+												 resultDest->partitionColumnCollation,
+												 partitionColumnValue);
+	}
+
+	partitionIndex = FindShardIntervalIndex(partitionColumnValue, shardSearchInfo);
+	if (partitionIndex == INVALID_SHARD_INDEX)
+	{
+		ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+						errmsg("could not find shard for partition column value")));
+	}
+
+	MemoryContextSwitchTo(oldContext);
+
+	partitionDest = resultDest->partitionDestReceivers[partitionIndex];
+	if (partitionDest == NULL)
+	{
+		StringInfo resultId = NULL;
+		List *nodeList = NIL;
+		bool writeLocalFile = true;
+
+		oldContext = MemoryContextSwitchTo(resultDest->memoryContext);
+
+		resultId = makeStringInfo();
+		appendStringInfo(resultId, "%s_%d", resultDest->resultIdPrefix,
+						 partitionIndex);
+
+		partitionDest = CreateRemoteFileDestReceiver(resultId->data, executorState,
+													 nodeList, writeLocalFile);
+		partitionDest->rStartup(partitionDest, 0, resultDest->tupleDescriptor);
+
+		resultDest->partitionDestReceivers[partitionIndex] = partitionDest;
+
+		MemoryContextSwitchTo(oldContext);
+	}
+
+	partitionDest->receiveSlot(slot, partitionDest);
+	resultDest->partitionRowCounts[partitionIndex]++;
+
+	return true;
+}
+
+
+/*
+ * PartitionedResultDestReceiverShutdown implements the rShutdown interface of
+ * PartitionedResultDestReceiver. It closes the files of all partitions.
+ */
+static void
+PartitionedResultDestReceiverShutdown(DestReceiver *destReceiver)
+{
+	PartitionedResultDestReceiver *resultDest =
+		(PartitionedResultDestReceiver *) destReceiver;
+	int partitionIndex = 0;
+
+	for (partitionIndex = 0; partitionIndex < resultDest->partitionCount;
+		 partitionIndex++)
+	{
+		DestReceiver *partitionDest = resultDest->partitionDestReceivers[partitionIndex];
+		if (partitionDest != NULL)
+		{
+			partitionDest->rShutdown(partitionDest);
+		}
+	}
+}
+
+
+/*
+ * PartitionedResultDestReceiverDestroy implements the rDestroy interface of
+ * PartitionedResultDestReceiver.
+ */
+static void
+PartitionedResultDestReceiverDestroy(DestReceiver *destReceiver)
+{
+	PartitionedResultDestReceiver *resultDest =
+		(PartitionedResultDestReceiver *) destReceiver;
+	int partitionIndex = 0;
+
+	for (partitionIndex = 0; partitionIndex < resultDest->partitionCount;
+		 partitionIndex++)
+	{
+		DestReceiver *partitionDest = resultDest->partitionDestReceivers[partitionIndex];
+		if (partitionDest != NULL)
+		{
+			partitionDest->rDestroy(partitionDest);
+		}
+	}
+
+	pfree(resultDest->partitionDestReceivers);
+	pfree(resultDest->partitionRowCounts);
+	pfree(resultDest);
+}
+
+
+/*
+ * QueryTupleShardSearchInfo returns a DistTableCacheEntry which has enough
+ * information to find the partition of a tuple with FindShardIntervalIndex().
+ * Like the synthetic shard intervals used by worker_hash_partition_table(),
+ * the entry is only filled with the fields that are needed for that.
+ */
+static DistTableCacheEntry *
+QueryTupleShardSearchInfo(ArrayType *minValuesArray, ArrayType *maxValuesArray,
+						  char partitionMethod, Oid partitionColumnType)
+{
+	Datum *minValues = DeconstructArrayObject(minValuesArray);
+	Datum *maxValues = DeconstructArrayObject(maxValuesArray);
+	int partitionCount = ArrayObjectCount(minValuesArray);
+	ShardInterval **shardIntervalArray = NULL;
+	DistTableCacheEntry *shardSearchInfo = NULL;
+	Oid intervalTypeId = partitionColumnType;
+	FmgrInfo *hashFunction = NULL;
+	Oid typeInputFunctionId = InvalidOid;
+	Oid typeIoParam = InvalidOid;
+	int partitionIndex = 0;
+
+	if (partitionMethod == DISTRIBUTE_BY_HASH)
+	{
+		/* hash partitions are ranges of hash tokens */
+		intervalTypeId = INT4OID;
+		hashFunction = GetFunctionInfo(partitionColumnType, HASH_AM_OID,
+									   HASHSTANDARD_PROC);
+	}
+
+	getTypeInputInfo(intervalTypeId, &typeInputFunctionId, &typeIoParam);
+
+	shardIntervalArray = palloc0(partitionCount * sizeof(ShardInterval *));
+
+	for (partitionIndex = 0; partitionIndex < partitionCount; partitionIndex++)
+	{
+		ShardInterval *shardInterval = CitusMakeNode(ShardInterval);
+		char *minValueString = TextDatumGetCString(minValues[partitionIndex]);
+		char *maxValueString = TextDatumGetCString(maxValues[partitionIndex]);
+
+		shardInterval->valueTypeId = intervalTypeId;
+		shardInterval->minValueExists = true;
+		shardInterval->minValue = OidInputFunctionCall(typeInputFunctionId,
+													   minValueString, typeIoParam, -1);
+		shardInterval->maxValueExists = true;
+		shardInterval->maxValue = OidInputFunctionCall(typeInputFunctionId,
+													   maxValueString, typeIoParam, -1);
+
+		shardIntervalArray[partitionIndex] = shardInterval;
+	}
+
+	shardSearchInfo = palloc0(sizeof(DistTableCacheEntry));
+	shardSearchInfo->partitionMethod = partitionMethod;
+	shardSearchInfo->sortedShardIntervalArray = shardIntervalArray;
+	shardSearchInfo->shardIntervalArrayLength = partitionCount;
+	shardSearchInfo->shardIntervalCompareFunction =
+		GetFunctionInfo(intervalTypeId, BTREE_AM_OID, BTORDER_PROC);
+	shardSearchInfo->hashFunction = hashFunction;
+
+	if (partitionMethod == DISTRIBUTE_BY_HASH)
+	{
+		shardSearchInfo->hasUniformHashDistribution =
+			HasUniformHashDistribution(shardIntervalArray, partitionCount);
+	}
+
+	return shardSearchInfo;
+}
+
+
+/*
+ * LookupPartitionMethod maps the oid of a citus.distribution_type enum value
+ * to the partition method it represents. Only hash and range partitioning
+ * are supported for partitioning query results.
+ */
+static char
+LookupPartitionMethod(Oid partitionMethodOid)
+{
+	Datum partitionMethodLabelDatum = DirectFunctionCall1(enum_out, partitionMethodOid);
+	char *partitionMethodLabel = DatumGetCString(partitionMethodLabelDatum);
+	char partitionMethod = 0;
+
+	if (strncmp(partitionMethodLabel, "hash", NAMEDATALEN) == 0)
+	{
+		partitionMethod = DISTRIBUTE_BY_HASH;
+	}
+	else if (strncmp(partitionMethodLabel, "range", NAMEDATALEN) == 0)
+	{
+		partitionMethod = DISTRIBUTE_BY_RANGE;
+	}
+	else
+	{
+		ereport(ERROR, (errmsg("only hash and range partitioning is supported for "
+							   "partitioning query results")));
+	}
+
+	return partitionMethod;
+}
@@ -23,6 +23,7 @@
 #include "access/xact.h"
 #include "catalog/dependency.h"
 #include "catalog/indexing.h"
+#include "catalog/pg_class.h"
 #include "catalog/pg_constraint.h"
 #include "catalog/pg_extension.h"
 #include "catalog/pg_namespace.h"
@@ -664,6 +665,61 @@ ShardLength(uint64 shardId)
 }
 
 
+/*
+ * TableShardLengthSum returns the sum of the shard lengths of the given
+ * distributed table, as recorded in the metadata. The shard lengths are only
+ * as fresh as the last shard statistics update, which makes this a cheap
+ * size estimate that does not need to contact the workers.
+ */
+uint64
+TableShardLengthSum(Oid relationId)
+{
+	uint64 tableLength = 0;
+	List *shardList = LoadShardList(relationId);
+	ListCell *shardCell = NULL;
+
+	foreach(shardCell, shardList)
+	{
+		uint64 *shardIdPointer = (uint64 *) lfirst(shardCell);
+		uint64 shardId = (*shardIdPointer);
+
+		tableLength += ShardLength(shardId);
+	}
+
+	return tableLength;
+}
+
+
+/*
+ * TableSizeEstimate returns the estimated size of the given distributed table
+ * in bytes. It uses the shard lengths in the metadata when they are known, and
+ * otherwise the number of pages that a distributed ANALYZE stored in the
+ * pg_class entry of the table. A return value of 0 means that the size of the
+ * table is unknown.
+ */
+uint64
+TableSizeEstimate(Oid relationId)
+{
+	uint64 tableSize = TableShardLengthSum(relationId);
+
+	if (tableSize == 0)
+	{
+		HeapTuple classTuple = SearchSysCache1(RELOID, ObjectIdGetDatum(relationId));
+
+		if (HeapTupleIsValid(classTuple))
+		{
+			Form_pg_class classForm = (Form_pg_class) GETSTRUCT(classTuple);
+
+			tableSize = (uint64) classForm->relpages * BLCKSZ;
+
+			ReleaseSysCache(classTuple);
+		}
+	}
+
+	return tableSize;
+}
+
+
 /*
  * NodeGroupHasShardPlacements returns whether any active shards are placed on the group
  */
@@ -1286,6 +1342,65 @@ UpdateShardPlacementState(uint64 placementId, char shardState)
 }
 
 
+/*
+ * UpdateShardPlacementLength sets the shardLength for the placement identified
+ * by placementId. It returns false if the placement no longer exists.
+ *
+ * Since sizes are typically updated for many placements at once, the function
+ * does not invalidate the relcache of the distributed table or increment the
+ * command counter. The caller should do so once per table after updating all
+ * of its placements.
+ */
+bool
+UpdateShardPlacementLength(uint64 placementId, uint64 shardLength)
+{
+	Relation pgDistPlacement = NULL;
+	SysScanDesc scanDescriptor = NULL;
+	ScanKeyData scanKey[1];
+	int scanKeyCount = 1;
+	bool indexOK = true;
+	HeapTuple heapTuple = NULL;
+	TupleDesc tupleDescriptor = NULL;
+	Datum values[Natts_pg_dist_placement];
+	bool isnull[Natts_pg_dist_placement];
+	bool replace[Natts_pg_dist_placement];
+
+	pgDistPlacement = heap_open(DistPlacementRelationId(), RowExclusiveLock);
+	tupleDescriptor = RelationGetDescr(pgDistPlacement);
+	ScanKeyInit(&scanKey[0], Anum_pg_dist_placement_placementid,
+				BTEqualStrategyNumber, F_INT8EQ, Int64GetDatum(placementId));
+
+	scanDescriptor = systable_beginscan(pgDistPlacement,
+										DistPlacementPlacementidIndexId(), indexOK,
+										NULL, scanKeyCount, scanKey);
+
+	heapTuple = systable_getnext(scanDescriptor);
+	if (!HeapTupleIsValid(heapTuple))
+	{
+		/* placement was removed concurrently */
+		systable_endscan(scanDescriptor);
+		heap_close(pgDistPlacement, NoLock);
+
+		return false;
+	}
+
+	memset(replace, 0, sizeof(replace));
+
+	values[Anum_pg_dist_placement_shardlength - 1] = Int64GetDatum(shardLength);
+	isnull[Anum_pg_dist_placement_shardlength - 1] = false;
+	replace[Anum_pg_dist_placement_shardlength - 1] = true;
+
+	heapTuple = heap_modify_tuple(heapTuple, tupleDescriptor, values, isnull, replace);
+
+	CatalogTupleUpdate(pgDistPlacement, &heapTuple->t_self, heapTuple);
+
+	systable_endscan(scanDescriptor);
+	heap_close(pgDistPlacement, NoLock);
+
+	return true;
+}
+
+
 /*
  * Check that the current user has `mode` permissions on relationId, error out
  * if not. Superusers always have such permissions.
@@ -62,11 +62,17 @@ static List * RelationShardListForShardCreate(ShardInterval *shardInterval);
 static bool WorkerShardStats(ShardPlacement *placement, Oid relationId,
 							 char *shardName, uint64 *shardSize,
 							 text **shardMinValue, text **shardMaxValue);
+static void AppendShardSizeQueryValues(DistTableCacheEntry *cacheEntry,
+									   List *workerNodeList,
+									   StringInfo *nodeValuesArray);
+static uint64 UpdatePlacementLengthsFromResult(PGresult *result,
+												List **updatedRelationIdList);
 
 /* exports for SQL callable functions */
 PG_FUNCTION_INFO_V1(master_create_empty_shard);
 PG_FUNCTION_INFO_V1(master_append_table_to_shard);
 PG_FUNCTION_INFO_V1(master_update_shard_statistics);
+PG_FUNCTION_INFO_V1(citus_update_shard_sizes);
 
 
 /*
@@ -361,6 +367,22 @@ master_update_shard_statistics(PG_FUNCTION_ARGS)
 }
 
 
+/*
+ * citus_update_shard_sizes refreshes the sizes of the shard placements of all
+ * hash-distributed tables, without waiting for the maintenance daemon.
+ */
+Datum
+citus_update_shard_sizes(PG_FUNCTION_ARGS)
+{
+	CheckCitusVersion(ERROR);
+	EnsureCoordinator();
+
+	UpdateShardSizes();
+
+	PG_RETURN_VOID();
+}
+
+
 /*
  * CheckDistributedTable checks if the given relationId corresponds to a
  * distributed table. If it does not, the function errors out.
@@ -873,6 +895,267 @@ UpdateShardStatistics(int64 shardId)
 }
 
 
+/*
+ * UpdateShardSizes fetches the sizes of the shard placements of all
+ * hash-distributed tables from the workers, using a single query per worker
+ * that is sent to all workers in parallel, and stores the sizes that changed
+ * in pg_dist_placement. Workers that cannot be reached are skipped with a
+ * warning. The relcache of each table whose sizes changed is invalidated once,
+ * after all of its placements are updated. The function returns the number of
+ * placements that were updated.
+ */
+uint64
+UpdateShardSizes(void)
+{
+	List *workerNodeList = ActivePrimaryNodeList(NoLock);
+	int workerNodeCount = list_length(workerNodeList);
+	StringInfo *nodeValuesArray = palloc0(workerNodeCount * sizeof(StringInfo));
+	List *distTableList = DistributedTableList();
+	List *connectionList = NIL;
+	List *queryList = NIL;
+	List *updatedRelationIdList = NIL;
+	ListCell *distTableCell = NULL;
+	ListCell *workerNodeCell = NULL;
+	ListCell *connectionCell = NULL;
+	ListCell *queryCell = NULL;
+	ListCell *relationIdCell = NULL;
+	uint64 updatedPlacementCount = 0;
+	int workerNodeIndex = 0;
+
+	foreach(distTableCell, distTableList)
+	{
+		DistTableCacheEntry *cacheEntry = (DistTableCacheEntry *) lfirst(distTableCell);
+
+		if (cacheEntry->partitionMethod != DISTRIBUTE_BY_HASH ||
+			CStoreTable(cacheEntry->relationId))
+		{
+			continue;
+		}
+
+		AppendShardSizeQueryValues(cacheEntry, workerNodeList, nodeValuesArray);
+	}
+
+	/* open connections in parallel to the workers that have placements */
+	foreach(workerNodeCell, workerNodeList)
+	{
+		WorkerNode *workerNode = (WorkerNode *) lfirst(workerNodeCell);
+		StringInfo nodeValues = nodeValuesArray[workerNodeIndex++];
+		StringInfo sizeQuery = NULL;
+		MultiConnection *connection = NULL;
+		uint32 connectionFlags = 0;
+
+		if (nodeValues == NULL)
+		{
+			continue;
+		}
+
+		sizeQuery = makeStringInfo();
+		appendStringInfo(sizeQuery, SHARD_PLACEMENT_SIZES_QUERY, nodeValues->data);
+
+		connection = StartNodeConnection(connectionFlags, workerNode->workerName,
+										 workerNode->workerPort);
+
+		connectionList = lappend(connectionList, connection);
+		queryList = lappend(queryList, sizeQuery->data);
+	}
+
+	FinishConnectionListEstablishment(connectionList);
+
+	/* send the queries in parallel */
+	forboth(connectionCell, connectionList, queryCell, queryList)
+	{
+		MultiConnection *connection = (MultiConnection *) lfirst(connectionCell);
+		char *sizeQuery = (char *) lfirst(queryCell);
+
+		if (PQstatus(connection->pgConn) != CONNECTION_OK ||
+			SendRemoteCommand(connection, sizeQuery) == 0)
+		{
+			ReportConnectionError(connection, WARNING);
+
+			/* do not wait for a result */
+			lfirst(queryCell) = NULL;
+		}
+	}
+
+	/* get the results and update the sizes that changed */
+	forboth(connectionCell, connectionList, queryCell, queryList)
+	{
+		MultiConnection *connection = (MultiConnection *) lfirst(connectionCell);
+		PGresult *result = NULL;
+		bool raiseInterrupts = true;
+
+		if (lfirst(queryCell) == NULL)
+		{
+			continue;
+		}
+
+		result = GetRemoteCommandResult(connection, raiseInterrupts);
+		if (!IsResponseOK(result))
+		{
+			ReportResultError(connection, result, WARNING);
+		}
+		else
+		{
+			updatedPlacementCount +=
+				UpdatePlacementLengthsFromResult(result, &updatedRelationIdList);
+		}
+
+		PQclear(result);
+		ForgetResults(connection);
+	}
+
+	foreach(relationIdCell, updatedRelationIdList)
+	{
+		CitusInvalidateRelcacheByRelid(lfirst_oid(relationIdCell));
+	}
+
+	if (updatedRelationIdList != NIL)
+	{
+		CommandCounterIncrement();
+	}
+
+	return updatedPlacementCount;
+}
+
+
+/*
+ * AppendShardSizeQueryValues appends a (shardid, placementid, shardlength,
+ * nspname, relname) row for each finalized placement of the given table to
+ * the VALUES list of the worker that holds the placement.
+ */
+static void
+AppendShardSizeQueryValues(DistTableCacheEntry *cacheEntry, List *workerNodeList,
+						   StringInfo *nodeValuesArray)
+{
+	Oid relationId = cacheEntry->relationId;
+	char *relationName = get_rel_name(relationId);
+	char *schemaName = get_namespace_name(get_rel_namespace(relationId));
+	int shardIndex = 0;
+
+	if (relationName == NULL || schemaName == NULL)
+	{
+		/* table was dropped concurrently */
+		return;
+	}
+
+	for (shardIndex = 0; shardIndex < cacheEntry->shardIntervalArrayLength; shardIndex++)
+	{
+		GroupShardPlacement *placementArray =
+			cacheEntry->arrayOfPlacementArrays[shardIndex];
+		int placementCount = cacheEntry->arrayOfPlacementArrayLengths[shardIndex];
+		int placementIndex = 0;
+
+		for (placementIndex = 0; placementIndex < placementCount; placementIndex++)
+		{
+			GroupShardPlacement *placement = &placementArray[placementIndex];
+			ListCell *workerNodeCell = NULL;
+			int workerNodeIndex = 0;
+			char *shardName = NULL;
+
+			if (placement->shardState != FILE_FINALIZED)
+			{
+				continue;
+			}
+
+			foreach(workerNodeCell, workerNodeList)
+			{
+				WorkerNode *workerNode = (WorkerNode *) lfirst(workerNodeCell);
+				StringInfo nodeValues = NULL;
+
+				if (workerNode->groupId != placement->groupId)
+				{
+					workerNodeIndex++;
+					continue;
+				}
+
+				nodeValues = nodeValuesArray[workerNodeIndex];
+				if (nodeValues == NULL)
+				{
+					nodeValues = makeStringInfo();
+					nodeValuesArray[workerNodeIndex] = nodeValues;
+				}
+				else
+				{
+					appendStringInfoChar(nodeValues, ',');
+				}
+
+				shardName = pstrdup(relationName);
+				AppendShardIdToName(&shardName, placement->shardId);
+
+				appendStringInfo(nodeValues, "(" UINT64_FORMAT ", " UINT64_FORMAT ", "
+								 UINT64_FORMAT ", %s, %s)",
+								 placement->shardId, placement->placementId,
+								 placement->shardLength,
+								 quote_literal_cstr(schemaName),
+								 quote_literal_cstr(shardName));
+				break;
+			}
+		}
+	}
+}
+
+
+/*
+ * UpdatePlacementLengthsFromResult updates the shardlength of the placements
+ * in the result of a SHARD_PLACEMENT_SIZES_QUERY whose size changed, adds the
+ * distributed tables of the updated placements to updatedRelationIdList, and
+ * returns the number of updated placements. Shards that are locked, for
+ * instance because they are being moved, are skipped until the next update.
+ *
+ * The shard metadata lock is released once the placement is updated rather
+ * than at the end of the transaction, since a refresh may touch more shards
+ * than the lock table has room for. The updated row stays locked until then.
+ */
+static uint64
+UpdatePlacementLengthsFromResult(PGresult *result, List **updatedRelationIdList)
+{
+	int rowCount = PQntuples(result);
+	int rowIndex = 0;
+	uint64 updatedPlacementCount = 0;
+
+	for (rowIndex = 0; rowIndex < rowCount; rowIndex++)
+	{
+		uint64 shardId = 0;
+		uint64 placementId = 0;
+		uint64 oldShardLength = 0;
+		uint64 newShardLength = 0;
+
+		if (PQgetisnull(result, rowIndex, 3))
+		{
+			continue;
+		}
+
+		shardId = pg_strtouint64(PQgetvalue(result, rowIndex, 0), NULL, 10);
+		placementId = pg_strtouint64(PQgetvalue(result, rowIndex, 1), NULL, 10);
+		oldShardLength = pg_strtouint64(PQgetvalue(result, rowIndex, 2), NULL, 10);
+		newShardLength = pg_strtouint64(PQgetvalue(result, rowIndex, 3), NULL, 10);
+
+		if (newShardLength == oldShardLength)
+		{
+			continue;
+		}
+
+		if (!TryLockShardDistributionMetadata(shardId, ShareLock))
+		{
+			continue;
+		}
+
+		if (UpdateShardPlacementLength(placementId, newShardLength))
+		{
+			Oid relationId = RelationIdForShard(shardId);
+
+			*updatedRelationIdList = list_append_unique_oid(*updatedRelationIdList,
+															relationId);
+			updatedPlacementCount++;
+		}
+
+		UnlockShardDistributionMetadata(shardId, ShareLock);
+	}
+
+	return updatedPlacementCount;
+}
+
+
 /*
  * WorkerShardStats queries the worker node, and retrieves shard statistics that
  * we assume have changed after new table data have been appended to the shard.
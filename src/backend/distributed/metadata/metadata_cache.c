@@ -44,6 +44,7 @@
 #include "distributed/pg_dist_shard.h"
 #include "distributed/pg_dist_placement.h"
 #include "distributed/shared_library_init.h"
+#include "distributed/shared_metadata_cache.h"
 #include "distributed/shardinterval_utils.h"
 #include "distributed/version_compat.h"
 #include "distributed/worker_manager.h"
@@ -74,6 +75,7 @@
 
 /* user configuration */
 int ReadFromSecondaries = USE_SECONDARY_NODES_NEVER;
+bool EnableIncrementalCacheInvalidation = false;
 
 /*
  * ShardCacheEntry represents an entry in the shardId -> ShardInterval cache.
@@ -131,6 +133,10 @@ typedef struct MetadataCacheData
 	Oid distTransactionRelationId;
 	Oid distTransactionGroupIndexId;
 	Oid distTransactionRecordIndexId;
+	Oid distMetadataChangeRelationId;
+	Oid distMetadataChangeGroupIndexId;
+	Oid distShardRangeColumnRelationId;
+	Oid distShardRangeColumnIndexId;
 	Oid citusCatalogNamespaceId;
 	Oid copyFormatTypeId;
 	Oid readIntermediateResultFuncId;
@@ -189,6 +195,11 @@ static ShardCacheEntry * LookupShardCacheEntry(int64 shardId);
 static DistTableCacheEntry * LookupDistTableCacheEntry(Oid relationId);
 static void BuildDistTableCacheEntry(DistTableCacheEntry *cacheEntry);
 static void BuildCachedShardList(DistTableCacheEntry *cacheEntry);
+static bool RefreshDistTableCacheEntry(DistTableCacheEntry *cacheEntry);
+static void BuildShardBoundaryArrays(DistTableCacheEntry *cacheEntry,
+									 Oid intervalTypeId);
+static GroupShardPlacement * BuildCachedPlacementArray(ShardInterval *shardInterval,
+													   int *numberOfPlacements);
 static ShardInterval ** SortShardIntervalArray(ShardInterval **shardIntervalArray,
 											   int shardCount,
 											   FmgrInfo *
@@ -212,6 +223,7 @@ static void RegisterWorkerNodeCacheCallbacks(void);
 static void RegisterLocalGroupIdCacheCallbacks(void);
 static uint32 WorkerNodeHashCode(const void *key, Size keySize);
 static void ResetDistTableCacheEntry(DistTableCacheEntry *cacheEntry);
+static void InvalidateRelcacheByRelid(Oid relationId);
 static void CreateDistTableCache(void);
 static void CreateDistObjectCache(void);
 static void InvalidateForeignRelationGraphCacheCallback(Datum argument, Oid relationId);
@@ -881,6 +893,15 @@ LookupDistTableCacheEntry(Oid relationId)
 			return cacheEntry;
 		}
 
+		/* if only placements changed, reload just those */
+		if (EnableIncrementalCacheInvalidation &&
+			RefreshDistTableCacheEntry(cacheEntry))
+		{
+			cacheEntry->isValid = true;
+
+			return cacheEntry;
+		}
+
 		/* free the content of old, invalid, entries */
 		ResetDistTableCacheEntry(cacheEntry);
 	}
@@ -1031,6 +1052,9 @@ BuildDistTableCacheEntry(DistTableCacheEntry *cacheEntry)
 	Datum datumArray[Natts_pg_dist_partition];
 	bool isNullArray[Natts_pg_dist_partition];
 
+	/* read the version before the catalogs, see shared_metadata_cache.c */
+	cacheEntry->metadataVersion = SharedMetadataCacheVersion();
+
 	pgDistPartition = heap_open(DistPartitionRelationId(), AccessShareLock);
 	distPartitionTuple =
 		LookupDistPartitionTuple(pgDistPartition, cacheEntry->relationId);
@@ -1158,6 +1182,8 @@ BuildCachedShardList(DistTableCacheEntry *cacheEntry)
 	int32 columnTypeMod = -1;
 	Oid intervalTypeId = InvalidOid;
 	int32 intervalTypeMod = -1;
+	bool useSharedCache = false;
+	bool loadedFromSharedCache = false;
 
 	GetPartitionTypeInputInfo(cacheEntry->partitionKeyString,
 							  cacheEntry->partitionMethod,
@@ -1166,9 +1192,33 @@ BuildCachedShardList(DistTableCacheEntry *cacheEntry)
 							  &intervalTypeId,
 							  &intervalTypeMod);
 
-	distShardTupleList = LookupDistShardTuples(cacheEntry->relationId);
-	shardIntervalArrayLength = list_length(distShardTupleList);
-	if (shardIntervalArrayLength > 0)
+	/*
+	 * A transaction that changed shard metadata should neither see the shard
+	 * lists of other backends, which lack its own changes, nor publish shard
+	 * lists that contain its uncommitted changes.
+	 */
+	useSharedCache = EnableSharedMetadataCache && !HasPendingShardMetadataChanges();
+
+	if (useSharedCache)
+	{
+		MemoryContext oldContext = MemoryContextSwitchTo(MetadataCacheMemoryContext);
+
+		loadedFromSharedCache =
+			LoadSharedShardList(cacheEntry->relationId, cacheEntry->metadataVersion,
+								&shardIntervalArrayLength, &shardIntervalArray,
+								&cacheEntry->arrayOfPlacementArrays,
+								&cacheEntry->arrayOfPlacementArrayLengths);
+
+		MemoryContextSwitchTo(oldContext);
+	}
+
+	if (!loadedFromSharedCache)
+	{
+		distShardTupleList = LookupDistShardTuples(cacheEntry->relationId);
+		shardIntervalArrayLength = list_length(distShardTupleList);
+	}
+
+	if (!loadedFromSharedCache && shardIntervalArrayLength > 0)
 	{
 		Relation distShardRelation = heap_open(DistShardRelationId(), AccessShareLock);
 		TupleDesc distShardTupleDesc = RelationGetDescr(distShardRelation);
@@ -1266,10 +1316,17 @@ BuildCachedShardList(DistTableCacheEntry *cacheEntry)
 	}
 	else
 	{
-		/* sort the interval array */
-		sortedShardIntervalArray = SortShardIntervalArray(shardIntervalArray,
-														  shardIntervalArrayLength,
-														  shardIntervalCompareFunction);
+		/* sort the interval array, shared shard lists are already sorted */
+		if (loadedFromSharedCache)
+		{
+			sortedShardIntervalArray = shardIntervalArray;
+		}
+		else
+		{
+			sortedShardIntervalArray = SortShardIntervalArray(shardIntervalArray,
+															  shardIntervalArrayLength,
+															  shardIntervalCompareFunction);
+		}
 
 		/* check if there exists any shard intervals with no min/max values */
 		cacheEntry->hasUninitializedShardInterval =
@@ -1320,11 +1377,7 @@ BuildCachedShardList(DistTableCacheEntry *cacheEntry)
 		ShardCacheEntry *shardEntry = NULL;
 		ShardInterval *shardInterval = sortedShardIntervalArray[shardIndex];
 		bool foundInCache = false;
-		List *placementList = NIL;
-		MemoryContext oldContext = NULL;
-		ListCell *placementCell = NULL;
 		GroupShardPlacement *placementArray = NULL;
-		int placementOffset = 0;
 		int numberOfPlacements = 0;
 
 		shardEntry = hash_search(DistShardCacheHash, &shardInterval->shardId, HASH_ENTER,
@@ -1347,22 +1400,13 @@ BuildCachedShardList(DistTableCacheEntry *cacheEntry)
 		shardEntry->shardIndex = shardIndex;
 		shardEntry->tableEntry = cacheEntry;
 
-		/* build list of shard placements */
-		placementList = BuildShardPlacementList(shardInterval);
-		numberOfPlacements = list_length(placementList);
-
-		/* and copy that list into the cache entry */
-		oldContext = MemoryContextSwitchTo(MetadataCacheMemoryContext);
-		placementArray = palloc0(numberOfPlacements * sizeof(GroupShardPlacement));
-		foreach(placementCell, placementList)
+		if (loadedFromSharedCache)
 		{
-			GroupShardPlacement *srcPlacement =
-				(GroupShardPlacement *) lfirst(placementCell);
-
-			placementArray[placementOffset] = *srcPlacement;
-			placementOffset++;
+			/* placements were restored together with the shard intervals */
+			continue;
 		}
-		MemoryContextSwitchTo(oldContext);
+
+		placementArray = BuildCachedPlacementArray(shardInterval, &numberOfPlacements);
 
 		cacheEntry->arrayOfPlacementArrays[shardIndex] = placementArray;
 		cacheEntry->arrayOfPlacementArrayLengths[shardIndex] = numberOfPlacements;
@@ -1373,6 +1417,173 @@ BuildCachedShardList(DistTableCacheEntry *cacheEntry)
 
 	cacheEntry->shardColumnCompareFunction = shardColumnCompareFunction;
 	cacheEntry->shardIntervalCompareFunction = shardIntervalCompareFunction;
+
+	if (shardIntervalArrayLength > 0 && !cacheEntry->hasOverlappingShardInterval &&
+		IsIntegerShardIntervalType(intervalTypeId))
+	{
+		BuildShardBoundaryArrays(cacheEntry, intervalTypeId);
+	}
+
+	if (useSharedCache && !loadedFromSharedCache)
+	{
+		StoreSharedShardList(cacheEntry->relationId, cacheEntry->metadataVersion,
+							 shardIntervalArrayLength, sortedShardIntervalArray,
+							 cacheEntry->arrayOfPlacementArrays,
+							 cacheEntry->arrayOfPlacementArrayLengths);
+	}
+}
+
+
+/*
+ * BuildShardBoundaryArrays copies the min/max values of the sorted shard
+ * intervals into flat int64 arrays, such that the shard of a value can be
+ * found without calling the comparison function of the interval type. Should
+ * only be called if the intervals are initialized and do not overlap.
+ */
+static void
+BuildShardBoundaryArrays(DistTableCacheEntry *cacheEntry, Oid intervalTypeId)
+{
+	int shardCount = cacheEntry->shardIntervalArrayLength;
+	int64 *shardMinValueArray = NULL;
+	int64 *shardMaxValueArray = NULL;
+	int shardIndex = 0;
+
+	shardMinValueArray = MemoryContextAlloc(MetadataCacheMemoryContext,
+											shardCount * sizeof(int64));
+	shardMaxValueArray = MemoryContextAlloc(MetadataCacheMemoryContext,
+											shardCount * sizeof(int64));
+
+	for (shardIndex = 0; shardIndex < shardCount; shardIndex++)
+	{
+		ShardInterval *shardInterval = cacheEntry->sortedShardIntervalArray[shardIndex];
+
+		shardMinValueArray[shardIndex] =
+			ShardIntervalValueAsInt64(shardInterval->minValue, intervalTypeId);
+		shardMaxValueArray[shardIndex] =
+			ShardIntervalValueAsInt64(shardInterval->maxValue, intervalTypeId);
+	}
+
+	cacheEntry->shardIntervalTypeId = intervalTypeId;
+	cacheEntry->shardMinValueArray = shardMinValueArray;
+	cacheEntry->shardMaxValueArray = shardMaxValueArray;
+}
+
+
+/*
+ * BuildCachedPlacementArray reads the placements of the given shard from
+ * pg_dist_placement into an array allocated in the metadata cache context.
+ */
+static GroupShardPlacement *
+BuildCachedPlacementArray(ShardInterval *shardInterval, int *numberOfPlacements)
+{
+	List *placementList = BuildShardPlacementList(shardInterval);
+	ListCell *placementCell = NULL;
+	GroupShardPlacement *placementArray = NULL;
+	int placementOffset = 0;
+	MemoryContext oldContext = NULL;
+
+	*numberOfPlacements = list_length(placementList);
+
+	/* copy the list into the cache context */
+	oldContext = MemoryContextSwitchTo(MetadataCacheMemoryContext);
+	placementArray = palloc0(*numberOfPlacements * sizeof(GroupShardPlacement));
+	foreach(placementCell, placementList)
+	{
+		GroupShardPlacement *srcPlacement =
+			(GroupShardPlacement *) lfirst(placementCell);
+
+		placementArray[placementOffset] = *srcPlacement;
+		placementOffset++;
+	}
+	MemoryContextSwitchTo(oldContext);
+
+	return placementArray;
+}
+
+
+/*
+ * RefreshDistTableCacheEntry brings an invalidated cache entry of a
+ * distributed table up to date by only reloading the placements of the shards
+ * of which the placements changed since the entry was built, instead of
+ * rebuilding and re-sorting all of its shard intervals. The function returns
+ * false if anything else might have changed, in which case the entry should
+ * be rebuilt.
+ */
+static bool
+RefreshDistTableCacheEntry(DistTableCacheEntry *cacheEntry)
+{
+	uint64 metadataVersion = 0;
+	List *changedShardIdList = NIL;
+	ListCell *shardIdCell = NULL;
+	MemoryContext oldContext = NULL;
+
+	if (!cacheEntry->isDistributedTable)
+	{
+		return false;
+	}
+
+	/* read the version before the catalogs, see shared_metadata_cache.c */
+	metadataVersion = SharedMetadataCacheVersion();
+
+	if (!ShardMetadataChangesSince(cacheEntry->relationId, cacheEntry->metadataVersion,
+								   &changedShardIdList))
+	{
+		return false;
+	}
+
+	/* make sure all changed shards belong to the entry before changing anything */
+	foreach(shardIdCell, changedShardIdList)
+	{
+		int64 shardId = *((uint64 *) lfirst(shardIdCell));
+		ShardCacheEntry *shardEntry = NULL;
+		bool foundInCache = false;
+
+		shardEntry = hash_search(DistShardCacheHash, &shardId, HASH_FIND,
+								 &foundInCache);
+		if (!foundInCache || shardEntry->tableEntry != cacheEntry)
+		{
+			return false;
+		}
+	}
+
+	foreach(shardIdCell, changedShardIdList)
+	{
+		int64 shardId = *((uint64 *) lfirst(shardIdCell));
+		ShardCacheEntry *shardEntry = NULL;
+		ShardInterval *shardInterval = NULL;
+		GroupShardPlacement *placementArray = NULL;
+		int numberOfPlacements = 0;
+		int shardIndex = 0;
+
+		shardEntry = hash_search(DistShardCacheHash, &shardId, HASH_FIND, NULL);
+		shardIndex = shardEntry->shardIndex;
+		shardInterval = cacheEntry->sortedShardIntervalArray[shardIndex];
+
+		placementArray = BuildCachedPlacementArray(shardInterval, &numberOfPlacements);
+
+		pfree(cacheEntry->arrayOfPlacementArrays[shardIndex]);
+		cacheEntry->arrayOfPlacementArrays[shardIndex] = placementArray;
+		cacheEntry->arrayOfPlacementArrayLengths[shardIndex] = numberOfPlacements;
+	}
+
+	/* foreign keys are not part of the shard metadata, so always reload them */
+	list_free(cacheEntry->referencedRelationsViaForeignKey);
+	list_free(cacheEntry->referencingRelationsViaForeignKey);
+	cacheEntry->referencedRelationsViaForeignKey = NIL;
+	cacheEntry->referencingRelationsViaForeignKey = NIL;
+
+	oldContext = MemoryContextSwitchTo(MetadataCacheMemoryContext);
+
+	cacheEntry->referencedRelationsViaForeignKey = ReferencedRelationIdList(
+		cacheEntry->relationId);
+	cacheEntry->referencingRelationsViaForeignKey = ReferencingRelationIdList(
+		cacheEntry->relationId);
+
+	MemoryContextSwitchTo(oldContext);
+
+	cacheEntry->metadataVersion = metadataVersion;
+
+	return true;
 }
 
 
@@ -2122,6 +2333,50 @@ DistTransactionRecordIndexId(void)
 }
 
 
+/* return oid of pg_dist_metadata_change relation */
+Oid
+DistMetadataChangeRelationId(void)
+{
+	CachedRelationLookup("pg_dist_metadata_change",
+						 &MetadataCache.distMetadataChangeRelationId);
+
+	return MetadataCache.distMetadataChangeRelationId;
+}
+
+
+/* return oid of pg_dist_metadata_change_group_index */
+Oid
+DistMetadataChangeGroupIndexId(void)
+{
+	CachedRelationLookup("pg_dist_metadata_change_group_index",
+						 &MetadataCache.distMetadataChangeGroupIndexId);
+
+	return MetadataCache.distMetadataChangeGroupIndexId;
+}
+
+
+/* return oid of pg_dist_shard_range_column relation */
+Oid
+DistShardRangeColumnRelationId(void)
+{
+	CachedRelationLookup("pg_dist_shard_range_column",
+						 &MetadataCache.distShardRangeColumnRelationId);
+
+	return MetadataCache.distShardRangeColumnRelationId;
+}
+
+
+/* return oid of pg_dist_shard_range_column_index */
+Oid
+DistShardRangeColumnIndexId(void)
+{
+	CachedRelationLookup("pg_dist_shard_range_column_index",
+						 &MetadataCache.distShardRangeColumnIndexId);
+
+	return MetadataCache.distShardRangeColumnIndexId;
+}
+
+
 /* return oid of pg_dist_placement_groupid_index */
 Oid
 DistPlacementGroupidIndexId(void)
@@ -3342,6 +3597,16 @@ ResetDistTableCacheEntry(DistTableCacheEntry *cacheEntry)
 		pfree(cacheEntry->arrayOfPlacementArrays);
 		cacheEntry->arrayOfPlacementArrays = NULL;
 	}
+	if (cacheEntry->shardMinValueArray)
+	{
+		pfree(cacheEntry->shardMinValueArray);
+		cacheEntry->shardMinValueArray = NULL;
+	}
+	if (cacheEntry->shardMaxValueArray)
+	{
+		pfree(cacheEntry->shardMaxValueArray);
+		cacheEntry->shardMaxValueArray = NULL;
+	}
 	if (cacheEntry->referencedRelationsViaForeignKey)
 	{
 		list_free(cacheEntry->referencedRelationsViaForeignKey);
@@ -3942,7 +4207,21 @@ CachedRelationNamespaceLookup(const char *relationName, Oid relnamespace,
 
 
 /*
- * Register a relcache invalidation for a non-shared relation.
+ * Register a relcache invalidation for a non-shared relation, and record that
+ * the metadata of the relation changed.
+ */
+void
+CitusInvalidateRelcacheByRelid(Oid relationId)
+{
+	MarkShardMetadataChanged(relationId, INVALID_SHARD_ID);
+
+	InvalidateRelcacheByRelid(relationId);
+}
+
+
+/*
+ * InvalidateRelcacheByRelid registers a relcache invalidation for a non-shared
+ * relation, without recording a shard metadata change.
  *
  * We ignore the case that there's no corresponding pg_class entry - that
  * happens if we register a relcache invalidation (e.g. for a
@@ -3950,8 +4229,8 @@ CachedRelationNamespaceLookup(const char *relationName, Oid relnamespace,
  * because in those cases we're guaranteed to already have registered an
  * invalidation for the target relation.
  */
-void
-CitusInvalidateRelcacheByRelid(Oid relationId)
+static void
+InvalidateRelcacheByRelid(Oid relationId)
 {
 	HeapTuple classTuple = SearchSysCache1(RELOID, ObjectIdGetDatum(relationId));
 
@@ -3965,7 +4244,7 @@ CitusInvalidateRelcacheByRelid(Oid relationId)
 
 /*
  * Register a relcache invalidation for the distributed relation associated
- * with the shard.
+ * with the shard, and record that the placements of the shard changed.
  */
 void
 CitusInvalidateRelcacheByShardId(int64 shardId)
@@ -3995,7 +4274,10 @@ CitusInvalidateRelcacheByShardId(int64 shardId)
 	if (HeapTupleIsValid(heapTuple))
 	{
 		shardForm = (Form_pg_dist_shard) GETSTRUCT(heapTuple);
-		CitusInvalidateRelcacheByRelid(shardForm->logicalrelid);
+
+		/* only the placements of the shard changed */
+		MarkShardMetadataChanged(shardForm->logicalrelid, shardId);
+		InvalidateRelcacheByRelid(shardForm->logicalrelid);
 	}
 	else
 	{
@@ -0,0 +1,381 @@
+/*-------------------------------------------------------------------------
+ *
+ * metadata_change_log.c
+ *
+ * Routines for keeping track of the metadata changes that metadata workers
+ * missed while they were out of sync.
+ *
+ * When a metadata worker is marked as not synced, commands that change the
+ * metadata are no longer sent to it and the maintenance daemon later sends
+ * the whole metadata snapshot to the worker. For clusters with many shards,
+ * the snapshot is large compared to the handful of changes the worker missed.
+ *
+ * If citus.enable_delta_metadata_sync is on when a worker goes out of sync,
+ * we start a change log for the worker in pg_dist_metadata_change, and from
+ * then on append every metadata command that is not sent to the worker to its
+ * log. The maintenance daemon then only sends the logged commands, in the order
+ * of their change ids. If a command cannot be replayed later (e.g., it runs
+ * outside of a transaction block), we drop the log and fall back to sending
+ * the snapshot.
+ *
+ * Copyright (c) Citus Data, Inc.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+#include "miscadmin.h"
+
+#include "access/genam.h"
+#include "access/heapam.h"
+#include "access/htup_details.h"
+#include "access/xact.h"
+#include "catalog/indexing.h"
+#include "commands/sequence.h"
+#include "distributed/listutils.h"
+#include "distributed/master_protocol.h"
+#include "distributed/metadata_cache.h"
+#include "distributed/metadata_sync.h"
+#include "distributed/pg_dist_metadata_change.h"
+#include "distributed/worker_manager.h"
+#include "distributed/version_compat.h"
+#include "utils/builtins.h"
+#include "utils/fmgroids.h"
+#include "utils/rel.h"
+
+
+/* GUC, determining whether metadata workers that go out of sync get a change log */
+bool EnableDeltaMetadataSync = false;
+
+
+static bool HasMetadataWorkersMissingChanges(void);
+static bool WorkerNodeMissesMetadataChanges(WorkerNode *workerNode);
+static List * MetadataChangeLogGroupIdList(void);
+static void InsertMetadataChange(int32 groupId, const char *command);
+static int64 NextMetadataChangeId(void);
+
+
+/*
+ * StartMetadataChangeLog starts the change log of the given group with the
+ * given command. The caller should only start a log for a group which had its
+ * metadata in sync until the current transaction.
+ */
+void
+StartMetadataChangeLog(int32 groupId, const char *command)
+{
+	InsertMetadataChange(groupId, command);
+}
+
+
+/*
+ * LogMetadataChangeForUnsyncedNodes appends the given metadata command to the
+ * change logs of the metadata workers that do not receive the command.
+ */
+void
+LogMetadataChangeForUnsyncedNodes(const char *command)
+{
+	List *groupIdList = NIL;
+	ListCell *groupIdCell = NULL;
+
+	if (!HasMetadataWorkersMissingChanges())
+	{
+		return;
+	}
+
+	groupIdList = MetadataChangeLogGroupIdList();
+
+	foreach(groupIdCell, groupIdList)
+	{
+		int32 groupId = lfirst_int(groupIdCell);
+		WorkerNode *workerNode = PrimaryNodeForGroup(groupId, NULL);
+
+		if (workerNode == NULL || !WorkerNodeMissesMetadataChanges(workerNode))
+		{
+			continue;
+		}
+
+		InsertMetadataChange(groupId, command);
+	}
+}
+
+
+/*
+ * DropMetadataChangeLogsOfUnsyncedNodes drops the change logs of the metadata
+ * workers that do not receive a metadata command which cannot be replayed
+ * later, such that they get the whole metadata snapshot instead.
+ */
+void
+DropMetadataChangeLogsOfUnsyncedNodes(void)
+{
+	List *groupIdList = NIL;
+	ListCell *groupIdCell = NULL;
+
+	if (!HasMetadataWorkersMissingChanges())
+	{
+		return;
+	}
+
+	groupIdList = MetadataChangeLogGroupIdList();
+
+	foreach(groupIdCell, groupIdList)
+	{
+		int32 groupId = lfirst_int(groupIdCell);
+		WorkerNode *workerNode = PrimaryNodeForGroup(groupId, NULL);
+
+		if (workerNode == NULL || !WorkerNodeMissesMetadataChanges(workerNode))
+		{
+			continue;
+		}
+
+		DeleteMetadataChangeLog(groupId);
+	}
+}
+
+
+/*
+ * HasMetadataChangeLog returns whether the given group has a change log.
+ */
+bool
+HasMetadataChangeLog(int32 groupId)
+{
+	Relation pgDistMetadataChange = NULL;
+	SysScanDesc scanDescriptor = NULL;
+	ScanKeyData scanKey[1];
+	int scanKeyCount = 1;
+	bool indexOK = true;
+	bool hasChangeLog = false;
+
+	pgDistMetadataChange = heap_open(DistMetadataChangeRelationId(), AccessShareLock);
+
+	ScanKeyInit(&scanKey[0], Anum_pg_dist_metadata_change_groupid,
+				BTEqualStrategyNumber, F_INT4EQ, Int32GetDatum(groupId));
+
+	scanDescriptor = systable_beginscan(pgDistMetadataChange,
+										DistMetadataChangeGroupIndexId(), indexOK,
+										NULL, scanKeyCount, scanKey);
+
+	hasChangeLog = HeapTupleIsValid(systable_getnext(scanDescriptor));
+
+	systable_endscan(scanDescriptor);
+	heap_close(pgDistMetadataChange, NoLock);
+
+	return hasChangeLog;
+}
+
+
+/*
+ * MetadataChangeLogCommandList returns the commands in the change log of the
+ * given group, in the order in which they should be applied.
+ */
+List *
+MetadataChangeLogCommandList(int32 groupId)
+{
+	List *commandList = NIL;
+	Relation pgDistMetadataChange = NULL;
+	TupleDesc tupleDescriptor = NULL;
+	SysScanDesc scanDescriptor = NULL;
+	ScanKeyData scanKey[1];
+	int scanKeyCount = 1;
+	bool indexOK = true;
+	HeapTuple heapTuple = NULL;
+
+	pgDistMetadataChange = heap_open(DistMetadataChangeRelationId(), AccessShareLock);
+	tupleDescriptor = RelationGetDescr(pgDistMetadataChange);
+
+	ScanKeyInit(&scanKey[0], Anum_pg_dist_metadata_change_groupid,
+				BTEqualStrategyNumber, F_INT4EQ, Int32GetDatum(groupId));
+
+	/* the index is on (groupid, changeid), so the changes come in order */
+	scanDescriptor = systable_beginscan(pgDistMetadataChange,
+										DistMetadataChangeGroupIndexId(), indexOK,
+										NULL, scanKeyCount, scanKey);
+
+	while (HeapTupleIsValid(heapTuple = systable_getnext(scanDescriptor)))
+	{
+		bool isNull = false;
+		Datum commandDatum = heap_getattr(heapTuple,
+										  Anum_pg_dist_metadata_change_command,
+										  tupleDescriptor, &isNull);
+
+		commandList = lappend(commandList, TextDatumGetCString(commandDatum));
+	}
+
+	systable_endscan(scanDescriptor);
+	heap_close(pgDistMetadataChange, NoLock);
+
+	return commandList;
+}
+
+
+/*
+ * DeleteMetadataChangeLog deletes the change log of the given group, if any.
+ */
+void
+DeleteMetadataChangeLog(int32 groupId)
+{
+	Relation pgDistMetadataChange = NULL;
+	SysScanDesc scanDescriptor = NULL;
+	ScanKeyData scanKey[1];
+	int scanKeyCount = 1;
+	bool indexOK = true;
+	HeapTuple heapTuple = NULL;
+
+	pgDistMetadataChange = heap_open(DistMetadataChangeRelationId(), RowExclusiveLock);
+
+	ScanKeyInit(&scanKey[0], Anum_pg_dist_metadata_change_groupid,
+				BTEqualStrategyNumber, F_INT4EQ, Int32GetDatum(groupId));
+
+	scanDescriptor = systable_beginscan(pgDistMetadataChange,
+										DistMetadataChangeGroupIndexId(), indexOK,
+										NULL, scanKeyCount, scanKey);
+
+	while (HeapTupleIsValid(heapTuple = systable_getnext(scanDescriptor)))
+	{
+		simple_heap_delete(pgDistMetadataChange, &heapTuple->t_self);
+	}
+
+	systable_endscan(scanDescriptor);
+
+	CommandCounterIncrement();
+
+	heap_close(pgDistMetadataChange, NoLock);
+}
+
+
+/*
+ * HasMetadataWorkersMissingChanges returns whether there is a metadata worker
+ * that does not receive metadata commands. It only consults the metadata
+ * cache, such that sending metadata commands does not need to access
+ * pg_dist_metadata_change when all metadata workers are in sync.
+ */
+static bool
+HasMetadataWorkersMissingChanges(void)
+{
+	HTAB *workerNodeHash = GetWorkerNodeHash();
+	WorkerNode *workerNode = NULL;
+	HASH_SEQ_STATUS status;
+
+	hash_seq_init(&status, workerNodeHash);
+
+	while ((workerNode = hash_seq_search(&status)) != NULL)
+	{
+		if (NodeIsPrimary(workerNode) && WorkerNodeMissesMetadataChanges(workerNode))
+		{
+			hash_seq_term(&status);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+
+/*
+ * WorkerNodeMissesMetadataChanges returns whether the given node has metadata,
+ * but is skipped when sending commands to WORKERS_WITH_METADATA.
+ */
+static bool
+WorkerNodeMissesMetadataChanges(WorkerNode *workerNode)
+{
+	return workerNode->hasMetadata &&
+		   (!workerNode->metadataSynced || !workerNode->isActive);
+}
+
+
+/*
+ * MetadataChangeLogGroupIdList returns the ids of the groups that have a
+ * change log. The table only has rows while some metadata workers are out of
+ * sync, so a sequential scan is cheap.
+ */
+static List *
+MetadataChangeLogGroupIdList(void)
+{
+	List *groupIdList = NIL;
+	Relation pgDistMetadataChange = NULL;
+	TupleDesc tupleDescriptor = NULL;
+	SysScanDesc scanDescriptor = NULL;
+	int scanKeyCount = 0;
+	bool indexOK = false;
+	HeapTuple heapTuple = NULL;
+
+	pgDistMetadataChange = heap_open(DistMetadataChangeRelationId(), AccessShareLock);
+	tupleDescriptor = RelationGetDescr(pgDistMetadataChange);
+
+	scanDescriptor = systable_beginscan(pgDistMetadataChange, InvalidOid, indexOK,
+										NULL, scanKeyCount, NULL);
+
+	while (HeapTupleIsValid(heapTuple = systable_getnext(scanDescriptor)))
+	{
+		bool isNull = false;
+		Datum groupIdDatum = heap_getattr(heapTuple,
+										  Anum_pg_dist_metadata_change_groupid,
+										  tupleDescriptor, &isNull);
+
+		groupIdList = list_append_unique_int(groupIdList, DatumGetInt32(groupIdDatum));
+	}
+
+	systable_endscan(scanDescriptor);
+	heap_close(pgDistMetadataChange, NoLock);
+
+	return groupIdList;
+}
+
+
+/*
+ * InsertMetadataChange appends the given command to the change log of the
+ * given group. The change becomes visible together with the metadata change
+ * itself when the local transaction commits.
+ */
+static void
+InsertMetadataChange(int32 groupId, const char *command)
+{
+	Relation pgDistMetadataChange = NULL;
+	TupleDesc tupleDescriptor = NULL;
+	HeapTuple heapTuple = NULL;
+	Datum values[Natts_pg_dist_metadata_change];
+	bool isNulls[Natts_pg_dist_metadata_change];
+
+	memset(values, 0, sizeof(values));
+	memset(isNulls, false, sizeof(isNulls));
+
+	values[Anum_pg_dist_metadata_change_groupid - 1] = Int32GetDatum(groupId);
+	values[Anum_pg_dist_metadata_change_changeid - 1] =
+		Int64GetDatum(NextMetadataChangeId());
+	values[Anum_pg_dist_metadata_change_command - 1] = CStringGetTextDatum(command);
+
+	pgDistMetadataChange = heap_open(DistMetadataChangeRelationId(), RowExclusiveLock);
+	tupleDescriptor = RelationGetDescr(pgDistMetadataChange);
+
+	heapTuple = heap_form_tuple(tupleDescriptor, values, isNulls);
+
+	CatalogTupleInsert(pgDistMetadataChange, heapTuple);
+
+	CommandCounterIncrement();
+
+	heap_close(pgDistMetadataChange, NoLock);
+}
+
+
+/*
+ * NextMetadataChangeId returns the next change id from the change id sequence.
+ * The sequence is accessed as the extension owner, since metadata commands can
+ * be sent on behalf of table owners.
+ */
+static int64
+NextMetadataChangeId(void)
+{
+	text *sequenceName = cstring_to_text(METADATA_CHANGEID_SEQUENCE_NAME);
+	Oid sequenceId = ResolveRelationId(sequenceName, false);
+	Datum changeIdDatum = 0;
+	Oid savedUserId = InvalidOid;
+	int savedSecurityContext = 0;
+
+	GetUserIdAndSecContext(&savedUserId, &savedSecurityContext);
+	SetUserIdAndSecContext(CitusExtensionOwner(), SECURITY_LOCAL_USERID_CHANGE);
+
+	changeIdDatum = DirectFunctionCall1(nextval_oid, ObjectIdGetDatum(sequenceId));
+
+	SetUserIdAndSecContext(savedUserId, savedSecurityContext);
+
+	return DatumGetInt64(changeIdDatum);
+}
@@ -61,6 +61,7 @@ static char * SchemaOwnerName(Oid objectId);
 static bool HasMetadataWorkers(void);
 static List * DetachPartitionCommandList(void);
 static bool SyncMetadataSnapshotToNode(WorkerNode *workerNode, bool raiseOnError);
+static bool SyncMetadataChangesToNode(WorkerNode *workerNode, bool *nodeReachable);
 
 PG_FUNCTION_INFO_V1(start_metadata_sync_to_node);
 PG_FUNCTION_INFO_V1(stop_metadata_sync_to_node);
@@ -145,6 +146,9 @@ StartMetadatSyncToNode(char *nodeNameString, int32 nodePort)
 
 	SyncMetadataSnapshotToNode(workerNode, raiseInterrupts);
 	MarkNodeMetadataSynced(workerNode->workerName, workerNode->workerPort, true);
+
+	/* the snapshot contains the changes the node might have missed */
+	DeleteMetadataChangeLog(workerNode->groupId);
 }
 
 
@@ -176,6 +180,7 @@ stop_metadata_sync_to_node(PG_FUNCTION_ARGS)
 
 	MarkNodeHasMetadata(nodeNameString, nodePort, false);
 	MarkNodeMetadataSynced(nodeNameString, nodePort, false);
+	DeleteMetadataChangeLog(workerNode->groupId);
 
 	PG_RETURN_VOID();
 }
@@ -288,6 +293,66 @@ SyncMetadataSnapshotToNode(WorkerNode *workerNode, bool raiseOnError)
 }
 
 
+/*
+ * SyncMetadataChangesToNode sends the commands in the change log of the given
+ * worker, i.e. the metadata changes it missed while it was out of sync, in a
+ * single transaction. Returns whether the commands were committed, and sets
+ * nodeReachable to whether a connection to the worker could be established.
+ */
+static bool
+SyncMetadataChangesToNode(WorkerNode *workerNode, bool *nodeReachable)
+{
+	char *extensionOwner = CitusExtensionOwnerName();
+	List *changeCommandList = MetadataChangeLogCommandList(workerNode->groupId);
+	MultiConnection *workerConnection = NULL;
+	ListCell *commandCell = NULL;
+	int connectionFlags = FORCE_NEW_CONNECTION;
+	bool failed = false;
+
+	workerConnection = GetNodeUserDatabaseConnection(connectionFlags,
+													 workerNode->workerName,
+													 workerNode->workerPort,
+													 extensionOwner, NULL);
+
+	*nodeReachable = (PQstatus(workerConnection->pgConn) == CONNECTION_OK);
+	if (!*nodeReachable)
+	{
+		CloseConnection(workerConnection);
+		return false;
+	}
+
+	RemoteTransactionBegin(workerConnection);
+
+	foreach(commandCell, changeCommandList)
+	{
+		char *commandString = lfirst(commandCell);
+
+		if (ExecuteOptionalRemoteCommand(workerConnection, commandString, NULL) != 0)
+		{
+			failed = true;
+			break;
+		}
+	}
+
+	if (failed)
+	{
+		RemoteTransactionAbort(workerConnection);
+	}
+	else
+	{
+		RemoteTransactionCommit(workerConnection);
+
+		/* the commit might have failed, or we might not know whether it did */
+		failed = (workerConnection->remoteTransaction.transactionState !=
+				  REMOTE_TRANS_COMMITTED);
+	}
+
+	CloseConnection(workerConnection);
+
+	return !failed;
+}
+
+
 /*
  * SendOptionalCommandListToWorkerInTransaction sends the given command list to
  * the given worker in a single transaction. If any of the commands fail, it
@@ -925,6 +990,24 @@ ShouldHaveShardsUpdateCommand(uint32 nodeId, bool shouldHaveShards)
 }
 
 
+/*
+ * NodeLocationUpdateCommand generates a command that can be executed to update
+ * the nodename and nodeport columns of a node in pg_dist_node table.
+ */
+char *
+NodeLocationUpdateCommand(uint32 nodeId, char *nodeName, int32 nodePort)
+{
+	StringInfo nodeLocationUpdateCommand = makeStringInfo();
+
+	appendStringInfo(nodeLocationUpdateCommand,
+					 "UPDATE pg_catalog.pg_dist_node SET nodename = %s, nodeport = %d "
+					 "WHERE nodeid = %u", quote_literal_cstr(nodeName), nodePort,
+					 nodeId);
+
+	return nodeLocationUpdateCommand->data;
+}
+
+
 /*
  * ColocationIdUpdateCommand creates the SQL command to change the colocationId
  * of the table with the given name to the given colocationId in pg_dist_partition
@@ -1323,8 +1406,39 @@ SyncMetadataToNodes(void)
 		if (workerNode->hasMetadata && !workerNode->metadataSynced)
 		{
 			bool raiseInterrupts = false;
+			bool syncSucceeded = false;
+			bool nodeReachable = true;
+
+			/* only send the missed changes if we kept track of them */
+			if (HasMetadataChangeLog(workerNode->groupId))
+			{
+				syncSucceeded = SyncMetadataChangesToNode(workerNode, &nodeReachable);
+
+				if (!syncSucceeded && nodeReachable)
+				{
+					/*
+					 * Replaying the log is not idempotent, e.g. the node might
+					 * have committed the changes while we failed to record that,
+					 * so retrying the same log could fail forever. Drop the log
+					 * and send the snapshot instead, which does not depend on
+					 * the state of the node. If the node could not be reached,
+					 * we keep the log and try again later.
+					 */
+					ereport(LOG, (errmsg("could not sync the missed metadata changes "
+										 "to %s:%d, syncing the metadata snapshot",
+										 workerNode->workerName,
+										 workerNode->workerPort)));
+
+					DeleteMetadataChangeLog(workerNode->groupId);
+				}
+			}
+
+			if (!syncSucceeded && nodeReachable)
+			{
+				syncSucceeded = SyncMetadataSnapshotToNode(workerNode, raiseInterrupts);
+			}
 
-			if (!SyncMetadataSnapshotToNode(workerNode, raiseInterrupts))
+			if (!syncSucceeded)
 			{
 				result = METADATA_SYNC_FAILED_SYNC;
 			}
@@ -1332,6 +1446,7 @@ SyncMetadataToNodes(void)
 			{
 				MarkNodeMetadataSynced(workerNode->workerName,
 									   workerNode->workerPort, true);
+				DeleteMetadataChangeLog(workerNode->groupId);
 			}
 		}
 	}
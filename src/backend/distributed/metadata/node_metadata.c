@@ -87,7 +87,7 @@ static void SetUpDistributedTableDependencies(WorkerNode *workerNode);
 static WorkerNode * TupleToWorkerNode(TupleDesc tupleDescriptor, HeapTuple heapTuple);
 static WorkerNode * ModifiableWorkerNode(const char *nodeName, int32 nodePort);
 static void UpdateNodeLocation(int32 nodeId, char *newNodeName, int32 newNodePort);
-static bool UnsetMetadataSyncedForAll(void);
+static bool UnsetMetadataSyncedForAll(List **unsyncedGroupIdList);
 static WorkerNode * SetShouldHaveShards(WorkerNode *workerNode, bool shouldHaveShards);
 
 /* declarations for dynamic loading */
@@ -624,6 +624,8 @@ master_update_node(PG_FUNCTION_ARGS)
 	WorkerNode *workerNode = NULL;
 	WorkerNode *workerNodeWithSameAddress = NULL;
 	List *placementList = NIL;
+	List *unsyncedGroupIdList = NIL;
+	char *nodeLocationUpdateCommand = NULL;
 	BackgroundWorkerHandle *handle = NULL;
 
 	CheckCitusVersion(ERROR);
@@ -710,9 +712,29 @@ master_update_node(PG_FUNCTION_ARGS)
 	 * It is possible that maintenance daemon does the first resync too
 	 * early, but that's fine, since this will start a retry loop with
 	 * 5 second intervals until sync is complete.
+	 *
+	 * Nodes that were already out of sync miss the update as well, so we
+	 * add it to their change logs, if any. With delta metadata sync, the
+	 * nodes that we mark as not-synced here start their change logs with
+	 * the update, such that maintenanced only needs to send the update.
 	 */
-	if (UnsetMetadataSyncedForAll())
+	nodeLocationUpdateCommand = NodeLocationUpdateCommand(nodeId, newNodeNameString,
+														  newNodePort);
+	LogMetadataChangeForUnsyncedNodes(nodeLocationUpdateCommand);
+
+	if (UnsetMetadataSyncedForAll(&unsyncedGroupIdList))
 	{
+		if (EnableDeltaMetadataSync)
+		{
+			ListCell *groupIdCell = NULL;
+
+			foreach(groupIdCell, unsyncedGroupIdList)
+			{
+				StartMetadataChangeLog(lfirst_int(groupIdCell),
+									   nodeLocationUpdateCommand);
+			}
+		}
+
 		TriggerMetadataSync(MyDatabaseId);
 	}
 
@@ -1012,6 +1034,11 @@ RemoveNodeFromCluster(char *nodeName, int32 nodePort)
 
 	DeleteNodeRow(workerNode->workerName, nodePort);
 
+	if (NodeIsPrimary(workerNode))
+	{
+		DeleteMetadataChangeLog(workerNode->groupId);
+	}
+
 	nodeDeleteCommand = NodeDeleteCommand(workerNode->nodeId);
 
 	/* make sure we don't have any lingering session lifespan connections */
@@ -1576,10 +1603,11 @@ DatumToString(Datum datum, Oid dataType)
 
 /*
  * UnsetMetadataSyncedForAll sets the metadatasynced column of all metadata
- * nodes to false. It returns true if it updated at least a node.
+ * nodes to false. It returns true if it updated at least a node, and adds the
+ * groups of the updated nodes to unsyncedGroupIdList.
  */
 static bool
-UnsetMetadataSyncedForAll(void)
+UnsetMetadataSyncedForAll(List **unsyncedGroupIdList)
 {
 	bool updatedAtLeastOne = false;
 	Relation relation = NULL;
@@ -1621,6 +1649,12 @@ UnsetMetadataSyncedForAll(void)
 		Datum values[Natts_pg_dist_node];
 		bool isnull[Natts_pg_dist_node];
 		bool replace[Natts_pg_dist_node];
+		bool groupIdIsNull = false;
+		Datum groupIdDatum = heap_getattr(heapTuple, Anum_pg_dist_node_groupid,
+										  tupleDescriptor, &groupIdIsNull);
+
+		*unsyncedGroupIdList = lappend_int(*unsyncedGroupIdList,
+										   DatumGetInt32(groupIdDatum));
 
 		memset(replace, false, sizeof(replace));
 		memset(isnull, false, sizeof(isnull));
@@ -0,0 +1,1737 @@
+/*-------------------------------------------------------------------------
+ *
+ * shard_column_ranges.c
+ *
+ * Per-shard value ranges of non-distribution columns of hash-distributed
+ * tables. Shard pruning only considers the distribution column, so a query
+ * on a hash-distributed time-series table that filters on a timestamp
+ * column is sent to every shard, even though most shards might not contain
+ * any matching rows.
+ *
+ * Columns are selected for tracking with citus_add_shard_range_column(),
+ * which records them in pg_dist_shard_range_column. The maintenance daemon
+ * on the coordinator (or citus_update_shard_column_ranges()) then fetches
+ * the minimum and maximum non-NULL value of these columns in every shard,
+ * and stores them in shared memory. Before a multi-shard SELECT on a single
+ * table is executed, tasks of shards of which the ranges cannot match the
+ * simple comparisons in the WHERE clause are skipped.
+ *
+ * A range is only used as long as it is known to cover all committed rows
+ * of the shard. Every change is ordered by a counter in shared memory. A
+ * refresh takes the next counter value before it queries the shards, and
+ * transactions that write to a shard take the next counter value once their
+ * writes are committed on the workers, such that a range is known to be
+ * current when it was refreshed after the last write of its shard finished.
+ * The writes of the current transaction itself are not visible to other
+ * backends, so the shards written by the current transaction are never
+ * skipped. Writes that we cannot observe, i.e. through metadata workers or
+ * directly into the shards, are not covered, hence ranges are not used when
+ * there are metadata workers.
+ *
+ * The ranges are not persisted, after a restart the shards are not skipped
+ * until the next refresh.
+ *
+ * Copyright (c) 2019, Citus Data, Inc.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+#include "libpq-fe.h"
+#include "miscadmin.h"
+
+#include "access/genam.h"
+#include "access/heapam.h"
+#include "access/htup_details.h"
+#include "access/stratnum.h"
+#include "access/xact.h"
+#include "catalog/indexing.h"
+#include "distributed/connection_management.h"
+#include "distributed/master_metadata_utility.h"
+#include "distributed/master_protocol.h"
+#include "distributed/metadata_cache.h"
+#include "distributed/metadata_sync.h"
+#include "distributed/multi_join_order.h"
+#include "distributed/pg_dist_shard_range_column.h"
+#include "distributed/relay_utility.h"
+#include "distributed/remote_commands.h"
+#include "distributed/shard_column_ranges.h"
+#include "distributed/tuplestore.h"
+#include "distributed/worker_manager.h"
+#include "distributed/version_compat.h"
+#include "lib/stringinfo.h"
+#include "storage/ipc.h"
+#include "storage/lwlock.h"
+#include "storage/shmem.h"
+#include "utils/builtins.h"
+#include "utils/fmgroids.h"
+#include "utils/hsearch.h"
+#include "utils/lsyscache.h"
+#include "utils/rel.h"
+#include "utils/typcache.h"
+
+
+/* maximum length of the stored representation of a minimum or maximum value */
+#define SHARD_COLUMN_RANGE_VALUE_SIZE 64
+
+/* number of shards a transaction tracks before it skips all ranges */
+#define MAX_PENDING_SHARD_MODIFICATIONS 256
+
+/*
+ * Query that returns the (shardid, relationid, attnum, typeid, minvalue,
+ * maxvalue) row of a column of a shard. The values are sorted on the worker
+ * using the default btree operator class and the collation of the column,
+ * which the coordinator uses when comparing them as well.
+ */
+#define SHARD_COLUMN_RANGE_QUERY \
+	"SELECT " UINT64_FORMAT "::bigint, %u::oid, %d, %u::oid, " \
+	"(SELECT %s FROM %s WHERE %s IS NOT NULL ORDER BY %s LIMIT 1), " \
+	"(SELECT %s FROM %s WHERE %s IS NOT NULL ORDER BY %s DESC LIMIT 1)"
+
+
+/*
+ * Shared memory data for the shard column ranges.
+ */
+typedef struct ShardColumnRangeControlData
+{
+	/* lock protecting the counters and the hashes */
+	int trancheId;
+	char *lockTrancheName;
+	LWLock lock;
+
+	/* counter that orders refreshes and modifications */
+	uint64 changeCounter;
+
+	/* ranges that were refreshed before this counter value are not used */
+	uint64 invalidationCounter;
+} ShardColumnRangeControlData;
+
+
+/*
+ * Key of the range hash, shard ids are only unique within a database.
+ */
+typedef struct ShardColumnRangeKey
+{
+	uint64 shardId;
+	Oid databaseId;
+	int32 attnum;
+} ShardColumnRangeKey;
+
+
+/*
+ * ShardColumnRangeEntry stores the range of the non-NULL values of a column
+ * of a shard at the time of the refresh. Values of collatable types are
+ * stored in their text representation, other values as hex-encoded output
+ * of their binary send function, which does not depend on settings such as
+ * DateStyle.
+ */
+typedef struct ShardColumnRangeEntry
+{
+	ShardColumnRangeKey key;
+
+	Oid relationId;
+	Oid typeId;
+
+	/* counter value that was taken before the shard was queried */
+	uint64 refreshCounter;
+
+	/* false if the column only contains NULLs */
+	bool hasValues;
+	char minValue[SHARD_COLUMN_RANGE_VALUE_SIZE];
+	char maxValue[SHARD_COLUMN_RANGE_VALUE_SIZE];
+} ShardColumnRangeEntry;
+
+
+/*
+ * Key of the modification hash.
+ */
+typedef struct ShardModificationKey
+{
+	uint64 shardId;
+	Oid databaseId;
+} ShardModificationKey;
+
+
+/*
+ * ShardModificationEntry records when a shard with tracked columns was last
+ * written. Shards are registered before their ranges are refreshed, writers
+ * do not register shards.
+ */
+typedef struct ShardModificationEntry
+{
+	ShardModificationKey key;
+
+	/* counter value of the last refresh that registered the shard */
+	uint64 registrationCounter;
+
+	/* counter value that was taken after the last write was committed */
+	uint64 modificationCounter;
+} ShardModificationEntry;
+
+
+/*
+ * TrackedColumn is a row of pg_dist_shard_range_column.
+ */
+typedef struct TrackedColumn
+{
+	Oid relationId;
+	AttrNumber attnum;
+} TrackedColumn;
+
+
+/*
+ * ShardColumnRestriction is a "column op constant" clause of a query that
+ * can be compared against the ranges of the column.
+ */
+typedef struct ShardColumnRestriction
+{
+	AttrNumber attnum;
+	Oid typeId;
+	Oid collation;
+	StrategyNumber strategy;
+	Datum value;
+} ShardColumnRestriction;
+
+
+/* config variables */
+int MaxShardColumnRanges = 0;
+int ShardColumnRangeUpdateInterval = -1;
+
+static shmem_startup_hook_type prev_shmem_startup_hook = NULL;
+static ShardColumnRangeControlData *ShardColumnRangeControl = NULL;
+static HTAB *ShardColumnRangeHash = NULL;
+static HTAB *ShardModificationHash = NULL;
+
+/* shards written by the current transaction */
+static uint64 PendingShardModifications[MAX_PENDING_SHARD_MODIFICATIONS];
+static int PendingShardModificationCount = 0;
+static bool PendingShardModificationsOverflowed = false;
+
+
+static size_t ShardColumnRangeShmemSize(void);
+static void ShardColumnRangeShmemInit(void);
+static void EnsureShardColumnRangesEnabled(void);
+static AttrNumber TrackedColumnAttnum(Oid relationId, char *columnName);
+static HeapTuple LookupShardRangeColumnTuple(Relation pgDistShardRangeColumn,
+											 Oid relationId, AttrNumber attnum,
+											 SysScanDesc *scanDescriptor);
+static List * ShardRangeColumnList(void);
+static void AppendShardColumnRangeQueries(TrackedColumn *trackedColumn,
+										  List *workerNodeList,
+										  StringInfo *nodeQueryArray,
+										  List **shardIdList);
+static void AppendShardColumnValueExpression(StringInfo expression, Oid typeId,
+											 char *quotedColumnName);
+static uint64 RegisterShardsForRefresh(List *shardIdList);
+static uint64 StoreShardColumnRangesFromResult(PGresult *result,
+											   uint64 refreshCounter);
+static void RemoveStaleShardColumnRanges(uint64 refreshCounter);
+static bool ShardModifiedInTransaction(uint64 shardId);
+static bool CurrentShardColumnRange(uint64 shardId, AttrNumber attnum,
+									ShardColumnRangeEntry *rangeCopy);
+static List * ShardColumnRestrictionList(Node *quals);
+static ShardColumnRestriction * ShardColumnRestrictionFromClause(Node *clause);
+static bool ShardColumnRangeMatches(ShardColumnRangeEntry *range,
+									ShardColumnRestriction *restriction);
+static Datum ShardColumnRangeValue(char *storedValue, Oid typeId);
+
+
+/* exports for SQL callable functions */
+PG_FUNCTION_INFO_V1(citus_add_shard_range_column);
+PG_FUNCTION_INFO_V1(citus_remove_shard_range_column);
+PG_FUNCTION_INFO_V1(citus_update_shard_column_ranges);
+PG_FUNCTION_INFO_V1(citus_shard_column_ranges);
+
+
+/*
+ * citus_add_shard_range_column starts tracking the per-shard ranges of the
+ * given column of a hash-distributed table. The ranges become available
+ * after the next refresh.
+ */
+Datum
+citus_add_shard_range_column(PG_FUNCTION_ARGS)
+{
+	Oid relationId = PG_GETARG_OID(0);
+	char *columnName = text_to_cstring(PG_GETARG_TEXT_P(1));
+	AttrNumber attnum = InvalidAttrNumber;
+	Relation pgDistShardRangeColumn = NULL;
+	SysScanDesc scanDescriptor = NULL;
+	HeapTuple heapTuple = NULL;
+	Datum values[Natts_pg_dist_shard_range_column];
+	bool isNulls[Natts_pg_dist_shard_range_column];
+
+	CheckCitusVersion(ERROR);
+	EnsureCoordinator();
+	EnsureTableOwner(relationId);
+
+	attnum = TrackedColumnAttnum(relationId, columnName);
+
+	pgDistShardRangeColumn = heap_open(DistShardRangeColumnRelationId(),
+									   RowExclusiveLock);
+
+	heapTuple = LookupShardRangeColumnTuple(pgDistShardRangeColumn, relationId, attnum,
+											&scanDescriptor);
+	systable_endscan(scanDescriptor);
+
+	if (HeapTupleIsValid(heapTuple))
+	{
+		/* already tracked */
+		heap_close(pgDistShardRangeColumn, NoLock);
+
+		PG_RETURN_VOID();
+	}
+
+	memset(values, 0, sizeof(values));
+	memset(isNulls, false, sizeof(isNulls));
+
+	values[Anum_pg_dist_shard_range_column_logicalrelid - 1] =
+		ObjectIdGetDatum(relationId);
+	values[Anum_pg_dist_shard_range_column_attnum - 1] = Int16GetDatum(attnum);
+
+	heapTuple = heap_form_tuple(RelationGetDescr(pgDistShardRangeColumn), values,
+								isNulls);
+
+	CatalogTupleInsert(pgDistShardRangeColumn, heapTuple);
+
+	CommandCounterIncrement();
+	heap_close(pgDistShardRangeColumn, NoLock);
+
+	PG_RETURN_VOID();
+}
+
+
+/*
+ * citus_remove_shard_range_column stops tracking the per-shard ranges of the
+ * given column. The stored ranges are removed on the next refresh.
+ */
+Datum
+citus_remove_shard_range_column(PG_FUNCTION_ARGS)
+{
+	Oid relationId = PG_GETARG_OID(0);
+	char *columnName = text_to_cstring(PG_GETARG_TEXT_P(1));
+	AttrNumber attnum = InvalidAttrNumber;
+	Relation pgDistShardRangeColumn = NULL;
+	SysScanDesc scanDescriptor = NULL;
+	HeapTuple heapTuple = NULL;
+
+	CheckCitusVersion(ERROR);
+	EnsureCoordinator();
+	EnsureTableOwner(relationId);
+
+	attnum = get_attnum(relationId, columnName);
+
+	pgDistShardRangeColumn = heap_open(DistShardRangeColumnRelationId(),
+									   RowExclusiveLock);
+
+	heapTuple = LookupShardRangeColumnTuple(pgDistShardRangeColumn, relationId, attnum,
+											&scanDescriptor);
+	if (!HeapTupleIsValid(heapTuple))
+	{
+		ereport(ERROR, (errmsg("ranges of column \"%s\" of relation \"%s\" are not "
+							   "tracked", columnName, get_rel_name(relationId))));
+	}
+
+	CatalogTupleDelete(pgDistShardRangeColumn, &heapTuple->t_self);
+
+	systable_endscan(scanDescriptor);
+
+	CommandCounterIncrement();
+	heap_close(pgDistShardRangeColumn, NoLock);
+
+	PG_RETURN_VOID();
+}
+
+
+/*
+ * citus_update_shard_column_ranges refreshes the ranges of all tracked
+ * columns without waiting for the maintenance daemon, and returns the number
+ * of stored ranges.
+ */
+Datum
+citus_update_shard_column_ranges(PG_FUNCTION_ARGS)
+{
+	uint64 rangeCount = 0;
+
+	CheckCitusVersion(ERROR);
+	EnsureCoordinator();
+	EnsureShardColumnRangesEnabled();
+
+	/*
+	 * The ranges are shared by all sessions, so they should not be derived
+	 * from a snapshot or from writes of a transaction that might not commit.
+	 */
+	PreventInTransactionBlock(true, "citus_update_shard_column_ranges");
+
+	rangeCount = UpdateShardColumnRanges();
+
+	PG_RETURN_INT64(rangeCount);
+}
+
+
+/*
+ * citus_shard_column_ranges returns the ranges that are stored for the
+ * shards of the current database, and whether they are current.
+ */
+Datum
+citus_shard_column_ranges(PG_FUNCTION_ARGS)
+{
+	TupleDesc tupleDescriptor = NULL;
+	Tuplestorestate *tupleStore = NULL;
+	HASH_SEQ_STATUS status;
+	ShardColumnRangeEntry *rangeEntry = NULL;
+	List *rangeList = NIL;
+	ListCell *rangeCell = NULL;
+
+	CheckCitusVersion(ERROR);
+	EnsureShardColumnRangesEnabled();
+
+	tupleStore = SetupTuplestore(fcinfo, &tupleDescriptor);
+
+	/* copy the ranges, to not convert the values while holding the lock */
+	LWLockAcquire(&ShardColumnRangeControl->lock, LW_SHARED);
+
+	hash_seq_init(&status, ShardColumnRangeHash);
+
+	while ((rangeEntry = (ShardColumnRangeEntry *) hash_seq_search(&status)) != NULL)
+	{
+		ShardColumnRangeEntry *rangeCopy = NULL;
+
+		if (rangeEntry->key.databaseId != MyDatabaseId)
+		{
+			continue;
+		}
+
+		rangeCopy = palloc(sizeof(ShardColumnRangeEntry));
+		memcpy(rangeCopy, rangeEntry, sizeof(ShardColumnRangeEntry));
+
+		rangeList = lappend(rangeList, rangeCopy);
+	}
+
+	LWLockRelease(&ShardColumnRangeControl->lock);
+
+	foreach(rangeCell, rangeList)
+	{
+		ShardColumnRangeEntry *rangeCopy = (ShardColumnRangeEntry *) lfirst(rangeCell);
+		ShardColumnRangeEntry currentRange;
+		char *columnName = get_attname(rangeCopy->relationId, rangeCopy->key.attnum,
+									   true);
+		Datum values[6];
+		bool isNulls[6];
+
+		if (columnName == NULL || get_atttype(rangeCopy->relationId,
+											  rangeCopy->key.attnum) !=
+			rangeCopy->typeId)
+		{
+			/* column was dropped or changed its type since the refresh */
+			continue;
+		}
+
+		memset(values, 0, sizeof(values));
+		memset(isNulls, false, sizeof(isNulls));
+
+		values[0] = Int64GetDatum(rangeCopy->key.shardId);
+		values[1] = ObjectIdGetDatum(rangeCopy->relationId);
+		values[2] = CStringGetTextDatum(columnName);
+
+		if (rangeCopy->hasValues)
+		{
+			Oid outputFunctionId = InvalidOid;
+			bool isVarlena = false;
+			Datum minValue = ShardColumnRangeValue(rangeCopy->minValue,
+												   rangeCopy->typeId);
+			Datum maxValue = ShardColumnRangeValue(rangeCopy->maxValue,
+												   rangeCopy->typeId);
+
+			getTypeOutputInfo(rangeCopy->typeId, &outputFunctionId, &isVarlena);
+
+			values[3] = CStringGetTextDatum(OidOutputFunctionCall(outputFunctionId,
+																  minValue));
+			values[4] = CStringGetTextDatum(OidOutputFunctionCall(outputFunctionId,
+																  maxValue));
+		}
+		else
+		{
+			isNulls[3] = true;
+			isNulls[4] = true;
+		}
+
+		values[5] = BoolGetDatum(CurrentShardColumnRange(rangeCopy->key.shardId,
+														 rangeCopy->key.attnum,
+														 &currentRange) &&
+								 currentRange.refreshCounter ==
+								 rangeCopy->refreshCounter);
+
+		tuplestore_putvalues(tupleStore, tupleDescriptor, values, isNulls);
+	}
+
+	tuplestore_donestoring(tupleStore);
+
+	return (Datum) 0;
+}
+
+
+/*
+ * InitializeShardColumnRanges, called at server start, requests the shared
+ * memory for the shard column ranges if citus.max_shard_column_ranges is set.
+ */
+void
+InitializeShardColumnRanges(void)
+{
+	if (MaxShardColumnRanges == 0)
+	{
+		return;
+	}
+
+	if (!IsUnderPostmaster)
+	{
+		RequestAddinShmemSpace(ShardColumnRangeShmemSize());
+	}
+
+	prev_shmem_startup_hook = shmem_startup_hook;
+	shmem_startup_hook = ShardColumnRangeShmemInit;
+}
+
+
+/*
+ * ShardColumnRangeShmemSize returns the size of the shared memory that is
+ * required for the shard column ranges.
+ */
+static size_t
+ShardColumnRangeShmemSize(void)
+{
+	Size size = 0;
+
+	size = add_size(size, sizeof(ShardColumnRangeControlData));
+	size = add_size(size, hash_estimate_size(MaxShardColumnRanges,
+											 sizeof(ShardColumnRangeEntry)));
+	size = add_size(size, hash_estimate_size(MaxShardColumnRanges,
+											 sizeof(ShardModificationEntry)));
+
+	return size;
+}
+
+
+/*
+ * ShardColumnRangeShmemInit initializes the requested shared memory for the
+ * shard column ranges.
+ */
+static void
+ShardColumnRangeShmemInit(void)
+{
+	bool alreadyInitialized = false;
+	HASHCTL hashInfo;
+	int hashFlags = 0;
+
+	LWLockAcquire(AddinShmemInitLock, LW_EXCLUSIVE);
+
+	ShardColumnRangeControl =
+		(ShardColumnRangeControlData *) ShmemInitStruct(
+			"Citus Shard Column Ranges",
+			sizeof(ShardColumnRangeControlData),
+			&alreadyInitialized);
+
+	/*
+	 * Might already be initialized on EXEC_BACKEND type platforms that call
+	 * shared library initialization functions in every backend.
+	 */
+	if (!alreadyInitialized)
+	{
+		ShardColumnRangeControl->trancheId = LWLockNewTrancheId();
+		ShardColumnRangeControl->lockTrancheName = "Citus Shard Column Ranges";
+		LWLockRegisterTranche(ShardColumnRangeControl->trancheId,
+							  ShardColumnRangeControl->lockTrancheName);
+
+		LWLockInitialize(&ShardColumnRangeControl->lock,
+						 ShardColumnRangeControl->trancheId);
+
+		ShardColumnRangeControl->changeCounter = 0;
+		ShardColumnRangeControl->invalidationCounter = 0;
+	}
+
+	memset(&hashInfo, 0, sizeof(hashInfo));
+	hashInfo.keysize = sizeof(ShardColumnRangeKey);
+	hashInfo.entrysize = sizeof(ShardColumnRangeEntry);
+	hashFlags = (HASH_ELEM | HASH_BLOBS);
+
+	ShardColumnRangeHash = ShmemInitHash("Citus Shard Column Range Hash",
+										 MaxShardColumnRanges, MaxShardColumnRanges,
+										 &hashInfo, hashFlags);
+
+	memset(&hashInfo, 0, sizeof(hashInfo));
+	hashInfo.keysize = sizeof(ShardModificationKey);
+	hashInfo.entrysize = sizeof(ShardModificationEntry);
+	hashFlags = (HASH_ELEM | HASH_BLOBS);
+
+	ShardModificationHash = ShmemInitHash("Citus Shard Modification Hash",
+										  MaxShardColumnRanges, MaxShardColumnRanges,
+										  &hashInfo, hashFlags);
+
+	LWLockRelease(AddinShmemInitLock);
+
+	if (prev_shmem_startup_hook != NULL)
+	{
+		prev_shmem_startup_hook();
+	}
+}
+
+
+/*
+ * EnsureShardColumnRangesEnabled errors out if no shared memory was reserved
+ * for the shard column ranges.
+ */
+static void
+EnsureShardColumnRangesEnabled(void)
+{
+	if (ShardColumnRangeControl == NULL)
+	{
+		ereport(ERROR, (errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+						errmsg("shard column ranges are disabled"),
+						errhint("Set citus.max_shard_column_ranges to a positive "
+								"value and restart the server.")));
+	}
+}
+
+
+/*
+ * TrackedColumnAttnum returns the attribute number of the given column, and
+ * errors out if the ranges of the column cannot be tracked.
+ */
+static AttrNumber
+TrackedColumnAttnum(Oid relationId, char *columnName)
+{
+	char *relationName = get_rel_name(relationId);
+	AttrNumber attnum = InvalidAttrNumber;
+	Var *partitionColumn = NULL;
+	Oid typeId = InvalidOid;
+	TypeCacheEntry *typeEntry = NULL;
+
+	if (!IsDistributedTable(relationId) ||
+		PartitionMethod(relationId) != DISTRIBUTE_BY_HASH)
+	{
+		ereport(ERROR, (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+						errmsg("cannot track the shard ranges of columns of "
+							   "relation \"%s\"", relationName),
+						errdetail("Shard ranges are only tracked for hash-distributed "
+								  "tables.")));
+	}
+
+	attnum = get_attnum(relationId, columnName);
+	if (attnum <= 0)
+	{
+		ereport(ERROR, (errcode(ERRCODE_UNDEFINED_COLUMN),
+						errmsg("column \"%s\" of relation \"%s\" does not exist",
+							   columnName, relationName)));
+	}
+
+	partitionColumn = DistPartitionKey(relationId);
+	if (partitionColumn != NULL && partitionColumn->varattno == attnum)
+	{
+		ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+						errmsg("column \"%s\" is the distribution column of relation "
+							   "\"%s\"", columnName, relationName)));
+	}
+
+	typeId = get_atttype(relationId, attnum);
+	typeEntry = lookup_type_cache(typeId, TYPECACHE_CMP_PROC);
+	if (!OidIsValid(typeEntry->cmp_proc))
+	{
+		ereport(ERROR, (errcode(ERRCODE_UNDEFINED_FUNCTION),
+						errmsg("data type %s has no default operator class for "
+							   "access method \"btree\"", format_type_be(typeId))));
+	}
+
+	if (!type_is_collatable(typeId))
+	{
+		Oid sendFunctionId = InvalidOid;
+		Oid receiveFunctionId = InvalidOid;
+		Oid typeIoParam = InvalidOid;
+		bool isVarlena = false;
+
+		/* errors out if the type has no binary input or output function */
+		getTypeBinaryOutputInfo(typeId, &sendFunctionId, &isVarlena);
+		getTypeBinaryInputInfo(typeId, &receiveFunctionId, &typeIoParam);
+	}
+
+	return attnum;
+}
+
+
+/*
+ * LookupShardRangeColumnTuple returns the pg_dist_shard_range_column tuple of
+ * the given column, or an invalid tuple if the column is not tracked. The
+ * caller should end the returned scan once it is done with the tuple.
+ */
+static HeapTuple
+LookupShardRangeColumnTuple(Relation pgDistShardRangeColumn, Oid relationId,
+							AttrNumber attnum, SysScanDesc *scanDescriptor)
+{
+	ScanKeyData scanKey[2];
+	int scanKeyCount = 2;
+	bool indexOK = true;
+
+	ScanKeyInit(&scanKey[0], Anum_pg_dist_shard_range_column_logicalrelid,
+				BTEqualStrategyNumber, F_OIDEQ, ObjectIdGetDatum(relationId));
+	ScanKeyInit(&scanKey[1], Anum_pg_dist_shard_range_column_attnum,
+				BTEqualStrategyNumber, F_INT2EQ, Int16GetDatum(attnum));
+
+	*scanDescriptor = systable_beginscan(pgDistShardRangeColumn,
+										 DistShardRangeColumnIndexId(), indexOK,
+										 NULL, scanKeyCount, scanKey);
+
+	return systable_getnext(*scanDescriptor);
+}
+
+
+/*
+ * DeleteShardRangeColumns removes the tracked columns of the given relation
+ * from pg_dist_shard_range_column, which is called when the relation is
+ * dropped.
+ */
+void
+DeleteShardRangeColumns(Oid relationId)
+{
+	Relation pgDistShardRangeColumn = NULL;
+	SysScanDesc scanDescriptor = NULL;
+	ScanKeyData scanKey[1];
+	int scanKeyCount = 1;
+	bool indexOK = true;
+	HeapTuple heapTuple = NULL;
+
+	pgDistShardRangeColumn = heap_open(DistShardRangeColumnRelationId(),
+									   RowExclusiveLock);
+
+	ScanKeyInit(&scanKey[0], Anum_pg_dist_shard_range_column_logicalrelid,
+				BTEqualStrategyNumber, F_OIDEQ, ObjectIdGetDatum(relationId));
+
+	scanDescriptor = systable_beginscan(pgDistShardRangeColumn,
+										DistShardRangeColumnIndexId(), indexOK,
+										NULL, scanKeyCount, scanKey);
+
+	heapTuple = systable_getnext(scanDescriptor);
+	while (HeapTupleIsValid(heapTuple))
+	{
+		CatalogTupleDelete(pgDistShardRangeColumn, &heapTuple->t_self);
+
+		heapTuple = systable_getnext(scanDescriptor);
+	}
+
+	systable_endscan(scanDescriptor);
+
+	CommandCounterIncrement();
+	heap_close(pgDistShardRangeColumn, NoLock);
+}
+
+
+/*
+ * ShardRangeColumnList returns the tracked columns in pg_dist_shard_range_column.
+ */
+static List *
+ShardRangeColumnList(void)
+{
+	List *trackedColumnList = NIL;
+	Relation pgDistShardRangeColumn = NULL;
+	SysScanDesc scanDescriptor = NULL;
+	bool indexOK = false;
+	HeapTuple heapTuple = NULL;
+
+	pgDistShardRangeColumn = heap_open(DistShardRangeColumnRelationId(),
+									   AccessShareLock);
+
+	scanDescriptor = systable_beginscan(pgDistShardRangeColumn, InvalidOid, indexOK,
+										NULL, 0, NULL);
+
+	heapTuple = systable_getnext(scanDescriptor);
+	while (HeapTupleIsValid(heapTuple))
+	{
+		Form_pg_dist_shard_range_column rangeColumnForm =
+			(Form_pg_dist_shard_range_column) GETSTRUCT(heapTuple);
+		TrackedColumn *trackedColumn = palloc0(sizeof(TrackedColumn));
+
+		trackedColumn->relationId = rangeColumnForm->logicalrelid;
+		trackedColumn->attnum = rangeColumnForm->attnum;
+
+		trackedColumnList = lappend(trackedColumnList, trackedColumn);
+
+		heapTuple = systable_getnext(scanDescriptor);
+	}
+
+	systable_endscan(scanDescriptor);
+	heap_close(pgDistShardRangeColumn, NoLock);
+
+	return trackedColumnList;
+}
+
+
+/*
+ * UpdateShardColumnRanges fetches the ranges of the tracked columns from the
+ * workers, using a single query per worker that is sent to all workers in
+ * parallel, and stores them in shared memory. Ranges that could not be
+ * refreshed, because the worker cannot be reached or the column is no
+ * longer tracked, are removed. The function returns the number of stored
+ * ranges.
+ *
+ * We always open new connections, since a cached connection might be part of
+ * a remote transaction of the current session and query the shards with an
+ * outdated snapshot. The connections are closed once the ranges are stored.
+ */
+uint64
+UpdateShardColumnRanges(void)
+{
+	List *workerNodeList = NIL;
+	StringInfo *nodeQueryArray = NULL;
+	List *trackedColumnList = NIL;
+	List *shardIdList = NIL;
+	List *connectionList = NIL;
+	List *queryList = NIL;
+	ListCell *trackedColumnCell = NULL;
+	ListCell *workerNodeCell = NULL;
+	ListCell *connectionCell = NULL;
+	ListCell *queryCell = NULL;
+	uint64 refreshCounter = 0;
+	uint64 rangeCount = 0;
+	int workerNodeIndex = 0;
+
+	if (ShardColumnRangeControl == NULL)
+	{
+		return 0;
+	}
+
+	workerNodeList = ActivePrimaryNodeList(NoLock);
+	nodeQueryArray = palloc0(list_length(workerNodeList) * sizeof(StringInfo));
+	trackedColumnList = ShardRangeColumnList();
+
+	foreach(trackedColumnCell, trackedColumnList)
+	{
+		TrackedColumn *trackedColumn = (TrackedColumn *) lfirst(trackedColumnCell);
+
+		AppendShardColumnRangeQueries(trackedColumn, workerNodeList, nodeQueryArray,
+									  &shardIdList);
+	}
+
+	/*
+	 * Register the shards before we query them, such that transactions that
+	 * commit a write after the shards were queried find them.
+	 */
+	refreshCounter = RegisterShardsForRefresh(shardIdList);
+
+	/* open connections in parallel to the workers that have shards to refresh */
+	foreach(workerNodeCell, workerNodeList)
+	{
+		WorkerNode *workerNode = (WorkerNode *) lfirst(workerNodeCell);
+		StringInfo nodeQuery = nodeQueryArray[workerNodeIndex++];
+		MultiConnection *connection = NULL;
+		uint32 connectionFlags = FORCE_NEW_CONNECTION;
+
+		if (nodeQuery == NULL)
+		{
+			continue;
+		}
+
+		connection = StartNodeConnection(connectionFlags, workerNode->workerName,
+										 workerNode->workerPort);
+
+		connectionList = lappend(connectionList, connection);
+		queryList = lappend(queryList, nodeQuery->data);
+	}
+
+	FinishConnectionListEstablishment(connectionList);
+
+	/* send the queries in parallel */
+	forboth(connectionCell, connectionList, queryCell, queryList)
+	{
+		MultiConnection *connection = (MultiConnection *) lfirst(connectionCell);
+		char *rangeQuery = (char *) lfirst(queryCell);
+
+		if (PQstatus(connection->pgConn) != CONNECTION_OK ||
+			SendRemoteCommand(connection, rangeQuery) == 0)
+		{
+			ReportConnectionError(connection, WARNING);
+
+			/* do not wait for a result */
+			lfirst(queryCell) = NULL;
+		}
+	}
+
+	/* get the results and store the ranges */
+	forboth(connectionCell, connectionList, queryCell, queryList)
+	{
+		MultiConnection *connection = (MultiConnection *) lfirst(connectionCell);
+		PGresult *result = NULL;
+		bool raiseInterrupts = true;
+
+		if (lfirst(queryCell) == NULL)
+		{
+			continue;
+		}
+
+		result = GetRemoteCommandResult(connection, raiseInterrupts);
+		if (!IsResponseOK(result))
+		{
+			ReportResultError(connection, result, WARNING);
+		}
+		else
+		{
+			rangeCount += StoreShardColumnRangesFromResult(result, refreshCounter);
+		}
+
+		PQclear(result);
+		ForgetResults(connection);
+	}
+
+	foreach(connectionCell, connectionList)
+	{
+		MultiConnection *connection = (MultiConnection *) lfirst(connectionCell);
+
+		CloseConnection(connection);
+	}
+
+	RemoveStaleShardColumnRanges(refreshCounter);
+
+	return rangeCount;
+}
+
+
+/*
+ * AppendShardColumnRangeQueries appends a SHARD_COLUMN_RANGE_QUERY for each
+ * shard of the table of the given column to the query of the worker that
+ * holds the first finalized placement of the shard, and appends the ids of
+ * the shards to shardIdList.
+ */
+static void
+AppendShardColumnRangeQueries(TrackedColumn *trackedColumn, List *workerNodeList,
+							  StringInfo *nodeQueryArray, List **shardIdList)
+{
+	Oid relationId = trackedColumn->relationId;
+	AttrNumber attnum = trackedColumn->attnum;
+	DistTableCacheEntry *cacheEntry = NULL;
+	char *relationName = NULL;
+	char *schemaName = NULL;
+	char *columnName = NULL;
+	char *quotedColumnName = NULL;
+	StringInfo valueExpression = makeStringInfo();
+	Oid typeId = InvalidOid;
+	int shardIndex = 0;
+
+	if (!IsDistributedTable(relationId))
+	{
+		/* table was dropped concurrently */
+		return;
+	}
+
+	cacheEntry = DistributedTableCacheEntry(relationId);
+	relationName = get_rel_name(relationId);
+	schemaName = get_namespace_name(get_rel_namespace(relationId));
+	columnName = get_attname(relationId, attnum, true);
+	typeId = get_atttype(relationId, attnum);
+
+	if (cacheEntry->partitionMethod != DISTRIBUTE_BY_HASH || relationName == NULL ||
+		schemaName == NULL || columnName == NULL || !OidIsValid(typeId))
+	{
+		return;
+	}
+
+	quotedColumnName = (char *) quote_identifier(columnName);
+	AppendShardColumnValueExpression(valueExpression, typeId, quotedColumnName);
+
+	for (shardIndex = 0; shardIndex < cacheEntry->shardIntervalArrayLength; shardIndex++)
+	{
+		GroupShardPlacement *placementArray =
+			cacheEntry->arrayOfPlacementArrays[shardIndex];
+		int placementCount = cacheEntry->arrayOfPlacementArrayLengths[shardIndex];
+		int placementIndex = 0;
+
+		for (placementIndex = 0; placementIndex < placementCount; placementIndex++)
+		{
+			GroupShardPlacement *placement = &placementArray[placementIndex];
+			ListCell *workerNodeCell = NULL;
+			int workerNodeIndex = 0;
+			bool queryAppended = false;
+
+			if (placement->shardState != FILE_FINALIZED)
+			{
+				continue;
+			}
+
+			foreach(workerNodeCell, workerNodeList)
+			{
+				WorkerNode *workerNode = (WorkerNode *) lfirst(workerNodeCell);
+				StringInfo nodeQuery = NULL;
+				char *shardName = NULL;
+				char *qualifiedShardName = NULL;
+				uint64 *shardIdPointer = NULL;
+
+				if (workerNode->groupId != placement->groupId)
+				{
+					workerNodeIndex++;
+					continue;
+				}
+
+				nodeQuery = nodeQueryArray[workerNodeIndex];
+				if (nodeQuery == NULL)
+				{
+					nodeQuery = makeStringInfo();
+					nodeQueryArray[workerNodeIndex] = nodeQuery;
+				}
+				else
+				{
+					appendStringInfoString(nodeQuery, " UNION ALL ");
+				}
+
+				shardName = pstrdup(relationName);
+				AppendShardIdToName(&shardName, placement->shardId);
+				qualifiedShardName = quote_qualified_identifier(schemaName, shardName);
+
+				appendStringInfo(nodeQuery, SHARD_COLUMN_RANGE_QUERY,
+								 placement->shardId, relationId, attnum, typeId,
+								 valueExpression->data, qualifiedShardName,
+								 quotedColumnName, quotedColumnName,
+								 valueExpression->data, qualifiedShardName,
+								 quotedColumnName, quotedColumnName);
+
+				shardIdPointer = (uint64 *) palloc0(sizeof(uint64));
+				*shardIdPointer = placement->shardId;
+				*shardIdList = lappend(*shardIdList, shardIdPointer);
+
+				queryAppended = true;
+				break;
+			}
+
+			/* the range of a shard is only read from a single placement */
+			if (queryAppended)
+			{
+				break;
+			}
+		}
+	}
+}
+
+
+/*
+ * AppendShardColumnValueExpression appends the expression that converts a
+ * value of the given column into its stored representation.
+ */
+static void
+AppendShardColumnValueExpression(StringInfo expression, Oid typeId,
+								 char *quotedColumnName)
+{
+	if (type_is_collatable(typeId))
+	{
+		appendStringInfo(expression, "%s::text", quotedColumnName);
+	}
+	else
+	{
+		Oid sendFunctionId = InvalidOid;
+		bool isVarlena = false;
+		char *functionName = NULL;
+		char *schemaName = NULL;
+
+		getTypeBinaryOutputInfo(typeId, &sendFunctionId, &isVarlena);
+
+		functionName = get_func_name(sendFunctionId);
+		schemaName = get_namespace_name(get_func_namespace(sendFunctionId));
+
+		appendStringInfo(expression, "pg_catalog.encode(%s(%s), 'hex')",
+						 quote_qualified_identifier(schemaName, functionName),
+						 quotedColumnName);
+	}
+}
+
+
+/*
+ * RegisterShardsForRefresh adds the given shards to the modification hash,
+ * unless they are already registered, and returns the counter value of the
+ * refresh.
+ */
+static uint64
+RegisterShardsForRefresh(List *shardIdList)
+{
+	ListCell *shardIdCell = NULL;
+	uint64 refreshCounter = 0;
+
+	LWLockAcquire(&ShardColumnRangeControl->lock, LW_EXCLUSIVE);
+
+	refreshCounter = ++ShardColumnRangeControl->changeCounter;
+
+	foreach(shardIdCell, shardIdList)
+	{
+		uint64 shardId = *((uint64 *) lfirst(shardIdCell));
+		ShardModificationKey modificationKey;
+		ShardModificationEntry *modificationEntry = NULL;
+		bool found = false;
+
+		memset(&modificationKey, 0, sizeof(modificationKey));
+		modificationKey.shardId = shardId;
+		modificationKey.databaseId = MyDatabaseId;
+
+		modificationEntry = (ShardModificationEntry *) hash_search(
+			ShardModificationHash, &modificationKey, HASH_ENTER_NULL, &found);
+		if (modificationEntry == NULL)
+		{
+			/* out of shared memory, the ranges of the shard are not used */
+			continue;
+		}
+
+		if (!found)
+		{
+			modificationEntry->modificationCounter = 0;
+		}
+
+		modificationEntry->registrationCounter = refreshCounter;
+	}
+
+	LWLockRelease(&ShardColumnRangeControl->lock);
+
+	return refreshCounter;
+}
+
+
+/*
+ * StoreShardColumnRangesFromResult stores the ranges in the result of a
+ * SHARD_COLUMN_RANGE_QUERY and returns the number of stored ranges.
+ */
+static uint64
+StoreShardColumnRangesFromResult(PGresult *result, uint64 refreshCounter)
+{
+	int rowCount = PQntuples(result);
+	int rowIndex = 0;
+	uint64 rangeCount = 0;
+
+	LWLockAcquire(&ShardColumnRangeControl->lock, LW_EXCLUSIVE);
+
+	for (rowIndex = 0; rowIndex < rowCount; rowIndex++)
+	{
+		ShardColumnRangeKey rangeKey;
+		ShardColumnRangeEntry *rangeEntry = NULL;
+		bool hasValues = !PQgetisnull(result, rowIndex, 4) &&
+						 !PQgetisnull(result, rowIndex, 5);
+		char *minValue = hasValues ? PQgetvalue(result, rowIndex, 4) : "";
+		char *maxValue = hasValues ? PQgetvalue(result, rowIndex, 5) : "";
+
+		memset(&rangeKey, 0, sizeof(rangeKey));
+		rangeKey.shardId = pg_strtouint64(PQgetvalue(result, rowIndex, 0), NULL, 10);
+		rangeKey.databaseId = MyDatabaseId;
+		rangeKey.attnum = pg_atoi(PQgetvalue(result, rowIndex, 2), sizeof(int32), 0);
+
+		if (strlen(minValue) >= SHARD_COLUMN_RANGE_VALUE_SIZE ||
+			strlen(maxValue) >= SHARD_COLUMN_RANGE_VALUE_SIZE)
+		{
+			/* values are too long to store, the shard is never skipped */
+			hash_search(ShardColumnRangeHash, &rangeKey, HASH_REMOVE, NULL);
+			continue;
+		}
+
+		rangeEntry = (ShardColumnRangeEntry *) hash_search(ShardColumnRangeHash,
+														   &rangeKey, HASH_ENTER_NULL,
+														   NULL);
+		if (rangeEntry == NULL)
+		{
+			/* out of shared memory */
+			continue;
+		}
+
+		rangeEntry->relationId = atooid(PQgetvalue(result, rowIndex, 1));
+		rangeEntry->typeId = atooid(PQgetvalue(result, rowIndex, 3));
+		rangeEntry->refreshCounter = refreshCounter;
+		rangeEntry->hasValues = hasValues;
+		strlcpy(rangeEntry->minValue, minValue, SHARD_COLUMN_RANGE_VALUE_SIZE);
+		strlcpy(rangeEntry->maxValue, maxValue, SHARD_COLUMN_RANGE_VALUE_SIZE);
+
+		rangeCount++;
+	}
+
+	LWLockRelease(&ShardColumnRangeControl->lock);
+
+	return rangeCount;
+}
+
+
+/*
+ * RemoveStaleShardColumnRanges removes the ranges and registered shards of
+ * the current database that were not refreshed by the refresh with the given
+ * counter value or by a later one.
+ */
+static void
+RemoveStaleShardColumnRanges(uint64 refreshCounter)
+{
+	HASH_SEQ_STATUS status;
+	ShardColumnRangeEntry *rangeEntry = NULL;
+	ShardModificationEntry *modificationEntry = NULL;
+
+	LWLockAcquire(&ShardColumnRangeControl->lock, LW_EXCLUSIVE);
+
+	hash_seq_init(&status, ShardColumnRangeHash);
+
+	while ((rangeEntry = (ShardColumnRangeEntry *) hash_seq_search(&status)) != NULL)
+	{
+		if (rangeEntry->key.databaseId == MyDatabaseId &&
+			rangeEntry->refreshCounter < refreshCounter)
+		{
+			hash_search(ShardColumnRangeHash, &rangeEntry->key, HASH_REMOVE, NULL);
+		}
+	}
+
+	hash_seq_init(&status, ShardModificationHash);
+
+	while ((modificationEntry =
+				(ShardModificationEntry *) hash_seq_search(&status)) != NULL)
+	{
+		if (modificationEntry->key.databaseId == MyDatabaseId &&
+			modificationEntry->registrationCounter < refreshCounter)
+		{
+			hash_search(ShardModificationHash, &modificationEntry->key, HASH_REMOVE,
+						NULL);
+		}
+	}
+
+	LWLockRelease(&ShardColumnRangeControl->lock);
+}
+
+
+/*
+ * RecordShardModification records that the current transaction writes to the
+ * given shard, such that its ranges are not used by the transaction and are
+ * invalidated when the transaction ends.
+ */
+void
+RecordShardModification(uint64 shardId)
+{
+	int shardIndex = 0;
+
+	if (ShardColumnRangeControl == NULL || PendingShardModificationsOverflowed)
+	{
+		return;
+	}
+
+	for (shardIndex = 0; shardIndex < PendingShardModificationCount; shardIndex++)
+	{
+		if (PendingShardModifications[shardIndex] == shardId)
+		{
+			return;
+		}
+	}
+
+	if (PendingShardModificationCount == MAX_PENDING_SHARD_MODIFICATIONS)
+	{
+		/* too many shards to track individually, invalidate all ranges */
+		PendingShardModificationsOverflowed = true;
+		return;
+	}
+
+	PendingShardModifications[PendingShardModificationCount++] = shardId;
+}
+
+
+/*
+ * RecordTaskListShardModifications records the anchor shards of the given
+ * tasks as modified by the current transaction.
+ */
+void
+RecordTaskListShardModifications(List *taskList)
+{
+	ListCell *taskCell = NULL;
+
+	if (ShardColumnRangeControl == NULL)
+	{
+		return;
+	}
+
+	foreach(taskCell, taskList)
+	{
+		Task *task = (Task *) lfirst(taskCell);
+
+		if (task->anchorShardId != INVALID_SHARD_ID)
+		{
+			RecordShardModification(task->anchorShardId);
+		}
+	}
+}
+
+
+/*
+ * PublishShardModifications invalidates the ranges of the shards that the
+ * current transaction wrote to. It is called when the transaction ends,
+ * after the remote transactions are committed or aborted, and therefore
+ * does not allocate memory or throw errors.
+ */
+void
+PublishShardModifications(void)
+{
+	uint64 modificationCounter = 0;
+	int shardIndex = 0;
+
+	if (ShardColumnRangeControl == NULL ||
+		(PendingShardModificationCount == 0 && !PendingShardModificationsOverflowed))
+	{
+		return;
+	}
+
+	LWLockAcquire(&ShardColumnRangeControl->lock, LW_EXCLUSIVE);
+
+	modificationCounter = ++ShardColumnRangeControl->changeCounter;
+
+	if (PendingShardModificationsOverflowed)
+	{
+		ShardColumnRangeControl->invalidationCounter = modificationCounter;
+	}
+	else
+	{
+		for (shardIndex = 0; shardIndex < PendingShardModificationCount; shardIndex++)
+		{
+			ShardModificationKey modificationKey;
+			ShardModificationEntry *modificationEntry = NULL;
+
+			memset(&modificationKey, 0, sizeof(modificationKey));
+			modificationKey.shardId = PendingShardModifications[shardIndex];
+			modificationKey.databaseId = MyDatabaseId;
+
+			modificationEntry = (ShardModificationEntry *) hash_search(
+				ShardModificationHash, &modificationKey, HASH_FIND, NULL);
+			if (modificationEntry != NULL)
+			{
+				modificationEntry->modificationCounter = modificationCounter;
+			}
+		}
+	}
+
+	LWLockRelease(&ShardColumnRangeControl->lock);
+
+	PendingShardModificationCount = 0;
+	PendingShardModificationsOverflowed = false;
+}
+
+
+/*
+ * InvalidateShardColumnRanges invalidates all ranges, which is used when
+ * shards were written without knowing which ones, for instance when 2PC
+ * recovery commits a prepared transaction.
+ */
+void
+InvalidateShardColumnRanges(void)
+{
+	if (ShardColumnRangeControl == NULL)
+	{
+		return;
+	}
+
+	LWLockAcquire(&ShardColumnRangeControl->lock, LW_EXCLUSIVE);
+
+	ShardColumnRangeControl->invalidationCounter =
+		++ShardColumnRangeControl->changeCounter;
+
+	LWLockRelease(&ShardColumnRangeControl->lock);
+}
+
+
+/*
+ * ShardModifiedInTransaction returns whether the current transaction wrote
+ * to the given shard.
+ */
+static bool
+ShardModifiedInTransaction(uint64 shardId)
+{
+	int shardIndex = 0;
+
+	if (PendingShardModificationsOverflowed)
+	{
+		return true;
+	}
+
+	for (shardIndex = 0; shardIndex < PendingShardModificationCount; shardIndex++)
+	{
+		if (PendingShardModifications[shardIndex] == shardId)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+
+/*
+ * CurrentShardColumnRange copies the range of the given column of the given
+ * shard into rangeCopy and returns true, if the range was refreshed after
+ * all committed writes to the shard. Otherwise, it returns false.
+ */
+static bool
+CurrentShardColumnRange(uint64 shardId, AttrNumber attnum,
+						ShardColumnRangeEntry *rangeCopy)
+{
+	ShardColumnRangeKey rangeKey;
+	ShardModificationKey modificationKey;
+	ShardColumnRangeEntry *rangeEntry = NULL;
+	ShardModificationEntry *modificationEntry = NULL;
+	bool isCurrent = false;
+
+	memset(&rangeKey, 0, sizeof(rangeKey));
+	rangeKey.shardId = shardId;
+	rangeKey.databaseId = MyDatabaseId;
+	rangeKey.attnum = attnum;
+
+	memset(&modificationKey, 0, sizeof(modificationKey));
+	modificationKey.shardId = shardId;
+	modificationKey.databaseId = MyDatabaseId;
+
+	LWLockAcquire(&ShardColumnRangeControl->lock, LW_SHARED);
+
+	rangeEntry = (ShardColumnRangeEntry *) hash_search(ShardColumnRangeHash, &rangeKey,
+													   HASH_FIND, NULL);
+	modificationEntry = (ShardModificationEntry *) hash_search(ShardModificationHash,
+															   &modificationKey,
+															   HASH_FIND, NULL);
+
+	if (rangeEntry != NULL && modificationEntry != NULL &&
+		rangeEntry->refreshCounter > modificationEntry->modificationCounter &&
+		rangeEntry->refreshCounter > ShardColumnRangeControl->invalidationCounter)
+	{
+		memcpy(rangeCopy, rangeEntry, sizeof(ShardColumnRangeEntry));
+		isCurrent = true;
+	}
+
+	LWLockRelease(&ShardColumnRangeControl->lock);
+
+	return isCurrent;
+}
+
+
+/*
+ * PruneTaskListByShardColumnRanges returns the tasks of a read-only job on a
+ * single hash-distributed table, without the tasks of shards of which the
+ * ranges of the tracked columns cannot match the "column op constant"
+ * clauses in the WHERE clause of the job query. At least one task is always
+ * kept, such that the shape of the result does not change.
+ */
+List *
+PruneTaskListByShardColumnRanges(Job *job, List *taskList)
+{
+	Query *jobQuery = job->jobQuery;
+	RangeTblEntry *rangeTableEntry = NULL;
+	List *restrictionList = NIL;
+	List *prunedTaskList = NIL;
+	ListCell *taskCell = NULL;
+
+	if (ShardColumnRangeControl == NULL || PendingShardModificationsOverflowed ||
+		list_length(taskList) < 2 || jobQuery == NULL ||
+		jobQuery->commandType != CMD_SELECT || list_length(jobQuery->rtable) != 1 ||
+		jobQuery->jointree == NULL || jobQuery->jointree->quals == NULL)
+	{
+		return taskList;
+	}
+
+	rangeTableEntry = (RangeTblEntry *) linitial(jobQuery->rtable);
+	if (rangeTableEntry->rtekind != RTE_RELATION)
+	{
+		return taskList;
+	}
+
+	restrictionList = ShardColumnRestrictionList(jobQuery->jointree->quals);
+	if (restrictionList == NIL)
+	{
+		return taskList;
+	}
+
+	/* writes through metadata workers do not invalidate the ranges */
+	if (ClusterHasKnownMetadataWorkers())
+	{
+		return taskList;
+	}
+
+	foreach(taskCell, taskList)
+	{
+		Task *task = (Task *) lfirst(taskCell);
+		uint64 shardId = task->anchorShardId;
+		ListCell *restrictionCell = NULL;
+		bool shardMatches = true;
+
+		if (shardId == INVALID_SHARD_ID || ShardModifiedInTransaction(shardId))
+		{
+			prunedTaskList = lappend(prunedTaskList, task);
+			continue;
+		}
+
+		foreach(restrictionCell, restrictionList)
+		{
+			ShardColumnRestriction *restriction =
+				(ShardColumnRestriction *) lfirst(restrictionCell);
+			ShardColumnRangeEntry range;
+
+			if (!CurrentShardColumnRange(shardId, restriction->attnum, &range) ||
+				range.relationId != rangeTableEntry->relid ||
+				range.typeId != restriction->typeId)
+			{
+				continue;
+			}
+
+			if (!ShardColumnRangeMatches(&range, restriction))
+			{
+				shardMatches = false;
+				break;
+			}
+		}
+
+		if (shardMatches)
+		{
+			prunedTaskList = lappend(prunedTaskList, task);
+		}
+	}
+
+	if (prunedTaskList == NIL)
+	{
+		prunedTaskList = list_make1(linitial(taskList));
+	}
+
+	if (list_length(prunedTaskList) < list_length(taskList))
+	{
+		ereport(DEBUG2, (errmsg("skipping %d of %d shards based on column ranges",
+								list_length(taskList) - list_length(prunedTaskList),
+								list_length(taskList))));
+	}
+
+	return prunedTaskList;
+}
+
+
+/*
+ * ShardColumnRestrictionList returns the restrictions of the top-level AND'd
+ * clauses in the given WHERE clause that can be compared against the ranges
+ * of a column.
+ */
+static List *
+ShardColumnRestrictionList(Node *quals)
+{
+	List *restrictionList = NIL;
+	List *clauseList = NIL;
+	ListCell *clauseCell = NULL;
+
+	if (IsA(quals, List))
+	{
+		clauseList = (List *) quals;
+	}
+	else if (IsA(quals, BoolExpr) && ((BoolExpr *) quals)->boolop == AND_EXPR)
+	{
+		clauseList = ((BoolExpr *) quals)->args;
+	}
+	else
+	{
+		clauseList = list_make1(quals);
+	}
+
+	foreach(clauseCell, clauseList)
+	{
+		Node *clause = (Node *) lfirst(clauseCell);
+
+		if (IsA(clause, List) ||
+			(IsA(clause, BoolExpr) && ((BoolExpr *) clause)->boolop == AND_EXPR))
+		{
+			restrictionList = list_concat(restrictionList,
+										  ShardColumnRestrictionList(clause));
+		}
+		else
+		{
+			ShardColumnRestriction *restriction =
+				ShardColumnRestrictionFromClause(clause);
+
+			if (restriction != NULL)
+			{
+				restrictionList = lappend(restrictionList, restriction);
+			}
+		}
+	}
+
+	return restrictionList;
+}
+
+
+/*
+ * ShardColumnRestrictionFromClause returns the restriction for a clause of
+ * the form "column op constant" or "constant op column", where op is a btree
+ * comparison operator of the default operator class of the column type, or
+ * NULL for any other clause.
+ */
+static ShardColumnRestriction *
+ShardColumnRestrictionFromClause(Node *clause)
+{
+	OpExpr *operatorExpression = NULL;
+	Node *leftOperand = NULL;
+	Node *rightOperand = NULL;
+	Var *column = NULL;
+	Const *constant = NULL;
+	TypeCacheEntry *typeEntry = NULL;
+	ShardColumnRestriction *restriction = NULL;
+	int strategy = 0;
+	Oid leftType = InvalidOid;
+	Oid rightType = InvalidOid;
+	bool commuted = false;
+
+	if (!IsA(clause, OpExpr) || list_length(((OpExpr *) clause)->args) != 2)
+	{
+		return NULL;
+	}
+
+	operatorExpression = (OpExpr *) clause;
+	leftOperand = (Node *) linitial(operatorExpression->args);
+	rightOperand = (Node *) lsecond(operatorExpression->args);
+
+	if (IsA(leftOperand, Var) && IsA(rightOperand, Const))
+	{
+		column = (Var *) leftOperand;
+		constant = (Const *) rightOperand;
+	}
+	else if (IsA(leftOperand, Const) && IsA(rightOperand, Var))
+	{
+		column = (Var *) rightOperand;
+		constant = (Const *) leftOperand;
+		commuted = true;
+	}
+	else
+	{
+		return NULL;
+	}
+
+	if (column->varno != 1 || column->varlevelsup != 0 || column->varattno <= 0 ||
+		constant->constisnull)
+	{
+		return NULL;
+	}
+
+	/* the values were sorted on the workers using the collation of the column */
+	if (operatorExpression->inputcollid != column->varcollid)
+	{
+		return NULL;
+	}
+
+	typeEntry = lookup_type_cache(column->vartype, TYPECACHE_BTREE_OPFAMILY |
+								  TYPECACHE_CMP_PROC);
+	if (!OidIsValid(typeEntry->btree_opf) || !OidIsValid(typeEntry->cmp_proc) ||
+		!op_in_opfamily(operatorExpression->opno, typeEntry->btree_opf))
+	{
+		return NULL;
+	}
+
+	get_op_opfamily_properties(operatorExpression->opno, typeEntry->btree_opf, false,
+							   &strategy, &leftType, &rightType);
+	if (leftType != column->vartype || rightType != column->vartype)
+	{
+		return NULL;
+	}
+
+	if (commuted)
+	{
+		strategy = BTCommuteStrategyNumber(strategy);
+	}
+
+	restriction = palloc0(sizeof(ShardColumnRestriction));
+	restriction->attnum = column->varattno;
+	restriction->typeId = column->vartype;
+	restriction->collation = column->varcollid;
+	restriction->strategy = strategy;
+	restriction->value = constant->constvalue;
+
+	return restriction;
+}
+
+
+/*
+ * ShardColumnRangeMatches returns whether a row of a shard with the given
+ * column range can satisfy the given restriction.
+ */
+static bool
+ShardColumnRangeMatches(ShardColumnRangeEntry *range,
+						ShardColumnRestriction *restriction)
+{
+	TypeCacheEntry *typeEntry = NULL;
+	FmgrInfo *compareFunction = NULL;
+	Datum minValue = 0;
+	Datum maxValue = 0;
+	int minComparison = 0;
+	int maxComparison = 0;
+
+	if (!range->hasValues)
+	{
+		/* comparisons with NULL never hold */
+		return false;
+	}
+
+	typeEntry = lookup_type_cache(restriction->typeId, TYPECACHE_CMP_PROC_FINFO);
+	compareFunction = &typeEntry->cmp_proc_finfo;
+
+	minValue = ShardColumnRangeValue(range->minValue, range->typeId);
+	maxValue = ShardColumnRangeValue(range->maxValue, range->typeId);
+
+	minComparison = DatumGetInt32(FunctionCall2Coll(compareFunction,
+													restriction->collation,
+													minValue, restriction->value));
+	maxComparison = DatumGetInt32(FunctionCall2Coll(compareFunction,
+													restriction->collation,
+													maxValue, restriction->value));
+
+	switch (restriction->strategy)
+	{
+		case BTLessStrategyNumber:
+		{
+			return minComparison < 0;
+		}
+
+		case BTLessEqualStrategyNumber:
+		{
+			return minComparison <= 0;
+		}
+
+		case BTEqualStrategyNumber:
+		{
+			return minComparison <= 0 && maxComparison >= 0;
+		}
+
+		case BTGreaterEqualStrategyNumber:
+		{
+			return maxComparison >= 0;
+		}
+
+		case BTGreaterStrategyNumber:
+		{
+			return maxComparison > 0;
+		}
+
+		default:
+		{
+			return true;
+		}
+	}
+}
+
+
+/*
+ * ShardColumnRangeValue converts a stored minimum or maximum value of the
+ * given type into a datum.
+ */
+static Datum
+ShardColumnRangeValue(char *storedValue, Oid typeId)
+{
+	Oid typeIoParam = InvalidOid;
+
+	if (type_is_collatable(typeId))
+	{
+		Oid inputFunctionId = InvalidOid;
+
+		getTypeInputInfo(typeId, &inputFunctionId, &typeIoParam);
+
+		return OidInputFunctionCall(inputFunctionId, storedValue, typeIoParam, -1);
+	}
+	else
+	{
+		Oid receiveFunctionId = InvalidOid;
+		int hexLength = strlen(storedValue);
+		StringInfoData binaryValue;
+
+		initStringInfo(&binaryValue);
+		enlargeStringInfo(&binaryValue, hexLength / 2 + 1);
+
+		binaryValue.len = hex_decode(storedValue, hexLength, binaryValue.data);
+		binaryValue.data[binaryValue.len] = '\0';
+
+		getTypeBinaryInputInfo(typeId, &receiveFunctionId, &typeIoParam);
+
+		return OidReceiveFunctionCall(receiveFunctionId, &binaryValue, typeIoParam,
+									  -1);
+	}
+}
@@ -0,0 +1,1153 @@
+/*-------------------------------------------------------------------------
+ *
+ * shared_metadata_cache.c
+ *
+ * Shard metadata cache that is shared by all backends. Building the shard
+ * interval and placement arrays of a distributed table requires scanning
+ * pg_dist_shard and pg_dist_placement, converting the min/max values of each
+ * shard via the type input functions and sorting the intervals, which is
+ * expensive for tables with many shards. Each backend does this once per
+ * table, so every new connection pays for it again.
+ *
+ * When citus.enable_shared_metadata_cache is on, the sorted shard intervals
+ * and placements of a table are additionally serialized into a dynamic shared
+ * memory area, such that other backends can restore them without touching
+ * the catalogs.
+ *
+ * The shared copies are versioned by a single counter in shared memory, which
+ * is advanced after a transaction that changed shard metadata commits, i.e.
+ * once its changes are visible to new snapshots. A backend reads the version
+ * before it scans the catalogs and only stores its shard list if the version
+ * did not change in the meantime, and a shared copy is only used if its
+ * version is still the current one. Hence a shard list that was read using
+ * a snapshot older than a concurrent metadata change is never used by other
+ * backends.
+ *
+ * Each version also corresponds to a record in a ring of recent metadata
+ * changes, which tells which relation, and for placement changes which
+ * shard, changed. Backends use it to refresh only the placements of the
+ * changed shards of an invalidated cache entry, instead of rebuilding the
+ * whole entry, see RefreshDistTableCacheEntry.
+ *
+ * Prepared transactions publish their changes when they are prepared, but the
+ * changes only become visible once they are committed, so shard lists that
+ * are read in between would be stale. The global identifiers of prepared
+ * transactions that changed shard metadata are therefore remembered, and
+ * COMMIT PREPARED of such a transaction advances the version once more.
+ *
+ * Copyright (c) 2019, Citus Data, Inc.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+#include "miscadmin.h"
+
+#include "access/twophase.h"
+#include "access/xact.h"
+#include "catalog/pg_type.h"
+#include "distributed/citus_nodes.h"
+#include "distributed/relay_utility.h"
+#include "distributed/shared_metadata_cache.h"
+#include "executor/spi.h"
+#include "nodes/pg_list.h"
+#include "port/atomics.h"
+#include "storage/dsm.h"
+#include "storage/ipc.h"
+#include "storage/lwlock.h"
+#include "storage/shmem.h"
+#include "utils/datum.h"
+#include "utils/dsa.h"
+#include "utils/hsearch.h"
+#include "utils/memutils.h"
+#include "utils/timestamp.h"
+
+
+/* maximum number of distributed tables of which the shard lists are shared */
+#define SHARED_METADATA_CACHE_MAX_TABLES 4096
+
+/* maximum amount of dynamic shared memory used for the shard lists */
+#define SHARED_METADATA_CACHE_MAX_SIZE (256 * 1024 * 1024)
+
+/* number of recent metadata changes that are remembered in shared memory */
+#define METADATA_CHANGE_RING_SIZE 1024
+
+/* number of changes a transaction tracks before invalidating the database */
+#define MAX_PENDING_METADATA_CHANGES 64
+
+
+/*
+ * MetadataChangeRecord describes a shard metadata change. A record with an
+ * invalid shard id covers all shards of the relation, a record with an
+ * invalid relation id covers all relations of the database, and a record
+ * with an invalid database id covers all databases.
+ */
+typedef struct MetadataChangeRecord
+{
+	Oid databaseId;
+	Oid relationId;
+	uint64 shardId;
+} MetadataChangeRecord;
+
+
+/*
+ * Shared memory data for the shared metadata cache.
+ */
+typedef struct SharedMetadataCacheControlData
+{
+	/*
+	 * Lock protecting the area handle and the shard list hash. Taken in
+	 * shared mode to read shard lists and in exclusive mode to change them.
+	 */
+	int trancheId;
+	char *lockTrancheName;
+	LWLock lock;
+
+	/* dynamic shared memory area in which the shard lists are stored */
+	dsa_handle areaHandle;
+
+	/* version of the shard metadata, advanced on every change */
+	pg_atomic_uint64 metadataVersion;
+
+	/* version at which shard lists of older versions were last removed */
+	uint64 sweptVersion;
+
+	/* recent metadata changes, the change of version v is at v % ring size */
+	MetadataChangeRecord changeRing[METADATA_CHANGE_RING_SIZE];
+
+	/*
+	 * Number of used entries in the array of global identifiers of prepared
+	 * transactions that changed shard metadata, which has room for
+	 * max_prepared_xacts entries.
+	 */
+	int preparedChangeCount;
+
+	/*
+	 * Set when a prepared transaction that changed shard metadata could not
+	 * be remembered, or when transactions that were prepared before the
+	 * shared memory was initialized might still be pending. In both cases
+	 * every COMMIT PREPARED advances the version.
+	 */
+	bool untrackedPreparedChanges;
+
+	/* time at which the shared memory was initialized */
+	TimestampTz initTime;
+} SharedMetadataCacheControlData;
+
+
+/*
+ * Key of the shard list hash, relation ids are only unique within a database.
+ */
+typedef struct SharedShardListKey
+{
+	Oid databaseId;
+	Oid relationId;
+} SharedShardListKey;
+
+
+/*
+ * SharedShardListEntry points to the serialized shard list of a table.
+ */
+typedef struct SharedShardListEntry
+{
+	SharedShardListKey key;
+
+	/* metadata version at which the shard list was read */
+	uint64 metadataVersion;
+
+	int shardCount;
+	dsa_pointer shardListData;
+} SharedShardListEntry;
+
+
+/* config variable */
+bool EnableSharedMetadataCache = false;
+
+static shmem_startup_hook_type prev_shmem_startup_hook = NULL;
+static SharedMetadataCacheControlData *SharedMetadataCacheControl = NULL;
+static HTAB *SharedShardListHash = NULL;
+
+/* global identifiers of prepared transactions that changed shard metadata */
+static char *PreparedChangeGidArray = NULL;
+
+/* the shared memory area, once this backend attached to it */
+static dsa_area *SharedMetadataCacheArea = NULL;
+
+/* shard metadata changes of the current transaction */
+static MetadataChangeRecord PendingMetadataChanges[MAX_PENDING_METADATA_CHANGES];
+static int PendingMetadataChangeCount = 0;
+
+
+static size_t SharedMetadataCacheShmemSize(void);
+static void SharedMetadataCacheShmemInit(void);
+static void SharedMetadataCacheXactCallback(XactEvent event, void *arg);
+static void PublishMetadataChanges(MetadataChangeRecord *changeArray, int changeCount);
+static bool PreparedBeforeTime(TimestampTz timestamp);
+static bool MetadataChangeCoversRelation(MetadataChangeRecord *change, Oid relationId);
+static void AppendChangedShardId(List **changedShardIdList, uint64 shardId);
+static bool AttachSharedMetadataCacheArea(bool createIfMissing);
+static void RemoveStaleSharedShardLists(uint64 metadataVersion);
+static Size ShardListSerializedSize(int shardCount, ShardInterval **shardIntervalArray,
+									int *arrayOfPlacementArrayLengths);
+static void SerializeShardList(char *data, int shardCount,
+							   ShardInterval **shardIntervalArray,
+							   GroupShardPlacement **arrayOfPlacementArrays,
+							   int *arrayOfPlacementArrayLengths);
+static void DeserializeShardList(char *data, Oid relationId, int shardCount,
+								 ShardInterval **shardIntervalArray,
+								 GroupShardPlacement **arrayOfPlacementArrays,
+								 int *arrayOfPlacementArrayLengths);
+
+
+/*
+ * InitializeSharedMetadataCache, called at server start, requests the shared
+ * memory of the shared metadata cache and registers the transaction callback
+ * that publishes metadata changes.
+ */
+void
+InitializeSharedMetadataCache(void)
+{
+	if (!IsUnderPostmaster)
+	{
+		RequestAddinShmemSpace(SharedMetadataCacheShmemSize());
+	}
+
+	prev_shmem_startup_hook = shmem_startup_hook;
+	shmem_startup_hook = SharedMetadataCacheShmemInit;
+
+	RegisterXactCallback(SharedMetadataCacheXactCallback, NULL);
+}
+
+
+/*
+ * SharedMetadataCacheShmemSize returns the size of the shared memory that is
+ * required for the shared metadata cache.
+ */
+static size_t
+SharedMetadataCacheShmemSize(void)
+{
+	Size size = 0;
+
+	size = add_size(size, sizeof(SharedMetadataCacheControlData));
+	size = add_size(size, mul_size(max_prepared_xacts, GIDSIZE));
+	size = add_size(size, hash_estimate_size(SHARED_METADATA_CACHE_MAX_TABLES,
+											 sizeof(SharedShardListEntry)));
+
+	return size;
+}
+
+
+/*
+ * SharedMetadataCacheShmemInit initializes the requested shared memory for the
+ * shared metadata cache. The dynamic shared memory area is only created once
+ * a shard list is stored.
+ */
+static void
+SharedMetadataCacheShmemInit(void)
+{
+	bool alreadyInitialized = false;
+	HASHCTL hashInfo;
+	int hashFlags = 0;
+
+	LWLockAcquire(AddinShmemInitLock, LW_EXCLUSIVE);
+
+	SharedMetadataCacheControl =
+		(SharedMetadataCacheControlData *) ShmemInitStruct(
+			"Citus Shared Metadata Cache",
+			sizeof(SharedMetadataCacheControlData),
+			&alreadyInitialized);
+
+	/*
+	 * Might already be initialized on EXEC_BACKEND type platforms that call
+	 * shared library initialization functions in every backend.
+	 */
+	if (!alreadyInitialized)
+	{
+		SharedMetadataCacheControl->trancheId = LWLockNewTrancheId();
+		SharedMetadataCacheControl->lockTrancheName = "Citus Shared Metadata Cache";
+		LWLockRegisterTranche(SharedMetadataCacheControl->trancheId,
+							  SharedMetadataCacheControl->lockTrancheName);
+
+		LWLockInitialize(&SharedMetadataCacheControl->lock,
+						 SharedMetadataCacheControl->trancheId);
+
+		SharedMetadataCacheControl->areaHandle = DSM_HANDLE_INVALID;
+		SharedMetadataCacheControl->sweptVersion = 0;
+		SharedMetadataCacheControl->preparedChangeCount = 0;
+		SharedMetadataCacheControl->initTime = GetCurrentTimestamp();
+
+		/* transactions prepared before a restart are not known */
+		SharedMetadataCacheControl->untrackedPreparedChanges =
+			(max_prepared_xacts > 0);
+
+		/* start at 1, such that 0 never matches a valid version */
+		pg_atomic_init_u64(&SharedMetadataCacheControl->metadataVersion, 1);
+	}
+
+	PreparedChangeGidArray =
+		(char *) ShmemInitStruct("Citus Prepared Metadata Changes",
+								 mul_size(max_prepared_xacts, GIDSIZE),
+								 &alreadyInitialized);
+
+	memset(&hashInfo, 0, sizeof(hashInfo));
+	hashInfo.keysize = sizeof(SharedShardListKey);
+	hashInfo.entrysize = sizeof(SharedShardListEntry);
+	hashFlags = (HASH_ELEM | HASH_BLOBS);
+
+	SharedShardListHash = ShmemInitHash("Citus Shared Shard List Hash",
+										SHARED_METADATA_CACHE_MAX_TABLES,
+										SHARED_METADATA_CACHE_MAX_TABLES,
+										&hashInfo, hashFlags);
+
+	LWLockRelease(AddinShmemInitLock);
+
+	if (prev_shmem_startup_hook != NULL)
+	{
+		prev_shmem_startup_hook();
+	}
+}
+
+
+/*
+ * SharedMetadataCacheVersion returns the current version of the shard
+ * metadata. Callers that build a shard list from the catalogs should read
+ * the version before scanning the catalogs.
+ */
+uint64
+SharedMetadataCacheVersion(void)
+{
+	uint64 metadataVersion = 0;
+
+	if (SharedMetadataCacheControl == NULL)
+	{
+		return 0;
+	}
+
+	metadataVersion = pg_atomic_read_u64(&SharedMetadataCacheControl->metadataVersion);
+
+	/* make sure the catalogs are not read before the version */
+	pg_read_barrier();
+
+	return metadataVersion;
+}
+
+
+/*
+ * MarkShardMetadataChanged records that the current transaction changed the
+ * metadata of the given relation, or only the placements of the given shard
+ * if shardId is valid, such that the change is published when the transaction
+ * ends.
+ */
+void
+MarkShardMetadataChanged(Oid relationId, uint64 shardId)
+{
+	MetadataChangeRecord *lastChange = NULL;
+	int changeIndex = 0;
+
+	for (changeIndex = 0; changeIndex < PendingMetadataChangeCount; changeIndex++)
+	{
+		MetadataChangeRecord *pendingChange = &PendingMetadataChanges[changeIndex];
+
+		if (pendingChange->relationId == InvalidOid)
+		{
+			/* the whole database is already invalidated */
+			return;
+		}
+
+		if (pendingChange->relationId == relationId &&
+			(pendingChange->shardId == INVALID_SHARD_ID ||
+			 pendingChange->shardId == shardId))
+		{
+			return;
+		}
+	}
+
+	if (PendingMetadataChangeCount == MAX_PENDING_METADATA_CHANGES ||
+		relationId == InvalidOid)
+	{
+		/* too many changes to track individually, invalidate the database */
+		PendingMetadataChangeCount = 0;
+		relationId = InvalidOid;
+		shardId = INVALID_SHARD_ID;
+	}
+
+	lastChange = &PendingMetadataChanges[PendingMetadataChangeCount];
+	lastChange->databaseId = MyDatabaseId;
+	lastChange->relationId = relationId;
+	lastChange->shardId = shardId;
+
+	PendingMetadataChangeCount++;
+}
+
+
+/*
+ * HasPendingShardMetadataChanges returns whether the current transaction
+ * changed shard metadata that is not yet visible to other backends. Shard
+ * lists should then neither be loaded from nor stored in the shared cache.
+ */
+bool
+HasPendingShardMetadataChanges(void)
+{
+	return PendingMetadataChangeCount > 0;
+}
+
+
+/*
+ * RememberPreparedMetadataChanges is called right before the current
+ * transaction is prepared with the given global identifier. If the
+ * transaction changed shard metadata, the identifier is remembered such that
+ * PublishPreparedMetadataChanges advances the version on COMMIT PREPARED.
+ */
+void
+RememberPreparedMetadataChanges(const char *gid)
+{
+	int preparedChangeCount = 0;
+
+	if (SharedMetadataCacheControl == NULL || PendingMetadataChangeCount == 0 ||
+		IsAbortedTransactionBlockState())
+	{
+		/* aborted transactions are rolled back when they are prepared */
+		return;
+	}
+
+	LWLockAcquire(&SharedMetadataCacheControl->lock, LW_EXCLUSIVE);
+
+	preparedChangeCount = SharedMetadataCacheControl->preparedChangeCount;
+	if (preparedChangeCount < max_prepared_xacts)
+	{
+		strlcpy(PreparedChangeGidArray + preparedChangeCount * GIDSIZE, gid, GIDSIZE);
+		SharedMetadataCacheControl->preparedChangeCount++;
+	}
+	else
+	{
+		/* only happens if preparing transactions failed after this point */
+		SharedMetadataCacheControl->untrackedPreparedChanges = true;
+	}
+
+	LWLockRelease(&SharedMetadataCacheControl->lock);
+}
+
+
+/*
+ * PublishPreparedMetadataChanges is called after the prepared transaction
+ * with the given global identifier was committed or rolled back. If the
+ * transaction changed shard metadata and was committed, the version is
+ * advanced, since shard lists might have been read from the catalogs while
+ * the transaction was prepared. Prepared transactions that only changed data
+ * do not affect the shared cache.
+ */
+void
+PublishPreparedMetadataChanges(const char *gid, bool committed)
+{
+	bool changedMetadata = false;
+	bool untrackedPreparedChanges = false;
+	int preparedChangeCount = 0;
+	int changeIndex = 0;
+
+	if (SharedMetadataCacheControl == NULL)
+	{
+		return;
+	}
+
+	LWLockAcquire(&SharedMetadataCacheControl->lock, LW_EXCLUSIVE);
+
+	preparedChangeCount = SharedMetadataCacheControl->preparedChangeCount;
+	for (changeIndex = 0; changeIndex < preparedChangeCount; changeIndex++)
+	{
+		char *preparedGid = PreparedChangeGidArray + changeIndex * GIDSIZE;
+
+		if (strncmp(preparedGid, gid, GIDSIZE) == 0)
+		{
+			char *lastGid = PreparedChangeGidArray + (preparedChangeCount - 1) * GIDSIZE;
+
+			/* move the last identifier into the free slot */
+			memmove(preparedGid, lastGid, GIDSIZE);
+			SharedMetadataCacheControl->preparedChangeCount--;
+
+			changedMetadata = true;
+			break;
+		}
+	}
+
+	untrackedPreparedChanges = SharedMetadataCacheControl->untrackedPreparedChanges;
+	preparedChangeCount = SharedMetadataCacheControl->preparedChangeCount;
+
+	LWLockRelease(&SharedMetadataCacheControl->lock);
+
+	if (untrackedPreparedChanges && !changedMetadata)
+	{
+		/*
+		 * We cannot tell whether the transaction changed metadata. Once no
+		 * transactions remain that were prepared before the shared memory was
+		 * initialized, we can stop being careful, unless some identifiers
+		 * could not be remembered.
+		 */
+		changedMetadata = true;
+
+		if (preparedChangeCount < max_prepared_xacts &&
+			!PreparedBeforeTime(SharedMetadataCacheControl->initTime))
+		{
+			LWLockAcquire(&SharedMetadataCacheControl->lock, LW_EXCLUSIVE);
+			SharedMetadataCacheControl->untrackedPreparedChanges = false;
+			LWLockRelease(&SharedMetadataCacheControl->lock);
+		}
+	}
+
+	if (changedMetadata && committed)
+	{
+		AdvanceSharedMetadataCacheVersion();
+	}
+}
+
+
+/*
+ * PreparedBeforeTime returns whether there are prepared transactions that
+ * were prepared before the given time.
+ */
+static bool
+PreparedBeforeTime(TimestampTz timestamp)
+{
+	Oid argTypes[1] = { TIMESTAMPTZOID };
+	Datum argValues[1] = { TimestampTzGetDatum(timestamp) };
+	bool preparedBefore = true;
+	int spiStatus = 0;
+
+	if (SPI_connect() != SPI_OK_CONNECT)
+	{
+		return true;
+	}
+
+	spiStatus = SPI_execute_with_args("SELECT 1 FROM pg_catalog.pg_prepared_xacts "
+									  "WHERE prepared < $1 LIMIT 1", 1, argTypes,
+									  argValues, NULL, true, 1);
+	if (spiStatus == SPI_OK_SELECT)
+	{
+		preparedBefore = (SPI_processed > 0);
+	}
+
+	SPI_finish();
+
+	return preparedBefore;
+}
+
+
+/*
+ * AdvanceSharedMetadataCacheVersion publishes a change that covers all
+ * metadata, which makes all the shard lists in the shared metadata cache
+ * stale and requires invalidated cache entries to be rebuilt. It is used
+ * when it is not known which metadata changed, and should only be called
+ * once the changes are visible to new snapshots.
+ */
+void
+AdvanceSharedMetadataCacheVersion(void)
+{
+	MetadataChangeRecord allMetadataChange;
+
+	allMetadataChange.databaseId = InvalidOid;
+	allMetadataChange.relationId = InvalidOid;
+	allMetadataChange.shardId = INVALID_SHARD_ID;
+
+	PublishMetadataChanges(&allMetadataChange, 1);
+}
+
+
+/*
+ * SharedMetadataCacheXactCallback publishes the metadata changes of the
+ * transaction when it ends. XACT_EVENT_COMMIT is called after the transaction
+ * became visible to other backends, and before the invalidation messages are
+ * sent, such that other backends find the changes once they process them.
+ *
+ * Changes of aborted and prepared transactions are published as well, since
+ * the local cache entries might have been built from their uncommitted
+ * metadata. Prepared transactions that changed metadata publish a change that
+ * covers all metadata again on COMMIT PREPARED, see
+ * PublishPreparedMetadataChanges.
+ */
+static void
+SharedMetadataCacheXactCallback(XactEvent event, void *arg)
+{
+	switch (event)
+	{
+		case XACT_EVENT_COMMIT:
+		case XACT_EVENT_ABORT:
+		case XACT_EVENT_PREPARE:
+		{
+			if (PendingMetadataChangeCount > 0)
+			{
+				PublishMetadataChanges(PendingMetadataChanges,
+									   PendingMetadataChangeCount);
+			}
+
+			PendingMetadataChangeCount = 0;
+			break;
+		}
+
+		default:
+		{
+			break;
+		}
+	}
+}
+
+
+/*
+ * PublishMetadataChanges advances the metadata version once for each of the
+ * given changes and stores the changes in the ring of recent changes.
+ */
+static void
+PublishMetadataChanges(MetadataChangeRecord *changeArray, int changeCount)
+{
+	uint64 metadataVersion = 0;
+	int changeIndex = 0;
+
+	if (SharedMetadataCacheControl == NULL)
+	{
+		return;
+	}
+
+	LWLockAcquire(&SharedMetadataCacheControl->lock, LW_EXCLUSIVE);
+
+	metadataVersion = pg_atomic_read_u64(&SharedMetadataCacheControl->metadataVersion);
+
+	for (changeIndex = 0; changeIndex < changeCount; changeIndex++)
+	{
+		metadataVersion++;
+
+		SharedMetadataCacheControl->changeRing[metadataVersion %
+											   METADATA_CHANGE_RING_SIZE] =
+			changeArray[changeIndex];
+	}
+
+	pg_atomic_write_u64(&SharedMetadataCacheControl->metadataVersion, metadataVersion);
+
+	LWLockRelease(&SharedMetadataCacheControl->lock);
+}
+
+
+/*
+ * ShardMetadataChangesSince finds the shards of the given relation of which
+ * the placements changed after the given metadata version, including the
+ * changes of the current transaction, and appends their shard ids to
+ * changedShardIdList. The function returns false if something other than
+ * placements changed, or if the changes are no longer known.
+ */
+bool
+ShardMetadataChangesSince(Oid relationId, uint64 metadataVersion,
+						  List **changedShardIdList)
+{
+	uint64 currentVersion = 0;
+	uint64 changeVersion = 0;
+	int changeIndex = 0;
+	bool changesKnown = true;
+
+	if (SharedMetadataCacheControl == NULL || metadataVersion == 0)
+	{
+		return false;
+	}
+
+	for (changeIndex = 0; changeIndex < PendingMetadataChangeCount; changeIndex++)
+	{
+		MetadataChangeRecord *pendingChange = &PendingMetadataChanges[changeIndex];
+
+		if (!MetadataChangeCoversRelation(pendingChange, relationId))
+		{
+			continue;
+		}
+
+		if (pendingChange->shardId == INVALID_SHARD_ID)
+		{
+			return false;
+		}
+
+		AppendChangedShardId(changedShardIdList, pendingChange->shardId);
+	}
+
+	LWLockAcquire(&SharedMetadataCacheControl->lock, LW_SHARED);
+
+	currentVersion = pg_atomic_read_u64(&SharedMetadataCacheControl->metadataVersion);
+	if (currentVersion - metadataVersion > METADATA_CHANGE_RING_SIZE)
+	{
+		/* the ring has wrapped around since the given version */
+		changesKnown = false;
+	}
+
+	for (changeVersion = metadataVersion + 1;
+		 changesKnown && changeVersion <= currentVersion;
+		 changeVersion++)
+	{
+		MetadataChangeRecord *change =
+			&SharedMetadataCacheControl->changeRing[changeVersion %
+													METADATA_CHANGE_RING_SIZE];
+
+		if (!MetadataChangeCoversRelation(change, relationId))
+		{
+			continue;
+		}
+
+		if (change->shardId == INVALID_SHARD_ID)
+		{
+			changesKnown = false;
+			break;
+		}
+
+		AppendChangedShardId(changedShardIdList, change->shardId);
+	}
+
+	LWLockRelease(&SharedMetadataCacheControl->lock);
+
+	return changesKnown;
+}
+
+
+/*
+ * MetadataChangeCoversRelation returns whether the given change might have
+ * changed the metadata of the given relation in the current database.
+ */
+static bool
+MetadataChangeCoversRelation(MetadataChangeRecord *change, Oid relationId)
+{
+	if (change->databaseId != InvalidOid && change->databaseId != MyDatabaseId)
+	{
+		return false;
+	}
+
+	if (change->relationId != InvalidOid && change->relationId != relationId)
+	{
+		return false;
+	}
+
+	return true;
+}
+
+
+/*
+ * AppendChangedShardId appends the given shard id to the list, unless it is
+ * already in the list.
+ */
+static void
+AppendChangedShardId(List **changedShardIdList, uint64 shardId)
+{
+	ListCell *shardIdCell = NULL;
+	uint64 *shardIdPointer = NULL;
+
+	foreach(shardIdCell, *changedShardIdList)
+	{
+		if (*((uint64 *) lfirst(shardIdCell)) == shardId)
+		{
+			return;
+		}
+	}
+
+	shardIdPointer = (uint64 *) palloc0(sizeof(uint64));
+	*shardIdPointer = shardId;
+
+	*changedShardIdList = lappend(*changedShardIdList, shardIdPointer);
+}
+
+
+/*
+ * LoadSharedShardList restores the sorted shard intervals and placements of
+ * the given relation from the shared metadata cache into the current memory
+ * context. The function returns false if there is no shard list of the
+ * current metadata version in the cache.
+ */
+bool
+LoadSharedShardList(Oid relationId, uint64 metadataVersion, int *shardCount,
+					ShardInterval ***shardIntervalArray,
+					GroupShardPlacement ***arrayOfPlacementArrays,
+					int **arrayOfPlacementArrayLengths)
+{
+	SharedShardListEntry *shardListEntry = NULL;
+	SharedShardListKey shardListKey;
+	uint64 currentVersion = 0;
+	int entryShardCount = 0;
+
+	if (!EnableSharedMetadataCache || SharedMetadataCacheControl == NULL ||
+		metadataVersion == 0)
+	{
+		return false;
+	}
+
+	if (!AttachSharedMetadataCacheArea(false))
+	{
+		return false;
+	}
+
+	memset(&shardListKey, 0, sizeof(shardListKey));
+	shardListKey.databaseId = MyDatabaseId;
+	shardListKey.relationId = relationId;
+
+	LWLockAcquire(&SharedMetadataCacheControl->lock, LW_SHARED);
+
+	shardListEntry = (SharedShardListEntry *) hash_search(SharedShardListHash,
+														  &shardListKey, HASH_FIND,
+														  NULL);
+
+	currentVersion = pg_atomic_read_u64(&SharedMetadataCacheControl->metadataVersion);
+	if (shardListEntry == NULL || shardListEntry->metadataVersion != currentVersion)
+	{
+		LWLockRelease(&SharedMetadataCacheControl->lock);
+
+		return false;
+	}
+
+	entryShardCount = shardListEntry->shardCount;
+	if (entryShardCount > 0)
+	{
+		char *data = dsa_get_address(SharedMetadataCacheArea,
+									 shardListEntry->shardListData);
+
+		*shardIntervalArray = palloc0(entryShardCount * sizeof(ShardInterval *));
+		*arrayOfPlacementArrays = palloc0(entryShardCount *
+										  sizeof(GroupShardPlacement *));
+		*arrayOfPlacementArrayLengths = palloc0(entryShardCount * sizeof(int));
+
+		DeserializeShardList(data, relationId, entryShardCount, *shardIntervalArray,
+							 *arrayOfPlacementArrays, *arrayOfPlacementArrayLengths);
+	}
+	else
+	{
+		*shardIntervalArray = NULL;
+		*arrayOfPlacementArrays = NULL;
+		*arrayOfPlacementArrayLengths = NULL;
+	}
+
+	LWLockRelease(&SharedMetadataCacheControl->lock);
+
+	*shardCount = entryShardCount;
+
+	return true;
+}
+
+
+/*
+ * StoreSharedShardList stores the sorted shard intervals and placements of the
+ * given relation in the shared metadata cache, unless the metadata changed
+ * since metadataVersion was read. The shard list is silently not stored if
+ * the cache is full.
+ */
+void
+StoreSharedShardList(Oid relationId, uint64 metadataVersion, int shardCount,
+					 ShardInterval **shardIntervalArray,
+					 GroupShardPlacement **arrayOfPlacementArrays,
+					 int *arrayOfPlacementArrayLengths)
+{
+	SharedShardListEntry *shardListEntry = NULL;
+	SharedShardListKey shardListKey;
+	dsa_pointer shardListData = InvalidDsaPointer;
+	char *data = NULL;
+	Size dataSize = 0;
+	bool foundInCache = false;
+
+	if (!EnableSharedMetadataCache || SharedMetadataCacheControl == NULL ||
+		metadataVersion == 0)
+	{
+		return;
+	}
+
+	/* serialize before taking the lock, to keep the critical section short */
+	dataSize = ShardListSerializedSize(shardCount, shardIntervalArray,
+									   arrayOfPlacementArrayLengths);
+	data = palloc(dataSize);
+
+	SerializeShardList(data, shardCount, shardIntervalArray, arrayOfPlacementArrays,
+					   arrayOfPlacementArrayLengths);
+
+	if (!AttachSharedMetadataCacheArea(true))
+	{
+		pfree(data);
+		return;
+	}
+
+	memset(&shardListKey, 0, sizeof(shardListKey));
+	shardListKey.databaseId = MyDatabaseId;
+	shardListKey.relationId = relationId;
+
+	LWLockAcquire(&SharedMetadataCacheControl->lock, LW_EXCLUSIVE);
+
+	if (metadataVersion !=
+		pg_atomic_read_u64(&SharedMetadataCacheControl->metadataVersion))
+	{
+		/* metadata changed while we were reading it, the shard list may be stale */
+		LWLockRelease(&SharedMetadataCacheControl->lock);
+		pfree(data);
+
+		return;
+	}
+
+	RemoveStaleSharedShardLists(metadataVersion);
+
+	shardListEntry = (SharedShardListEntry *) hash_search(SharedShardListHash,
+														  &shardListKey,
+														  HASH_ENTER_NULL,
+														  &foundInCache);
+	if (shardListEntry == NULL)
+	{
+		/* the cache is full, all entries are of the current version */
+		LWLockRelease(&SharedMetadataCacheControl->lock);
+		pfree(data);
+
+		return;
+	}
+
+	if (foundInCache)
+	{
+		/* another backend already stored the shard list of this version */
+		LWLockRelease(&SharedMetadataCacheControl->lock);
+		pfree(data);
+
+		return;
+	}
+
+	shardListData = dsa_allocate_extended(SharedMetadataCacheArea, dataSize,
+										  DSA_ALLOC_NO_OOM);
+	if (!DsaPointerIsValid(shardListData))
+	{
+		hash_search(SharedShardListHash, &shardListKey, HASH_REMOVE, NULL);
+
+		LWLockRelease(&SharedMetadataCacheControl->lock);
+		pfree(data);
+
+		return;
+	}
+
+	memcpy(dsa_get_address(SharedMetadataCacheArea, shardListData), data, dataSize);
+
+	shardListEntry->metadataVersion = metadataVersion;
+	shardListEntry->shardCount = shardCount;
+	shardListEntry->shardListData = shardListData;
+
+	LWLockRelease(&SharedMetadataCacheControl->lock);
+
+	pfree(data);
+}
+
+
+/*
+ * AttachSharedMetadataCacheArea attaches to the dynamic shared memory area of
+ * the shared metadata cache, and creates the area first if createIfMissing is
+ * true. The mapping is kept until the backend exits. The function returns
+ * false if the area does not exist yet.
+ */
+static bool
+AttachSharedMetadataCacheArea(bool createIfMissing)
+{
+	MemoryContext oldContext = NULL;
+	dsa_handle areaHandle = DSM_HANDLE_INVALID;
+	LWLockMode lockMode = createIfMissing ? LW_EXCLUSIVE : LW_SHARED;
+
+	if (SharedMetadataCacheArea != NULL)
+	{
+		return true;
+	}
+
+	oldContext = MemoryContextSwitchTo(TopMemoryContext);
+
+	LWLockAcquire(&SharedMetadataCacheControl->lock, lockMode);
+
+	areaHandle = SharedMetadataCacheControl->areaHandle;
+	if (areaHandle != DSM_HANDLE_INVALID)
+	{
+		SharedMetadataCacheArea = dsa_attach(areaHandle);
+		dsa_pin_mapping(SharedMetadataCacheArea);
+	}
+	else if (createIfMissing)
+	{
+		SharedMetadataCacheArea = dsa_create(SharedMetadataCacheControl->trancheId);
+		dsa_set_size_limit(SharedMetadataCacheArea, SHARED_METADATA_CACHE_MAX_SIZE);
+
+		/* keep the area around when no backend is attached */
+		dsa_pin(SharedMetadataCacheArea);
+		dsa_pin_mapping(SharedMetadataCacheArea);
+
+		SharedMetadataCacheControl->areaHandle =
+			dsa_get_handle(SharedMetadataCacheArea);
+	}
+
+	LWLockRelease(&SharedMetadataCacheControl->lock);
+
+	MemoryContextSwitchTo(oldContext);
+
+	return SharedMetadataCacheArea != NULL;
+}
+
+
+/*
+ * RemoveStaleSharedShardLists frees the shard lists of versions older than
+ * the given version, which can never be used again. The caller should hold
+ * the lock in exclusive mode.
+ */
+static void
+RemoveStaleSharedShardLists(uint64 metadataVersion)
+{
+	SharedShardListEntry *shardListEntry = NULL;
+	HASH_SEQ_STATUS status;
+
+	if (SharedMetadataCacheControl->sweptVersion == metadataVersion)
+	{
+		return;
+	}
+
+	hash_seq_init(&status, SharedShardListHash);
+
+	while ((shardListEntry = (SharedShardListEntry *) hash_seq_search(&status)) != NULL)
+	{
+		if (shardListEntry->metadataVersion == metadataVersion)
+		{
+			continue;
+		}
+
+		if (DsaPointerIsValid(shardListEntry->shardListData))
+		{
+			dsa_free(SharedMetadataCacheArea, shardListEntry->shardListData);
+		}
+
+		hash_search(SharedShardListHash, &shardListEntry->key, HASH_REMOVE, NULL);
+	}
+
+	SharedMetadataCacheControl->sweptVersion = metadataVersion;
+}
+
+
+/*
+ * ShardListSerializedSize returns the number of bytes SerializeShardList
+ * writes for the given shard list.
+ */
+static Size
+ShardListSerializedSize(int shardCount, ShardInterval **shardIntervalArray,
+						int *arrayOfPlacementArrayLengths)
+{
+	Size size = 0;
+	int shardIndex = 0;
+
+	for (shardIndex = 0; shardIndex < shardCount; shardIndex++)
+	{
+		ShardInterval *shardInterval = shardIntervalArray[shardIndex];
+		int placementCount = arrayOfPlacementArrayLengths[shardIndex];
+
+		size = add_size(size, sizeof(uint64) + sizeof(char) + sizeof(Oid) +
+						sizeof(int) + sizeof(bool));
+		size = add_size(size, datumEstimateSpace(shardInterval->minValue,
+												 !shardInterval->minValueExists,
+												 shardInterval->valueByVal,
+												 shardInterval->valueTypeLen));
+		size = add_size(size, datumEstimateSpace(shardInterval->maxValue,
+												 !shardInterval->maxValueExists,
+												 shardInterval->valueByVal,
+												 shardInterval->valueTypeLen));
+		size = add_size(size, sizeof(int));
+		size = add_size(size, mul_size(placementCount, sizeof(GroupShardPlacement)));
+	}
+
+	/* avoid zero-sized allocations for tables without shards */
+	return Max(size, 1);
+}
+
+
+/*
+ * SerializeShardList writes the given shard intervals and placements into
+ * data, which should be ShardListSerializedSize bytes large. The fields are
+ * copied byte-wise, since the data is not necessarily aligned.
+ */
+static void
+SerializeShardList(char *data, int shardCount, ShardInterval **shardIntervalArray,
+				   GroupShardPlacement **arrayOfPlacementArrays,
+				   int *arrayOfPlacementArrayLengths)
+{
+	char *writePointer = data;
+	int shardIndex = 0;
+
+	for (shardIndex = 0; shardIndex < shardCount; shardIndex++)
+	{
+		ShardInterval *shardInterval = shardIntervalArray[shardIndex];
+		int placementCount = arrayOfPlacementArrayLengths[shardIndex];
+		Size placementSize = placementCount * sizeof(GroupShardPlacement);
+
+		memcpy(writePointer, &shardInterval->shardId, sizeof(uint64));
+		writePointer += sizeof(uint64);
+		memcpy(writePointer, &shardInterval->storageType, sizeof(char));
+		writePointer += sizeof(char);
+		memcpy(writePointer, &shardInterval->valueTypeId, sizeof(Oid));
+		writePointer += sizeof(Oid);
+		memcpy(writePointer, &shardInterval->valueTypeLen, sizeof(int));
+		writePointer += sizeof(int);
+		memcpy(writePointer, &shardInterval->valueByVal, sizeof(bool));
+		writePointer += sizeof(bool);
+
+		datumSerialize(shardInterval->minValue, !shardInterval->minValueExists,
+					   shardInterval->valueByVal, shardInterval->valueTypeLen,
+					   &writePointer);
+		datumSerialize(shardInterval->maxValue, !shardInterval->maxValueExists,
+					   shardInterval->valueByVal, shardInterval->valueTypeLen,
+					   &writePointer);
+
+		memcpy(writePointer, &placementCount, sizeof(int));
+		writePointer += sizeof(int);
+
+		if (placementCount > 0)
+		{
+			memcpy(writePointer, arrayOfPlacementArrays[shardIndex], placementSize);
+			writePointer += placementSize;
+		}
+	}
+}
+
+
+/*
+ * DeserializeShardList restores the shard intervals and placements written by
+ * SerializeShardList into the given arrays, allocating them in the current
+ * memory context.
+ */
+static void
+DeserializeShardList(char *data, Oid relationId, int shardCount,
+					 ShardInterval **shardIntervalArray,
+					 GroupShardPlacement **arrayOfPlacementArrays,
+					 int *arrayOfPlacementArrayLengths)
+{
+	char *readPointer = data;
+	int shardIndex = 0;
+
+	for (shardIndex = 0; shardIndex < shardCount; shardIndex++)
+	{
+		ShardInterval *shardInterval = CitusMakeNode(ShardInterval);
+		GroupShardPlacement *placementArray = NULL;
+		int placementCount = 0;
+		bool minValueIsNull = false;
+		bool maxValueIsNull = false;
+
+		shardInterval->relationId = relationId;
+		shardInterval->shardIndex = shardIndex;
+
+		memcpy(&shardInterval->shardId, readPointer, sizeof(uint64));
+		readPointer += sizeof(uint64);
+		memcpy(&shardInterval->storageType, readPointer, sizeof(char));
+		readPointer += sizeof(char);
+		memcpy(&shardInterval->valueTypeId, readPointer, sizeof(Oid));
+		readPointer += sizeof(Oid);
+		memcpy(&shardInterval->valueTypeLen, readPointer, sizeof(int));
+		readPointer += sizeof(int);
+		memcpy(&shardInterval->valueByVal, readPointer, sizeof(bool));
+		readPointer += sizeof(bool);
+
+		shardInterval->minValue = datumRestore(&readPointer, &minValueIsNull);
+		shardInterval->minValueExists = !minValueIsNull;
+		shardInterval->maxValue = datumRestore(&readPointer, &maxValueIsNull);
+		shardInterval->maxValueExists = !maxValueIsNull;
+
+		memcpy(&placementCount, readPointer, sizeof(int));
+		readPointer += sizeof(int);
+
+		placementArray = palloc0(placementCount * sizeof(GroupShardPlacement));
+		if (placementCount > 0)
+		{
+			Size placementSize = placementCount * sizeof(GroupShardPlacement);
+
+			memcpy(placementArray, readPointer, placementSize);
+			readPointer += placementSize;
+		}
+
+		shardIntervalArray[shardIndex] = shardInterval;
+		arrayOfPlacementArrays[shardIndex] = placementArray;
+		arrayOfPlacementArrayLengths[shardIndex] = placementCount;
+	}
+}
@@ -18,6 +18,7 @@
 #include "catalog/pg_type.h"
 #include "distributed/citus_nodefuncs.h"
 #include "distributed/citus_nodes.h"
+#include "distributed/commands.h"
 #include "distributed/function_call_delegation.h"
 #include "distributed/insert_select_planner.h"
 #include "distributed/intermediate_result_pruning.h"
@@ -45,10 +46,10 @@
 #include "parser/parse_type.h"
 #if PG_VERSION_NUM >= 120000
 #include "optimizer/optimizer.h"
-#include "optimizer/plancat.h"
 #else
 #include "optimizer/cost.h"
 #endif
+#include "optimizer/plancat.h"
 #include "optimizer/pathnode.h"
 #include "optimizer/planner.h"
 #include "utils/builtins.h"
@@ -124,6 +125,14 @@ distributed_planner(Query *parse, int cursorOptions, ParamListInfo boundParams)
 
 		needsDistributedPlanning = true;
 	}
+	else if (cursorOptions & CURSOR_OPT_FORCE_LOCAL_PLANNING)
+	{
+		/*
+		 * The caller wants to read the data that is stored in the local table
+		 * itself, which we do while distributing a table that has data.
+		 */
+		needsDistributedPlanning = false;
+	}
 	else if (CitusHasBeenLoaded())
 	{
 		if (IsLocalReferenceTableJoin(parse, rangeTableList))
@@ -249,7 +258,9 @@ distributed_planner(Query *parse, int cursorOptions, ParamListInfo boundParams)
 	 * standart_planner performs some modifications on parse tree. In such cases
 	 * we will simply error out.
 	 */
-	if (!needsDistributedPlanning && NeedsDistributedPlanning(parse))
+	if (!needsDistributedPlanning &&
+		!(cursorOptions & CURSOR_OPT_FORCE_LOCAL_PLANNING) &&
+		NeedsDistributedPlanning(parse))
 	{
 		ereport(ERROR, (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
 						errmsg("cannot perform distributed planning on this "
@@ -645,6 +656,11 @@ CreateDistributedPlan(uint64 planId, Query *originalQuery, Query *query, ParamLi
 			distributedPlan =
 				CreateInsertSelectPlan(planId, originalQuery, plannerRestrictionContext);
 		}
+		else if (CanUseCopyForMultiRowInsert(originalQuery))
+		{
+			/* large multi-row INSERTs are copied into the shards via the coordinator */
+			distributedPlan = CreateMultiRowInsertCopyPlan(originalQuery);
+		}
 		else
 		{
 			/* modifications are always routed through the same planner/executor */
@@ -1486,6 +1502,46 @@ multi_relation_restriction_hook(PlannerInfo *root, RelOptInfo *relOptInfo,
 }
 
 
+/*
+ * multi_get_relation_info_hook is a hook called when the planner reads the
+ * catalog information of a relation. For distributed tables, postgres bases
+ * the size estimate on the (typically empty) table on the coordinator. We
+ * replace it with the size of the distributed table that a distributed ANALYZE
+ * stored in pg_class, before the planner uses it to estimate the number of
+ * rows and the costs of the paths.
+ */
+void
+multi_get_relation_info_hook(PlannerInfo *root, Oid relationObjectId, bool inhparent,
+							 RelOptInfo *rel)
+{
+	HeapTuple classTuple = NULL;
+	Form_pg_class classForm = NULL;
+
+	if (!EnableDistributedAnalyze || inhparent || rel->reloptkind != RELOPT_BASEREL ||
+		!IsDistributedTable(relationObjectId))
+	{
+		return;
+	}
+
+	classTuple = SearchSysCache1(RELOID, ObjectIdGetDatum(relationObjectId));
+	if (!HeapTupleIsValid(classTuple))
+	{
+		return;
+	}
+
+	classForm = (Form_pg_class) GETSTRUCT(classTuple);
+
+	/* a reltuples of 0 means that the table has not been analyzed */
+	if (classForm->reltuples > 0)
+	{
+		rel->tuples = classForm->reltuples;
+		rel->pages = classForm->relpages;
+	}
+
+	ReleaseSysCache(classTuple);
+}
+
+
 /*
  * AdjustReadIntermediateResultCost adjusts the row count and total cost
  * of a read_intermediate_result call based on the file size.
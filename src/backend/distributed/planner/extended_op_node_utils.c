@@ -54,6 +54,7 @@ BuildExtendedOpNodeProperties(MultiExtendedOp *extendedOpNode)
 	bool hasNonPartitionColumnDistinctAgg = false;
 	bool pullDistinctColumns = false;
 	bool pushDownWindowFunctions = false;
+	bool pullUpWindowFunctions = false;
 
 	tableNodeList = FindNodesOfType((MultiNode *) extendedOpNode, T_MultiTable);
 	groupedByDisjointPartitionColumn = GroupedByDisjointPartitionColumn(tableNodeList,
@@ -71,11 +72,13 @@ BuildExtendedOpNodeProperties(MultiExtendedOp *extendedOpNode)
 								 hasNonPartitionColumnDistinctAgg);
 
 	/*
-	 * TODO: Only window functions that can be pushed down reach here, thus,
-	 * using hasWindowFuncs is safe for now. However, this should be fixed
-	 * when we support pull-to-master window functions.
+	 * Window functions are either pushed down as-is, or evaluated on the
+	 * coordinator when they are not partitioned by the distribution column.
 	 */
-	pushDownWindowFunctions = extendedOpNode->hasWindowFuncs;
+	pushDownWindowFunctions = extendedOpNode->hasWindowFuncs &&
+							  extendedOpNode->onlyPushableWindowFunctions;
+	pullUpWindowFunctions = extendedOpNode->hasWindowFuncs &&
+							!extendedOpNode->onlyPushableWindowFunctions;
 
 	extendedOpNodeProperties.groupedByDisjointPartitionColumn =
 		groupedByDisjointPartitionColumn;
@@ -84,6 +87,7 @@ BuildExtendedOpNodeProperties(MultiExtendedOp *extendedOpNode)
 		hasNonPartitionColumnDistinctAgg;
 	extendedOpNodeProperties.pullDistinctColumns = pullDistinctColumns;
 	extendedOpNodeProperties.pushDownWindowFunctions = pushDownWindowFunctions;
+	extendedOpNodeProperties.pullUpWindowFunctions = pullUpWindowFunctions;
 
 	return extendedOpNodeProperties;
 }
@@ -43,10 +43,15 @@
 #include "parser/parsetree.h"
 #include "parser/parse_coerce.h"
 #include "parser/parse_relation.h"
+#include "rewrite/rewriteManip.h"
 #include "utils/lsyscache.h"
 #include "utils/rel.h"
 
 
+/* config variable */
+int MultiRowInsertCopyThreshold = 0;
+
+
 static DistributedPlan * CreateDistributedInsertSelectPlan(Query *originalQuery,
 														   PlannerRestrictionContext *
 														   plannerRestrictionContext);
@@ -74,6 +79,7 @@ static Query * WrapSubquery(Query *subquery);
 static bool CheckInsertSelectQuery(Query *query);
 static List * TwoPhaseInsertSelectTaskList(Oid targetRelationId, Query *insertSelectQuery,
 										   char *resultIdPrefix);
+static Query * MultiRowInsertValuesQuery(Query *insertQuery);
 
 
 /*
@@ -1223,6 +1229,153 @@ CreateCoordinatorInsertSelectPlan(uint64 planId, Query *parse)
 }
 
 
+/*
+ * CanUseCopyForMultiRowInsert returns whether the given multi-row INSERT can
+ * be executed by copying its rows into the target table, rather than by
+ * sending a deparsed INSERT with a VALUES list to each shard. This is only
+ * done for INSERTs that have at least citus.multi_row_insert_copy_threshold
+ * rows and no ON CONFLICT or RETURNING clause, since COPY supports neither.
+ */
+bool
+CanUseCopyForMultiRowInsert(Query *query)
+{
+	RangeTblEntry *valuesRte = NULL;
+	RangeTblEntry *insertRte = NULL;
+
+	if (MultiRowInsertCopyThreshold <= 0)
+	{
+		return false;
+	}
+
+	valuesRte = ExtractDistributedInsertValuesRTE(query);
+	if (valuesRte == NULL ||
+		list_length(valuesRte->values_lists) < MultiRowInsertCopyThreshold)
+	{
+		return false;
+	}
+
+	if (query->onConflict != NULL || query->returningList != NIL ||
+		query->cteList != NIL || query->hasSubLinks)
+	{
+		return false;
+	}
+
+	/* COPY into an append-distributed table would create new shards */
+	insertRte = ExtractResultRelationRTE(query);
+	if (PartitionMethod(insertRte->relid) == DISTRIBUTE_BY_APPEND)
+	{
+		return false;
+	}
+
+	return true;
+}
+
+
+/*
+ * CreateMultiRowInsertCopyPlan creates a plan for a multi-row INSERT that
+ * evaluates the VALUES list on the coordinator and copies the rows into the
+ * target table. The plan is executed in the same way as an INSERT ... SELECT
+ * via the coordinator, with the VALUES list as the SELECT. The rows are thus
+ * sent to each shard with a single COPY, in binary format when the column
+ * types allow it, rather than as a deparsed VALUES list that the workers need
+ * to parse.
+ */
+DistributedPlan *
+CreateMultiRowInsertCopyPlan(Query *originalQuery)
+{
+	DistributedPlan *distributedPlan = CitusMakeNode(DistributedPlan);
+	RangeTblEntry *insertRte = ExtractResultRelationRTE(originalQuery);
+	List *insertTargetList = NIL;
+	ListCell *targetEntryCell = NULL;
+
+	Assert(CanUseCopyForMultiRowInsert(originalQuery));
+
+	foreach(targetEntryCell, originalQuery->targetList)
+	{
+		TargetEntry *targetEntry = (TargetEntry *) lfirst(targetEntryCell);
+
+		if (!targetEntry->resjunk)
+		{
+			insertTargetList = lappend(insertTargetList, copyObject(targetEntry));
+		}
+	}
+
+	ereport(DEBUG2, (errmsg("Creating plan to copy multi-row INSERT values")));
+
+	distributedPlan->modLevel = RowModifyLevelForQuery(originalQuery);
+	distributedPlan->insertSelectSubquery = MultiRowInsertValuesQuery(originalQuery);
+	distributedPlan->insertTargetList = insertTargetList;
+	distributedPlan->targetRelationId = insertRte->relid;
+
+	return distributedPlan;
+}
+
+
+/*
+ * MultiRowInsertValuesQuery builds a SELECT ... FROM (VALUES ...) query that
+ * returns the rows of the given multi-row INSERT, with one column for each
+ * entry in its target list. Columns that are not part of the VALUES list,
+ * such as default expressions, are evaluated for each row.
+ */
+static Query *
+MultiRowInsertValuesQuery(Query *insertQuery)
+{
+	Query *valuesQuery = makeNode(Query);
+	RangeTblEntry *valuesRte = ExtractDistributedInsertValuesRTE(insertQuery);
+	RangeTblRef *valuesRangeTableRef = makeNode(RangeTblRef);
+	int valuesRangeTableIndex = 0;
+	int rangeTableIndex = 1;
+	AttrNumber resultNumber = 1;
+	ListCell *rangeTableCell = NULL;
+	ListCell *targetEntryCell = NULL;
+
+	foreach(rangeTableCell, insertQuery->rtable)
+	{
+		if (lfirst(rangeTableCell) == valuesRte)
+		{
+			valuesRangeTableIndex = rangeTableIndex;
+			break;
+		}
+
+		rangeTableIndex++;
+	}
+
+	Assert(valuesRangeTableIndex > 0);
+
+	valuesQuery->commandType = CMD_SELECT;
+	valuesQuery->querySource = QSRC_ORIGINAL;
+	valuesQuery->canSetTag = true;
+	valuesQuery->rtable = list_make1(copyObject(valuesRte));
+
+	valuesRangeTableRef->rtindex = 1;
+	valuesQuery->jointree = makeFromExpr(list_make1(valuesRangeTableRef), NULL);
+
+	foreach(targetEntryCell, insertQuery->targetList)
+	{
+		TargetEntry *insertTargetEntry = (TargetEntry *) lfirst(targetEntryCell);
+		TargetEntry *valuesTargetEntry = NULL;
+		Expr *valuesExpr = NULL;
+
+		if (insertTargetEntry->resjunk)
+		{
+			continue;
+		}
+
+		/* the VALUES RTE is the only range table entry of the new query */
+		valuesExpr = copyObject(insertTargetEntry->expr);
+		ChangeVarNodes((Node *) valuesExpr, valuesRangeTableIndex, 1, 0);
+
+		valuesTargetEntry = makeTargetEntry(valuesExpr, resultNumber,
+											insertTargetEntry->resname, false);
+		valuesQuery->targetList = lappend(valuesQuery->targetList, valuesTargetEntry);
+
+		resultNumber++;
+	}
+
+	return valuesQuery;
+}
+
+
 /*
  * CoordinatorInsertSelectSupported returns an error if executing an
  * INSERT ... SELECT command by pulling results of the SELECT to the coordinator
@@ -19,10 +19,12 @@
 #include "access/htup_details.h"
 #include "catalog/pg_am.h"
 #include "distributed/listutils.h"
+#include "distributed/master_metadata_utility.h"
 #include "distributed/metadata_cache.h"
 #include "distributed/multi_join_order.h"
 #include "distributed/multi_physical_planner.h"
 #include "distributed/pg_dist_partition.h"
+#include "distributed/worker_manager.h"
 #include "distributed/worker_protocol.h"
 #include "lib/stringinfo.h"
 #if PG_VERSION_NUM >= 120000
@@ -42,6 +44,7 @@
 /* Config variables managed via guc.c */
 bool LogMultiJoinOrder = false; /* print join order as a debugging aid */
 bool EnableSingleHashRepartitioning = false;
+bool EnableCostBasedJoinOrder = false;
 
 /* Function pointer type definition for join rule evaluation functions */
 typedef JoinOrderNode *(*RuleEvalFunction) (JoinOrderNode *currentJoinNode,
@@ -59,6 +62,10 @@ static bool ExtractLeftMostRangeTableIndex(Node *node, int *rangeTableIndex);
 static List * JoinOrderForTable(TableEntry *firstTable, List *tableEntryList,
 								List *joinClauseList);
 static List * BestJoinOrder(List *candidateJoinOrders);
+static List * CheapestJoinOrder(List *candidateJoinOrders, double *bestJoinOrderCost);
+static double * JoinOrderTableSizeArray(List *joinOrder);
+static double JoinOrderCost(List *joinOrder, double *tableSizeArray,
+						   uint32 workerNodeCount);
 static List * FewestOfJoinRuleType(List *candidateJoinOrders, JoinRuleType ruleType);
 static uint32 JoinRuleTypeCount(List *joinOrder, JoinRuleType ruleTypeToCount);
 static List * LatestLargeDataTransfer(List *candidateJoinOrders);
@@ -289,7 +296,22 @@ JoinOrderList(List *tableEntryList, List *joinClauseList)
 							   "equal operator")));
 	}
 
-	bestJoinOrder = BestJoinOrder(candidateJoinOrderList);
+	if (EnableCostBasedJoinOrder)
+	{
+		double bestJoinOrderCost = 0.0;
+
+		bestJoinOrder = CheapestJoinOrder(candidateJoinOrderList, &bestJoinOrderCost);
+
+		if (LogMultiJoinOrder)
+		{
+			ereport(LOG, (errmsg("join order cost estimate: %.0f bytes",
+								 bestJoinOrderCost)));
+		}
+	}
+	else
+	{
+		bestJoinOrder = BestJoinOrder(candidateJoinOrderList);
+	}
 
 	/* if logging is enabled, print join order */
 	if (LogMultiJoinOrder)
@@ -457,6 +479,152 @@ BestJoinOrder(List *candidateJoinOrders)
 }
 
 
+/*
+ * CheapestJoinOrder takes in a list of candidate join orders, and picks the join
+ * order that is estimated to move the fewest bytes across the network. If more
+ * than one join order has the lowest cost, the function falls back to the rule
+ * based heuristics in BestJoinOrder to break the tie. The estimated cost of the
+ * chosen join order is returned through bestJoinOrderCost.
+ */
+static List *
+CheapestJoinOrder(List *candidateJoinOrders, double *bestJoinOrderCost)
+{
+	List *cheapestJoinOrders = NIL;
+	double cheapestCost = 0.0;
+	ListCell *joinOrderCell = NULL;
+	uint32 workerNodeCount = Max(ActiveReadableWorkerNodeCount(), 1);
+
+	/* all candidate join orders contain the same tables, so size them only once */
+	double *tableSizeArray =
+		JoinOrderTableSizeArray((List *) linitial(candidateJoinOrders));
+
+	foreach(joinOrderCell, candidateJoinOrders)
+	{
+		List *joinOrder = (List *) lfirst(joinOrderCell);
+		double joinOrderCost = JoinOrderCost(joinOrder, tableSizeArray,
+											 workerNodeCount);
+
+		if (cheapestJoinOrders == NIL || joinOrderCost < cheapestCost)
+		{
+			cheapestJoinOrders = list_make1(joinOrder);
+			cheapestCost = joinOrderCost;
+		}
+		else if (joinOrderCost == cheapestCost)
+		{
+			cheapestJoinOrders = lappend(cheapestJoinOrders, joinOrder);
+		}
+	}
+
+	*bestJoinOrderCost = cheapestCost;
+
+	return BestJoinOrder(cheapestJoinOrders);
+}
+
+
+/*
+ * JoinOrderTableSizeArray returns an array, indexed by range table id, with the
+ * estimated sizes of the tables in the given join order.
+ */
+static double *
+JoinOrderTableSizeArray(List *joinOrder)
+{
+	double *tableSizeArray = NULL;
+	uint32 maxRangeTableId = 0;
+	ListCell *joinOrderNodeCell = NULL;
+
+	foreach(joinOrderNodeCell, joinOrder)
+	{
+		JoinOrderNode *joinOrderNode = (JoinOrderNode *) lfirst(joinOrderNodeCell);
+
+		maxRangeTableId = Max(maxRangeTableId, joinOrderNode->tableEntry->rangeTableId);
+	}
+
+	tableSizeArray = palloc0((maxRangeTableId + 1) * sizeof(double));
+
+	foreach(joinOrderNodeCell, joinOrder)
+	{
+		JoinOrderNode *joinOrderNode = (JoinOrderNode *) lfirst(joinOrderNodeCell);
+		TableEntry *tableEntry = joinOrderNode->tableEntry;
+
+		tableSizeArray[tableEntry->rangeTableId] =
+			(double) TableSizeEstimate(tableEntry->relationId);
+	}
+
+	return tableSizeArray;
+}
+
+
+/*
+ * JoinOrderCost estimates the number of bytes the given join order transfers
+ * across the network. Reference and co-located joins do not move any data. A
+ * single partition join repartitions the side that is not partitioned on the
+ * join column, a dual partition join repartitions both sides, and a cartesian
+ * product broadcasts the joined table to all worker nodes.
+ *
+ * We do not have join selectivities at this stage, so we take the size of an
+ * intermediate join result to be the size of its largest input. This tends to
+ * hold for joins on keys, which are the common case for distributed tables.
+ * The table sizes are looked up in the given array, indexed by range table id.
+ */
+static double
+JoinOrderCost(List *joinOrder, double *tableSizeArray, uint32 workerNodeCount)
+{
+	double joinOrderCost = 0.0;
+	double joinedRelationSize = 0.0;
+	ListCell *joinOrderNodeCell = NULL;
+
+	foreach(joinOrderNodeCell, joinOrder)
+	{
+		JoinOrderNode *joinOrderNode = (JoinOrderNode *) lfirst(joinOrderNodeCell);
+		TableEntry *tableEntry = joinOrderNode->tableEntry;
+		TableEntry *anchorTable = joinOrderNode->anchorTable;
+		double relationSize = tableSizeArray[tableEntry->rangeTableId];
+
+		switch (joinOrderNode->joinRuleType)
+		{
+			case SINGLE_HASH_PARTITION_JOIN:
+			case SINGLE_RANGE_PARTITION_JOIN:
+			{
+				/* the candidate table is the anchor when the joined tables move */
+				if (anchorTable != NULL &&
+					anchorTable->rangeTableId == tableEntry->rangeTableId)
+				{
+					joinOrderCost += joinedRelationSize;
+				}
+				else
+				{
+					joinOrderCost += relationSize;
+				}
+
+				break;
+			}
+
+			case DUAL_PARTITION_JOIN:
+			{
+				joinOrderCost += joinedRelationSize + relationSize;
+				break;
+			}
+
+			case CARTESIAN_PRODUCT:
+			{
+				joinOrderCost += relationSize * workerNodeCount;
+				break;
+			}
+
+			default:
+			{
+				/* first table, reference and local joins do not move data */
+				break;
+			}
+		}
+
+		joinedRelationSize = Max(joinedRelationSize, relationSize);
+	}
+
+	return joinOrderCost;
+}
+
+
 /*
  * FewestOfJoinRuleType finds join orders that have the fewest number of times
  * the given join rule occurs in the candidate join orders, and filters all
@@ -59,6 +59,7 @@
 /* Config variable managed via guc.c */
 int LimitClauseRowFetchCount = -1; /* number of rows to fetch from each task */
 double CountDistinctErrorRate = 0.0; /* precision of count(distinct) approximate */
+bool EnableCoordinatorDistinctAggregates = false;
 
 
 typedef struct MasterAggregateWalkerContext
@@ -222,6 +223,8 @@ static void ProcessDistinctClauseForWorkerQuery(List *distinctClause, bool hasDi
 												bool *distinctPreventsLimitPushdown);
 static void ProcessWindowFunctionsForWorkerQuery(List *windowClauseList,
 												 List *originalTargetEntryList,
+												 ExtendedOpNodeProperties *
+												 extendedOpNodeProperties,
 												 QueryWindowClause *queryWindowClause,
 												 QueryTargetList *queryTargetList);
 static void ProcessLimitOrderByForWorkerQuery(OrderByLimitReference orderByLimitReference,
@@ -271,6 +274,10 @@ static void ErrorIfContainsUnsupportedAggregate(MultiNode *logicalPlanNode);
 static void ErrorIfUnsupportedArrayAggregate(Aggref *arrayAggregateExpression);
 static void ErrorIfUnsupportedJsonAggregate(AggregateType type,
 											Aggref *aggregateExpression);
+static bool ShouldPullDistinctAggregateColumns(Aggref *aggregate,
+											   AggregateType aggregateType,
+											   bool pullDistinctColumns);
+static bool CoordinatorDistinctAggregateSupported(AggregateType aggregateType);
 static void ErrorIfUnsupportedAggregateDistinct(Aggref *aggregateExpression,
 												MultiNode *logicalPlanNode);
 static Var * AggregateDistinctColumn(Aggref *aggregateExpression);
@@ -1392,12 +1399,18 @@ MasterExtendedOpNode(MultiExtendedOp *originalOpNode,
 
 		bool hasAggregates = contain_agg_clause((Node *) originalExpression);
 		bool hasWindowFunction = contain_window_function((Node *) originalExpression);
+		bool pullUpWindowFunction = hasWindowFunction &&
+									extendedOpNodeProperties->pullUpWindowFunctions;
 
 		/*
 		 * if the aggregate belongs to a window function, it is not mutated, but pushed
 		 * down to worker as it is. Master query should treat that as a Var.
+		 *
+		 * Window functions that are evaluated on the master are mutated the same
+		 * way as aggregates, such that their columns reference the columns that
+		 * the worker query returns for them.
 		 */
-		if (hasAggregates && !hasWindowFunction)
+		if ((hasAggregates && !hasWindowFunction) || pullUpWindowFunction)
 		{
 			Node *newNode = MasterAggregateMutator((Node *) originalExpression,
 												   walkerContext);
@@ -1443,6 +1456,12 @@ MasterExtendedOpNode(MultiExtendedOp *originalOpNode,
 	masterExtendedOpNode->limitOffset = originalOpNode->limitOffset;
 	masterExtendedOpNode->havingQual = newHavingQual;
 
+	if (extendedOpNodeProperties->pullUpWindowFunctions)
+	{
+		masterExtendedOpNode->hasWindowFuncs = true;
+		masterExtendedOpNode->windowClause = originalOpNode->windowClause;
+	}
+
 	return masterExtendedOpNode;
 }
 
@@ -1516,9 +1535,8 @@ MasterAggregateExpression(Aggref *originalAggregate,
 	const AttrNumber argumentId = 1; /* our aggregates have single arguments */
 	AggClauseCosts aggregateCosts;
 
-	if (aggregateType == AGGREGATE_COUNT && originalAggregate->aggdistinct &&
-		CountDistinctErrorRate == DISABLE_DISTINCT_APPROXIMATION &&
-		walkerContext->pullDistinctColumns)
+	if (ShouldPullDistinctAggregateColumns(originalAggregate, aggregateType,
+										   walkerContext->pullDistinctColumns))
 	{
 		Aggref *aggregate = (Aggref *) copyObject(originalAggregate);
 		List *varList = pull_var_clause_default((Node *) aggregate);
@@ -2150,12 +2168,20 @@ WorkerExtendedOpNode(MultiExtendedOp *originalOpNode,
 									  &queryHavingQual, &queryTargetList,
 									  &queryGroupClause);
 
-	ProcessDistinctClauseForWorkerQuery(originalDistinctClause, hasDistinctOn,
-										queryGroupClause.groupClauseList,
-										queryHasAggregates, &queryDistinctClause,
-										&distinctPreventsLimitPushdown);
+	/*
+	 * Window functions that are evaluated on the coordinator need to see all
+	 * the rows, so we neither push down DISTINCT nor LIMIT in that case.
+	 */
+	if (!extendedOpNodeProperties->pullUpWindowFunctions)
+	{
+		ProcessDistinctClauseForWorkerQuery(originalDistinctClause, hasDistinctOn,
+											queryGroupClause.groupClauseList,
+											queryHasAggregates, &queryDistinctClause,
+											&distinctPreventsLimitPushdown);
+	}
 
 	ProcessWindowFunctionsForWorkerQuery(originalWindowClause, originalTargetEntryList,
+										 extendedOpNodeProperties,
 										 &queryWindowClause, &queryTargetList);
 
 	/*
@@ -2169,7 +2195,8 @@ WorkerExtendedOpNode(MultiExtendedOp *originalOpNode,
 	 */
 	groupByExtended =
 		list_length(queryGroupClause.groupClauseList) > originalGroupClauseLength;
-	if (!groupByExtended && !distinctPreventsLimitPushdown)
+	if (!groupByExtended && !distinctPreventsLimitPushdown &&
+		!extendedOpNodeProperties->pullUpWindowFunctions)
 	{
 		/* both sort and limit clauses rely on similar information */
 		OrderByLimitReference limitOrderByReference =
@@ -2215,10 +2242,10 @@ WorkerExtendedOpNode(MultiExtendedOp *originalOpNode,
  * the worker with two expressions count() and sum(). Thus, a single target entry
  * might end up with multiple expressions in the worker query.
  *
- * The function doesn't change the aggragates in the window functions and sends them
- * as-is. The reason is that Citus currently only supports pushing down window
- * functions as-is. As we implement pull-to-master window functions, we should
- * revisit here as well.
+ * The function doesn't change the aggragates in the window functions that are
+ * pushed down and sends them as-is. For window functions that are evaluated on
+ * the coordinator, only the columns that the window function refers to are
+ * added to the worker target list.
  *
  * The function also handles count distinct operator if it is used in repartition
  * subqueries or on non-partition columns (e.g., cannot be pushed down). Each
@@ -2250,6 +2277,8 @@ ProcessTargetListForWorkerQuery(List *targetEntryList,
 		List *newExpressionList = NIL;
 		bool hasAggregates = contain_agg_clause((Node *) originalExpression);
 		bool hasWindowFunction = contain_window_function((Node *) originalExpression);
+		bool pullUpWindowFunction = hasWindowFunction &&
+									extendedOpNodeProperties->pullUpWindowFunctions;
 
 		/* reset walker context */
 		workerAggContext->expressionList = NIL;
@@ -2259,8 +2288,11 @@ ProcessTargetListForWorkerQuery(List *targetEntryList,
 		 * If the expression uses aggregates inside window function contain agg
 		 * clause still returns true. We want to make sure it is not a part of
 		 * window function before we proceed.
+		 *
+		 * Window functions that are evaluated on the coordinator do not contain
+		 * aggregates, so the walker only collects the columns that they refer to.
 		 */
-		if (hasAggregates && !hasWindowFunction)
+		if ((hasAggregates && !hasWindowFunction) || pullUpWindowFunction)
 		{
 			WorkerAggregateWalker((Node *) originalExpression, workerAggContext);
 
@@ -2434,10 +2466,10 @@ ProcessDistinctClauseForWorkerQuery(List *distinctClause, bool hasDistinctOn,
  * that worker query's workerWindowClauseList is set when the window clauses are safe to
  * pushdown.
  *
- * TODO: Citus only supports pushing down window clauses as-is under certain circumstances.
- * And, at this point in the planning, we are guaraanted to process a window function
- * which is safe to pushdown as-is. It should also be possible to pull the relevant data
- * to the coordinator and apply the window clauses for the remaining cases.
+ * Window clauses that are not safe to pushdown are evaluated on the coordinator
+ * instead. In that case ProcessTargetListForWorkerQuery() has already added the
+ * columns that the window functions and their PARTITION BY and ORDER BY clauses
+ * refer to, and the worker query doesn't get a window clause.
  *
  * Note that even though Citus only pushes down the window functions, it may need to
  * modify the target list of the worker query when the window function refers to
@@ -2446,19 +2478,20 @@ ProcessDistinctClauseForWorkerQuery(List *distinctClause, bool hasDistinctOn,
  * to the worker target list to make sure that the window function refers to the
  * non-mutated aggragate.
  *
- *     inputs: windowClauseList, originalTargetEntryList
+ *     inputs: windowClauseList, originalTargetEntryList, extendedOpNodeProperties
  *     outputs: queryWindowClause, queryTargetList
  *
  */
 static void
 ProcessWindowFunctionsForWorkerQuery(List *windowClauseList,
 									 List *originalTargetEntryList,
+									 ExtendedOpNodeProperties *extendedOpNodeProperties,
 									 QueryWindowClause *queryWindowClause,
 									 QueryTargetList *queryTargetList)
 {
 	ListCell *windowClauseCell = NULL;
 
-	if (windowClauseList == NIL)
+	if (windowClauseList == NIL || extendedOpNodeProperties->pullUpWindowFunctions)
 	{
 		queryWindowClause->hasWindowFunctions = false;
 
@@ -2827,9 +2860,8 @@ WorkerAggregateExpressionList(Aggref *originalAggregate,
 	List *workerAggregateList = NIL;
 	AggClauseCosts aggregateCosts;
 
-	if (aggregateType == AGGREGATE_COUNT && originalAggregate->aggdistinct &&
-		CountDistinctErrorRate == DISABLE_DISTINCT_APPROXIMATION &&
-		walkerContext->pullDistinctColumns)
+	if (ShouldPullDistinctAggregateColumns(originalAggregate, aggregateType,
+										   walkerContext->pullDistinctColumns))
 	{
 		Aggref *aggregate = (Aggref *) copyObject(originalAggregate);
 		List *columnList = pull_var_clause_default((Node *) aggregate);
@@ -3612,7 +3644,8 @@ ErrorIfUnsupportedAggregateDistinct(Aggref *aggregateExpression,
 			distinctSupported = TablePartitioningSupportsDistinct(tableNodeList,
 																  extendedOpNode,
 																  distinctColumn,
-																  aggregateType);
+																  aggregateType) ||
+								CoordinatorDistinctAggregateSupported(aggregateType);
 			if (!distinctSupported)
 			{
 				errorDetail = "aggregate (distinct) on complex expressions is"
@@ -3624,7 +3657,8 @@ ErrorIfUnsupportedAggregateDistinct(Aggref *aggregateExpression,
 			bool supports = TablePartitioningSupportsDistinct(tableNodeList,
 															  extendedOpNode,
 															  distinctColumn,
-															  aggregateType);
+															  aggregateType) ||
+							CoordinatorDistinctAggregateSupported(aggregateType);
 			if (!supports)
 			{
 				distinctSupported = false;
@@ -3654,6 +3688,68 @@ ErrorIfUnsupportedAggregateDistinct(Aggref *aggregateExpression,
 }
 
 
+/*
+ * ShouldPullDistinctAggregateColumns returns true if the columns of the given
+ * aggregate (distinct) should be pulled to the coordinator, where the aggregate
+ * is evaluated on its own. In that case, the worker queries group by these
+ * columns, such that each task sends every distinct value only once.
+ */
+static bool
+ShouldPullDistinctAggregateColumns(Aggref *aggregate, AggregateType aggregateType,
+								   bool pullDistinctColumns)
+{
+	if (!aggregate->aggdistinct || !pullDistinctColumns)
+	{
+		return false;
+	}
+
+	/* count(distinct) may be approximated with hll instead */
+	if (aggregateType == AGGREGATE_COUNT)
+	{
+		return CountDistinctErrorRate == DISABLE_DISTINCT_APPROXIMATION;
+	}
+
+	return CoordinatorDistinctAggregateSupported(aggregateType);
+}
+
+
+/*
+ * CoordinatorDistinctAggregateSupported returns true if the given aggregate type
+ * with a distinct clause can be evaluated on the coordinator over the distinct
+ * values that the workers send, which is what we already do for count(distinct)
+ * on non-partition columns.
+ */
+static bool
+CoordinatorDistinctAggregateSupported(AggregateType aggregateType)
+{
+	if (!EnableCoordinatorDistinctAggregates)
+	{
+		return false;
+	}
+
+	switch (aggregateType)
+	{
+		case AGGREGATE_AVERAGE:
+		case AGGREGATE_MIN:
+		case AGGREGATE_MAX:
+		case AGGREGATE_SUM:
+		case AGGREGATE_BIT_AND:
+		case AGGREGATE_BIT_OR:
+		case AGGREGATE_BOOL_AND:
+		case AGGREGATE_BOOL_OR:
+		case AGGREGATE_EVERY:
+		{
+			return true;
+		}
+
+		default:
+		{
+			return false;
+		}
+	}
+}
+
+
 /*
  * AggregateDistinctColumn checks if the given aggregate expression's distinct
  * clause is on a single column. If it is, the function finds and returns that
@@ -54,6 +54,10 @@
 #include "utils/relcache.h"
 
 
+/* Config variable managed via guc.c */
+bool EnableCoordinatorWindowFunctions = false;
+
+
 /* Struct to differentiate different qualifier types in an expression tree walker */
 typedef struct QualifierWalkerContext
 {
@@ -773,10 +777,47 @@ MultiNodeTree(Query *queryTree)
 	SetChild((MultiUnaryNode *) extendedOpNode, currentTopNode);
 	currentTopNode = (MultiNode *) extendedOpNode;
 
+	/*
+	 * Window functions that are safe to push down are planned by the subquery
+	 * pushdown planner. Any window function that reaches here is evaluated on
+	 * the coordinator on top of the rows pulled from the workers.
+	 */
+	extendedOpNode->onlyPushableWindowFunctions = !queryTree->hasWindowFuncs;
+
 	return currentTopNode;
 }
 
 
+/*
+ * SafeToPullUpWindowFunction returns true if the window functions in the given
+ * query can be evaluated on the coordinator. In that case the workers only
+ * return the columns that the window functions refer to, and the coordinator
+ * sorts the rows on the window's PARTITION BY and ORDER BY clauses before
+ * computing the window functions.
+ *
+ * Since this pulls every matching row to the coordinator, it is only done when
+ * citus.enable_coordinator_window_functions is set. We also do not combine
+ * coordinator window functions with aggregates, since the window functions
+ * would then have to be evaluated on top of the coordinator's aggregation plan.
+ */
+bool
+SafeToPullUpWindowFunction(Query *query)
+{
+	if (!EnableCoordinatorWindowFunctions)
+	{
+		return false;
+	}
+
+	if (query->hasAggs || query->groupClause != NIL || query->havingQual != NULL ||
+		query->groupingSets != NIL)
+	{
+		return false;
+	}
+
+	return true;
+}
+
+
 /*
  * ContainsReadIntermediateResultFunction determines whether an expresion tree contains
  * a call to the read_intermediate_result function.
@@ -874,7 +915,8 @@ DeferErrorIfQueryNotSupported(Query *queryTree)
 	}
 
 	if (queryTree->hasWindowFuncs &&
-		!SafeToPushdownWindowFunction(queryTree, &errorInfo))
+		!SafeToPushdownWindowFunction(queryTree, &errorInfo) &&
+		!SafeToPullUpWindowFunction(queryTree))
 	{
 		preconditionsSatisfied = false;
 		errorMessage = "could not run distributed query because the window "
@@ -50,12 +50,16 @@ static List * MasterTargetList(List *workerTargetList);
 static PlannedStmt * BuildSelectStatement(Query *masterQuery, List *masterTargetList,
 										  CustomScan *remoteScan);
 static Agg * BuildAggregatePlan(PlannerInfo *root, Query *masterQuery, Plan *subPlan);
+static Plan * BuildWindowPlan(Query *masterQuery, Plan *subPlan);
+static List * WindowAggTargetList(List *subPlanTargetList, List *windowFunctionList);
 static bool HasDistinctAggregate(Query *masterQuery);
 static bool UseGroupAggregateWithHLL(Query *masterQuery);
 static bool QueryContainsAggregateWithHLL(Query *query);
 static Plan * BuildDistinctPlan(Query *masterQuery, Plan *subPlan);
 static Agg * makeAggNode(List *groupClauseList, List *havingQual,
 						 AggStrategy aggrStrategy, List *queryTargetList, Plan *subPlan);
+static WindowAgg * makeWindowAggNode(WindowClause *windowClause, List *targetList,
+									 Plan *subPlan);
 static void FinalizeStatement(PlannerInfo *root, PlannedStmt *stmt, Plan *topLevelPlan);
 
 
@@ -177,6 +181,16 @@ BuildSelectStatement(Query *masterQuery, List *masterTargetList, CustomScan *rem
 		topLevelPlan = (Plan *) aggregationPlan;
 		selectStatement->planTree = topLevelPlan;
 	}
+	else if (masterQuery->hasWindowFuncs)
+	{
+		/*
+		 * Window functions that could not be pushed down are evaluated on top
+		 * of the columns fetched from the workers.
+		 */
+		remoteScan->scan.plan.targetlist = masterTargetList;
+
+		topLevelPlan = BuildWindowPlan(masterQuery, &remoteScan->scan.plan);
+	}
 	else
 	{
 		/* otherwise set the final projections on the scan plan directly */
@@ -462,6 +476,124 @@ BuildAggregatePlan(PlannerInfo *root, Query *masterQuery, Plan *subPlan)
 }
 
 
+/*
+ * BuildWindowPlan creates the window aggregation plan for window functions that
+ * are evaluated on the master node. For each window clause, we sort the tuples
+ * on the clause's PARTITION BY and ORDER BY entries and put a WindowAgg node on
+ * top of the sort, which computes the window functions of that clause.
+ *
+ * Intermediate WindowAgg nodes pass through the columns of the remote scan along
+ * with the window functions computed so far, and the top level WindowAgg node
+ * projects the master query's target list.
+ */
+static Plan *
+BuildWindowPlan(Query *masterQuery, Plan *subPlan)
+{
+	Plan *windowPlan = subPlan;
+	List *windowClauseList = masterQuery->windowClause;
+	List *computedWindowFunctionList = NIL;
+	WindowClause *windowClause = NULL;
+	int windowClauseCount = list_length(windowClauseList);
+	int windowClauseIndex = 0;
+
+	/* collects the window functions along with the columns outside of them */
+	List *windowFunctionList = pull_var_clause((Node *) masterQuery->targetList,
+											   PVC_INCLUDE_WINDOWFUNCS);
+
+	Assert(windowClauseCount > 0);
+
+	foreach_ptr(windowClause, windowClauseList)
+	{
+		List *windowSortClauseList = list_concat(list_copy(windowClause->partitionClause),
+												 list_copy(windowClause->orderClause));
+		List *windowTargetList = NIL;
+		Node *windowFunctionNode = NULL;
+
+		windowClauseIndex++;
+
+		if (windowSortClauseList != NIL)
+		{
+			Sort *sortPlan = make_sort_from_sortclauses(windowSortClauseList, windowPlan);
+
+			/* just for reproducible costs between different PostgreSQL versions */
+			sortPlan->plan.startup_cost = 0;
+			sortPlan->plan.total_cost = 0;
+			sortPlan->plan.plan_rows = 0;
+
+			windowPlan = (Plan *) sortPlan;
+		}
+
+		/* collect the window functions that this window clause computes */
+		foreach_ptr(windowFunctionNode, windowFunctionList)
+		{
+			WindowFunc *windowFunction = NULL;
+
+			if (!IsA(windowFunctionNode, WindowFunc))
+			{
+				continue;
+			}
+
+			windowFunction = (WindowFunc *) windowFunctionNode;
+			if (windowFunction->winref == windowClause->winref)
+			{
+				computedWindowFunctionList =
+					list_append_unique(computedWindowFunctionList, windowFunction);
+			}
+		}
+
+		if (windowClauseIndex == windowClauseCount)
+		{
+			windowTargetList = masterQuery->targetList;
+		}
+		else
+		{
+			windowTargetList = WindowAggTargetList(subPlan->targetlist,
+												   computedWindowFunctionList);
+		}
+
+		windowPlan = (Plan *) makeWindowAggNode(windowClause, windowTargetList,
+												windowPlan);
+	}
+
+	return windowPlan;
+}
+
+
+/*
+ * WindowAggTargetList builds the target list of an intermediate WindowAgg
+ * node. The target list contains the columns of the remote scan such that the
+ * sort clauses of the upper window clauses can find their entries, followed by
+ * the window functions computed so far. The upper WindowAgg nodes then refer to
+ * these window functions instead of computing them again.
+ */
+static List *
+WindowAggTargetList(List *subPlanTargetList, List *windowFunctionList)
+{
+	List *windowTargetList = NIL;
+	TargetEntry *subPlanTargetEntry = NULL;
+	WindowFunc *windowFunction = NULL;
+	AttrNumber resultNumber = 1;
+
+	foreach_ptr(subPlanTargetEntry, subPlanTargetList)
+	{
+		TargetEntry *windowTargetEntry = flatCopyTargetEntry(subPlanTargetEntry);
+		windowTargetEntry->resno = resultNumber++;
+
+		windowTargetList = lappend(windowTargetList, windowTargetEntry);
+	}
+
+	foreach_ptr(windowFunction, windowFunctionList)
+	{
+		TargetEntry *windowTargetEntry = makeTargetEntry((Expr *) windowFunction,
+														 resultNumber++, NULL, true);
+
+		windowTargetList = lappend(windowTargetList, windowTargetEntry);
+	}
+
+	return windowTargetList;
+}
+
+
 /*
  * HasDistinctAggregate returns true if the query has a distinct
  * aggregate in its target list or in having clause.
@@ -653,3 +785,59 @@ makeAggNode(List *groupClauseList, List *havingQual, AggStrategy aggrStrategy,
 
 	return aggNode;
 }
+
+
+/*
+ * makeWindowAggNode creates a "WindowAgg" plan node for the given window clause.
+ * The subPlan is expected to be sorted on the partition and order clauses of the
+ * window clause. This follows create_windowagg_plan() in createplan.c.
+ */
+static WindowAgg *
+makeWindowAggNode(WindowClause *windowClause, List *targetList, Plan *subPlan)
+{
+	WindowAgg *windowAggNode = makeNode(WindowAgg);
+	Plan *plan = &windowAggNode->plan;
+	List *partitionClauseList = windowClause->partitionClause;
+	List *orderClauseList = windowClause->orderClause;
+	List *subPlanTargetList = subPlan->targetlist;
+
+	windowAggNode->winref = windowClause->winref;
+
+	windowAggNode->partNumCols = list_length(partitionClauseList);
+	windowAggNode->partColIdx = extract_grouping_cols(partitionClauseList,
+													  subPlanTargetList);
+	windowAggNode->partOperators = extract_grouping_ops(partitionClauseList);
+
+	windowAggNode->ordNumCols = list_length(orderClauseList);
+	windowAggNode->ordColIdx = extract_grouping_cols(orderClauseList,
+													 subPlanTargetList);
+	windowAggNode->ordOperators = extract_grouping_ops(orderClauseList);
+
+#if (PG_VERSION_NUM >= 120000)
+	windowAggNode->partCollations = extract_grouping_collations(partitionClauseList,
+																subPlanTargetList);
+	windowAggNode->ordCollations = extract_grouping_collations(orderClauseList,
+															   subPlanTargetList);
+#endif
+
+	windowAggNode->frameOptions = windowClause->frameOptions;
+	windowAggNode->startOffset = windowClause->startOffset;
+	windowAggNode->endOffset = windowClause->endOffset;
+	windowAggNode->startInRangeFunc = windowClause->startInRangeFunc;
+	windowAggNode->endInRangeFunc = windowClause->endInRangeFunc;
+	windowAggNode->inRangeColl = windowClause->inRangeColl;
+	windowAggNode->inRangeAsc = windowClause->inRangeAsc;
+	windowAggNode->inRangeNullsFirst = windowClause->inRangeNullsFirst;
+
+	plan->targetlist = targetList;
+	plan->qual = NIL;
+	plan->lefttree = subPlan;
+	plan->righttree = NULL;
+
+	/* just for reproducible costs between different PostgreSQL versions */
+	plan->startup_cost = 0;
+	plan->total_cost = 0;
+	plan->plan_rows = 0;
+
+	return windowAggNode;
+}
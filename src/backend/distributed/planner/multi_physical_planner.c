@@ -89,6 +89,29 @@ bool EnableUniqueJobIds = true;
 static List *OperatorCache = NIL;
 
 
+/*
+ * ShardArrayRestriction describes a top-level partcol = ANY(const array)
+ * restriction on a hash-distributed table, with the array elements split by
+ * the shard they hash to. It is used to send each task only the elements
+ * that can match rows in its shard.
+ */
+typedef struct ShardArrayRestriction
+{
+	/* position of the restriction among the ANDed quals of the query */
+	int clauseIndex;
+
+	/* range table entry of the restricted partition column */
+	Index rangeTableId;
+
+	/*
+	 * Array constant with the elements of each shard, indexed by shard index.
+	 * NULL if all elements of the original array belong to that shard.
+	 */
+	int shardCount;
+	Const **shardArrayConsts;
+} ShardArrayRestriction;
+
+
 /* Local functions forward declarations for job creation */
 static Job * BuildJobTree(MultiTreeRoot *multiTree);
 static MultiNode * LeftMostNode(MultiTreeRoot *multiTree);
@@ -140,9 +163,17 @@ static Job * BuildJobTreeTaskList(Job *jobTree,
 static void ErrorIfUnsupportedShardDistribution(Query *query);
 static Task * QueryPushdownTaskCreate(Query *originalQuery, int shardIndex,
 									  RelationRestrictionContext *restrictionContext,
+									  List *shardArrayRestrictionList,
 									  uint32 taskId,
 									  TaskType taskType,
 									  bool modifyRequiresMasterEvaluation);
+static List * ShardArrayRestrictionList(Query *query);
+static ShardArrayRestriction * BuildShardArrayRestriction(Node *clause,
+														  List *rangeTableList);
+static void ApplyShardArrayRestrictions(Query *taskQuery,
+										List *shardArrayRestrictionList,
+										List *fragmentList, int shardIndex);
+static List * QualConjunctList(Node *quals);
 static bool ShardIntervalsEqual(FmgrInfo *comparisonFunction,
 								ShardInterval *firstInterval,
 								ShardInterval *secondInterval);
@@ -597,6 +628,8 @@ BuildJobQuery(MultiNode *multiNode, List *dependedJobList)
 	bool hasDistinctOn = false;
 	List *distinctClause = NIL;
 	bool isRepartitionJoin = false;
+	bool hasWindowFuncs = false;
+	List *windowClause = NIL;
 
 	/* we start building jobs from below the collect node */
 	Assert(!CitusIsA(multiNode, MultiCollect));
@@ -672,6 +705,8 @@ BuildJobQuery(MultiNode *multiNode, List *dependedJobList)
 		limitOffset = extendedOp->limitOffset;
 		sortClauseList = extendedOp->sortClauseList;
 		havingQual = extendedOp->havingQual;
+		hasWindowFuncs = extendedOp->hasWindowFuncs;
+		windowClause = extendedOp->windowClause;
 	}
 
 	/* build group clauses */
@@ -731,6 +766,8 @@ BuildJobQuery(MultiNode *multiNode, List *dependedJobList)
 	jobQuery->hasAggs = contain_agg_clause((Node *) targetList);
 	jobQuery->distinctClause = distinctClause;
 	jobQuery->hasDistinctOn = hasDistinctOn;
+	jobQuery->hasWindowFuncs = hasWindowFuncs;
+	jobQuery->windowClause = windowClause;
 
 	return jobQuery;
 }
@@ -2172,6 +2209,7 @@ QueryPushdownSqlTaskList(Query *query, uint64 jobId,
 	int maxShardOffset = 0;
 	bool *taskRequiredForShardIndex = NULL;
 	ListCell *prunedRelationShardCell = NULL;
+	List *shardArrayRestrictionList = NIL;
 
 	/* error if shards are not co-partitioned */
 	ErrorIfUnsupportedShardDistribution(query);
@@ -2238,6 +2276,9 @@ QueryPushdownSqlTaskList(Query *query, uint64 jobId,
 		}
 	}
 
+	/* split IN lists on distribution columns once, rather than for every task */
+	shardArrayRestrictionList = ShardArrayRestrictionList(query);
+
 	/*
 	 * To avoid iterating through all shards indexes we keep the minimum and maximum
 	 * offsets of shards that were not pruned away. This optimisation is primarily
@@ -2260,7 +2301,8 @@ QueryPushdownSqlTaskList(Query *query, uint64 jobId,
 		}
 
 		subqueryTask = QueryPushdownTaskCreate(query, shardOffset,
-											   relationRestrictionContext, taskIdIndex,
+											   relationRestrictionContext,
+											   shardArrayRestrictionList, taskIdIndex,
 											   taskType, modifyRequiresMasterEvaluation);
 		subqueryTask->jobId = jobId;
 		sqlTaskList = lappend(sqlTaskList, subqueryTask);
@@ -2284,6 +2326,311 @@ QueryPushdownSqlTaskList(Query *query, uint64 jobId,
 }
 
 
+/*
+ * ShardArrayRestrictionList returns a ShardArrayRestriction for each ANDed
+ * partcol = ANY(const array) restriction in the WHERE clause of the query
+ * that applies to a hash-distributed table.
+ *
+ * Since such a restriction can only be true for rows whose distribution
+ * column hashes to one of the array elements, the elements that belong to
+ * other shards can be left out of the query that is sent for a shard.
+ * Restrictions below the top-level AND are not considered, as removing
+ * elements there could change the result of the surrounding expression.
+ */
+static List *
+ShardArrayRestrictionList(Query *query)
+{
+	List *shardArrayRestrictionList = NIL;
+	List *conjunctList = NIL;
+	ListCell *conjunctCell = NULL;
+	int clauseIndex = 0;
+
+	if (query->jointree == NULL)
+	{
+		return NIL;
+	}
+
+	conjunctList = QualConjunctList(query->jointree->quals);
+	foreach(conjunctCell, conjunctList)
+	{
+		Node *clause = (Node *) lfirst(conjunctCell);
+		ShardArrayRestriction *shardArrayRestriction =
+			BuildShardArrayRestriction(clause, query->rtable);
+
+		if (shardArrayRestriction != NULL)
+		{
+			shardArrayRestriction->clauseIndex = clauseIndex;
+			shardArrayRestrictionList = lappend(shardArrayRestrictionList,
+												shardArrayRestriction);
+		}
+
+		clauseIndex++;
+	}
+
+	return shardArrayRestrictionList;
+}
+
+
+/*
+ * BuildShardArrayRestriction splits the array of the given clause by shard if
+ * it is of the form partcol = ANY(const array) on a hash-distributed table.
+ * Otherwise, or if there is nothing to gain from splitting the array, it
+ * returns NULL.
+ */
+static ShardArrayRestriction *
+BuildShardArrayRestriction(Node *clause, List *rangeTableList)
+{
+	ScalarArrayOpExpr *arrayOperatorExpression = NULL;
+	ShardArrayRestriction *shardArrayRestriction = NULL;
+	Node *leftOperand = NULL;
+	Node *rightOperand = NULL;
+	Var *partitionColumn = NULL;
+	Const *arrayConst = NULL;
+	RangeTblEntry *rangeTableEntry = NULL;
+	DistTableCacheEntry *cacheEntry = NULL;
+	ArrayType *array = NULL;
+	Oid elementType = InvalidOid;
+	int16 typeLength = 0;
+	bool typeByValue = false;
+	char typeAlignment = '\0';
+	Datum *elementValues = NULL;
+	bool *elementNulls = NULL;
+	int elementCount = 0;
+	int elementIndex = 0;
+	int *elementShardIndexes = NULL;
+	int *shardElementCounts = NULL;
+	int shardCount = 0;
+	int shardIndex = 0;
+	bool splitsArray = false;
+
+	if (!IsA(clause, ScalarArrayOpExpr))
+	{
+		return NULL;
+	}
+
+	arrayOperatorExpression = (ScalarArrayOpExpr *) clause;
+	if (!arrayOperatorExpression->useOr ||
+		!OperatorImplementsEquality(arrayOperatorExpression->opno))
+	{
+		return NULL;
+	}
+
+	leftOperand = strip_implicit_coercions(linitial(arrayOperatorExpression->args));
+	rightOperand = (Node *) lsecond(arrayOperatorExpression->args);
+	if (!IsA(leftOperand, Var) || !IsA(rightOperand, Const))
+	{
+		return NULL;
+	}
+
+	partitionColumn = (Var *) leftOperand;
+	arrayConst = (Const *) rightOperand;
+	if (partitionColumn->varlevelsup != 0 || arrayConst->constisnull ||
+		partitionColumn->varno > list_length(rangeTableList))
+	{
+		return NULL;
+	}
+
+	/*
+	 * The range table entries of job queries are function RTEs that carry the
+	 * Citus RTE kind. Their columns already refer to the position of the entry
+	 * in the job's range table, which is also the range table id of the shard
+	 * fragments of the tasks.
+	 */
+	rangeTableEntry = rt_fetch(partitionColumn->varno, rangeTableList);
+	if (GetRangeTblKind(rangeTableEntry) != CITUS_RTE_RELATION ||
+		!IsDistributedTable(rangeTableEntry->relid))
+	{
+		return NULL;
+	}
+
+	cacheEntry = DistributedTableCacheEntry(rangeTableEntry->relid);
+	shardCount = cacheEntry->shardIntervalArrayLength;
+	if (cacheEntry->partitionMethod != DISTRIBUTE_BY_HASH ||
+		cacheEntry->hashFunction == NULL || shardCount <= 1 ||
+		partitionColumn->varattno != cacheEntry->partitionColumn->varattno)
+	{
+		return NULL;
+	}
+
+	array = DatumGetArrayTypeP(arrayConst->constvalue);
+	elementType = ARR_ELEMTYPE(array);
+	if (elementType != partitionColumn->vartype)
+	{
+		return NULL;
+	}
+
+	get_typlenbyvalalign(elementType, &typeLength, &typeByValue, &typeAlignment);
+	deconstruct_array(array, elementType, typeLength, typeByValue, typeAlignment,
+					  &elementValues, &elementNulls, &elementCount);
+
+	/* find the shard of each element, NULLs can never match */
+	elementShardIndexes = (int *) palloc(Max(elementCount, 1) * sizeof(int));
+	shardElementCounts = (int *) palloc0(shardCount * sizeof(int));
+
+	for (elementIndex = 0; elementIndex < elementCount; elementIndex++)
+	{
+		Datum hashedValue = 0;
+
+		elementShardIndexes[elementIndex] = INVALID_SHARD_INDEX;
+		if (elementNulls[elementIndex])
+		{
+			continue;
+		}
+
+		hashedValue = FunctionCall1Coll(cacheEntry->hashFunction,
+										cacheEntry->partitionColumn->varcollid,
+										elementValues[elementIndex]);
+		shardIndex = FindShardIntervalIndex(hashedValue, cacheEntry);
+		if (shardIndex != INVALID_SHARD_INDEX)
+		{
+			elementShardIndexes[elementIndex] = shardIndex;
+			shardElementCounts[shardIndex]++;
+		}
+	}
+
+	shardArrayRestriction = palloc0(sizeof(ShardArrayRestriction));
+	shardArrayRestriction->rangeTableId = partitionColumn->varno;
+	shardArrayRestriction->shardCount = shardCount;
+	shardArrayRestriction->shardArrayConsts = palloc0(shardCount * sizeof(Const *));
+
+	for (shardIndex = 0; shardIndex < shardCount; shardIndex++)
+	{
+		int shardElementCount = shardElementCounts[shardIndex];
+		Datum *shardElementValues = NULL;
+		int shardElementIndex = 0;
+		ArrayType *shardArray = NULL;
+
+		if (shardElementCount == elementCount)
+		{
+			/* all elements belong to this shard, keep the original array */
+			continue;
+		}
+
+		shardElementValues = (Datum *) palloc(Max(shardElementCount, 1) *
+											  sizeof(Datum));
+		for (elementIndex = 0; elementIndex < elementCount; elementIndex++)
+		{
+			if (elementShardIndexes[elementIndex] == shardIndex)
+			{
+				shardElementValues[shardElementIndex++] = elementValues[elementIndex];
+			}
+		}
+
+		shardArray = construct_array(shardElementValues, shardElementCount,
+									 elementType, typeLength, typeByValue,
+									 typeAlignment);
+
+		shardArrayRestriction->shardArrayConsts[shardIndex] =
+			makeConst(arrayConst->consttype, arrayConst->consttypmod,
+					  arrayConst->constcollid, arrayConst->constlen,
+					  PointerGetDatum(shardArray), false, arrayConst->constbyval);
+		splitsArray = true;
+	}
+
+	pfree(elementShardIndexes);
+	pfree(shardElementCounts);
+
+	if (!splitsArray)
+	{
+		return NULL;
+	}
+
+	return shardArrayRestriction;
+}
+
+
+/*
+ * ApplyShardArrayRestrictions replaces the arrays of the restrictions found
+ * by ShardArrayRestrictionList() in the task query with the elements of the
+ * shard that the task reads. The shard of a restricted relation is taken from
+ * fragmentList if given, and is shardIndex otherwise.
+ */
+static void
+ApplyShardArrayRestrictions(Query *taskQuery, List *shardArrayRestrictionList,
+							List *fragmentList, int shardIndex)
+{
+	List *conjunctList = NIL;
+	ListCell *restrictionCell = NULL;
+
+	if (shardArrayRestrictionList == NIL)
+	{
+		return;
+	}
+
+	conjunctList = QualConjunctList(taskQuery->jointree->quals);
+
+	foreach(restrictionCell, shardArrayRestrictionList)
+	{
+		ShardArrayRestriction *shardArrayRestriction =
+			(ShardArrayRestriction *) lfirst(restrictionCell);
+		int restrictionShardIndex = shardIndex;
+		ScalarArrayOpExpr *arrayOperatorExpression = NULL;
+		Const *shardArrayConst = NULL;
+
+		if (fragmentList != NIL)
+		{
+			ListCell *fragmentCell = NULL;
+
+			restrictionShardIndex = INVALID_SHARD_INDEX;
+			foreach(fragmentCell, fragmentList)
+			{
+				RangeTableFragment *fragment = (RangeTableFragment *) lfirst(fragmentCell);
+
+				if (fragment->rangeTableId == shardArrayRestriction->rangeTableId &&
+					fragment->fragmentType == CITUS_RTE_RELATION)
+				{
+					ShardInterval *shardInterval =
+						(ShardInterval *) fragment->fragmentReference;
+
+					restrictionShardIndex = shardInterval->shardIndex;
+					break;
+				}
+			}
+		}
+
+		if (restrictionShardIndex < 0 ||
+			restrictionShardIndex >= shardArrayRestriction->shardCount)
+		{
+			continue;
+		}
+
+		shardArrayConst = shardArrayRestriction->shardArrayConsts[restrictionShardIndex];
+		if (shardArrayConst == NULL)
+		{
+			continue;
+		}
+
+		arrayOperatorExpression = (ScalarArrayOpExpr *) list_nth(
+			conjunctList, shardArrayRestriction->clauseIndex);
+		Assert(IsA(arrayOperatorExpression, ScalarArrayOpExpr));
+
+		/* the task query is a copy, so the clause can be changed in place */
+		arrayOperatorExpression->args =
+			list_make2(linitial(arrayOperatorExpression->args), shardArrayConst);
+	}
+}
+
+
+/*
+ * QualConjunctList returns the list of ANDed clauses of the given quals, which
+ * may be an implicitly ANDed list or an expression.
+ */
+static List *
+QualConjunctList(Node *quals)
+{
+	if (quals == NULL)
+	{
+		return NIL;
+	}
+	else if (IsA(quals, List))
+	{
+		return (List *) quals;
+	}
+
+	return make_ands_implicit((Expr *) quals);
+}
+
+
 /*
  * ErrorIfUnsupportedShardDistribution gets list of relations in the given query
  * and checks if two conditions below hold for them, otherwise it errors out.
@@ -2399,7 +2746,8 @@ ErrorIfUnsupportedShardDistribution(Query *query)
  */
 static Task *
 QueryPushdownTaskCreate(Query *originalQuery, int shardIndex,
-						RelationRestrictionContext *restrictionContext, uint32 taskId,
+						RelationRestrictionContext *restrictionContext,
+						List *shardArrayRestrictionList, uint32 taskId,
 						TaskType taskType, bool modifyRequiresMasterEvaluation)
 {
 	Query *taskQuery = copyObject(originalQuery);
@@ -2485,6 +2833,9 @@ QueryPushdownTaskCreate(Query *originalQuery, int shardIndex,
 							   "shards in the query")));
 	}
 
+	/* only send the IN list values that can match rows in the task's shards */
+	ApplyShardArrayRestrictions(taskQuery, shardArrayRestrictionList, NIL, shardIndex);
+
 	/*
 	 * Augment the relations in the query with the shard IDs.
 	 */
@@ -2702,6 +3053,7 @@ SqlTaskList(Job *job)
 	List *rangeTableFragmentsList = NIL;
 	List *fragmentCombinationList = NIL;
 	ListCell *fragmentCombinationCell = NULL;
+	List *shardArrayRestrictionList = NIL;
 
 	Query *jobQuery = job->jobQuery;
 	List *rangeTableList = jobQuery->rtable;
@@ -2735,6 +3087,9 @@ SqlTaskList(Job *job)
 	whereClauseTree = (Node *) make_ands_explicit((List *) jobQuery->jointree->quals);
 	jobQuery->jointree->quals = whereClauseTree;
 
+	/* split IN lists on distribution columns once, rather than for every task */
+	shardArrayRestrictionList = ShardArrayRestrictionList(jobQuery);
+
 	/*
 	 * For each range table, we first get a list of their shards or merge tasks.
 	 * We also apply partition pruning based on the selection criteria. If all
@@ -2776,6 +3131,10 @@ SqlTaskList(Job *job)
 		fragmentRangeTableList = taskQuery->rtable;
 		UpdateRangeTableAlias(fragmentRangeTableList, fragmentCombination);
 
+		/* only send the IN list values that can match rows in the task's shards */
+		ApplyShardArrayRestrictions(taskQuery, shardArrayRestrictionList,
+									fragmentCombination, INVALID_SHARD_INDEX);
+
 		/* transform the updated task query to a SQL query string */
 		sqlQueryString = makeStringInfo();
 		pg_get_query_def(taskQuery, sqlQueryString);
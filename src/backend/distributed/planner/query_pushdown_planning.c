@@ -1534,6 +1534,8 @@ SubqueryPushdownMultiNodeTree(Query *queryTree)
 	List *subqueryTargetEntryList = NIL;
 	List *havingClauseColumnList = NIL;
 	DeferredErrorMessage *unsupportedQueryError = NULL;
+	StringInfo windowErrorDetail = NULL;
+	bool onlyPushableWindowFunctions = true;
 
 	/* verify we can perform distributed planning on this query */
 	unsupportedQueryError = DeferErrorIfQueryNotSupported(queryTree);
@@ -1542,6 +1544,17 @@ SubqueryPushdownMultiNodeTree(Query *queryTree)
 		RaiseDeferredError(unsupportedQueryError, ERROR);
 	}
 
+	/*
+	 * Window functions that are not partitioned by the distribution column
+	 * are evaluated on the coordinator. We decide on that before the columns
+	 * are re-mapped to the pushed down query below.
+	 */
+	if (queryTree->hasWindowFuncs)
+	{
+		onlyPushableWindowFunctions =
+			SafeToPushdownWindowFunction(queryTree, &windowErrorDetail);
+	}
+
 	/*
 	 * We would be creating a new Query and pushing down top level query's
 	 * contents down to it. Join and filter clauses in higher level query would
@@ -1631,6 +1644,7 @@ SubqueryPushdownMultiNodeTree(Query *queryTree)
 	 * in the logical optimizer.
 	 */
 	extendedOpNode = MultiExtendedOpNode(queryTree);
+	extendedOpNode->onlyPushableWindowFunctions = onlyPushableWindowFunctions;
 
 	/*
 	 * Postgres standard planner converts having qual node to a list of and
@@ -52,6 +52,7 @@
 #include "postgres.h"
 #include "funcapi.h"
 
+#include "access/heapam.h"
 #include "catalog/pg_type.h"
 #include "catalog/pg_class.h"
 #include "distributed/citus_nodes.h"
@@ -60,7 +61,9 @@
 #include "distributed/distributed_planner.h"
 #include "distributed/errormessage.h"
 #include "distributed/log_utils.h"
+#include "distributed/master_metadata_utility.h"
 #include "distributed/metadata_cache.h"
+#include "distributed/multi_join_order.h"
 #include "distributed/multi_logical_planner.h"
 #include "distributed/multi_router_planner.h"
 #include "distributed/multi_physical_planner.h"
@@ -72,6 +75,11 @@
 #include "distributed/log_utils.h"
 #include "distributed/version_compat.h"
 #include "lib/stringinfo.h"
+#if PG_VERSION_NUM >= 120000
+#include "optimizer/optimizer.h"
+#else
+#include "optimizer/clauses.h"
+#endif
 #include "optimizer/planner.h"
 #include "optimizer/prep.h"
 #include "parser/parsetree.h"
@@ -87,8 +95,14 @@
 #endif
 #include "utils/builtins.h"
 #include "utils/guc.h"
+#include "utils/lsyscache.h"
+#include "utils/rel.h"
 
 
+/* Config variables managed via guc.c */
+int BroadcastJoinThreshold = 0; /* in KB, 0 disables broadcast joins */
+bool EnableSemiJoinReduction = false;
+
 /* track depth of current recursive planner query */
 static int recursivePlanningDepth = 0;
 
@@ -174,6 +188,17 @@ static bool ContainsReferencesToOuterQuery(Query *query);
 static bool ContainsReferencesToOuterQueryWalker(Node *node,
 												 VarLevelsUpWalkerContext *context);
 static void WrapFunctionsInSubqueries(Query *query);
+static bool ShouldBroadcastSmallDistributedTables(Query *query,
+												  RecursivePlanningContext *context);
+static void RecursivelyPlanSmallDistributedTables(Query *query,
+												  RecursivePlanningContext *context);
+static bool JoinTreeContainsOuterJoin(Node *joinTreeNode);
+static void TransformRelationRTE(RangeTblEntry *rangeTableEntry);
+static void AddSemiJoinReductionFilters(Query *query, int rangeTableIndex,
+										Query *subquery);
+static List * InnerJoinQualList(Node *joinTreeNode);
+static bool CanAddSemiJoinFilter(Query *subquery);
+static Query * SemiJoinKeyQuery(RangeTblEntry *rangeTableEntry, Var *keyColumn);
 static void TransformFunctionRTE(RangeTblEntry *rangeTblEntry);
 static bool ShouldTransformRTE(RangeTblEntry *rangeTableEntry);
 
@@ -283,6 +308,16 @@ RecursivelyPlanSubqueriesAndCTEs(Query *query, RecursivePlanningContext *context
 	/* make sure function calls in joins are executed in the coordinator */
 	WrapFunctionsInSubqueries(query);
 
+	/*
+	 * Small distributed tables that are not joined on their distribution
+	 * column are broadcast as intermediate results, such that the remaining
+	 * distributed table can be joined with them on every shard.
+	 */
+	if (ShouldBroadcastSmallDistributedTables(query, context))
+	{
+		RecursivelyPlanSmallDistributedTables(query, context);
+	}
+
 	/* descend into subqueries */
 	query_tree_walker(query, RecursivelyPlanSubqueryWalker, context, 0);
 
@@ -505,6 +540,9 @@ RecursivelyPlanNonColocatedJoinWalker(Node *joinNode,
 		subquery = rte->subquery;
 		if (!SubqueryColocated(subquery, colocatedJoinChecker))
 		{
+			AddSemiJoinReductionFilters(colocatedJoinChecker->subquery, rangeTableIndex,
+										subquery);
+
 			RecursivelyPlanSubquery(subquery, recursivePlanningContext);
 		}
 	}
@@ -1556,6 +1594,584 @@ ShouldTransformRTE(RangeTblEntry *rangeTableEntry)
 }
 
 
+/*
+ * ShouldBroadcastSmallDistributedTables returns true if the given query joins
+ * several distributed tables directly, but not on their distribution columns.
+ * Such joins would otherwise require repartitioning all of the tables, even if
+ * some of them are small enough to be sent to every worker as a whole.
+ */
+static bool
+ShouldBroadcastSmallDistributedTables(Query *query, RecursivePlanningContext *context)
+{
+	List *rangeTableList = query->rtable;
+	ListCell *rangeTableCell = NULL;
+	int distributedTableCount = 0;
+
+	if (BroadcastJoinThreshold <= 0)
+	{
+		return false;
+	}
+
+	if (query->commandType != CMD_SELECT)
+	{
+		return false;
+	}
+
+	if (context->allDistributionKeysInQueryAreEqual)
+	{
+		return false;
+	}
+
+	/* direct joins with local tables are not supported by any of Citus planners */
+	if (FindNodeCheckInRangeTableList(rangeTableList, IsLocalTableRTE))
+	{
+		return false;
+	}
+
+	/*
+	 * The broadcast table becomes a recurring tuple source, which we cannot use
+	 * on the outer side of an outer join. For simplicity, we skip outer joins
+	 * altogether.
+	 */
+	if (JoinTreeContainsOuterJoin((Node *) query->jointree))
+	{
+		return false;
+	}
+
+	foreach(rangeTableCell, rangeTableList)
+	{
+		RangeTblEntry *rangeTableEntry = (RangeTblEntry *) lfirst(rangeTableCell);
+
+		if (rangeTableEntry->rtekind == RTE_RELATION &&
+			IsDistributedTable(rangeTableEntry->relid) &&
+			PartitionMethod(rangeTableEntry->relid) != DISTRIBUTE_BY_NONE)
+		{
+			distributedTableCount++;
+		}
+	}
+
+	if (distributedTableCount < 2)
+	{
+		return false;
+	}
+
+	return !AllDistributionKeysInSubqueryAreEqual(query,
+												  context->plannerRestrictionContext);
+}
+
+
+/*
+ * RecursivelyPlanSmallDistributedTables keeps the largest distributed table of
+ * the query in place, and recursively plans every other distributed table whose
+ * size is below citus.broadcast_join_threshold. The recursively planned tables
+ * are materialized once as intermediate results that are sent to all workers,
+ * and the remaining table is joined with them locally on each of its shards.
+ *
+ * The table sizes come from the shard lengths in the metadata, or from a
+ * distributed ANALYZE, so they are only as accurate as the last statistics
+ * update. Hash-distributed shards have a length of 0 until their sizes are
+ * refreshed, so a size of 0 means that the size is unknown. Such tables might be
+ * large, hence they are never broadcast and are preferred as the table that is
+ * kept in place.
+ */
+static void
+RecursivelyPlanSmallDistributedTables(Query *query, RecursivePlanningContext *context)
+{
+	List *distributedTableIndexList = NIL;
+	ListCell *rangeTableCell = NULL;
+	ListCell *rangeTableIndexCell = NULL;
+	int rangeTableIndex = 0;
+	int largestTableIndex = 0;
+	uint64 largestTableSize = 0;
+	uint64 thresholdInBytes = ((uint64) BroadcastJoinThreshold) * 1024L;
+	uint64 *tableSizeArray = palloc0((list_length(query->rtable) + 1) *
+									 sizeof(uint64));
+
+	foreach(rangeTableCell, query->rtable)
+	{
+		RangeTblEntry *rangeTableEntry = (RangeTblEntry *) lfirst(rangeTableCell);
+		uint64 tableSize = 0;
+
+		rangeTableIndex++;
+
+		if (rangeTableEntry->rtekind != RTE_RELATION ||
+			!IsDistributedTable(rangeTableEntry->relid) ||
+			PartitionMethod(rangeTableEntry->relid) == DISTRIBUTE_BY_NONE)
+		{
+			continue;
+		}
+
+		tableSize = TableSizeEstimate(rangeTableEntry->relid);
+		tableSizeArray[rangeTableIndex] = tableSize;
+
+		if (tableSize == 0)
+		{
+			/* a table of unknown size is considered to be the largest */
+			tableSize = PG_UINT64_MAX;
+		}
+
+		if (largestTableIndex == 0 || tableSize > largestTableSize)
+		{
+			largestTableIndex = rangeTableIndex;
+			largestTableSize = tableSize;
+		}
+
+		distributedTableIndexList = lappend_int(distributedTableIndexList,
+												rangeTableIndex);
+	}
+
+	foreach(rangeTableIndexCell, distributedTableIndexList)
+	{
+		RangeTblEntry *rangeTableEntry = NULL;
+		uint64 tableSize = 0;
+
+		rangeTableIndex = lfirst_int(rangeTableIndexCell);
+		if (rangeTableIndex == largestTableIndex)
+		{
+			continue;
+		}
+
+		tableSize = tableSizeArray[rangeTableIndex];
+		if (tableSize == 0 || tableSize > thresholdInBytes)
+		{
+			continue;
+		}
+
+		rangeTableEntry = rt_fetch(rangeTableIndex, query->rtable);
+
+		ereport(DEBUG1, (errmsg("broadcasting distributed table %s of "
+								UINT64_FORMAT " bytes for the join",
+								get_rel_name(rangeTableEntry->relid), tableSize)));
+
+		TransformRelationRTE(rangeTableEntry);
+
+		/* tables that are already broadcast may filter the remaining ones */
+		AddSemiJoinReductionFilters(query, rangeTableIndex, rangeTableEntry->subquery);
+
+		RecursivelyPlanSubquery(rangeTableEntry->subquery, context);
+	}
+}
+
+
+/*
+ * JoinTreeContainsOuterJoin returns true if the given join tree contains any
+ * joins other than inner joins.
+ */
+static bool
+JoinTreeContainsOuterJoin(Node *joinTreeNode)
+{
+	if (joinTreeNode == NULL)
+	{
+		return false;
+	}
+	else if (IsA(joinTreeNode, FromExpr))
+	{
+		FromExpr *fromExpr = (FromExpr *) joinTreeNode;
+		ListCell *fromListCell = NULL;
+
+		foreach(fromListCell, fromExpr->fromlist)
+		{
+			if (JoinTreeContainsOuterJoin((Node *) lfirst(fromListCell)))
+			{
+				return true;
+			}
+		}
+	}
+	else if (IsA(joinTreeNode, JoinExpr))
+	{
+		JoinExpr *joinExpr = (JoinExpr *) joinTreeNode;
+
+		if (joinExpr->jointype != JOIN_INNER)
+		{
+			return true;
+		}
+
+		return JoinTreeContainsOuterJoin(joinExpr->larg) ||
+			   JoinTreeContainsOuterJoin(joinExpr->rarg);
+	}
+
+	return false;
+}
+
+
+/*
+ * TransformRelationRTE wraps a given relation RangeTableEntry inside a
+ * (SELECT <all columns> FROM relation) subquery. The target list keeps the
+ * attribute numbers of the relation, so that the Vars in the rest of the query
+ * that refer to the relation's columns keep pointing to the same columns.
+ * Dropped columns are replaced by NULL placeholders.
+ *
+ * The said RangeTableEntry is modified and now points to the new subquery.
+ */
+static void
+TransformRelationRTE(RangeTblEntry *rangeTableEntry)
+{
+	Query *subquery = makeNode(Query);
+	RangeTblRef *newRangeTableRef = makeNode(RangeTblRef);
+	RangeTblEntry *newRangeTableEntry = NULL;
+	Relation relation = NULL;
+	TupleDesc tupleDescriptor = NULL;
+	int columnIndex = 0;
+
+	subquery->commandType = CMD_SELECT;
+
+	/* copy the input rangeTableEntry to prevent cycles */
+	newRangeTableEntry = copyObject(rangeTableEntry);
+
+	/* set the FROM expression to the relation */
+	subquery->rtable = list_make1(newRangeTableEntry);
+	newRangeTableRef->rtindex = 1;
+	subquery->jointree = makeFromExpr(list_make1(newRangeTableRef), NULL);
+
+	/* the relation is already locked by the parser */
+	relation = relation_open(rangeTableEntry->relid, NoLock);
+	tupleDescriptor = RelationGetDescr(relation);
+
+	for (columnIndex = 0; columnIndex < tupleDescriptor->natts; columnIndex++)
+	{
+		Form_pg_attribute attribute = TupleDescAttr(tupleDescriptor, columnIndex);
+		AttrNumber attributeNumber = columnIndex + 1;
+		Expr *targetExpression = NULL;
+		TargetEntry *targetEntry = NULL;
+
+		if (attribute->attisdropped)
+		{
+			targetExpression = (Expr *) makeNullConst(INT4OID, -1, InvalidOid);
+		}
+		else
+		{
+			targetExpression = (Expr *) makeVar(1, attributeNumber,
+												attribute->atttypid,
+												attribute->atttypmod,
+												attribute->attcollation, 0);
+		}
+
+		targetEntry = makeTargetEntry(targetExpression, attributeNumber,
+									  pstrdup(NameStr(attribute->attname)), false);
+		subquery->targetList = lappend(subquery->targetList, targetEntry);
+	}
+
+	relation_close(relation, NoLock);
+
+	/* replace the relation with the constructed subquery */
+	rangeTableEntry->rtekind = RTE_SUBQUERY;
+	rangeTableEntry->subquery = subquery;
+	rangeTableEntry->relid = InvalidOid;
+	rangeTableEntry->relkind = 0;
+	rangeTableEntry->inh = false;
+	rangeTableEntry->tablesample = NULL;
+	rangeTableEntry->requiredPerms = 0;
+}
+
+
+/*
+ * AddSemiJoinReductionFilters is called right before the subquery at the given
+ * range table index of the query is recursively planned. The function looks
+ * for equi-join clauses between the subquery and recurring tuple sources of
+ * the query, namely reference tables and subqueries that are already replaced
+ * by intermediate results. For each such clause, it adds a filter of the form
+ *
+ *   <subquery column expression> IN (SELECT <join column> FROM <other side>)
+ *
+ * to the subquery's WHERE clause. In an inner join, rows of the subquery that
+ * do not have a match on the other side cannot appear in the result, so the
+ * filter leaves the query result intact while shrinking the intermediate result
+ * that we build from the subquery and send to the workers.
+ *
+ * Since the other side is already available on all nodes, the filter is an
+ * exact semi-join rather than an approximation such as a bloom filter.
+ */
+static void
+AddSemiJoinReductionFilters(Query *query, int rangeTableIndex, Query *subquery)
+{
+	List *joinQualList = NIL;
+	ListCell *joinQualCell = NULL;
+
+	if (!EnableSemiJoinReduction)
+	{
+		return;
+	}
+
+	/* filtering the outer side of an outer join would remove result rows */
+	if (JoinTreeContainsOuterJoin((Node *) query->jointree))
+	{
+		return;
+	}
+
+	if (!CanAddSemiJoinFilter(subquery))
+	{
+		return;
+	}
+
+	joinQualList = InnerJoinQualList((Node *) query->jointree);
+
+	foreach(joinQualCell, joinQualList)
+	{
+		Node *joinQual = (Node *) lfirst(joinQualCell);
+		OpExpr *joinClause = NULL;
+		Var *leftColumn = NULL;
+		Var *rightColumn = NULL;
+		Var *subqueryColumn = NULL;
+		Var *keyColumn = NULL;
+		Oid filterOperatorId = InvalidOid;
+		RangeTblEntry *keyRangeTableEntry = NULL;
+		TargetEntry *subqueryTargetEntry = NULL;
+		Query *keyQuery = NULL;
+		TargetEntry *keyTargetEntry = NULL;
+		OpExpr *filterExpression = NULL;
+		Param *keyParam = NULL;
+		SubLink *filterSubLink = NULL;
+
+		if (!IsA(joinQual, OpExpr) || list_length(((OpExpr *) joinQual)->args) != 2)
+		{
+			continue;
+		}
+
+		joinClause = (OpExpr *) joinQual;
+		if (!IsA(linitial(joinClause->args), Var) || !IsA(lsecond(joinClause->args), Var))
+		{
+			continue;
+		}
+
+		leftColumn = (Var *) linitial(joinClause->args);
+		rightColumn = (Var *) lsecond(joinClause->args);
+		if (leftColumn->varlevelsup != 0 || rightColumn->varlevelsup != 0)
+		{
+			continue;
+		}
+
+		/* the filter keeps the subquery column on the left of the operator */
+		if (leftColumn->varno == rangeTableIndex && rightColumn->varno != rangeTableIndex)
+		{
+			subqueryColumn = leftColumn;
+			keyColumn = rightColumn;
+			filterOperatorId = joinClause->opno;
+		}
+		else if (rightColumn->varno == rangeTableIndex &&
+				 leftColumn->varno != rangeTableIndex)
+		{
+			subqueryColumn = rightColumn;
+			keyColumn = leftColumn;
+			filterOperatorId = get_commutator(joinClause->opno);
+		}
+		else
+		{
+			continue;
+		}
+
+		if (filterOperatorId == InvalidOid || subqueryColumn->varattno <= 0 ||
+			keyColumn->varattno <= 0)
+		{
+			continue;
+		}
+
+		/* semi-joins on equality operators can be executed as hash joins */
+		if (!op_mergejoinable(joinClause->opno, exprType((Node *) leftColumn)))
+		{
+			continue;
+		}
+
+		subqueryTargetEntry = get_tle_by_resno(subquery->targetList,
+											   subqueryColumn->varattno);
+		if (subqueryTargetEntry == NULL || subqueryTargetEntry->resjunk ||
+			contain_volatile_functions((Node *) subqueryTargetEntry->expr))
+		{
+			continue;
+		}
+
+		keyRangeTableEntry = rt_fetch(keyColumn->varno, query->rtable);
+		keyQuery = SemiJoinKeyQuery(keyRangeTableEntry, keyColumn);
+		if (keyQuery == NULL)
+		{
+			continue;
+		}
+
+		keyTargetEntry = (TargetEntry *) linitial(keyQuery->targetList);
+
+		keyParam = makeNode(Param);
+		keyParam->paramkind = PARAM_SUBLINK;
+		keyParam->paramid = 1;
+		keyParam->paramtype = exprType((Node *) keyTargetEntry->expr);
+		keyParam->paramtypmod = exprTypmod((Node *) keyTargetEntry->expr);
+		keyParam->paramcollid = exprCollation((Node *) keyTargetEntry->expr);
+		keyParam->location = -1;
+
+		filterExpression = (OpExpr *) copyObject(joinClause);
+		filterExpression->opno = filterOperatorId;
+		filterExpression->opfuncid = InvalidOid;
+		filterExpression->args = list_make2(copyObject(subqueryTargetEntry->expr),
+											keyParam);
+
+		filterSubLink = makeNode(SubLink);
+		filterSubLink->subLinkType = ANY_SUBLINK;
+		filterSubLink->subLinkId = 0;
+		filterSubLink->testexpr = (Node *) filterExpression;
+		filterSubLink->operName = NIL;
+		filterSubLink->subselect = (Node *) keyQuery;
+		filterSubLink->location = -1;
+
+		if (subquery->jointree->quals == NULL)
+		{
+			subquery->jointree->quals = (Node *) filterSubLink;
+		}
+		else
+		{
+			subquery->jointree->quals =
+				(Node *) makeBoolExpr(AND_EXPR, list_make2(subquery->jointree->quals,
+														   filterSubLink), -1);
+		}
+
+		subquery->hasSubLinks = true;
+
+		ereport(DEBUG2, (errmsg("adding semi-join reduction filter to subquery "
+								"before recursively planning it")));
+	}
+}
+
+
+/*
+ * InnerJoinQualList returns the top-level conjuncts of the WHERE clause and of
+ * the join clauses of the given join tree, which is expected to contain only
+ * inner joins.
+ */
+static List *
+InnerJoinQualList(Node *joinTreeNode)
+{
+	List *qualList = NIL;
+	Node *quals = NULL;
+
+	if (joinTreeNode == NULL)
+	{
+		return NIL;
+	}
+	else if (IsA(joinTreeNode, FromExpr))
+	{
+		FromExpr *fromExpr = (FromExpr *) joinTreeNode;
+		ListCell *fromListCell = NULL;
+
+		foreach(fromListCell, fromExpr->fromlist)
+		{
+			Node *fromElement = (Node *) lfirst(fromListCell);
+
+			qualList = list_concat(qualList, InnerJoinQualList(fromElement));
+		}
+
+		quals = fromExpr->quals;
+	}
+	else if (IsA(joinTreeNode, JoinExpr))
+	{
+		JoinExpr *joinExpr = (JoinExpr *) joinTreeNode;
+
+		qualList = list_concat(InnerJoinQualList(joinExpr->larg),
+							   InnerJoinQualList(joinExpr->rarg));
+
+		quals = joinExpr->quals;
+	}
+
+	if (quals == NULL)
+	{
+		return qualList;
+	}
+
+	if (IsA(quals, BoolExpr) && ((BoolExpr *) quals)->boolop == AND_EXPR)
+	{
+		return list_concat(qualList, list_copy(((BoolExpr *) quals)->args));
+	}
+
+	return lappend(qualList, quals);
+}
+
+
+/*
+ * CanAddSemiJoinFilter returns true if adding a filter to the WHERE clause of
+ * the given subquery removes only the rows of its result that the filter
+ * rejects. This does not hold for subqueries that aggregate, limit or otherwise
+ * combine multiple input rows.
+ */
+static bool
+CanAddSemiJoinFilter(Query *subquery)
+{
+	if (subquery->commandType != CMD_SELECT || subquery->jointree == NULL)
+	{
+		return false;
+	}
+
+	if (subquery->hasAggs || subquery->groupClause != NIL ||
+		subquery->groupingSets != NIL || subquery->havingQual != NULL ||
+		subquery->hasWindowFuncs || subquery->hasTargetSRFs ||
+		subquery->distinctClause != NIL || subquery->setOperations != NULL ||
+		subquery->limitCount != NULL || subquery->limitOffset != NULL ||
+		subquery->rowMarks != NIL || subquery->cteList != NIL)
+	{
+		return false;
+	}
+
+	return !ContainsReferencesToOuterQuery(subquery);
+}
+
+
+/*
+ * SemiJoinKeyQuery returns a query that selects the given join column from the
+ * given range table entry, if the entry is a recurring tuple source that does
+ * not require another distributed execution to read. Otherwise, the function
+ * returns NULL.
+ */
+static Query *
+SemiJoinKeyQuery(RangeTblEntry *rangeTableEntry, Var *keyColumn)
+{
+	Query *keyQuery = NULL;
+	TargetEntry *keyTargetEntry = NULL;
+
+	if (rangeTableEntry->rtekind == RTE_RELATION &&
+		IsDistributedTable(rangeTableEntry->relid) &&
+		PartitionMethod(rangeTableEntry->relid) == DISTRIBUTE_BY_NONE)
+	{
+		RangeTblRef *keyRangeTableRef = makeNode(RangeTblRef);
+		Var *keyQueryColumn = copyObject(keyColumn);
+
+		keyRangeTableRef->rtindex = 1;
+		keyQueryColumn->varno = 1;
+		keyQueryColumn->varnoold = 1;
+
+		keyQuery = makeNode(Query);
+		keyQuery->commandType = CMD_SELECT;
+		keyQuery->rtable = list_make1(copyObject(rangeTableEntry));
+		keyQuery->jointree = makeFromExpr(list_make1(keyRangeTableRef), NULL);
+
+		keyTargetEntry = makeTargetEntry((Expr *) keyQueryColumn, 1,
+										 get_rte_attribute_name(rangeTableEntry,
+																keyColumn->varattno),
+										 false);
+	}
+	else if (rangeTableEntry->rtekind == RTE_SUBQUERY &&
+			 list_length(rangeTableEntry->subquery->rtable) == 1 &&
+			 ContainsReadIntermediateResultFunction(
+				 (Node *) rangeTableEntry->subquery->rtable))
+	{
+		TargetEntry *resultTargetEntry = NULL;
+
+		keyQuery = copyObject(rangeTableEntry->subquery);
+
+		resultTargetEntry = get_tle_by_resno(keyQuery->targetList, keyColumn->varattno);
+		if (resultTargetEntry == NULL)
+		{
+			return NULL;
+		}
+
+		keyTargetEntry = flatCopyTargetEntry(resultTargetEntry);
+		keyTargetEntry->resno = 1;
+	}
+	else
+	{
+		return NULL;
+	}
+
+	keyQuery->targetList = list_make1(keyTargetEntry);
+
+	return keyQuery;
+}
+
+
 /*
  * BuildSubPlanResultQuery returns a query of the form:
  *
@@ -104,6 +104,14 @@ typedef struct PruningInstance
 	 */
 	Const *hashedEqualConsts;
 
+	/*
+	 * Indexes of the shards that a partcol IN (...) / partcol = ANY(...)
+	 * restriction on a hash-partitioned table maps to.  Only set when the
+	 * array contains more than one distinct value; NULL means there is no
+	 * such restriction.
+	 */
+	Bitmapset *equalShardIndexes;
+
 	/*
 	 * Types of constraints not understood.  We could theoretically try more
 	 * expensive methods of pruning if any such restrictions are found.
@@ -156,6 +164,7 @@ typedef FunctionCallInfoData FunctionCall2InfoData;
  */
 typedef struct ClauseWalkerContext
 {
+	DistTableCacheEntry *cacheEntry;
 	Var *partitionColumn;
 	char partitionMethod;
 
@@ -190,6 +199,8 @@ static Const * TransformPartitionRestrictionValue(Var *partitionColumn,
 static void AddSAOPartitionKeyRestrictionToInstance(ClauseWalkerContext *context,
 													ScalarArrayOpExpr *
 													arrayOperatorExpression);
+static bool AddSAOShardIndexesToInstance(ClauseWalkerContext *context,
+										 ArrayType *array);
 static void AddHashRestrictionToInstance(ClauseWalkerContext *context, OpExpr *opClause,
 										 Var *varClause, Const *constantClause);
 static void AddNewConjuction(ClauseWalkerContext *context, OpExpr *op);
@@ -202,6 +213,9 @@ static int PerformCompare(FunctionCallInfo compareFunctionCall);
 
 static List * PruneOne(DistTableCacheEntry *cacheEntry, ClauseWalkerContext *context,
 					   PruningInstance *prune);
+static List * PruneWithShardIndexes(DistTableCacheEntry *cacheEntry,
+									ClauseWalkerContext *context,
+									PruningInstance *prune);
 static List * PruneWithBoundaries(DistTableCacheEntry *cacheEntry,
 								  ClauseWalkerContext *context,
 								  PruningInstance *prune);
@@ -266,6 +280,7 @@ PruneShards(Oid relationId, Index rangeTableId, List *whereClauseList,
 	}
 
 
+	context.cacheEntry = cacheEntry;
 	context.partitionMethod = partitionMethod;
 	context.partitionColumn = PartitionColumn(relationId, rangeTableId);
 	context.currentPruningInstance = palloc0(sizeof(PruningInstance));
@@ -332,12 +347,19 @@ PruneShards(Oid relationId, Index rangeTableId, List *whereClauseList,
 		if (context.partitionMethod == DISTRIBUTE_BY_HASH)
 		{
 			if (!prune->evaluatesToFalse && !prune->equalConsts &&
-				!prune->hashedEqualConsts)
+				!prune->hashedEqualConsts && !prune->equalShardIndexes)
 			{
 				/* if hash-partitioned and no equals constraints, return all shards */
 				foundRestriction = false;
 				break;
 			}
+			else if (partitionValueConst != NULL && prune->equalConsts == NULL &&
+					 prune->equalShardIndexes != NULL)
+			{
+				/* the IN list contains multiple partition column values */
+				singlePartitionValueConst = NULL;
+				foundPartitionColumnValue = true;
+			}
 			else if (partitionValueConst != NULL && prune->equalConsts != NULL)
 			{
 				if (!foundPartitionColumnValue)
@@ -625,7 +647,8 @@ PrunableExpressionsWalker(Node *node, ClauseWalkerContext *context)
  * AddSAOPartitionKeyRestrictionToInstance adds partcol = arrayelem operator
  * restriction to the current pruning instance for each element of the array. These
  * restrictions are added to pruning instance to prune shards based on IN/=ANY
- * constraints.
+ * constraints. For hash-partitioned tables the elements are instead mapped to a
+ * set of shards directly, see AddSAOShardIndexesToInstance().
  */
 static void
 AddSAOPartitionKeyRestrictionToInstance(ClauseWalkerContext *context,
@@ -661,6 +684,22 @@ AddSAOPartitionKeyRestrictionToInstance(ClauseWalkerContext *context,
 
 		array = DatumGetArrayTypeP(((Const *) arrayArgument)->constvalue);
 
+		/*
+		 * For hash-partitioned tables, map all elements to their shards in one
+		 * pass instead of adding a pruning instance per element.
+		 */
+		if (context->partitionMethod == DISTRIBUTE_BY_HASH &&
+			AddSAOShardIndexesToInstance(context, array))
+		{
+			if (!prune->addedToPruningInstances)
+			{
+				context->pruningInstances = lappend(context->pruningInstances, prune);
+				prune->addedToPruningInstances = true;
+			}
+
+			return;
+		}
+
 		/* get the necessary information from array type to iterate over it */
 		elementType = ARR_ELEMTYPE(array);
 		get_typlenbyvalalign(elementType,
@@ -703,6 +742,114 @@ AddSAOPartitionKeyRestrictionToInstance(ClauseWalkerContext *context,
 }
 
 
+/*
+ * AddSAOShardIndexesToInstance restricts the current pruning instance of a
+ * hash-partitioned table to the shards that the elements of a partcol =
+ * ANY(array) restriction hash to.  All elements are hashed in a single pass
+ * and deduplicated into a bitmap of shard indexes, which avoids building and
+ * pruning a separate instance for each element of a large IN list.
+ *
+ * Returns false without changing the instance if the array elements are not
+ * of the partition column type, or if the array does not contain at least two
+ * distinct non-NULL values. The caller then falls back to adding a restriction
+ * per element, which also lets PruneShards() report a single partition value.
+ */
+static bool
+AddSAOShardIndexesToInstance(ClauseWalkerContext *context, ArrayType *array)
+{
+	PruningInstance *prune = context->currentPruningInstance;
+	DistTableCacheEntry *cacheEntry = context->cacheEntry;
+	FunctionCall2InfoData hashFunctionCall;
+	FunctionCallInfo hashFunctionCallInfo = (FunctionCallInfo) &hashFunctionCall;
+	ArrayIterator arrayIterator = NULL;
+	Datum arrayElement = 0;
+	bool isNull = false;
+	Datum firstElement = 0;
+	bool foundElement = false;
+	bool foundDistinctElements = false;
+	Bitmapset *shardIndexes = NULL;
+
+	if (ARR_ELEMTYPE(array) != context->partitionColumn->vartype ||
+		cacheEntry->hashFunction == NULL)
+	{
+		return false;
+	}
+
+	/* initiate function call info once, instead of once per element */
+	InitFunctionCallInfoData(*hashFunctionCallInfo, cacheEntry->hashFunction, 1,
+							 cacheEntry->partitionColumn->varcollid, NULL, NULL);
+
+	arrayIterator = array_create_iterator(array, 0, NULL);
+	while (array_iterate(arrayIterator, &arrayElement, &isNull))
+	{
+		Datum hashedValue = 0;
+		int shardIndex = INVALID_SHARD_INDEX;
+
+		/* partcol = NULL can never be true */
+		if (isNull)
+		{
+			continue;
+		}
+
+		if (!foundElement)
+		{
+			firstElement = arrayElement;
+			foundElement = true;
+		}
+		else if (!foundDistinctElements &&
+				 PerformValueCompare((FunctionCallInfo) &
+									 context->compareValueFunctionCall,
+									 arrayElement, firstElement) != 0)
+		{
+			foundDistinctElements = true;
+		}
+
+		fcSetArg(hashFunctionCallInfo, 0, arrayElement);
+		hashFunctionCallInfo->isnull = false;
+		hashedValue = FunctionCallInvoke(hashFunctionCallInfo);
+
+		if (hashFunctionCallInfo->isnull)
+		{
+			ereport(ERROR, (errmsg("function %u returned NULL",
+								   hashFunctionCallInfo->flinfo->fn_oid)));
+		}
+
+		shardIndex = FindShardIntervalIndex(hashedValue, cacheEntry);
+		if (shardIndex != INVALID_SHARD_INDEX)
+		{
+			shardIndexes = bms_add_member(shardIndexes, shardIndex);
+		}
+	}
+
+	array_free_iterator(arrayIterator);
+
+	if (!foundDistinctElements)
+	{
+		bms_free(shardIndexes);
+		return false;
+	}
+
+	/* ANDed IN lists restrict the instance to the shards they have in common */
+	if (prune->equalShardIndexes != NULL)
+	{
+		shardIndexes = bms_intersect(prune->equalShardIndexes, shardIndexes);
+	}
+
+	if (bms_is_empty(shardIndexes))
+	{
+		prune->evaluatesToFalse = true;
+	}
+	else
+	{
+		prune->equalShardIndexes = shardIndexes;
+	}
+
+	prune->hasValidConstraint = true;
+
+	return true;
+}
+
+
 /*
  * AddNewConjuction adds the OpExpr to pending instance list of context
  * as conjunction as partial instance.
@@ -1040,6 +1187,12 @@ PruneOne(DistTableCacheEntry *cacheEntry, ClauseWalkerContext *context,
 		return NIL;
 	}
 
+	/* elements of IN lists on hash-partitioned tables are already mapped to shards */
+	if (prune->equalShardIndexes != NULL)
+	{
+		return PruneWithShardIndexes(cacheEntry, context, prune);
+	}
+
 	/*
 	 * For an equal constraints, if there's no overlapping shards (always the
 	 * case for hash and range partitioning, sometimes for append), can
@@ -1147,6 +1300,53 @@ PruneOne(DistTableCacheEntry *cacheEntry, ClauseWalkerContext *context,
 }
 
 
+/*
+ * PruneWithShardIndexes returns the shards in prune->equalShardIndexes that
+ * also satisfy the other equality restrictions of the instance, if any.
+ */
+static List *
+PruneWithShardIndexes(DistTableCacheEntry *cacheEntry, ClauseWalkerContext *context,
+					  PruningInstance *prune)
+{
+	ShardInterval **sortedShardIntervalArray = cacheEntry->sortedShardIntervalArray;
+	List *shardIntervalList = NIL;
+	int shardIndex = -1;
+
+	Assert(context->partitionMethod == DISTRIBUTE_BY_HASH);
+
+	if (prune->equalConsts || prune->hashedEqualConsts)
+	{
+		PruningInstance equalityInstance = *prune;
+		List *equalityShardList = NIL;
+		ListCell *shardIntervalCell = NULL;
+
+		/* equality restrictions select at most one shard, check it's in the set */
+		equalityInstance.equalShardIndexes = NULL;
+		equalityShardList = PruneOne(cacheEntry, context, &equalityInstance);
+
+		foreach(shardIntervalCell, equalityShardList)
+		{
+			ShardInterval *shardInterval = (ShardInterval *) lfirst(shardIntervalCell);
+
+			if (bms_is_member(ShardIndex(shardInterval), prune->equalShardIndexes))
+			{
+				shardIntervalList = lappend(shardIntervalList, shardInterval);
+			}
+		}
+
+		return shardIntervalList;
+	}
+
+	while ((shardIndex = bms_next_member(prune->equalShardIndexes, shardIndex)) >= 0)
+	{
+		shardIntervalList = lappend(shardIntervalList,
+									sortedShardIntervalArray[shardIndex]);
+	}
+
+	return shardIntervalList;
+}
+
+
 /*
  * PerformCompare invokes comparator with prepared values, check for
  * unexpected NULL returns.
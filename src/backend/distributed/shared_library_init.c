@@ -26,6 +26,8 @@
 #include "distributed/commands/utility_hook.h"
 #include "distributed/connection_management.h"
 #include "distributed/distributed_deadlock_detection.h"
+#include "distributed/insert_select_executor.h"
+#include "distributed/insert_select_planner.h"
 #include "distributed/intermediate_result_pruning.h"
 #include "distributed/local_executor.h"
 #include "distributed/maintenanced.h"
@@ -37,6 +39,7 @@
 #include "distributed/multi_explain.h"
 #include "distributed/multi_join_order.h"
 #include "distributed/multi_logical_optimizer.h"
+#include "distributed/multi_logical_planner.h"
 #include "distributed/distributed_planner.h"
 #include "distributed/multi_router_planner.h"
 #include "distributed/multi_server_executor.h"
@@ -47,8 +50,11 @@
 #include "distributed/query_pushdown_planning.h"
 #include "distributed/time_constants.h"
 #include "distributed/query_stats.h"
+#include "distributed/recursive_planning.h"
 #include "distributed/remote_commands.h"
 #include "distributed/shared_library_init.h"
+#include "distributed/shard_column_ranges.h"
+#include "distributed/shared_metadata_cache.h"
 #include "distributed/statistics_collection.h"
 #include "distributed/subplan_execution.h"
 #include "distributed/task_tracker.h"
@@ -61,6 +67,7 @@
 #include "postmaster/postmaster.h"
 #include "optimizer/planner.h"
 #include "optimizer/paths.h"
+#include "optimizer/plancat.h"
 #include "tcop/tcopprot.h"
 #include "utils/guc.h"
 #include "utils/guc_tables.h"
@@ -226,6 +233,7 @@ _PG_init(void)
 	/* register for planner hook */
 	set_rel_pathlist_hook = multi_relation_restriction_hook;
 	set_join_pathlist_hook = multi_join_restriction_hook;
+	get_relation_info_hook = multi_get_relation_info_hook;
 	ExecutorStart_hook = CitusExecutorStart;
 	ExecutorRun_hook = CitusExecutorRun;
 
@@ -233,6 +241,8 @@ _PG_init(void)
 	emit_log_hook = multi_log_hook;
 
 	InitializeMaintenanceDaemon();
+	InitializeSharedMetadataCache();
+	InitializeShardColumnRanges();
 
 	/* organize that task tracker is started once server is up */
 	TaskTrackerRegister();
@@ -435,6 +445,20 @@ RegisterCitusConfigVariables(void)
 		GUC_STANDARD,
 		NULL, NULL, NULL);
 
+	DefineCustomBoolVariable(
+		"citus.enable_partial_local_execution",
+		gettext_noop("Enables executing only the tasks on the shards that have been "
+					 "accessed locally in the transaction via local execution."),
+		gettext_noop("Once a transaction uses local execution, all the tasks on the "
+					 "local shards are executed locally one at a time. When enabled, "
+					 "the tasks on the local shards that have not been accessed "
+					 "locally are executed in parallel over connections instead."),
+		&EnablePartialLocalExecution,
+		false,
+		PGC_USERSET,
+		GUC_STANDARD,
+		NULL, NULL, NULL);
+
 	DefineCustomBoolVariable(
 		"citus.enable_single_hash_repartition_joins",
 		gettext_noop("Enables single hash repartitioning between hash "
@@ -504,6 +528,19 @@ RegisterCitusConfigVariables(void)
 		GUC_NO_SHOW_ALL,
 		NULL, NULL, NULL);
 
+	DefineCustomBoolVariable(
+		"citus.enable_cost_based_join_order",
+		gettext_noop("Picks the distributed join order by its estimated network cost."),
+		gettext_noop("When enabled, the planner estimates the number of bytes that "
+					 "each candidate join order moves across the network using "
+					 "the shard sizes in the metadata, and picks the cheapest one. "
+					 "Otherwise, join orders are ranked by their join rules only."),
+		&EnableCostBasedJoinOrder,
+		false,
+		PGC_USERSET,
+		GUC_STANDARD,
+		NULL, NULL, NULL);
+
 	DefineCustomBoolVariable(
 		"citus.log_remote_commands",
 		gettext_noop("Log queries sent to other nodes in the server log"),
@@ -546,6 +583,21 @@ RegisterCitusConfigVariables(void)
 		GUC_NO_SHOW_ALL,
 		NULL, NULL, NULL);
 
+	DefineCustomBoolVariable(
+		"citus.enable_incremental_deadlock_detection",
+		gettext_noop("Only searches for distributed deadlocks among the "
+					 "transactions affected by new wait edges"),
+		gettext_noop("Every distributed deadlock detection run remembers the "
+					 "wait edges it has seen. A new deadlock has to contain at "
+					 "least one new wait edge, so the next run only searches for "
+					 "cycles in the connected components of the wait graph that "
+					 "have new edges."),
+		&EnableIncrementalDeadlockDetection,
+		true,
+		PGC_SIGHUP,
+		GUC_NO_SHOW_ALL,
+		NULL, NULL, NULL);
+
 	DefineCustomBoolVariable(
 		"citus.explain_distributed_queries",
 		gettext_noop("Enables Explain for distributed queries."),
@@ -608,6 +660,36 @@ RegisterCitusConfigVariables(void)
 		GUC_UNIT_MS | GUC_STANDARD,
 		NULL, NULL, NULL);
 
+	DefineCustomIntVariable(
+		"citus.shard_column_range_update_interval",
+		gettext_noop("Sets the time to wait between refreshes of the shard "
+					 "column ranges."),
+		gettext_noop("The maintenance daemon on the coordinator periodically "
+					 "fetches the minimum and maximum values of the columns "
+					 "that were added with citus_add_shard_range_column() in "
+					 "every shard, which are used to skip shards in "
+					 "multi-shard queries. This setting determines how often "
+					 "the ranges are refreshed, use -1 to disable."),
+		&ShardColumnRangeUpdateInterval,
+		-1, -1, 7 * MS_PER_DAY,
+		PGC_SIGHUP,
+		GUC_UNIT_MS | GUC_STANDARD,
+		NULL, NULL, NULL);
+
+	DefineCustomIntVariable(
+		"citus.shard_size_update_interval",
+		gettext_noop("Sets the time to wait between updates of the shard sizes."),
+		gettext_noop("The maintenance daemon on the coordinator periodically "
+					 "fetches the sizes of the shards of hash-distributed "
+					 "tables from the workers and stores them in "
+					 "pg_dist_placement. This setting determines how often "
+					 "the sizes are updated, use -1 to disable."),
+		&ShardSizeUpdateInterval,
+		-1, -1, 7 * MS_PER_DAY,
+		PGC_SIGHUP,
+		GUC_UNIT_MS | GUC_STANDARD,
+		NULL, NULL, NULL);
+
 	DefineCustomIntVariable(
 		"citus.metadata_sync_interval",
 		gettext_noop("Sets the time to wait between metadata syncs."),
@@ -632,6 +714,49 @@ RegisterCitusConfigVariables(void)
 		GUC_UNIT_MS | GUC_NO_SHOW_ALL,
 		NULL, NULL, NULL);
 
+	DefineCustomBoolVariable(
+		"citus.enable_delta_metadata_sync",
+		gettext_noop("Only sends the missed metadata changes to metadata nodes "
+					 "that are out of sync."),
+		gettext_noop("When enabled, metadata nodes that get out of sync keep a "
+					 "log of the metadata changes they missed in "
+					 "pg_dist_metadata_change, and the maintenance daemon only "
+					 "sends these changes instead of the whole metadata "
+					 "snapshot."),
+		&EnableDeltaMetadataSync,
+		false,
+		PGC_SUSET,
+		GUC_NO_SHOW_ALL,
+		NULL, NULL, NULL);
+
+	DefineCustomBoolVariable(
+		"citus.enable_incremental_cache_invalidation",
+		gettext_noop("Only reloads the changed shard placements of distributed "
+					 "tables on cache invalidation."),
+		gettext_noop("When enabled, a change to the placements of a shard only "
+					 "reloads the placements of that shard from the catalogs, "
+					 "instead of rebuilding all the cached shard metadata of "
+					 "the distributed table."),
+		&EnableIncrementalCacheInvalidation,
+		false,
+		PGC_USERSET,
+		GUC_STANDARD,
+		NULL, NULL, NULL);
+
+	DefineCustomBoolVariable(
+		"citus.enable_shared_metadata_cache",
+		gettext_noop("Shares the shard metadata of distributed tables between "
+					 "backends."),
+		gettext_noop("When enabled, the sorted shard intervals and placements "
+					 "of distributed tables are kept in shared memory, such "
+					 "that new backends do not need to read them from the "
+					 "catalogs."),
+		&EnableSharedMetadataCache,
+		false,
+		PGC_SUSET,
+		GUC_STANDARD,
+		NULL, NULL, NULL);
+
 	DefineCustomBoolVariable(
 		"citus.select_opens_transaction_block",
 		gettext_noop("Open transaction blocks for SELECT commands"),
@@ -695,6 +820,23 @@ RegisterCitusConfigVariables(void)
 		GUC_UNIT_MS | GUC_NO_SHOW_ALL,
 		NULL, NULL, NULL);
 
+	DefineCustomIntVariable(
+		"citus.sequential_command_batch_size",
+		gettext_noop("Sets the number of commands sent to a worker node at once "
+					 "in sequential mode"),
+		gettext_noop("When citus.multi_shard_modify_mode is set to sequential, "
+					 "the executor uses a single connection per worker node and "
+					 "normally waits for the result of each command before "
+					 "sending the next one. When this setting is larger than 1, "
+					 "the commands of up to this many shard modifications are "
+					 "sent over the connection in a single round trip, which "
+					 "reduces the impact of network latency."),
+		&SequentialCommandBatchSize,
+		1, 1, INT_MAX,
+		PGC_USERSET,
+		GUC_NO_SHOW_ALL,
+		NULL, NULL, NULL);
+
 	DefineCustomBoolVariable(
 		"citus.enable_deadlock_prevention",
 		gettext_noop("Avoids deadlocks by preventing concurrent multi-shard commands"),
@@ -720,6 +862,23 @@ RegisterCitusConfigVariables(void)
 		GUC_STANDARD,
 		NULL, NULL, NULL);
 
+	DefineCustomBoolVariable(
+		"citus.enable_distributed_analyze",
+		gettext_noop("Merges the statistics of the shards into statistics for "
+					 "distributed tables on ANALYZE"),
+		gettext_noop("When enabled, ANALYZE on a distributed table fetches the "
+					 "statistics that were computed on each of its shards and "
+					 "stores the combined row count, null fraction, width, "
+					 "number of distinct values, most common values and "
+					 "histograms for the distributed table, such that the "
+					 "coordinator planner and the join order planner can use "
+					 "them."),
+		&EnableDistributedAnalyze,
+		false,
+		PGC_USERSET,
+		GUC_STANDARD,
+		NULL, NULL, NULL);
+
 	DefineCustomBoolVariable(
 		"citus.enable_object_propagation",
 		gettext_noop("Enables propagating object creation for more complex objects, "
@@ -825,6 +984,35 @@ RegisterCitusConfigVariables(void)
 		GUC_NO_SHOW_ALL,
 		NULL, NULL, NULL);
 
+	DefineCustomBoolVariable(
+		"citus.enable_semi_join_reduction",
+		gettext_noop("Filters recursively planned subqueries by the join keys of "
+					 "intermediate results and reference tables they are joined with."),
+		gettext_noop("When a subquery that is not co-located with the rest of the "
+					 "query is recursively planned, only the rows that have a match "
+					 "in the already available side of an inner join are included "
+					 "in its intermediate result."),
+		&EnableSemiJoinReduction,
+		false,
+		PGC_USERSET,
+		GUC_STANDARD,
+		NULL, NULL, NULL);
+
+	DefineCustomIntVariable(
+		"citus.broadcast_join_threshold",
+		gettext_noop("Sets the maximum size in KB of a distributed table that is "
+					 "broadcast for a join that is not on the distribution column."),
+		gettext_noop("When a query joins distributed tables on columns other than "
+					 "their distribution columns, the tables that are smaller than "
+					 "this threshold are sent to all workers as intermediate results "
+					 "instead of repartitioning the tables. Table sizes are taken from "
+					 "the shard statistics in the metadata. 0 disables broadcasting."),
+		&BroadcastJoinThreshold,
+		0, 0, MAX_KILOBYTES,
+		PGC_USERSET,
+		GUC_UNIT_KB | GUC_STANDARD,
+		NULL, NULL, NULL);
+
 	DefineCustomIntVariable(
 		"citus.max_intermediate_result_size",
 		gettext_noop("Sets the maximum size of the intermediate results in KB for "
@@ -854,6 +1042,37 @@ RegisterCitusConfigVariables(void)
 		GUC_STANDARD,
 		NULL, NULL, NULL);
 
+	DefineCustomIntVariable(
+		"citus.max_index_builds_per_node",
+		gettext_noop("Sets the maximum number of shard indexes that are built "
+					 "concurrently on a worker node."),
+		gettext_noop("Building an index on a shard can use up to "
+					 "maintenance_work_mem on the worker. When creating an index on "
+					 "a distributed table, this setting limits the number of shard "
+					 "indexes that are built at the same time on each worker. Shards "
+					 "with a larger size in the metadata are built first. 0 means "
+					 "the limit of citus.max_adaptive_executor_pool_size applies."),
+		&MaxIndexBuildsPerNode,
+		0, 0, INT_MAX,
+		PGC_USERSET,
+		GUC_STANDARD,
+		NULL, NULL, NULL);
+
+	DefineCustomIntVariable(
+		"citus.max_shard_column_ranges",
+		gettext_noop("Sets the maximum number of shard column ranges that are "
+					 "kept in shared memory."),
+		gettext_noop("The coordinator keeps the minimum and maximum values of "
+					 "the tracked columns of every shard in shared memory, to "
+					 "skip shards that cannot match a query. This setting "
+					 "limits the number of shard and column pairs, 0 disables "
+					 "the shard column ranges."),
+		&MaxShardColumnRanges,
+		0, 0, INT_MAX / 2,
+		PGC_POSTMASTER,
+		GUC_STANDARD,
+		NULL, NULL, NULL);
+
 	DefineCustomIntVariable(
 		"citus.max_worker_nodes_tracked",
 		gettext_noop("Sets the maximum number of worker nodes that are tracked."),
@@ -1002,6 +1221,37 @@ RegisterCitusConfigVariables(void)
 		GUC_STANDARD,
 		NULL, NULL, NULL);
 
+	DefineCustomBoolVariable(
+		"citus.enable_coordinator_distinct_aggregates",
+		gettext_noop("Enables aggregate (distinct) on non-partition columns by "
+					 "evaluating the aggregate on the coordinator."),
+		gettext_noop("Aggregates such as sum(distinct) and avg(distinct) on columns "
+					 "other than the partition column are evaluated the same way as "
+					 "count(distinct): the workers group by the column, such that "
+					 "each distinct value is sent only once per shard, and the "
+					 "coordinator computes the exact aggregate over these values."),
+		&EnableCoordinatorDistinctAggregates,
+		false,
+		PGC_USERSET,
+		GUC_STANDARD,
+		NULL, NULL, NULL);
+
+	DefineCustomIntVariable(
+		"citus.multi_row_insert_copy_threshold",
+		gettext_noop("Sets the number of rows from which multi-row INSERTs are "
+					 "copied into the shards."),
+		gettext_noop("Multi-row INSERTs without ON CONFLICT or RETURNING that have "
+					 "at least this many rows are evaluated on the coordinator and "
+					 "sent to each shard as a single COPY, in binary format when "
+					 "possible, instead of as an INSERT with a VALUES list. "
+					 "This avoids deparsing and parsing large VALUES lists. "
+					 "A value of 0 disables this."),
+		&MultiRowInsertCopyThreshold,
+		0, 0, INT_MAX,
+		PGC_USERSET,
+		GUC_STANDARD,
+		NULL, NULL, NULL);
+
 	DefineCustomEnumVariable(
 		"citus.multi_shard_commit_protocol",
 		gettext_noop("Sets the commit protocol for commands modifying multiple shards."),
@@ -1031,6 +1281,21 @@ RegisterCitusConfigVariables(void)
 		GUC_NO_SHOW_ALL,
 		NULL, NULL, NULL);
 
+	DefineCustomBoolVariable(
+		"citus.prefer_one_phase_commit",
+		gettext_noop("Uses one-phase commit for transactions in which only a single "
+					 "connection modified data."),
+		gettext_noop("Transactions that touch multiple nodes are committed with "
+					 "two-phase commit. When enabled, such transactions use a plain "
+					 "commit if, at commit time, only a single remote connection "
+					 "modified shard placements and the local node did not write "
+					 "anything."),
+		&PreferOnePhaseCommit,
+		false,
+		PGC_USERSET,
+		GUC_STANDARD,
+		NULL, NULL, NULL);
+
 	DefineCustomEnumVariable(
 		"citus.task_assignment_policy",
 		gettext_noop("Sets the policy to use when assigning tasks to worker nodes."),
@@ -1089,6 +1354,34 @@ RegisterCitusConfigVariables(void)
 		GUC_STANDARD,
 		NULL, NULL, NULL);
 
+	DefineCustomBoolVariable(
+		"citus.enable_repartitioned_insert_select",
+		gettext_noop("Enables repartitioning INSERT ... SELECT results on the workers."),
+		gettext_noop("When the SELECT in an INSERT ... SELECT cannot be pushed down "
+					 "to the target shards, its results are normally collected on the "
+					 "coordinator. When enabled, the results of the SELECT tasks are "
+					 "instead partitioned on the workers and moved directly to the "
+					 "workers that hold the target shards."),
+		&EnableRepartitionedInsertSelect,
+		false,
+		PGC_USERSET,
+		GUC_STANDARD,
+		NULL, NULL, NULL);
+
+	DefineCustomBoolVariable(
+		"citus.enable_coordinator_window_functions",
+		gettext_noop("Enables evaluating window functions on the coordinator when "
+					 "they cannot be pushed down to the workers."),
+		gettext_noop("Window functions that are not partitioned by the distribution "
+					 "column are computed on the coordinator after pulling the "
+					 "columns they refer to from the workers. Since this requires "
+					 "fetching all matching rows, it is disabled by default."),
+		&EnableCoordinatorWindowFunctions,
+		false,
+		PGC_USERSET,
+		GUC_STANDARD,
+		NULL, NULL, NULL);
+
 	DefineCustomEnumVariable(
 		"citus.shard_placement_policy",
 		gettext_noop("Sets the policy to use when choosing nodes for shard placement."),
@@ -15,6 +15,46 @@ COMMENT ON COLUMN pg_catalog.pg_dist_node.shouldhaveshards IS
 UPDATE pg_dist_colocation SET replicationfactor = -1 WHERE distributioncolumntype = 0;
 
 #include "udfs/any_value/9.1-1.sql"
+#include "udfs/citus_coordinated_transaction_stats/9.1-1.sql"
+#include "udfs/get_transaction_recovery_progress/9.1-1.sql"
+#include "udfs/read_intermediate_results/9.1-1.sql"
+#include "udfs/fetch_intermediate_results/9.1-1.sql"
+#include "udfs/worker_partition_query_result/9.1-1.sql"
+#include "udfs/get_index_build_progress/9.1-1.sql"
+#include "udfs/citus_update_shard_sizes/9.1-1.sql"
+#include "udfs/citus_add_shard_range_column/9.1-1.sql"
+#include "udfs/citus_remove_shard_range_column/9.1-1.sql"
+#include "udfs/citus_update_shard_column_ranges/9.1-1.sql"
+#include "udfs/citus_shard_column_ranges/9.1-1.sql"
+
+-- log of the metadata changes that out of sync metadata nodes missed
+CREATE SEQUENCE citus.pg_dist_metadata_change_changeid_seq
+    NO CYCLE;
+ALTER SEQUENCE citus.pg_dist_metadata_change_changeid_seq SET SCHEMA pg_catalog;
+
+CREATE TABLE citus.pg_dist_metadata_change (
+    groupid int NOT NULL,
+    changeid bigint NOT NULL,
+    command text NOT NULL
+);
+
+CREATE UNIQUE INDEX pg_dist_metadata_change_group_index
+ON citus.pg_dist_metadata_change using btree(groupid, changeid);
+
+ALTER TABLE citus.pg_dist_metadata_change SET SCHEMA pg_catalog;
+GRANT SELECT ON pg_catalog.pg_dist_metadata_change TO public;
+
+-- columns of which the coordinator tracks the value range in every shard
+CREATE TABLE citus.pg_dist_shard_range_column (
+    logicalrelid regclass NOT NULL,
+    attnum int2 NOT NULL
+);
+
+CREATE UNIQUE INDEX pg_dist_shard_range_column_index
+ON citus.pg_dist_shard_range_column using btree(logicalrelid, attnum);
+
+ALTER TABLE citus.pg_dist_shard_range_column SET SCHEMA pg_catalog;
+GRANT SELECT ON pg_catalog.pg_dist_shard_range_column TO public;
 
 -- drop function which was used for upgrading from 6.0
 -- creation was removed from citus--7.0-1.sql
@@ -0,0 +1,13 @@
+CREATE OR REPLACE FUNCTION pg_catalog.citus_coordinated_transaction_stats(
+    OUT one_phase_commits bigint,
+    OUT two_phase_commits bigint,
+    OUT avoided_two_phase_commits bigint)
+    RETURNS record
+    LANGUAGE C STRICT
+    AS 'MODULE_PATHNAME', $$citus_coordinated_transaction_stats$$;
+
+COMMENT ON FUNCTION pg_catalog.citus_coordinated_transaction_stats(
+    OUT one_phase_commits bigint,
+    OUT two_phase_commits bigint,
+    OUT avoided_two_phase_commits bigint)
+    IS 'returns the number of coordinated transactions committed with 1PC and 2PC';
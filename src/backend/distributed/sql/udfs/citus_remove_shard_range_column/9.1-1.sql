@@ -0,0 +1,9 @@
+CREATE OR REPLACE FUNCTION pg_catalog.citus_remove_shard_range_column(table_name regclass,
+                                                                      column_name text)
+    RETURNS void
+    LANGUAGE C STRICT
+    AS 'MODULE_PATHNAME', $$citus_remove_shard_range_column$$;
+
+COMMENT ON FUNCTION pg_catalog.citus_remove_shard_range_column(table_name regclass,
+                                                               column_name text)
+    IS 'stops tracking the range of the values of the column in every shard of the table';
@@ -0,0 +1,19 @@
+CREATE OR REPLACE FUNCTION pg_catalog.citus_shard_column_ranges(
+    OUT shardid bigint,
+    OUT table_name regclass,
+    OUT column_name text,
+    OUT min_value text,
+    OUT max_value text,
+    OUT is_current boolean)
+    RETURNS SETOF record
+    LANGUAGE C STRICT
+    AS 'MODULE_PATHNAME', $$citus_shard_column_ranges$$;
+
+COMMENT ON FUNCTION pg_catalog.citus_shard_column_ranges(
+    OUT shardid bigint,
+    OUT table_name regclass,
+    OUT column_name text,
+    OUT min_value text,
+    OUT max_value text,
+    OUT is_current boolean)
+    IS 'returns the ranges of the tracked columns in every shard';
@@ -0,0 +1,9 @@
+CREATE OR REPLACE FUNCTION pg_catalog.citus_update_shard_column_ranges()
+    RETURNS bigint
+    LANGUAGE C STRICT
+    AS 'MODULE_PATHNAME', $$citus_update_shard_column_ranges$$;
+
+COMMENT ON FUNCTION pg_catalog.citus_update_shard_column_ranges()
+    IS 'refreshes the ranges of the tracked columns in every shard';
+
+REVOKE ALL ON FUNCTION pg_catalog.citus_update_shard_column_ranges() FROM PUBLIC;
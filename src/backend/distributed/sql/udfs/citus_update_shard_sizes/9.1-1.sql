@@ -0,0 +1,9 @@
+CREATE OR REPLACE FUNCTION pg_catalog.citus_update_shard_sizes()
+    RETURNS void
+    LANGUAGE C STRICT
+    AS 'MODULE_PATHNAME', $$citus_update_shard_sizes$$;
+
+COMMENT ON FUNCTION pg_catalog.citus_update_shard_sizes()
+    IS 'updates the sizes of the shard placements of hash-distributed tables';
+
+REVOKE ALL ON FUNCTION pg_catalog.citus_update_shard_sizes() FROM PUBLIC;
@@ -0,0 +1,10 @@
+CREATE OR REPLACE FUNCTION pg_catalog.fetch_intermediate_results(
+    result_ids text[],
+    node_name text,
+    node_port int)
+    RETURNS bigint
+    LANGUAGE C STRICT VOLATILE
+    AS 'MODULE_PATHNAME', $$fetch_intermediate_results$$;
+
+COMMENT ON FUNCTION pg_catalog.fetch_intermediate_results(text[], text, int)
+    IS 'fetch the intermediate results with the given IDs from a remote node';
@@ -0,0 +1,19 @@
+CREATE OR REPLACE FUNCTION pg_catalog.get_index_build_progress(
+    OUT pid integer,
+    OUT shardid bigint,
+    OUT shard_size bigint,
+    OUT placement_count integer,
+    OUT finished_placement_count integer,
+    OUT status text)
+    RETURNS SETOF record
+    LANGUAGE C STRICT
+    AS 'MODULE_PATHNAME', $$get_index_build_progress$$;
+
+COMMENT ON FUNCTION pg_catalog.get_index_build_progress(
+    OUT pid integer,
+    OUT shardid bigint,
+    OUT shard_size bigint,
+    OUT placement_count integer,
+    OUT finished_placement_count integer,
+    OUT status text)
+    IS 'provides progress information about the ongoing distributed index builds';
@@ -0,0 +1,17 @@
+CREATE OR REPLACE FUNCTION pg_catalog.get_transaction_recovery_progress(
+    OUT pid integer,
+    OUT nodename text,
+    OUT nodeport integer,
+    OUT prepared_transactions bigint,
+    OUT recovered_transactions bigint)
+    RETURNS SETOF record
+    LANGUAGE C STRICT
+    AS 'MODULE_PATHNAME', $$get_transaction_recovery_progress$$;
+
+COMMENT ON FUNCTION pg_catalog.get_transaction_recovery_progress(
+    OUT pid integer,
+    OUT nodename text,
+    OUT nodeport integer,
+    OUT prepared_transactions bigint,
+    OUT recovered_transactions bigint)
+    IS 'provides progress information about the ongoing transaction recoveries';
@@ -0,0 +1,18 @@
+CREATE OR REPLACE FUNCTION pg_catalog.worker_partition_query_result(
+    result_prefix text,
+    query text,
+    partition_column_index int,
+    partition_method citus.distribution_type,
+    split_point_min_values text[],
+    split_point_max_values text[],
+    OUT partition_index int,
+    OUT rows_written bigint,
+    OUT bytes_written bigint)
+    RETURNS SETOF record
+    LANGUAGE C STRICT VOLATILE
+    AS 'MODULE_PATHNAME', $$worker_partition_query_result$$;
+
+COMMENT ON FUNCTION pg_catalog.worker_partition_query_result(text, text, int,
+                                                             citus.distribution_type,
+                                                             text[], text[])
+    IS 'execute a query and partition its results into a set of intermediate results';
@@ -60,6 +60,13 @@ typedef struct BackendManagementShmemData
 	 */
 	pg_atomic_uint64 nextTransactionNumber;
 
+	/* number of coordinated transactions committed with each commit protocol */
+	pg_atomic_uint64 onePhaseCommitCount;
+	pg_atomic_uint64 twoPhaseCommitCount;
+
+	/* number of one-phase commits of transactions that had asked for 2PC */
+	pg_atomic_uint64 avoidedTwoPhaseCommitCount;
+
 	BackendData backends[FLEXIBLE_ARRAY_MEMBER];
 } BackendManagementShmemData;
 
@@ -80,6 +87,7 @@ PG_FUNCTION_INFO_V1(assign_distributed_transaction_id);
 PG_FUNCTION_INFO_V1(get_current_transaction_id);
 PG_FUNCTION_INFO_V1(get_global_active_transactions);
 PG_FUNCTION_INFO_V1(get_all_active_transactions);
+PG_FUNCTION_INFO_V1(citus_coordinated_transaction_stats);
 
 
 /*
@@ -509,6 +517,10 @@ BackendManagementShmemInit(void)
 		/* start the distributed transaction ids from 1 */
 		pg_atomic_init_u64(&backendManagementShmemData->nextTransactionNumber, 1);
 
+		pg_atomic_init_u64(&backendManagementShmemData->onePhaseCommitCount, 0);
+		pg_atomic_init_u64(&backendManagementShmemData->twoPhaseCommitCount, 0);
+		pg_atomic_init_u64(&backendManagementShmemData->avoidedTwoPhaseCommitCount, 0);
+
 		/*
 		 * We need to init per backend's spinlock before any backend
 		 * starts its execution. Note that we initialize TotalProcs (e.g., not
@@ -729,6 +741,68 @@ GetCurrentDistributedTransactionId(void)
 }
 
 
+/*
+ * citus_coordinated_transaction_stats returns the number of coordinated
+ * transactions that have been committed with one-phase and two-phase commit
+ * on this node since the server started. It also returns how many of the
+ * one-phase commits were transactions that asked for 2PC, but ended up
+ * modifying data over a single connection.
+ */
+Datum
+citus_coordinated_transaction_stats(PG_FUNCTION_ARGS)
+{
+	TupleDesc tupleDescriptor = NULL;
+	Datum values[3];
+	bool isNulls[3];
+	HeapTuple heapTuple = NULL;
+
+	CheckCitusVersion(ERROR);
+
+	if (get_call_result_type(fcinfo, NULL, &tupleDescriptor) != TYPEFUNC_COMPOSITE)
+	{
+		elog(ERROR, "return type must be a row type");
+	}
+
+	memset(values, 0, sizeof(values));
+	memset(isNulls, false, sizeof(isNulls));
+
+	values[0] = Int64GetDatum(
+		pg_atomic_read_u64(&backendManagementShmemData->onePhaseCommitCount));
+	values[1] = Int64GetDatum(
+		pg_atomic_read_u64(&backendManagementShmemData->twoPhaseCommitCount));
+	values[2] = Int64GetDatum(
+		pg_atomic_read_u64(&backendManagementShmemData->avoidedTwoPhaseCommitCount));
+
+	heapTuple = heap_form_tuple(tupleDescriptor, values, isNulls);
+
+	PG_RETURN_DATUM(HeapTupleGetDatum(heapTuple));
+}
+
+
+/*
+ * RecordCoordinatedTransactionCommit increments the shared commit counters
+ * of coordinated transactions, see citus_coordinated_transaction_stats().
+ */
+void
+RecordCoordinatedTransactionCommit(bool usedTwoPhaseCommit, bool avoidedTwoPhaseCommit)
+{
+	if (usedTwoPhaseCommit)
+	{
+		pg_atomic_fetch_add_u64(&backendManagementShmemData->twoPhaseCommitCount, 1);
+	}
+	else
+	{
+		pg_atomic_fetch_add_u64(&backendManagementShmemData->onePhaseCommitCount, 1);
+	}
+
+	if (avoidedTwoPhaseCommit)
+	{
+		pg_atomic_fetch_add_u64(&backendManagementShmemData->avoidedTwoPhaseCommitCount,
+								1);
+	}
+}
+
+
 /*
  * AssignDistributedTransactionId generates a new distributed transaction id and
  * sets it for the current backend. It also sets the databaseId and
@@ -26,6 +26,7 @@
 #include "distributed/transaction_identifier.h"
 #include "nodes/pg_list.h"
 #include "utils/hsearch.h"
+#include "utils/memutils.h"
 #include "utils/timestamp.h"
 
 
@@ -38,9 +39,27 @@ typedef struct QueuedTransactionNode
 } QueuedTransactionNode;
 
 
+/* identifies a wait edge between two distributed transactions */
+typedef struct WaitEdgeKey
+{
+	DistributedTransactionId waitingTransactionId;
+	DistributedTransactionId blockingTransactionId;
+} WaitEdgeKey;
+
+
 /* GUC, determining whether debug messages for deadlock detection sent to LOG */
 bool LogDistributedDeadlockDetection = false;
 
+/* GUC, determining whether cycles are only searched in changed components */
+bool EnableIncrementalDeadlockDetection = true;
+
+/*
+ * Wait edges seen by the last deadlock detection run of this backend that
+ * completed without finding a deadlock, NULL if there is no such run.
+ */
+static HTAB *PreviousWaitEdgeHash = NULL;
+static MemoryContext PreviousWaitGraphContext = NULL;
+
 
 static bool CheckDeadlockForTransactionNode(TransactionNode *startingTransactionNode,
 											int maxStackDepth,
@@ -52,6 +71,11 @@ static void BuildDeadlockPathList(QueuedTransactionNode *cycledTransactionNode,
 								  TransactionNode **transactionNodeStack,
 								  List **deadlockPath);
 static void ResetVisitedFields(HTAB *adjacencyList);
+static void MarkComponentsWithNewWaitEdges(WaitGraph *waitGraph, HTAB *adjacencyList);
+static TransactionNode * FindComponentRoot(TransactionNode *transactionNode);
+static void BuildWaitEdgeKey(WaitEdge *edge, WaitEdgeKey *edgeKey);
+static void RememberWaitGraph(WaitGraph *waitGraph);
+static void ForgetPreviousWaitGraph(void);
 static bool AssociateDistributedTransactionWithBackendProc(TransactionNode *
 														   transactionNode);
 static TransactionNode * GetOrCreateTransactionNode(HTAB *adjacencyList,
@@ -97,6 +121,12 @@ check_distributed_deadlocks(PG_FUNCTION_ARGS)
  * transaction that's checked for deadlocks. Note that there exists
  *  0 to MaxBackends number of transactions.
  *
+ * A new deadlock always contains at least one wait edge that did not exist
+ * in the previous run. Hence, when citus.enable_incremental_deadlock_detection
+ * is on, we only start the search from the transactions in the connected
+ * components of the wait graph that have new edges. Most wait edges are
+ * long-lived on a busy cluster, so this skips the majority of the searches.
+ *
  * The function returns true if a deadlock is found. Otherwise, returns
  * false.
  */
@@ -110,6 +140,8 @@ CheckForDistributedDeadlocks(void)
 	int edgeCount = 0;
 	int localGroupId = GetLocalGroupId();
 	List *workerNodeList = ActiveReadableNodeList();
+	bool incrementalSearch = false;
+	bool uncancelledDeadlockFound = false;
 
 	/*
 	 * We don't need to do any distributed deadlock checking if there
@@ -127,6 +159,13 @@ CheckForDistributedDeadlocks(void)
 
 	edgeCount = waitGraph->edgeCount;
 
+	incrementalSearch = EnableIncrementalDeadlockDetection &&
+						PreviousWaitEdgeHash != NULL;
+	if (incrementalSearch)
+	{
+		MarkComponentsWithNewWaitEdges(waitGraph, adjacencyLists);
+	}
+
 	/*
 	 * We iterate on transaction nodes and search for deadlocks where the
 	 * starting node is the given transaction node.
@@ -149,6 +188,13 @@ CheckForDistributedDeadlocks(void)
 			continue;
 		}
 
+		/* cycles in unchanged components have already been searched */
+		if (incrementalSearch &&
+			!FindComponentRoot(transactionNode)->componentHasNewWaitEdge)
+		{
+			continue;
+		}
+
 		ResetVisitedFields(adjacencyLists);
 
 		deadlockFound = CheckDeadlockForTransactionNode(transactionNode,
@@ -217,11 +263,29 @@ CheckForDistributedDeadlocks(void)
 
 				hash_seq_term(&status);
 
+				/* we did not search the remaining transactions, do a full run next */
+				ForgetPreviousWaitGraph();
+
 				return true;
 			}
+
+			uncancelledDeadlockFound = true;
 		}
 	}
 
+	/*
+	 * Remember the wait edges only if every cycle in the graph has been handled,
+	 * otherwise the next run could skip a deadlock whose edges are all old.
+	 */
+	if (EnableIncrementalDeadlockDetection && !uncancelledDeadlockFound)
+	{
+		RememberWaitGraph(waitGraph);
+	}
+	else
+	{
+		ForgetPreviousWaitGraph();
+	}
+
 	return false;
 }
 
@@ -366,6 +430,143 @@ ResetVisitedFields(HTAB *adjacencyList)
 }
 
 
+/*
+ * MarkComponentsWithNewWaitEdges groups the transaction nodes of the adjacency
+ * list into weakly connected components using union-find, and then marks the
+ * components that contain a wait edge which was not in the previous wait graph.
+ */
+static void
+MarkComponentsWithNewWaitEdges(WaitGraph *waitGraph, HTAB *adjacencyList)
+{
+	int edgeIndex = 0;
+	int edgeCount = waitGraph->edgeCount;
+
+	for (edgeIndex = 0; edgeIndex < edgeCount; edgeIndex++)
+	{
+		WaitEdge *edge = &waitGraph->edges[edgeIndex];
+		WaitEdgeKey edgeKey;
+		TransactionNode *waitingRoot = NULL;
+		TransactionNode *blockingRoot = NULL;
+		bool foundEdge = false;
+
+		BuildWaitEdgeKey(edge, &edgeKey);
+
+		waitingRoot = FindComponentRoot((TransactionNode *) hash_search(
+											adjacencyList,
+											&edgeKey.waitingTransactionId,
+											HASH_FIND, NULL));
+		blockingRoot = FindComponentRoot((TransactionNode *) hash_search(
+											 adjacencyList,
+											 &edgeKey.blockingTransactionId,
+											 HASH_FIND, NULL));
+
+		if (waitingRoot != blockingRoot)
+		{
+			waitingRoot->componentParent = blockingRoot;
+			blockingRoot->componentHasNewWaitEdge |=
+				waitingRoot->componentHasNewWaitEdge;
+		}
+
+		hash_search(PreviousWaitEdgeHash, &edgeKey, HASH_FIND, &foundEdge);
+		if (!foundEdge)
+		{
+			blockingRoot->componentHasNewWaitEdge = true;
+		}
+	}
+}
+
+
+/*
+ * FindComponentRoot returns the root of the union-find tree of the given
+ * transaction node, and halves the path to the root on the way.
+ */
+static TransactionNode *
+FindComponentRoot(TransactionNode *transactionNode)
+{
+	while (transactionNode->componentParent != transactionNode)
+	{
+		transactionNode->componentParent =
+			transactionNode->componentParent->componentParent;
+		transactionNode = transactionNode->componentParent;
+	}
+
+	return transactionNode;
+}
+
+
+/*
+ * BuildWaitEdgeKey fills the hash key of the given wait edge. The key is zeroed
+ * first since it is hashed as a blob, including the padding bytes.
+ */
+static void
+BuildWaitEdgeKey(WaitEdge *edge, WaitEdgeKey *edgeKey)
+{
+	memset(edgeKey, 0, sizeof(WaitEdgeKey));
+
+	edgeKey->waitingTransactionId.initiatorNodeIdentifier = edge->waitingNodeId;
+	edgeKey->waitingTransactionId.transactionNumber = edge->waitingTransactionNum;
+	edgeKey->waitingTransactionId.timestamp = edge->waitingTransactionStamp;
+
+	edgeKey->blockingTransactionId.initiatorNodeIdentifier = edge->blockingNodeId;
+	edgeKey->blockingTransactionId.transactionNumber = edge->blockingTransactionNum;
+	edgeKey->blockingTransactionId.timestamp = edge->blockingTransactionStamp;
+}
+
+
+/*
+ * RememberWaitGraph replaces the wait edges of the previous run with the edges
+ * of the given wait graph, such that the next run can find the new edges.
+ */
+static void
+RememberWaitGraph(WaitGraph *waitGraph)
+{
+	HASHCTL info;
+	int edgeIndex = 0;
+
+	ForgetPreviousWaitGraph();
+
+	if (PreviousWaitGraphContext == NULL)
+	{
+		PreviousWaitGraphContext = AllocSetContextCreate(TopMemoryContext,
+														 "Previous Wait Graph Context",
+														 ALLOCSET_DEFAULT_SIZES);
+	}
+
+	memset(&info, 0, sizeof(info));
+	info.keysize = sizeof(WaitEdgeKey);
+	info.entrysize = sizeof(WaitEdgeKey);
+	info.hcxt = PreviousWaitGraphContext;
+
+	PreviousWaitEdgeHash = hash_create("previous wait edges",
+									   Max(waitGraph->edgeCount, 32), &info,
+									   HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+
+	for (edgeIndex = 0; edgeIndex < waitGraph->edgeCount; edgeIndex++)
+	{
+		WaitEdgeKey edgeKey;
+
+		BuildWaitEdgeKey(&waitGraph->edges[edgeIndex], &edgeKey);
+		hash_search(PreviousWaitEdgeHash, &edgeKey, HASH_ENTER, NULL);
+	}
+}
+
+
+/*
+ * ForgetPreviousWaitGraph drops the wait edges of the previous run, such that
+ * the next run searches the whole wait graph.
+ */
+static void
+ForgetPreviousWaitGraph(void)
+{
+	if (PreviousWaitGraphContext != NULL)
+	{
+		MemoryContextReset(PreviousWaitGraphContext);
+	}
+
+	PreviousWaitEdgeHash = NULL;
+}
+
+
 /*
  * AssociateDistributedTransactionWithBackendProc gets a transaction node
  * and searches the corresponding backend. Once found, transactionNodes'
@@ -521,6 +722,8 @@ GetOrCreateTransactionNode(HTAB *adjacencyList, DistributedTransactionId *transa
 	{
 		transactionNode->waitsFor = NIL;
 		transactionNode->initiatorProc = NULL;
+		transactionNode->componentParent = transactionNode;
+		transactionNode->componentHasNewWaitEdge = false;
 	}
 
 	return transactionNode;
@@ -45,6 +45,7 @@ static void FinishRemoteTransactionSavepointRollback(MultiConnection *connection
 													 SubTransactionId subId);
 
 static void Assign2PCIdentifier(MultiConnection *connection);
+static void SendRemoteTransactionPrepare(MultiConnection *connection);
 static void WarnAboutLeakedPreparedTransaction(MultiConnection *connection, bool commit);
 
 
@@ -472,11 +473,35 @@ RemoteTransactionAbort(MultiConnection *connection)
  */
 void
 StartRemoteTransactionPrepare(struct MultiConnection *connection)
+{
+	RemoteTransaction *transaction = &connection->remoteTransaction;
+	WorkerNode *workerNode = NULL;
+
+	Assign2PCIdentifier(connection);
+
+	/* log transactions to workers in pg_dist_transaction */
+	workerNode = FindWorkerNode(connection->hostname, connection->port);
+	if (workerNode != NULL)
+	{
+		LogTransactionRecord(workerNode->groupId, transaction->preparedName);
+	}
+
+	SendRemoteTransactionPrepare(connection);
+}
+
+
+/*
+ * SendRemoteTransactionPrepare sends PREPARE TRANSACTION over the connection
+ * in a non-blocking manner, using the 2PC identifier that has already been
+ * assigned to the transaction. It is the caller's responsibility to log the
+ * transaction in pg_dist_transaction before the local transaction commits.
+ */
+static void
+SendRemoteTransactionPrepare(MultiConnection *connection)
 {
 	RemoteTransaction *transaction = &connection->remoteTransaction;
 	StringInfoData command;
 	const bool raiseErrors = true;
-	WorkerNode *workerNode = NULL;
 
 	/* can't prepare a nonexistant transaction */
 	Assert(transaction->transactionState != REMOTE_TRANS_INVALID);
@@ -487,14 +512,7 @@ StartRemoteTransactionPrepare(struct MultiConnection *connection)
 	/* can't prepare if already started to prepare/abort/commit */
 	Assert(transaction->transactionState < REMOTE_TRANS_PREPARING);
 
-	Assign2PCIdentifier(connection);
-
-	/* log transactions to workers in pg_dist_transaction */
-	workerNode = FindWorkerNode(connection->hostname, connection->port);
-	if (workerNode != NULL)
-	{
-		LogTransactionRecord(workerNode->groupId, transaction->preparedName);
-	}
+	Assert(transaction->preparedName[0] != '\0');
 
 	initStringInfo(&command);
 	appendStringInfo(&command, "PREPARE TRANSACTION %s",
@@ -793,6 +811,12 @@ ResetRemoteTransaction(struct MultiConnection *connection)
 /*
  * CoordinatedRemoteTransactionsPrepare PREPAREs a 2PC transaction on all
  * non-failed transactions participating in the coordinated transaction.
+ *
+ * The PREPARE TRANSACTION commands are sent to all nodes first, and the
+ * transactions are logged in pg_dist_transaction in a single batch while the
+ * workers are preparing. The records only need to be in place before the local
+ * transaction commits, so there is no need to write them before sending the
+ * commands.
  */
 void
 CoordinatedRemoteTransactionsPrepare(void)
@@ -800,6 +824,8 @@ CoordinatedRemoteTransactionsPrepare(void)
 	dlist_iter iter;
 	bool raiseInterrupts = false;
 	List *connectionList = NIL;
+	List *groupIdList = NIL;
+	List *transactionNameList = NIL;
 
 	/* issue PREPARE TRANSACTION; to all relevant remote nodes */
 
@@ -809,6 +835,7 @@ CoordinatedRemoteTransactionsPrepare(void)
 		MultiConnection *connection = dlist_container(MultiConnection, transactionNode,
 													  iter.cur);
 		RemoteTransaction *transaction = &connection->remoteTransaction;
+		WorkerNode *workerNode = NULL;
 
 		Assert(transaction->transactionState != REMOTE_TRANS_INVALID);
 
@@ -818,10 +845,23 @@ CoordinatedRemoteTransactionsPrepare(void)
 			continue;
 		}
 
-		StartRemoteTransactionPrepare(connection);
+		Assign2PCIdentifier(connection);
+
+		workerNode = FindWorkerNode(connection->hostname, connection->port);
+		if (workerNode != NULL)
+		{
+			groupIdList = lappend_int(groupIdList, workerNode->groupId);
+			transactionNameList = lappend(transactionNameList,
+										  transaction->preparedName);
+		}
+
+		SendRemoteTransactionPrepare(connection);
 		connectionList = lappend(connectionList, connection);
 	}
 
+	/* log transactions to workers in pg_dist_transaction */
+	LogTransactionRecordList(groupIdList, transactionNameList);
+
 	raiseInterrupts = true;
 	WaitForAllConnections(connectionList, raiseInterrupts);
 
@@ -27,6 +27,7 @@
 #include "distributed/multi_executor.h"
 #include "distributed/transaction_management.h"
 #include "distributed/placement_connection.h"
+#include "distributed/shard_column_ranges.h"
 #include "distributed/subplan_execution.h"
 #include "distributed/version_compat.h"
 #include "utils/hsearch.h"
@@ -42,6 +43,13 @@ int MultiShardCommitProtocol = COMMIT_PROTOCOL_2PC;
 int SingleShardCommitProtocol = COMMIT_PROTOCOL_2PC;
 int SavedMultiShardCommitProtocol = COMMIT_PROTOCOL_BARE;
 
+/*
+ * GUC that determines whether a coordinated transaction that requested 2PC via
+ * CoordinatedTransactionShouldUse2PC() should use 1PC if it turns out that only
+ * a single remote connection modified data.
+ */
+bool PreferOnePhaseCommit = false;
+
 /*
  * GUC that determines whether a SELECT in a transaction block should also run in
  * a transaction block on the worker even if no writes have occurred yet.
@@ -91,6 +99,13 @@ MemoryContext CommitContext = NULL;
  */
 bool CoordinatedTransactionUses2PC = false;
 
+/*
+ * Set by CoordinatedTransactionUse2PC() when 2PC must be used regardless of the
+ * number of connections that modified data, e.g. for commands sent outside of
+ * the shard placement connection tracking.
+ */
+static bool CoordinatedTransactionRequires2PC = false;
+
 /* if disabled, distributed statements in a function may run as separate transactions */
 bool FunctionOpensTransactionBlock = true;
 
@@ -110,6 +125,7 @@ static void AdjustMaxPreparedTransactions(void);
 static void PushSubXact(SubTransactionId subId);
 static void PopSubXact(SubTransactionId subId);
 static void SwallowErrors(void (*func)());
+static bool CoordinatedTransactionHasSingleWriter(void);
 
 
 /*
@@ -149,6 +165,23 @@ CoordinatedTransactionUse2PC(void)
 {
 	Assert(InCoordinatedTransaction());
 
+	CoordinatedTransactionUses2PC = true;
+	CoordinatedTransactionRequires2PC = true;
+}
+
+
+/*
+ * CoordinatedTransactionShouldUse2PC() signals that the current coordinated
+ * transaction should use 2PC to commit, unless citus.prefer_one_phase_commit is
+ * enabled and it turns out at commit time that only a single connection
+ * modified shard placements. The callers should only rely on the placement
+ * connection tracking to find out which connections modified data.
+ */
+void
+CoordinatedTransactionShouldUse2PC(void)
+{
+	Assert(InCoordinatedTransaction());
+
 	CoordinatedTransactionUses2PC = true;
 }
 
@@ -236,6 +269,9 @@ CoordinatedTransactionCallback(XactEvent event, void *arg)
 				CoordinatedRemoteTransactionsCommit();
 			}
 
+			/* the writes of the transaction are now visible on the workers */
+			PublishShardModifications();
+
 			/* close connections etc. */
 			if (CurrentCoordinatedTransactionState != COORD_TRANS_NONE)
 			{
@@ -245,10 +281,11 @@ CoordinatedTransactionCallback(XactEvent event, void *arg)
 
 			CurrentCoordinatedTransactionState = COORD_TRANS_NONE;
 			XactModificationLevel = XACT_MODIFICATION_NONE;
-			LocalExecutionHappened = false;
+			ResetLocalExecutionState();
 			dlist_init(&InProgressTransactions);
 			activeSetStmts = NULL;
 			CoordinatedTransactionUses2PC = false;
+			CoordinatedTransactionRequires2PC = false;
 
 			UnSetDistributedTransactionId();
 
@@ -290,6 +327,8 @@ CoordinatedTransactionCallback(XactEvent event, void *arg)
 				CoordinatedRemoteTransactionsAbort();
 			}
 
+			PublishShardModifications();
+
 			/* close connections etc. */
 			if (CurrentCoordinatedTransactionState != COORD_TRANS_NONE)
 			{
@@ -299,10 +338,11 @@ CoordinatedTransactionCallback(XactEvent event, void *arg)
 
 			CurrentCoordinatedTransactionState = COORD_TRANS_NONE;
 			XactModificationLevel = XACT_MODIFICATION_NONE;
-			LocalExecutionHappened = false;
+			ResetLocalExecutionState();
 			dlist_init(&InProgressTransactions);
 			activeSetStmts = NULL;
 			CoordinatedTransactionUses2PC = false;
+			CoordinatedTransactionRequires2PC = false;
 			FunctionCallLevel = 0;
 
 			/*
@@ -340,12 +380,16 @@ CoordinatedTransactionCallback(XactEvent event, void *arg)
 			 */
 			RemoveIntermediateResultsDirectory();
 
+			PublishShardModifications();
+
 			UnSetDistributedTransactionId();
 			break;
 		}
 
 		case XACT_EVENT_PRE_COMMIT:
 		{
+			bool avoidedTwoPhaseCommit = false;
+
 			/*
 			 * If the distributed query involves 2PC, we already removed
 			 * the intermediate result directory on XACT_EVENT_PREPARE. However,
@@ -377,6 +421,17 @@ CoordinatedTransactionCallback(XactEvent event, void *arg)
 			 */
 			MarkFailedShardPlacements();
 
+			if (CoordinatedTransactionUses2PC && !CoordinatedTransactionRequires2PC &&
+				PreferOnePhaseCommit && CoordinatedTransactionHasSingleWriter())
+			{
+				/* a single writer commits atomically without 2PC */
+				CoordinatedTransactionUses2PC = false;
+				avoidedTwoPhaseCommit = true;
+			}
+
+			RecordCoordinatedTransactionCommit(CoordinatedTransactionUses2PC,
+											   avoidedTwoPhaseCommit);
+
 			if (CoordinatedTransactionUses2PC)
 			{
 				CoordinatedRemoteTransactionsPrepare();
@@ -612,6 +667,45 @@ ActiveSubXactContexts(void)
 }
 
 
+/*
+ * CoordinatedTransactionHasSingleWriter returns true if at most one of the
+ * remote transactions that are part of the coordinated transaction modified
+ * shard placements, and the local transaction did not write anything. In that
+ * case committing the single remote transaction in PRE_COMMIT is atomic, and
+ * there is no need for 2PC.
+ */
+static bool
+CoordinatedTransactionHasSingleWriter(void)
+{
+	dlist_iter iter;
+	int modifyingConnectionCount = 0;
+
+	/* local writes (e.g., via local execution) have to commit with the remote one */
+	if (TransactionIdIsValid(GetTopTransactionIdIfAny()))
+	{
+		return false;
+	}
+
+	dlist_foreach(iter, &InProgressTransactions)
+	{
+		MultiConnection *connection = dlist_container(MultiConnection, transactionNode,
+													  iter.cur);
+
+		if (ConnectionModifiedPlacement(connection))
+		{
+			modifyingConnectionCount++;
+		}
+
+		if (modifyingConnectionCount > 1)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
 /*
  * If an ERROR is thrown while processing a transaction the ABORT handler is called.
  * ERRORS thrown during ABORT are not treated any differently, the ABORT handler is also
@@ -31,9 +31,12 @@
 #include "distributed/connection_management.h"
 #include "distributed/listutils.h"
 #include "distributed/metadata_cache.h"
+#include "distributed/multi_progress.h"
 #include "distributed/pg_dist_transaction.h"
 #include "distributed/remote_commands.h"
+#include "distributed/shard_column_ranges.h"
 #include "distributed/transaction_recovery.h"
+#include "distributed/tuplestore.h"
 #include "distributed/worker_manager.h"
 #include "distributed/version_compat.h"
 #include "lib/stringinfo.h"
@@ -45,17 +48,72 @@
 #include "utils/rel.h"
 
 
+/* pg_dist_transaction record of a prepared transaction */
+typedef struct TransactionRecord
+{
+	char *transactionName;
+	ItemPointerData recordTid;
+} TransactionRecord;
+
+
+/* COMMIT/ROLLBACK PREPARED command for a prepared transaction on a worker */
+typedef struct PreparedTransactionResolution
+{
+	char *command;
+	bool shouldCommit;
+
+	/* pg_dist_transaction record to delete once the commit succeeds */
+	ItemPointerData recordTid;
+} PreparedTransactionResolution;
+
+
+/*
+ * WorkerRecoveryState keeps the state of the transaction recovery on a single
+ * worker, such that all workers can be recovered concurrently.
+ */
+typedef struct WorkerRecoveryState
+{
+	WorkerNode *workerNode;
+	MultiConnection *connection;
+
+	/* prepared transactions before and after the pg_dist_transaction snapshot */
+	HTAB *pendingTransactionSet;
+	HTAB *recheckTransactionSet;
+
+	/* pg_dist_transaction records of the worker */
+	List *transactionRecordList;
+
+	/* commands to send to the worker, commits first */
+	List *resolutionList;
+	ListCell *nextResolutionCell;
+
+	/* progress of the worker in the progress monitor, if any */
+	TransactionRecoveryProgress *progress;
+
+	bool recoveryFailed;
+} WorkerRecoveryState;
+
+
 /* exports for SQL callable functions */
 PG_FUNCTION_INFO_V1(recover_prepared_transactions);
+PG_FUNCTION_INFO_V1(get_transaction_recovery_progress);
 
 
 /* Local functions forward declarations */
-static int RecoverWorkerTransactions(WorkerNode *workerNode);
-static List * PendingWorkerTransactionList(MultiConnection *connection);
+static List * StartWorkerRecoveryList(List *workerList);
+static void FetchPendingWorkerTransactions(List *recoveryStateList, bool recheck);
+static List * WorkerTransactionRecordList(Relation pgDistTransaction, int32 groupId);
+static void PlanWorkerTransactionRecovery(WorkerRecoveryState *recoveryState,
+										  Relation pgDistTransaction,
+										  HTAB *activeTransactionNumberSet);
+static PreparedTransactionResolution * BuildPreparedTransactionResolution(
+	char *transactionName, bool shouldCommit);
+static int ResolvePreparedTransactions(List *recoveryStateList,
+									   Relation pgDistTransaction);
+static ProgressMonitorData * CreateTransactionRecoveryProgressMonitor(
+	List *recoveryStateList);
 static bool IsTransactionInProgress(HTAB *activeTransactionNumberSet,
 									char *preparedTransactionName);
-static bool RecoverPreparedTransactionOnWorker(MultiConnection *connection,
-											   char *transactionName, bool shouldCommit);
 
 
 /*
@@ -75,6 +133,59 @@ recover_prepared_transactions(PG_FUNCTION_ARGS)
 }
 
 
+/*
+ * get_transaction_recovery_progress returns the progress of the ongoing
+ * transaction recoveries, with a row for each worker that is being recovered.
+ */
+Datum
+get_transaction_recovery_progress(PG_FUNCTION_ARGS)
+{
+	TupleDesc tupleDescriptor = NULL;
+	Tuplestorestate *tupleStore = NULL;
+	List *attachedDSMSegments = NIL;
+	List *monitorList = NIL;
+	ListCell *monitorCell = NULL;
+
+	CheckCitusVersion(ERROR);
+
+	tupleStore = SetupTuplestore(fcinfo, &tupleDescriptor);
+	monitorList = ProgressMonitorList(TRANSACTION_RECOVERY_PROGRESS_MAGIC_NUMBER,
+									  &attachedDSMSegments);
+
+	foreach(monitorCell, monitorList)
+	{
+		ProgressMonitorData *monitor = (ProgressMonitorData *) lfirst(monitorCell);
+		TransactionRecoveryProgress *progressArray =
+			(TransactionRecoveryProgress *) monitor->steps;
+		int stepIndex = 0;
+
+		for (stepIndex = 0; stepIndex < monitor->stepCount; stepIndex++)
+		{
+			TransactionRecoveryProgress *progress = &progressArray[stepIndex];
+			Datum values[5];
+			bool isNulls[5];
+
+			memset(values, 0, sizeof(values));
+			memset(isNulls, false, sizeof(isNulls));
+
+			values[0] = Int32GetDatum(monitor->processId);
+			values[1] = CStringGetTextDatum(progress->nodeName);
+			values[2] = Int32GetDatum(progress->nodePort);
+			values[3] = Int64GetDatum(progress->preparedTransactionCount);
+			values[4] = Int64GetDatum(progress->recoveredTransactionCount);
+
+			tuplestore_putvalues(tupleStore, tupleDescriptor, values, isNulls);
+		}
+	}
+
+	tuplestore_donestoring(tupleStore);
+
+	DetachFromDSMSegments(attachedDSMSegments);
+
+	return (Datum) 0;
+}
+
+
 /*
  * LogTransactionRecord registers the fact that a transaction has been
  * prepared on a worker. The presence of this record indicates that the
@@ -82,27 +193,63 @@ recover_prepared_transactions(PG_FUNCTION_ARGS)
  */
 void
 LogTransactionRecord(int32 groupId, char *transactionName)
+{
+	LogTransactionRecordList(list_make1_int(groupId), list_make1(transactionName));
+}
+
+
+/*
+ * LogTransactionRecordList registers a batch of prepared transactions in
+ * pg_dist_transaction, the i-th transaction name in transactionNameList
+ * belongs to the i-th group in groupIdList. The catalog and its indexes are
+ * opened only once for the whole batch. Since the records are written as part
+ * of the local transaction, they become durable with the single commit record
+ * of the local transaction.
+ */
+void
+LogTransactionRecordList(List *groupIdList, List *transactionNameList)
 {
 	Relation pgDistTransaction = NULL;
 	TupleDesc tupleDescriptor = NULL;
-	HeapTuple heapTuple = NULL;
-	Datum values[Natts_pg_dist_transaction];
-	bool isNulls[Natts_pg_dist_transaction];
+	CatalogIndexState indexState = NULL;
+	ListCell *groupIdCell = NULL;
+	ListCell *transactionNameCell = NULL;
 
-	/* form new transaction tuple */
-	memset(values, 0, sizeof(values));
-	memset(isNulls, false, sizeof(isNulls));
+	Assert(list_length(groupIdList) == list_length(transactionNameList));
 
-	values[Anum_pg_dist_transaction_groupid - 1] = Int32GetDatum(groupId);
-	values[Anum_pg_dist_transaction_gid - 1] = CStringGetTextDatum(transactionName);
+	if (groupIdList == NIL)
+	{
+		return;
+	}
 
-	/* open transaction relation and insert new tuple */
+	/* open transaction relation and insert new tuples */
 	pgDistTransaction = heap_open(DistTransactionRelationId(), RowExclusiveLock);
-
 	tupleDescriptor = RelationGetDescr(pgDistTransaction);
-	heapTuple = heap_form_tuple(tupleDescriptor, values, isNulls);
+	indexState = CatalogOpenIndexes(pgDistTransaction);
+
+	forboth(groupIdCell, groupIdList, transactionNameCell, transactionNameList)
+	{
+		int32 groupId = lfirst_int(groupIdCell);
+		char *transactionName = (char *) lfirst(transactionNameCell);
+		HeapTuple heapTuple = NULL;
+		Datum values[Natts_pg_dist_transaction];
+		bool isNulls[Natts_pg_dist_transaction];
+
+		/* form new transaction tuple */
+		memset(values, 0, sizeof(values));
+		memset(isNulls, false, sizeof(isNulls));
 
-	CatalogTupleInsert(pgDistTransaction, heapTuple);
+		values[Anum_pg_dist_transaction_groupid - 1] = Int32GetDatum(groupId);
+		values[Anum_pg_dist_transaction_gid - 1] = CStringGetTextDatum(transactionName);
+
+		heapTuple = heap_form_tuple(tupleDescriptor, values, isNulls);
+
+		CatalogTupleInsertWithInfo(pgDistTransaction, heapTuple, indexState);
+
+		heap_freetuple(heapTuple);
+	}
+
+	CatalogCloseIndexes(indexState);
 
 	CommandCounterIncrement();
 
@@ -114,74 +261,40 @@ LogTransactionRecord(int32 groupId, char *transactionName)
 /*
  * RecoverTwoPhaseCommits recovers any pending prepared
  * transactions started by this node on other nodes.
+ *
+ * The recovery runs against all workers concurrently: the lists of prepared
+ * transactions are fetched from all workers at once and the resolutions are
+ * sent to all workers at once, such that the time it takes to recover a large
+ * number of prepared transactions does not grow with the number of workers.
  */
 int
 RecoverTwoPhaseCommits(void)
 {
 	List *workerList = NIL;
-	ListCell *workerNodeCell = NULL;
+	List *recoveryStateList = NIL;
+	ListCell *recoveryStateCell = NULL;
 	int recoveredTransactionCount = 0;
 
-	workerList = ActivePrimaryNodeList(NoLock);
-
-	foreach(workerNodeCell, workerList)
-	{
-		WorkerNode *workerNode = (WorkerNode *) lfirst(workerNodeCell);
-
-		recoveredTransactionCount += RecoverWorkerTransactions(workerNode);
-	}
-
-	return recoveredTransactionCount;
-}
-
-
-/*
- * RecoverWorkerTransactions recovers any pending prepared transactions
- * started by this node on the specified worker.
- */
-static int
-RecoverWorkerTransactions(WorkerNode *workerNode)
-{
-	int recoveredTransactionCount = 0;
-
-	int32 groupId = workerNode->groupId;
-	char *nodeName = workerNode->workerName;
-	int nodePort = workerNode->workerPort;
-
 	List *activeTransactionNumberList = NIL;
 	HTAB *activeTransactionNumberSet = NULL;
 
-	List *pendingTransactionList = NIL;
-	HTAB *pendingTransactionSet = NULL;
-	List *recheckTransactionList = NIL;
-	HTAB *recheckTransactionSet = NULL;
-
 	Relation pgDistTransaction = NULL;
-	SysScanDesc scanDescriptor = NULL;
-	ScanKeyData scanKey[1];
-	int scanKeyCount = 1;
-	bool indexOK = true;
-	HeapTuple heapTuple = NULL;
-	TupleDesc tupleDescriptor = NULL;
-
-	HASH_SEQ_STATUS status;
+	ProgressMonitorData *monitor = NULL;
 
 	MemoryContext localContext = NULL;
 	MemoryContext oldContext = NULL;
-	bool recoveryFailed = false;
 
-	int connectionFlags = 0;
-	MultiConnection *connection = GetNodeConnection(connectionFlags, nodeName, nodePort);
-	if (connection->pgConn == NULL || PQstatus(connection->pgConn) != CONNECTION_OK)
+	workerList = ActivePrimaryNodeList(NoLock);
+	if (workerList == NIL)
 	{
-		ereport(WARNING, (errmsg("transaction recovery cannot connect to %s:%d",
-								 nodeName, nodePort)));
-
 		return 0;
 	}
 
+	/* recover the workers in a consistent order */
+	workerList = SortList(workerList, CompareWorkerNodes);
+
 	localContext = AllocSetContextCreateExtended(CurrentMemoryContext,
-												 "RecoverWorkerTransactions",
+												 "RecoverTwoPhaseCommits",
 												 ALLOCSET_DEFAULT_MINSIZE,
 												 ALLOCSET_DEFAULT_INITSIZE,
 												 ALLOCSET_DEFAULT_MAXSIZE);
@@ -190,10 +303,11 @@ RecoverWorkerTransactions(WorkerNode *workerNode)
 
 	/* take table lock first to avoid running concurrently */
 	pgDistTransaction = heap_open(DistTransactionRelationId(), ShareUpdateExclusiveLock);
-	tupleDescriptor = RelationGetDescr(pgDistTransaction);
+
+	recoveryStateList = StartWorkerRecoveryList(workerList);
 
 	/*
-	 * We're going to check the list of prepared transactions on the worker,
+	 * We're going to check the list of prepared transactions on the workers,
 	 * but some of those prepared transactions might belong to ongoing
 	 * distributed transactions.
 	 *
@@ -222,41 +336,279 @@ RecoverWorkerTransactions(WorkerNode *workerNode)
 	 * We therefore observe the set of prepared transactions one more time in
 	 * step 4. The aforementioned transactions would show up in Q, but not in
 	 * P. We can skip those transactions and recover them later.
+	 *
+	 * Each step is done for all workers before moving on to the next step,
+	 * which preserves the order of the steps for every worker.
 	 */
 
-	/* find stale prepared transactions on the remote node */
-	pendingTransactionList = PendingWorkerTransactionList(connection);
-	pendingTransactionSet = ListToHashSet(pendingTransactionList, NAMEDATALEN, true);
+	/* find stale prepared transactions on the remote nodes */
+	FetchPendingWorkerTransactions(recoveryStateList, false);
 
 	/* find in-progress distributed transactions */
 	activeTransactionNumberList = ActiveDistributedTransactionNumbers();
 	activeTransactionNumberSet = ListToHashSet(activeTransactionNumberList,
 											   sizeof(uint64), false);
 
+	/* get a snapshot of pg_dist_transaction for each worker */
+	foreach(recoveryStateCell, recoveryStateList)
+	{
+		WorkerRecoveryState *recoveryState =
+			(WorkerRecoveryState *) lfirst(recoveryStateCell);
+
+		recoveryState->transactionRecordList =
+			WorkerTransactionRecordList(pgDistTransaction,
+										recoveryState->workerNode->groupId);
+	}
+
+	/* find stale prepared transactions on the remote nodes once more */
+	FetchPendingWorkerTransactions(recoveryStateList, true);
+
+	foreach(recoveryStateCell, recoveryStateList)
+	{
+		WorkerRecoveryState *recoveryState =
+			(WorkerRecoveryState *) lfirst(recoveryStateCell);
+
+		PlanWorkerTransactionRecovery(recoveryState, pgDistTransaction,
+									  activeTransactionNumberSet);
+	}
+
+	monitor = CreateTransactionRecoveryProgressMonitor(recoveryStateList);
+
+	recoveredTransactionCount = ResolvePreparedTransactions(recoveryStateList,
+															pgDistTransaction);
+
+	heap_close(pgDistTransaction, NoLock);
+
+	/* report the final progress of each worker */
+	foreach(recoveryStateCell, recoveryStateList)
+	{
+		WorkerRecoveryState *recoveryState =
+			(WorkerRecoveryState *) lfirst(recoveryStateCell);
+		TransactionRecoveryProgress *progress = recoveryState->progress;
+
+		if (progress == NULL)
+		{
+			continue;
+		}
+
+		ereport(DEBUG1, (errmsg("transaction recovery on %s:%d recovered "
+								UINT64_FORMAT " of " UINT64_FORMAT
+								" prepared transactions",
+								progress->nodeName, progress->nodePort,
+								progress->recoveredTransactionCount,
+								progress->preparedTransactionCount)));
+	}
+
+	if (monitor != NULL)
+	{
+		FinalizeCurrentProgressMonitor();
+	}
+
+	MemoryContextSwitchTo(oldContext);
+	MemoryContextDelete(localContext);
+
+	return recoveredTransactionCount;
+}
+
+
+/*
+ * StartWorkerRecoveryList establishes connections to the given workers in
+ * parallel, and returns the recovery states of the workers that we could
+ * connect to. Workers that we cannot connect to are skipped with a warning.
+ */
+static List *
+StartWorkerRecoveryList(List *workerList)
+{
+	List *recoveryStateList = NIL;
+	List *connectionList = NIL;
+	ListCell *workerNodeCell = NULL;
+	ListCell *connectionCell = NULL;
+
+	foreach(workerNodeCell, workerList)
+	{
+		WorkerNode *workerNode = (WorkerNode *) lfirst(workerNodeCell);
+		int connectionFlags = 0;
+		MultiConnection *connection = StartNodeConnection(connectionFlags,
+														  workerNode->workerName,
+														  workerNode->workerPort);
+
+		connectionList = lappend(connectionList, connection);
+	}
+
+	FinishConnectionListEstablishment(connectionList);
+
+	forboth(workerNodeCell, workerList, connectionCell, connectionList)
+	{
+		WorkerNode *workerNode = (WorkerNode *) lfirst(workerNodeCell);
+		MultiConnection *connection = (MultiConnection *) lfirst(connectionCell);
+		WorkerRecoveryState *recoveryState = NULL;
+
+		if (connection->pgConn == NULL || PQstatus(connection->pgConn) != CONNECTION_OK)
+		{
+			ereport(WARNING, (errmsg("transaction recovery cannot connect to %s:%d",
+									 workerNode->workerName,
+									 workerNode->workerPort)));
+
+			continue;
+		}
+
+		recoveryState = palloc0(sizeof(WorkerRecoveryState));
+		recoveryState->workerNode = workerNode;
+		recoveryState->connection = connection;
+
+		recoveryStateList = lappend(recoveryStateList, recoveryState);
+	}
+
+	return recoveryStateList;
+}
+
+
+/*
+ * FetchPendingWorkerTransactions fetches the prepared transactions started by
+ * this node from all workers in the recovery state list concurrently. The
+ * transactions are stored in the pending transaction set of the workers, or in
+ * the recheck transaction set if recheck is true.
+ */
+static void
+FetchPendingWorkerTransactions(List *recoveryStateList, bool recheck)
+{
+	StringInfo command = makeStringInfo();
+	ListCell *recoveryStateCell = NULL;
+	bool raiseInterrupts = true;
+	int coordinatorId = GetLocalGroupId();
+
+	appendStringInfo(command, "SELECT gid FROM pg_prepared_xacts "
+							  "WHERE gid LIKE 'citus\\_%d\\_%%'",
+					 coordinatorId);
+
+	foreach(recoveryStateCell, recoveryStateList)
+	{
+		WorkerRecoveryState *recoveryState =
+			(WorkerRecoveryState *) lfirst(recoveryStateCell);
+		MultiConnection *connection = recoveryState->connection;
+
+		int querySent = SendRemoteCommand(connection, command->data);
+		if (querySent == 0)
+		{
+			ReportConnectionError(connection, ERROR);
+		}
+	}
+
+	foreach(recoveryStateCell, recoveryStateList)
+	{
+		WorkerRecoveryState *recoveryState =
+			(WorkerRecoveryState *) lfirst(recoveryStateCell);
+		MultiConnection *connection = recoveryState->connection;
+		List *transactionNames = NIL;
+		HTAB *transactionSet = NULL;
+		PGresult *result = NULL;
+		int rowCount = 0;
+		int rowIndex = 0;
+
+		result = GetRemoteCommandResult(connection, raiseInterrupts);
+		if (!IsResponseOK(result))
+		{
+			ReportResultError(connection, result, ERROR);
+		}
+
+		rowCount = PQntuples(result);
+
+		for (rowIndex = 0; rowIndex < rowCount; rowIndex++)
+		{
+			const int columnIndex = 0;
+			char *transactionName = PQgetvalue(result, rowIndex, columnIndex);
+
+			transactionNames = lappend(transactionNames, pstrdup(transactionName));
+		}
+
+		PQclear(result);
+		ForgetResults(connection);
+
+		transactionSet = ListToHashSet(transactionNames, NAMEDATALEN, true);
+
+		if (recheck)
+		{
+			recoveryState->recheckTransactionSet = transactionSet;
+		}
+		else
+		{
+			recoveryState->pendingTransactionSet = transactionSet;
+		}
+	}
+}
+
+
+/*
+ * WorkerTransactionRecordList returns the pg_dist_transaction records of the
+ * given group, as seen by a new snapshot of pg_dist_transaction.
+ */
+static List *
+WorkerTransactionRecordList(Relation pgDistTransaction, int32 groupId)
+{
+	List *transactionRecordList = NIL;
+	SysScanDesc scanDescriptor = NULL;
+	ScanKeyData scanKey[1];
+	int scanKeyCount = 1;
+	bool indexOK = true;
+	HeapTuple heapTuple = NULL;
+	TupleDesc tupleDescriptor = RelationGetDescr(pgDistTransaction);
+
 	/* scan through all recovery records of the current worker */
 	ScanKeyInit(&scanKey[0], Anum_pg_dist_transaction_groupid,
 				BTEqualStrategyNumber, F_INT4EQ, Int32GetDatum(groupId));
 
-	/* get a snapshot of pg_dist_transaction */
 	scanDescriptor = systable_beginscan(pgDistTransaction,
 										DistTransactionGroupIndexId(), indexOK,
 										NULL, scanKeyCount, scanKey);
 
-	/* find stale prepared transactions on the remote node */
-	recheckTransactionList = PendingWorkerTransactionList(connection);
-	recheckTransactionSet = ListToHashSet(recheckTransactionList, NAMEDATALEN, true);
-
 	while (HeapTupleIsValid(heapTuple = systable_getnext(scanDescriptor)))
 	{
 		bool isNull = false;
-		bool isTransactionInProgress = false;
-		bool foundPreparedTransactionBeforeCommit = false;
-		bool foundPreparedTransactionAfterCommit = false;
+		TransactionRecord *transactionRecord = palloc0(sizeof(TransactionRecord));
 
 		Datum transactionNameDatum = heap_getattr(heapTuple,
 												  Anum_pg_dist_transaction_gid,
 												  tupleDescriptor, &isNull);
-		char *transactionName = TextDatumGetCString(transactionNameDatum);
+
+		transactionRecord->transactionName = TextDatumGetCString(transactionNameDatum);
+		transactionRecord->recordTid = heapTuple->t_self;
+
+		transactionRecordList = lappend(transactionRecordList, transactionRecord);
+	}
+
+	systable_endscan(scanDescriptor);
+
+	return transactionRecordList;
+}
+
+
+/*
+ * PlanWorkerTransactionRecovery compares the prepared transactions on the
+ * worker with its pg_dist_transaction records, and builds the list of
+ * prepared transactions to commit or abort on the worker. Records that do not
+ * have a prepared transaction are deleted right away.
+ */
+static void
+PlanWorkerTransactionRecovery(WorkerRecoveryState *recoveryState,
+							  Relation pgDistTransaction,
+							  HTAB *activeTransactionNumberSet)
+{
+	HTAB *pendingTransactionSet = recoveryState->pendingTransactionSet;
+	HTAB *recheckTransactionSet = recoveryState->recheckTransactionSet;
+	List *commitResolutionList = NIL;
+	List *abortResolutionList = NIL;
+	ListCell *transactionRecordCell = NULL;
+	char *pendingTransactionName = NULL;
+	HASH_SEQ_STATUS status;
+
+	foreach(transactionRecordCell, recoveryState->transactionRecordList)
+	{
+		TransactionRecord *transactionRecord =
+			(TransactionRecord *) lfirst(transactionRecordCell);
+		char *transactionName = transactionRecord->transactionName;
+		bool isTransactionInProgress = false;
+		bool foundPreparedTransactionBeforeCommit = false;
+		bool foundPreparedTransactionAfterCommit = false;
 
 		isTransactionInProgress = IsTransactionInProgress(activeTransactionNumberSet,
 														  transactionName);
@@ -284,33 +636,20 @@ RecoverWorkerTransactions(WorkerNode *workerNode)
 		{
 			/*
 			 * The transaction was committed, but the prepared transaction still exists
-			 * on the worker. Try committing it.
+			 * on the worker. Try committing it, and delete the recovery record once
+			 * the commit succeeds.
 			 *
 			 * We double check that the recovery record exists both before and after
 			 * checking ActiveDistributedTransactionNumbers(), since we may have
 			 * observed a prepared transaction that was committed immediately after.
 			 */
 			bool shouldCommit = true;
-			bool commitSucceeded = RecoverPreparedTransactionOnWorker(connection,
-																	  transactionName,
-																	  shouldCommit);
-			if (!commitSucceeded)
-			{
-				/*
-				 * Failed to commit on the current worker. Stop without throwing
-				 * an error to allow recover_prepared_transactions to continue with
-				 * other workers.
-				 */
-				recoveryFailed = true;
-				break;
-			}
+			PreparedTransactionResolution *resolution =
+				BuildPreparedTransactionResolution(transactionName, shouldCommit);
 
-			recoveredTransactionCount++;
+			resolution->recordTid = transactionRecord->recordTid;
 
-			/*
-			 * We successfully committed the prepared transaction, safe to delete
-			 * the recovery record.
-			 */
+			commitResolutionList = lappend(commitResolutionList, resolution);
 		}
 		else if (foundPreparedTransactionAfterCommit)
 		{
@@ -353,105 +692,242 @@ RecoverWorkerTransactions(WorkerNode *workerNode)
 			 * transactions that committed at an earlier time, in which case it's
 			 * safe delete the recovery record as well.
 			 */
+			simple_heap_delete(pgDistTransaction, &transactionRecord->recordTid);
 		}
+	}
 
-		simple_heap_delete(pgDistTransaction, &heapTuple->t_self);
+	/*
+	 * All remaining prepared transactions that are not part of an in-progress
+	 * distributed transaction should be aborted since we did not find a recovery
+	 * record, which implies the disributed transaction aborted.
+	 */
+	hash_seq_init(&status, pendingTransactionSet);
+
+	while ((pendingTransactionName = hash_seq_search(&status)) != NULL)
+	{
+		bool isTransactionInProgress = false;
+		bool shouldCommit = false;
+
+		isTransactionInProgress = IsTransactionInProgress(activeTransactionNumberSet,
+														  pendingTransactionName);
+		if (isTransactionInProgress)
+		{
+			continue;
+		}
+
+		abortResolutionList =
+			lappend(abortResolutionList,
+					BuildPreparedTransactionResolution(pendingTransactionName,
+													   shouldCommit));
 	}
 
-	systable_endscan(scanDescriptor);
-	heap_close(pgDistTransaction, NoLock);
+	/* aborts are only sent once all the commits on the worker succeeded */
+	recoveryState->resolutionList = list_concat(commitResolutionList,
+												abortResolutionList);
+	recoveryState->nextResolutionCell = list_head(recoveryState->resolutionList);
+}
+
 
-	if (!recoveryFailed)
+/*
+ * BuildPreparedTransactionResolution returns the resolution that commits or
+ * aborts the given prepared transaction.
+ */
+static PreparedTransactionResolution *
+BuildPreparedTransactionResolution(char *transactionName, bool shouldCommit)
+{
+	PreparedTransactionResolution *resolution =
+		palloc0(sizeof(PreparedTransactionResolution));
+	StringInfo command = makeStringInfo();
+
+	if (shouldCommit)
+	{
+		/* should have committed this prepared transaction */
+		appendStringInfo(command, "COMMIT PREPARED %s",
+						 quote_literal_cstr(transactionName));
+	}
+	else
 	{
-		char *pendingTransactionName = NULL;
-		bool abortSucceeded = true;
+		/* should have aborted this prepared transaction */
+		appendStringInfo(command, "ROLLBACK PREPARED %s",
+						 quote_literal_cstr(transactionName));
+	}
 
-		/*
-		 * All remaining prepared transactions that are not part of an in-progress
-		 * distributed transaction should be aborted since we did not find a recovery
-		 * record, which implies the disributed transaction aborted.
-		 */
-		hash_seq_init(&status, pendingTransactionSet);
+	resolution->command = command->data;
+	resolution->shouldCommit = shouldCommit;
+	ItemPointerSetInvalid(&resolution->recordTid);
+
+	return resolution;
+}
+
+
+/*
+ * ResolvePreparedTransactions sends the planned COMMIT/ROLLBACK PREPARED
+ * commands to the workers and returns the number of recovered transactions.
+ *
+ * In each round, the next command of every worker is sent before waiting for
+ * any of the results, such that the workers resolve their prepared
+ * transactions concurrently. COMMIT/ROLLBACK PREPARED cannot run in a
+ * transaction block, so the commands on a single connection cannot be
+ * combined into a multi-statement query. When a command fails on a worker,
+ * we stop recovering that worker without throwing an error, to continue with
+ * the other workers.
+ */
+static int
+ResolvePreparedTransactions(List *recoveryStateList, Relation pgDistTransaction)
+{
+	int recoveredTransactionCount = 0;
+	bool resolutionsInProgress = true;
 
-		while ((pendingTransactionName = hash_seq_search(&status)) != NULL)
+	while (resolutionsInProgress)
+	{
+		List *activeStateList = NIL;
+		ListCell *recoveryStateCell = NULL;
+
+		foreach(recoveryStateCell, recoveryStateList)
 		{
-			bool isTransactionInProgress = false;
-			bool shouldCommit = false;
+			WorkerRecoveryState *recoveryState =
+				(WorkerRecoveryState *) lfirst(recoveryStateCell);
+			MultiConnection *connection = recoveryState->connection;
+			PreparedTransactionResolution *resolution = NULL;
+			int querySent = 0;
+
+			if (recoveryState->recoveryFailed ||
+				recoveryState->nextResolutionCell == NULL)
+			{
+				continue;
+			}
+
+			resolution = (PreparedTransactionResolution *)
+						 lfirst(recoveryState->nextResolutionCell);
 
-			isTransactionInProgress = IsTransactionInProgress(activeTransactionNumberSet,
-															  pendingTransactionName);
-			if (isTransactionInProgress)
+			querySent = SendRemoteCommand(connection, resolution->command);
+			if (querySent == 0)
 			{
+				ReportConnectionError(connection, WARNING);
+				recoveryState->recoveryFailed = true;
 				continue;
 			}
 
-			shouldCommit = false;
-			abortSucceeded = RecoverPreparedTransactionOnWorker(connection,
-																pendingTransactionName,
-																shouldCommit);
-			if (!abortSucceeded)
+			activeStateList = lappend(activeStateList, recoveryState);
+		}
+
+		foreach(recoveryStateCell, activeStateList)
+		{
+			WorkerRecoveryState *recoveryState =
+				(WorkerRecoveryState *) lfirst(recoveryStateCell);
+			MultiConnection *connection = recoveryState->connection;
+			PreparedTransactionResolution *resolution =
+				(PreparedTransactionResolution *) lfirst(
+					recoveryState->nextResolutionCell);
+			bool raiseInterrupts = true;
+
+			PGresult *result = GetRemoteCommandResult(connection, raiseInterrupts);
+			if (!IsResponseOK(result))
 			{
-				hash_seq_term(&status);
-				break;
+				ReportResultError(connection, result, WARNING);
+				PQclear(result);
+				ForgetResults(connection);
+
+				recoveryState->recoveryFailed = true;
+				continue;
+			}
+
+			PQclear(result);
+			ClearResults(connection, false);
+
+			ereport(LOG, (errmsg("recovered a prepared transaction on %s:%d",
+								 connection->hostname, connection->port),
+						  errcontext("%s", resolution->command)));
+
+			if (resolution->shouldCommit)
+			{
+				/*
+				 * We successfully committed the prepared transaction, safe to delete
+				 * the recovery record.
+				 */
+				simple_heap_delete(pgDistTransaction, &resolution->recordTid);
+
+				/* we do not know which shards the transaction wrote to */
+				InvalidateShardColumnRanges();
 			}
 
 			recoveredTransactionCount++;
+
+			if (recoveryState->progress != NULL)
+			{
+				recoveryState->progress->recoveredTransactionCount++;
+			}
+
+			recoveryState->nextResolutionCell =
+				lnext(recoveryState->nextResolutionCell);
 		}
-	}
 
-	MemoryContextSwitchTo(oldContext);
-	MemoryContextDelete(localContext);
+		resolutionsInProgress = (activeStateList != NIL);
+	}
 
 	return recoveredTransactionCount;
 }
 
 
 /*
- * PendingWorkerTransactionList returns a list of pending prepared
- * transactions on a remote node that were started by this node.
+ * CreateTransactionRecoveryProgressMonitor creates a progress monitor with a
+ * step for each worker in the recovery state list, which can be observed via
+ * get_transaction_recovery_progress(). Returns NULL if there is nothing to
+ * recover, or if the monitor could not be created.
  */
-static List *
-PendingWorkerTransactionList(MultiConnection *connection)
+static ProgressMonitorData *
+CreateTransactionRecoveryProgressMonitor(List *recoveryStateList)
 {
-	StringInfo command = makeStringInfo();
-	bool raiseInterrupts = true;
-	int querySent = 0;
-	PGresult *result = NULL;
-	int rowCount = 0;
-	int rowIndex = 0;
-	List *transactionNames = NIL;
-	int coordinatorId = GetLocalGroupId();
+	ProgressMonitorData *monitor = NULL;
+	TransactionRecoveryProgress *progressArray = NULL;
+	ListCell *recoveryStateCell = NULL;
+	int workerIndex = 0;
+	bool hasResolutions = false;
 
-	appendStringInfo(command, "SELECT gid FROM pg_prepared_xacts "
-							  "WHERE gid LIKE 'citus\\_%d\\_%%'",
-					 coordinatorId);
+	foreach(recoveryStateCell, recoveryStateList)
+	{
+		WorkerRecoveryState *recoveryState =
+			(WorkerRecoveryState *) lfirst(recoveryStateCell);
+
+		if (recoveryState->resolutionList != NIL)
+		{
+			hasResolutions = true;
+		}
+	}
 
-	querySent = SendRemoteCommand(connection, command->data);
-	if (querySent == 0)
+	if (!hasResolutions)
 	{
-		ReportConnectionError(connection, ERROR);
+		return NULL;
 	}
 
-	result = GetRemoteCommandResult(connection, raiseInterrupts);
-	if (!IsResponseOK(result))
+	monitor = CreateProgressMonitor(TRANSACTION_RECOVERY_PROGRESS_MAGIC_NUMBER,
+									list_length(recoveryStateList),
+									sizeof(TransactionRecoveryProgress),
+									DistTransactionRelationId());
+	if (monitor == NULL)
 	{
-		ReportResultError(connection, result, ERROR);
+		return NULL;
 	}
 
-	rowCount = PQntuples(result);
+	progressArray = (TransactionRecoveryProgress *) monitor->steps;
 
-	for (rowIndex = 0; rowIndex < rowCount; rowIndex++)
+	foreach(recoveryStateCell, recoveryStateList)
 	{
-		const int columnIndex = 0;
-		char *transactionName = PQgetvalue(result, rowIndex, columnIndex);
-
-		transactionNames = lappend(transactionNames, pstrdup(transactionName));
+		WorkerRecoveryState *recoveryState =
+			(WorkerRecoveryState *) lfirst(recoveryStateCell);
+		TransactionRecoveryProgress *progress = &progressArray[workerIndex];
+
+		strlcpy(progress->nodeName, recoveryState->workerNode->workerName,
+				WORKER_LENGTH);
+		progress->nodePort = recoveryState->workerNode->workerPort;
+		progress->preparedTransactionCount = list_length(recoveryState->resolutionList);
+		progress->recoveredTransactionCount = 0;
+
+		recoveryState->progress = progress;
+		workerIndex++;
 	}
 
-	PQclear(result);
-	ForgetResults(connection);
-
-	return transactionNames;
+	return monitor;
 }
 
 
@@ -481,50 +957,3 @@ IsTransactionInProgress(HTAB *activeTransactionNumberSet, char *preparedTransact
 
 	return isTransactionInProgress;
 }
-
-
-/*
- * RecoverPreparedTransactionOnWorker recovers a single prepared transaction over
- * the given connection. If shouldCommit is true we send
- */
-static bool
-RecoverPreparedTransactionOnWorker(MultiConnection *connection, char *transactionName,
-								   bool shouldCommit)
-{
-	StringInfo command = makeStringInfo();
-	PGresult *result = NULL;
-	int executeCommand = 0;
-	bool raiseInterrupts = false;
-
-	if (shouldCommit)
-	{
-		/* should have committed this prepared transaction */
-		appendStringInfo(command, "COMMIT PREPARED %s",
-						 quote_literal_cstr(transactionName));
-	}
-	else
-	{
-		/* should have aborted this prepared transaction */
-		appendStringInfo(command, "ROLLBACK PREPARED %s",
-						 quote_literal_cstr(transactionName));
-	}
-
-	executeCommand = ExecuteOptionalRemoteCommand(connection, command->data, &result);
-	if (executeCommand == QUERY_SEND_FAILED)
-	{
-		return false;
-	}
-	if (executeCommand == RESPONSE_NOT_OKAY)
-	{
-		return false;
-	}
-
-	PQclear(result);
-	ClearResults(connection, raiseInterrupts);
-
-	ereport(LOG, (errmsg("recovered a prepared transaction on %s:%d",
-						 connection->hostname, connection->port),
-				  errcontext("%s", command->data)));
-
-	return true;
-}
@@ -22,6 +22,7 @@
 #include "distributed/connection_management.h"
 #include "distributed/listutils.h"
 #include "distributed/metadata_cache.h"
+#include "distributed/metadata_sync.h"
 #include "distributed/resource_lock.h"
 #include "distributed/remote_commands.h"
 #include "distributed/pg_dist_node.h"
@@ -55,6 +56,12 @@ SendCommandToWorkersAsUser(TargetWorkerSet targetWorkerSet, const char *nodeUser
 	List *workerNodeList = TargetWorkerSetNodeList(targetWorkerSet, ShareLock);
 	ListCell *workerNodeCell = NULL;
 
+	if (targetWorkerSet == WORKERS_WITH_METADATA)
+	{
+		/* the change log is replayed as the extension owner */
+		DropMetadataChangeLogsOfUnsyncedNodes();
+	}
+
 	/* run commands serially */
 	foreach(workerNodeCell, workerNodeList)
 	{
@@ -152,6 +159,12 @@ SendBareCommandListToWorkers(TargetWorkerSet targetWorkerSet, List *commandList)
 	char *nodeUser = CitusExtensionOwnerName();
 	ListCell *commandCell = NULL;
 
+	if (targetWorkerSet == WORKERS_WITH_METADATA)
+	{
+		/* bare commands cannot be replayed in the change log transaction */
+		DropMetadataChangeLogsOfUnsyncedNodes();
+	}
+
 	/* run commands serially */
 	foreach(workerNodeCell, workerNodeList)
 	{
@@ -191,6 +204,12 @@ SendBareOptionalCommandListToWorkersAsUser(TargetWorkerSet targetWorkerSet,
 	ListCell *commandCell = NULL;
 	int maxError = RESPONSE_OKAY;
 
+	if (targetWorkerSet == WORKERS_WITH_METADATA)
+	{
+		/* bare commands cannot be replayed in the change log transaction */
+		DropMetadataChangeLogsOfUnsyncedNodes();
+	}
+
 	/* run commands serially */
 	foreach(workerNodeCell, workerNodeList)
 	{
@@ -241,6 +260,19 @@ SendCommandToWorkersParams(TargetWorkerSet targetWorkerSet, const char *command,
 	List *workerNodeList = TargetWorkerSetNodeList(targetWorkerSet, ShareLock);
 	ListCell *workerNodeCell = NULL;
 
+	/* keep track of the changes that metadata workers which are out of sync miss */
+	if (targetWorkerSet == WORKERS_WITH_METADATA)
+	{
+		if (parameterCount == 0 && strcmp(user, CitusExtensionOwnerName()) == 0)
+		{
+			LogMetadataChangeForUnsyncedNodes(command);
+		}
+		else
+		{
+			DropMetadataChangeLogsOfUnsyncedNodes();
+		}
+	}
+
 	BeginOrContinueCoordinatedTransaction();
 	CoordinatedTransactionUse2PC();
 
@@ -85,6 +85,7 @@ copyJobInfo(Job *newnode, Job *from)
 	COPY_SCALAR_FIELD(requiresMasterEvaluation);
 	COPY_SCALAR_FIELD(deferredPruning);
 	COPY_NODE_FIELD(partitionKeyValue);
+	COPY_NODE_FIELD(localPlannedStatements);
 }
 
 
@@ -121,6 +122,7 @@ CopyNodeDistributedPlan(COPYFUNC_ARGS)
 	COPY_NODE_FIELD(usedSubPlanNodeList);
 
 	COPY_NODE_FIELD(planningError);
+	COPY_SCALAR_FIELD(numberOfTimesExecuted);
 }
 
 
@@ -264,6 +266,7 @@ CopyNodeTask(COPYFUNC_ARGS)
 	COPY_NODE_FIELD(relationRowLockList);
 	COPY_NODE_FIELD(rowValuesLists);
 	COPY_SCALAR_FIELD(partiallyLocalOrRemote);
+	COPY_NODE_FIELD(perPlacementQueryStrings);
 }
 
 
@@ -300,3 +303,18 @@ CopyNodeDeferredErrorMessage(COPYFUNC_ARGS)
 	COPY_SCALAR_FIELD(linenumber);
 	COPY_STRING_FIELD(functionname);
 }
+
+
+void
+CopyNodeLocalPlannedStatement(COPYFUNC_ARGS)
+{
+	DECLARE_FROM_AND_NEW_NODE(LocalPlannedStatement);
+
+	COPY_SCALAR_FIELD(shardId);
+	COPY_SCALAR_FIELD(localGroupId);
+	COPY_STRING_FIELD(queryString);
+	COPY_SCALAR_FIELD(userId);
+	COPY_SCALAR_FIELD(rowSecurity);
+	COPY_SCALAR_FIELD(cacheGeneration);
+	COPY_NODE_FIELD(localPlan);
+}
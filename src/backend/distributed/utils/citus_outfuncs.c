@@ -199,6 +199,7 @@ OutDistributedPlan(OUTFUNC_ARGS)
 	WRITE_NODE_FIELD(usedSubPlanNodeList);
 
 	WRITE_NODE_FIELD(planningError);
+	WRITE_UINT_FIELD(numberOfTimesExecuted);
 }
 
 
@@ -313,6 +314,9 @@ OutMultiExtendedOp(OUTFUNC_ARGS)
 	WRITE_NODE_FIELD(havingQual);
 	WRITE_BOOL_FIELD(hasDistinctOn);
 	WRITE_NODE_FIELD(distinctClause);
+	WRITE_BOOL_FIELD(hasWindowFuncs);
+	WRITE_BOOL_FIELD(onlyPushableWindowFunctions);
+	WRITE_NODE_FIELD(windowClause);
 
 	OutMultiUnaryNodeFields(str, (const MultiUnaryNode *) node);
 }
@@ -328,6 +332,7 @@ OutJobFields(StringInfo str, const Job *node)
 	WRITE_BOOL_FIELD(requiresMasterEvaluation);
 	WRITE_BOOL_FIELD(deferredPruning);
 	WRITE_NODE_FIELD(partitionKeyValue);
+	WRITE_NODE_FIELD(localPlannedStatements);
 }
 
 
@@ -479,6 +484,7 @@ OutTask(OUTFUNC_ARGS)
 	WRITE_NODE_FIELD(relationRowLockList);
 	WRITE_NODE_FIELD(rowValuesLists);
 	WRITE_BOOL_FIELD(partiallyLocalOrRemote);
+	WRITE_NODE_FIELD(perPlacementQueryStrings);
 }
 
 
@@ -517,3 +523,19 @@ OutDeferredErrorMessage(OUTFUNC_ARGS)
 	WRITE_INT_FIELD(linenumber);
 	WRITE_STRING_FIELD(functionname);
 }
+
+
+void
+OutLocalPlannedStatement(OUTFUNC_ARGS)
+{
+	WRITE_LOCALS(LocalPlannedStatement);
+	WRITE_NODE_TYPE("LOCALPLANNEDSTATEMENT");
+
+	WRITE_UINT64_FIELD(shardId);
+	WRITE_UINT_FIELD(localGroupId);
+	WRITE_STRING_FIELD(queryString);
+	WRITE_OID_FIELD(userId);
+	WRITE_BOOL_FIELD(rowSecurity);
+	WRITE_UINT64_FIELD(cacheGeneration);
+	WRITE_NODE_FIELD(localPlan);
+}
@@ -189,6 +189,7 @@ readJobInfo(Job *local_node)
 	READ_BOOL_FIELD(requiresMasterEvaluation);
 	READ_BOOL_FIELD(deferredPruning);
 	READ_NODE_FIELD(partitionKeyValue);
+	READ_NODE_FIELD(localPlannedStatements);
 }
 
 
@@ -227,6 +228,7 @@ ReadDistributedPlan(READFUNC_ARGS)
 	READ_NODE_FIELD(usedSubPlanNodeList);
 
 	READ_NODE_FIELD(planningError);
+	READ_UINT_FIELD(numberOfTimesExecuted);
 
 	READ_DONE();
 }
@@ -395,6 +397,7 @@ ReadTask(READFUNC_ARGS)
 	READ_NODE_FIELD(relationRowLockList);
 	READ_NODE_FIELD(rowValuesLists);
 	READ_BOOL_FIELD(partiallyLocalOrRemote);
+	READ_NODE_FIELD(perPlacementQueryStrings);
 
 	READ_DONE();
 }
@@ -424,6 +427,23 @@ ReadDeferredErrorMessage(READFUNC_ARGS)
 }
 
 
+READFUNC_RET
+ReadLocalPlannedStatement(READFUNC_ARGS)
+{
+	READ_LOCALS(LocalPlannedStatement);
+
+	READ_UINT64_FIELD(shardId);
+	READ_UINT_FIELD(localGroupId);
+	READ_STRING_FIELD(queryString);
+	READ_OID_FIELD(userId);
+	READ_BOOL_FIELD(rowSecurity);
+	READ_UINT64_FIELD(cacheGeneration);
+	READ_NODE_FIELD(localPlan);
+
+	READ_DONE();
+}
+
+
 READFUNC_RET
 ReadUnsupportedCitusNode(READFUNC_ARGS)
 {
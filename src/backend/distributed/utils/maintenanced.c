@@ -35,6 +35,7 @@
 #include "distributed/master_protocol.h"
 #include "distributed/metadata_cache.h"
 #include "distributed/metadata_sync.h"
+#include "distributed/shard_column_ranges.h"
 #include "distributed/statistics_collection.h"
 #include "distributed/transaction_recovery.h"
 #include "distributed/version_compat.h"
@@ -91,6 +92,9 @@ int Recover2PCInterval = 60000;
 int MetadataSyncInterval = 60000;
 int MetadataSyncRetryInterval = 5000;
 
+/* config variable for the shard size update interval, -1 disables updates */
+int ShardSizeUpdateInterval = -1;
+
 static shmem_startup_hook_type prev_shmem_startup_hook = NULL;
 static MaintenanceDaemonControlData *MaintenanceDaemonControl = NULL;
 
@@ -234,6 +238,8 @@ CitusMaintenanceDaemonMain(Datum main_arg)
 	bool retryStatsCollection USED_WITH_LIBCURL_ONLY = false;
 	ErrorContextCallback errorCallback;
 	TimestampTz lastRecoveryTime = 0;
+	TimestampTz lastShardSizeUpdateTime = 0;
+	TimestampTz lastShardColumnRangeUpdateTime = 0;
 	TimestampTz nextMetadataSyncTime = 0;
 
 	/*
@@ -455,6 +461,87 @@ CitusMaintenanceDaemonMain(Datum main_arg)
 			timeout = Min(timeout, Recover2PCInterval);
 		}
 
+		/*
+		 * If enabled, update the shard sizes in pg_dist_placement on the
+		 * coordinator.
+		 */
+		if (ShardSizeUpdateInterval > 0 && !RecoveryInProgress() &&
+			TimestampDifferenceExceeds(lastShardSizeUpdateTime, GetCurrentTimestamp(),
+									   ShardSizeUpdateInterval))
+		{
+			uint64 updatedPlacementCount = 0;
+
+			InvalidateMetadataSystemCache();
+			StartTransactionCommand();
+
+			if (!LockCitusExtension())
+			{
+				ereport(DEBUG1, (errmsg("could not lock the citus extension, "
+										"skipping shard size update")));
+			}
+			else if (CheckCitusVersion(DEBUG1) && CitusHasBeenLoaded() &&
+					 IsCoordinator())
+			{
+				/* like 2PC recovery, keep the interval independent of the run time */
+				lastShardSizeUpdateTime = GetCurrentTimestamp();
+
+				updatedPlacementCount = UpdateShardSizes();
+			}
+
+			CommitTransactionCommand();
+
+			if (updatedPlacementCount > 0)
+			{
+				ereport(DEBUG1, (errmsg("maintenance daemon updated the size of "
+										UINT64_FORMAT " shard placements",
+										updatedPlacementCount)));
+			}
+
+			/* make sure we don't wait too long */
+			timeout = Min(timeout, ShardSizeUpdateInterval);
+		}
+
+		/*
+		 * If enabled, refresh the ranges of the tracked columns of the shards
+		 * on the coordinator.
+		 */
+		if (ShardColumnRangeUpdateInterval > 0 && MaxShardColumnRanges > 0 &&
+			!RecoveryInProgress() &&
+			TimestampDifferenceExceeds(lastShardColumnRangeUpdateTime,
+									   GetCurrentTimestamp(),
+									   ShardColumnRangeUpdateInterval))
+		{
+			uint64 rangeCount = 0;
+
+			InvalidateMetadataSystemCache();
+			StartTransactionCommand();
+
+			if (!LockCitusExtension())
+			{
+				ereport(DEBUG1, (errmsg("could not lock the citus extension, "
+										"skipping shard column range update")));
+			}
+			else if (CheckCitusVersion(DEBUG1) && CitusHasBeenLoaded() &&
+					 IsCoordinator())
+			{
+				lastShardColumnRangeUpdateTime = GetCurrentTimestamp();
+
+				rangeCount = UpdateShardColumnRanges();
+			}
+
+			CommitTransactionCommand();
+
+			if (rangeCount > 0)
+			{
+				ereport(DEBUG1, (errmsg("maintenance daemon refreshed "
+										UINT64_FORMAT " shard column ranges",
+										rangeCount)));
+			}
+
+			/* make sure we don't wait too long */
+			timeout = Min(timeout, ShardColumnRangeUpdateInterval);
+		}
+
 		/* the config value -1 disables the distributed deadlock detection  */
 		if (DistributedDeadlockDetectionTimeoutFactor != -1.0)
 		{
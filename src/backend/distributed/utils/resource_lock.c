@@ -473,6 +473,22 @@ TryLockShardDistributionMetadata(int64 shardId, LOCKMODE lockMode)
 }
 
 
+/*
+ * UnlockShardDistributionMetadata releases a lock for distribution metadata
+ * related to the specified shard before the end of the transaction.
+ */
+void
+UnlockShardDistributionMetadata(int64 shardId, LOCKMODE lockMode)
+{
+	LOCKTAG tag;
+	const bool sessionLock = false;
+
+	SET_LOCKTAG_SHARD_METADATA_RESOURCE(tag, MyDatabaseId, shardId);
+
+	LockRelease(&tag, lockMode, sessionLock);
+}
+
+
 /*
  * LockShardResource acquires a lock needed to modify data on a remote shard.
  * This task may be assigned to multiple backends at the same time, so the lock
@@ -23,7 +23,13 @@
 #include "distributed/pg_dist_partition.h"
 #include "distributed/worker_protocol.h"
 #include "utils/catcache.h"
+#include "utils/date.h"
 #include "utils/memutils.h"
+#include "utils/timestamp.h"
+
+
+static int SearchShardIntervalIndex(Datum searchedValue,
+									DistTableCacheEntry *cacheEntry);
 
 
 /*
@@ -285,10 +291,8 @@ FindShardInterval(Datum partitionColumnValue, DistTableCacheEntry *cacheEntry)
 int
 FindShardIntervalIndex(Datum searchedValue, DistTableCacheEntry *cacheEntry)
 {
-	ShardInterval **shardIntervalCache = cacheEntry->sortedShardIntervalArray;
 	int shardCount = cacheEntry->shardIntervalArrayLength;
 	char partitionMethod = cacheEntry->partitionMethod;
-	FmgrInfo *compareFunction = cacheEntry->shardIntervalCompareFunction;
 	bool useBinarySearch = (partitionMethod != DISTRIBUTE_BY_HASH ||
 							!cacheEntry->hasUniformHashDistribution);
 	int shardIndex = INVALID_SHARD_INDEX;
@@ -302,10 +306,7 @@ FindShardIntervalIndex(Datum searchedValue, DistTableCacheEntry *cacheEntry)
 	{
 		if (useBinarySearch)
 		{
-			Assert(compareFunction != NULL);
-
-			shardIndex = SearchCachedShardInterval(searchedValue, shardIntervalCache,
-												   shardCount, compareFunction);
+			shardIndex = SearchShardIntervalIndex(searchedValue, cacheEntry);
 
 			/* we should always return a valid shard index for hash partitioned tables */
 			if (shardIndex == INVALID_SHARD_INDEX)
@@ -344,16 +345,42 @@ FindShardIntervalIndex(Datum searchedValue, DistTableCacheEntry *cacheEntry)
 	}
 	else
 	{
-		Assert(compareFunction != NULL);
-
-		shardIndex = SearchCachedShardInterval(searchedValue, shardIntervalCache,
-											   shardCount, compareFunction);
+		shardIndex = SearchShardIntervalIndex(searchedValue, cacheEntry);
 	}
 
 	return shardIndex;
 }
 
 
+/*
+ * SearchShardIntervalIndex searches the sorted shard intervals of the given
+ * cache entry for the interval that covers the given value. If the min/max
+ * values are available as integers, the search does not need to call the
+ * comparison function.
+ */
+static int
+SearchShardIntervalIndex(Datum searchedValue, DistTableCacheEntry *cacheEntry)
+{
+	ShardInterval **shardIntervalCache = cacheEntry->sortedShardIntervalArray;
+	int shardCount = cacheEntry->shardIntervalArrayLength;
+	FmgrInfo *compareFunction = cacheEntry->shardIntervalCompareFunction;
+
+	if (cacheEntry->shardMinValueArray != NULL)
+	{
+		int64 searchedInteger =
+			ShardIntervalValueAsInt64(searchedValue, cacheEntry->shardIntervalTypeId);
+
+		return SearchShardBoundaryArray(searchedInteger, cacheEntry->shardMinValueArray,
+										cacheEntry->shardMaxValueArray, shardCount);
+	}
+
+	Assert(compareFunction != NULL);
+
+	return SearchCachedShardInterval(searchedValue, shardIntervalCache, shardCount,
+									 compareFunction);
+}
+
+
 /*
  * SearchCachedShardInterval performs a binary search for a shard interval
  * matching a given partition column value and returns it's index in the cached
@@ -410,6 +437,119 @@ SearchCachedShardInterval(Datum partitionColumnValue, ShardInterval **shardInter
 }
 
 
+/*
+ * IsIntegerShardIntervalType returns whether shard interval values of the
+ * given type are ordered like their int64 representation returned by
+ * ShardIntervalValueAsInt64.
+ */
+bool
+IsIntegerShardIntervalType(Oid typeId)
+{
+	switch (typeId)
+	{
+		case INT2OID:
+		case INT4OID:
+		case INT8OID:
+		case DATEOID:
+		case TIMESTAMPOID:
+		case TIMESTAMPTZOID:
+		{
+			return true;
+		}
+
+		default:
+		{
+			return false;
+		}
+	}
+}
+
+
+/*
+ * ShardIntervalValueAsInt64 returns the given value of a type for which
+ * IsIntegerShardIntervalType holds as int64.
+ */
+int64
+ShardIntervalValueAsInt64(Datum value, Oid typeId)
+{
+	switch (typeId)
+	{
+		case INT2OID:
+		{
+			return DatumGetInt16(value);
+		}
+
+		case INT4OID:
+		{
+			return DatumGetInt32(value);
+		}
+
+		case DATEOID:
+		{
+			return DatumGetDateADT(value);
+		}
+
+		case INT8OID:
+		{
+			return DatumGetInt64(value);
+		}
+
+		case TIMESTAMPOID:
+		case TIMESTAMPTZOID:
+		{
+			return DatumGetTimestamp(value);
+		}
+
+		default:
+		{
+			ereport(ERROR, (errmsg("unexpected shard interval type %u", typeId)));
+		}
+	}
+}
+
+
+/*
+ * SearchShardBoundaryArray returns the index of the shard of which the min/max
+ * values cover the given value, or INVALID_SHARD_INDEX if there is none. The
+ * min/max value arrays should be sorted and the intervals should not overlap.
+ *
+ * The search finds the last shard of which the min value is not greater than
+ * the searched value. The loop does not depend on the outcome of the
+ * comparisons, which lets the compiler use conditional moves instead of
+ * branches that are hard to predict.
+ */
+int
+SearchShardBoundaryArray(int64 searchedValue, int64 *shardMinValueArray,
+						 int64 *shardMaxValueArray, int shardCount)
+{
+	int64 *searchBase = shardMinValueArray;
+	int remainingCount = shardCount;
+	int shardIndex = 0;
+
+	if (shardCount == 0 || searchedValue < shardMinValueArray[0])
+	{
+		return INVALID_SHARD_INDEX;
+	}
+
+	while (remainingCount > 1)
+	{
+		int halfCount = remainingCount / 2;
+
+		searchBase = (searchBase[halfCount] <= searchedValue) ?
+					 searchBase + halfCount : searchBase;
+		remainingCount -= halfCount;
+	}
+
+	shardIndex = searchBase - shardMinValueArray;
+	if (searchedValue > shardMaxValueArray[shardIndex])
+	{
+		return INVALID_SHARD_INDEX;
+	}
+
+	return shardIndex;
+}
+
+
 /*
  * SingleReplicatedTable checks whether all shards of a distributed table, do not have
  * more than one replica. If even one shard has more than one replica, this function
@@ -54,6 +54,7 @@ extern READFUNC_RET ReadTask(READFUNC_ARGS);
 extern READFUNC_RET ReadTaskExecution(READFUNC_ARGS);
 extern READFUNC_RET ReadDeferredErrorMessage(READFUNC_ARGS);
 extern READFUNC_RET ReadGroupShardPlacement(READFUNC_ARGS);
+extern READFUNC_RET ReadLocalPlannedStatement(READFUNC_ARGS);
 
 extern READFUNC_RET ReadUnsupportedCitusNode(READFUNC_ARGS);
 
@@ -69,6 +70,7 @@ extern void OutTask(OUTFUNC_ARGS);
 extern void OutTaskExecution(OUTFUNC_ARGS);
 extern void OutDeferredErrorMessage(OUTFUNC_ARGS);
 extern void OutGroupShardPlacement(OUTFUNC_ARGS);
+extern void OutLocalPlannedStatement(OUTFUNC_ARGS);
 
 extern void OutMultiNode(OUTFUNC_ARGS);
 extern void OutMultiTreeRoot(OUTFUNC_ARGS);
@@ -93,5 +95,6 @@ extern void CopyNodeRelationRowLock(COPYFUNC_ARGS);
 extern void CopyNodeTask(COPYFUNC_ARGS);
 extern void CopyNodeTaskExecution(COPYFUNC_ARGS);
 extern void CopyNodeDeferredErrorMessage(COPYFUNC_ARGS);
+extern void CopyNodeLocalPlannedStatement(COPYFUNC_ARGS);
 
 #endif /* CITUS_NODEFUNCS_H */
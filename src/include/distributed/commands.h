@@ -30,6 +30,7 @@ extern bool CallDistributedProcedureRemotely(CallStmt *callStmt, DestReceiver *d
 
 /* extension.c - forward declarations */
 extern bool IsCreateAlterExtensionUpdateCitusStmt(Node *parsetree);
+extern bool IsDropCitusStmt(Node *parsetree);
 extern void ErrorIfUnstableCreateOrAlterExtensionStmt(Node *parsetree);
 extern List * PlanCreateExtensionStmt(CreateExtensionStmt *stmt, const char *queryString);
 extern void ProcessCreateExtensionStmt(CreateExtensionStmt *stmt, const
@@ -100,6 +101,7 @@ extern List * PlanGrantStmt(GrantStmt *grantStmt);
 
 
 /* index.c - forward declarations */
+extern int MaxIndexBuildsPerNode;
 extern bool IsIndexRenameStmt(RenameStmt *renameStmt);
 extern List * PlanIndexStmt(IndexStmt *createIndexStatement,
 							const char *createIndexCommand);
@@ -109,6 +111,7 @@ extern List * PlanDropIndexStmt(DropStmt *dropIndexStatement,
 								const char *dropIndexCommand);
 extern void PostProcessIndexStmt(IndexStmt *indexStmt);
 extern void ErrorIfUnsupportedAlterIndexStmt(AlterTableStmt *alterTableStatement);
+extern void ExecuteIndexBuildTaskList(Oid relationId, List *taskList);
 
 
 /* policy.c -  forward declarations */
@@ -217,6 +220,7 @@ extern char * GenerateBackupNameForProcCollision(const ObjectAddress *address);
 extern ObjectWithArgs * ObjectWithArgsFromOid(Oid funcOid);
 
 /* vacuum.c - froward declarations */
+extern bool EnableDistributedAnalyze;
 extern void ProcessVacuumStmt(VacuumStmt *vacuumStmt, const char *vacuumCommand);
 
 extern bool ShouldPropagateSetCommand(VariableSetStmt *setStmt);
@@ -31,12 +31,21 @@ typedef struct TransactionNode
 	PGPROC *initiatorProc;
 
 	bool transactionVisited;
+
+	/* union-find parent of the weakly connected component of the node */
+	struct TransactionNode *componentParent;
+
+	/* only set on component roots, component has an edge not in the last graph */
+	bool componentHasNewWaitEdge;
 } TransactionNode;
 
 
 /* GUC, determining whether debug messages for deadlock detection sent to LOG */
 extern bool LogDistributedDeadlockDetection;
 
+/* GUC, determining whether cycles are only searched in changed components */
+extern bool EnableIncrementalDeadlockDetection;
+
 
 extern bool CheckForDistributedDeadlocks(void);
 extern HTAB * BuildAdjacencyListsForWaitGraph(WaitGraph *waitGraph);
@@ -32,6 +32,9 @@
 
 #define CURSOR_OPT_FORCE_DISTRIBUTED 0x080000
 
+/* plan distributed tables as regular tables, to read the local (shell) table */
+#define CURSOR_OPT_FORCE_LOCAL_PLANNING 0x100000
+
 typedef struct RelationRestrictionContext
 {
 	bool hasDistributedRelation;
@@ -116,6 +119,8 @@ extern void multi_join_restriction_hook(PlannerInfo *root,
 										RelOptInfo *innerrel,
 										JoinType jointype,
 										JoinPathExtraData *extra);
+extern void multi_get_relation_info_hook(PlannerInfo *root, Oid relationObjectId,
+										 bool inhparent, RelOptInfo *rel);
 extern bool IsModifyCommand(Query *query);
 extern bool IsModifyDistributedPlan(struct DistributedPlan *distributedPlan);
 extern void EnsurePartitionTableNotReplicated(Oid relationId);
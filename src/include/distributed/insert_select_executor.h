@@ -17,6 +17,9 @@
 #include "executor/execdesc.h"
 
 
+/* config variable */
+extern bool EnableRepartitionedInsertSelect;
+
 extern TupleTableSlot * CoordinatorInsertSelectExecScan(CustomScanState *node);
 extern bool ExecutingInsertSelect(void);
 
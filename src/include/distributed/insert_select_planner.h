@@ -23,6 +23,10 @@
 #include "nodes/plannodes.h"
 
 
+/* config variable */
+extern int MultiRowInsertCopyThreshold;
+
+
 extern bool InsertSelectIntoDistributedTable(Query *query);
 extern bool InsertSelectIntoLocalTable(Query *query);
 extern Query * ReorderInsertSelectTargetLists(Query *originalQuery,
@@ -34,6 +38,8 @@ extern DistributedPlan * CreateInsertSelectPlan(uint64 planId, Query *originalQu
 												PlannerRestrictionContext *
 												plannerRestrictionContext);
 extern char * InsertSelectResultIdPrefix(uint64 planId);
+extern bool CanUseCopyForMultiRowInsert(Query *query);
+extern DistributedPlan * CreateMultiRowInsertCopyPlan(Query *originalQuery);
 
 
 #endif /* INSERT_SELECT_PLANNER_H */
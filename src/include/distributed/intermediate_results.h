@@ -15,6 +15,7 @@
 #include "fmgr.h"
 
 #include "distributed/commands/multi_copy.h"
+#include "distributed/metadata_cache.h"
 #include "nodes/execnodes.h"
 #include "nodes/pg_list.h"
 #include "tcop/dest.h"
@@ -25,9 +26,17 @@
 extern DestReceiver * CreateRemoteFileDestReceiver(char *resultId, EState *executorState,
 												   List *initialNodeList, bool
 												   writeLocalFile);
+extern uint64 RemoteFileDestReceiverBytesSent(DestReceiver *destReceiver);
 extern void ReceiveQueryResultViaCopy(const char *resultId);
+extern void SendQueryResultViaCopy(const char *resultId);
 extern void RemoveIntermediateResultsDirectory(void);
 extern int64 IntermediateResultSize(char *resultId);
 
+/* distributed_intermediate_results.c */
+extern List ** RedistributeTaskListResults(char *resultIdPrefix,
+										   List *selectTaskList,
+										   int partitionColumnIndex,
+										   DistTableCacheEntry *targetRelation);
+
 
 #endif /* INTERMEDIATE_RESULTS_H */
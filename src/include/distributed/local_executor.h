@@ -16,6 +16,7 @@
 /* enabled with GUCs*/
 extern bool EnableLocalExecution;
 extern bool LogLocalCommands;
+extern bool EnablePartialLocalExecution;
 
 extern bool LocalExecutionHappened;
 
@@ -23,6 +24,7 @@ extern uint64 ExecuteLocalTaskList(CitusScanState *scanState, List *taskList);
 extern void ExtractLocalAndRemoteTasks(bool readOnlyPlan, List *taskList,
 									   List **localTaskList, List **remoteTaskList);
 extern bool ShouldExecuteTasksLocally(List *taskList);
+extern void ResetLocalExecutionState(void);
 extern void ErrorIfLocalExecutionHappened(void);
 extern void DisableLocalExecution(void);
 extern bool AnyTaskAccessesRemoteNode(List *taskList);
@@ -0,0 +1,26 @@
+/*-------------------------------------------------------------------------
+ *
+ * local_plan_cache.h
+ *	Functions to cache the local plans of the tasks executed locally.
+ *
+ * Copyright (c) 2019, Citus Data, Inc.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#ifndef LOCAL_PLAN_CACHE_H
+#define LOCAL_PLAN_CACHE_H
+
+#include "distributed/multi_physical_planner.h"
+#include "nodes/params.h"
+#include "nodes/plannodes.h"
+
+extern bool IsLocalPlanCachingSupported(Job *workerJob,
+										DistributedPlan *originalDistributedPlan);
+extern void CacheLocalPlanForShardQuery(Task *task,
+										DistributedPlan *originalDistributedPlan,
+										ParamListInfo paramListInfo);
+extern PlannedStmt * GetCachedLocalPlan(Task *task, DistributedPlan *distributedPlan);
+extern void AcquireLocalPlanLocks(PlannedStmt *localPlan);
+
+#endif /* LOCAL_PLAN_CACHE_H */
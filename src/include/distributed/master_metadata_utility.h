@@ -105,6 +105,8 @@ extern void CopyShardInterval(ShardInterval *srcInterval, ShardInterval *destInt
 extern void CopyShardPlacement(ShardPlacement *srcPlacement,
 							   ShardPlacement *destPlacement);
 extern uint64 ShardLength(uint64 shardId);
+extern uint64 TableShardLengthSum(Oid relationId);
+extern uint64 TableSizeEstimate(Oid relationId);
 extern bool NodeGroupHasShardPlacements(int32 groupId,
 										bool onlyConsiderActivePlacements);
 extern List * FinalizedShardPlacementList(uint64 shardId);
@@ -126,6 +128,7 @@ extern void InsertIntoPgDistPartition(Oid relationId, char distributionMethod,
 extern void DeletePartitionRow(Oid distributedRelationId);
 extern void DeleteShardRow(uint64 shardId);
 extern void UpdateShardPlacementState(uint64 placementId, char shardState);
+extern bool UpdateShardPlacementLength(uint64 placementId, uint64 shardLength);
 extern void DeleteShardPlacementRow(uint64 placementId);
 extern void CreateDistributedTable(Oid relationId, Var *distributionColumn,
 								   char distributionMethod, char *colocateWithTableName,
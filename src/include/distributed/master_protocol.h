@@ -67,6 +67,11 @@
 #define SHARD_RANGE_QUERY "SELECT min(%s), max(%s) FROM %s"
 #define SHARD_TABLE_SIZE_QUERY "SELECT pg_table_size(%s)"
 #define SHARD_CSTORE_TABLE_SIZE_QUERY "SELECT cstore_table_size(%s)"
+#define SHARD_PLACEMENT_SIZES_QUERY \
+	"SELECT s.shardid, s.placementid, s.shardlength, pg_table_size(c.oid) " \
+	"FROM (VALUES %s) s(shardid, placementid, shardlength, nspname, relname) " \
+	"JOIN pg_namespace n ON (n.nspname = s.nspname) " \
+	"JOIN pg_class c ON (c.relnamespace = n.oid AND c.relname = s.relname)"
 #define DROP_REGULAR_TABLE_COMMAND "DROP TABLE IF EXISTS %s CASCADE"
 #define DROP_FOREIGN_TABLE_COMMAND "DROP FOREIGN TABLE IF EXISTS %s CASCADE"
 #define CREATE_SCHEMA_COMMAND "CREATE SCHEMA IF NOT EXISTS %s AUTHORIZATION %s"
@@ -95,6 +100,7 @@ extern int ShardMaxSize;
 extern int ShardPlacementPolicy;
 extern int NextShardId;
 extern int NextPlacementId;
+extern int ShardSizeUpdateInterval;
 
 
 extern bool IsCoordinator(void);
@@ -119,6 +125,7 @@ extern List * InsertShardPlacementRows(Oid relationId, int64 shardId,
 									   List *workerNodeList, int workerStartIndex,
 									   int replicationFactor);
 extern uint64 UpdateShardStatistics(int64 shardId);
+extern uint64 UpdateShardSizes(void);
 extern void CreateShardsWithRoundRobinPolicy(Oid distributedTableId, int32 shardCount,
 											 int32 replicationFactor,
 											 bool useExclusiveConnections);
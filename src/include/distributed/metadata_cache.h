@@ -29,6 +29,8 @@ typedef enum
 } ReadFromSecondariesType;
 extern int ReadFromSecondaries;
 
+extern bool EnableIncrementalCacheInvalidation;
+
 
 /*
  * While upgrading pg_dist_local_group can be empty temporarily, in that
@@ -52,6 +54,9 @@ typedef struct
 	 */
 	bool isValid;
 
+	/* metadata version the entry was built at, see shared_metadata_cache.c */
+	uint64 metadataVersion;
+
 	bool isDistributedTable;
 	bool hasUninitializedShardInterval;
 	bool hasUniformHashDistribution; /* valid for hash partitioned tables */
@@ -95,6 +100,16 @@ typedef struct
 	/* pg_dist_placement metadata */
 	GroupShardPlacement **arrayOfPlacementArrays;
 	int *arrayOfPlacementArrayLengths;
+
+	/*
+	 * Min/max values of the sorted shard intervals as int64, if the interval
+	 * type is compared as an integer and the intervals are initialized and do
+	 * not overlap, NULL otherwise. Used to find the shard of a value without
+	 * calling the comparison function.
+	 */
+	Oid shardIntervalTypeId;
+	int64 *shardMinValueArray;
+	int64 *shardMaxValueArray;
 } DistTableCacheEntry;
 
 typedef struct DistObjectCacheEntryKey
@@ -180,6 +195,10 @@ extern Oid DistPlacementPlacementidIndexId(void);
 extern Oid DistTransactionRelationId(void);
 extern Oid DistTransactionGroupIndexId(void);
 extern Oid DistTransactionRecordIndexId(void);
+extern Oid DistMetadataChangeRelationId(void);
+extern Oid DistMetadataChangeGroupIndexId(void);
+extern Oid DistShardRangeColumnRelationId(void);
+extern Oid DistShardRangeColumnIndexId(void);
 extern Oid DistPlacementGroupidIndexId(void);
 extern Oid DistObjectPrimaryKeyIndexId(void);
 
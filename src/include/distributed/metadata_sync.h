@@ -19,6 +19,7 @@
 /* config variables */
 extern int MetadataSyncInterval;
 extern int MetadataSyncRetryInterval;
+extern bool EnableDeltaMetadataSync;
 
 typedef enum
 {
@@ -44,6 +45,7 @@ extern List * ShardDeleteCommandList(ShardInterval *shardInterval);
 extern char * NodeDeleteCommand(uint32 nodeId);
 extern char * NodeStateUpdateCommand(uint32 nodeId, bool isActive);
 extern char * ShouldHaveShardsUpdateCommand(uint32 nodeId, bool shouldHaveShards);
+extern char * NodeLocationUpdateCommand(uint32 nodeId, char *nodeName, int32 nodePort);
 extern char * ColocationIdUpdateCommand(Oid relationId, uint32 colocationId);
 extern char * CreateSchemaDDLCommand(Oid schemaId);
 extern char * PlacementUpsertCommand(uint64 shardId, uint64 placementId, int shardState,
@@ -56,6 +58,14 @@ extern bool SendOptionalCommandListToWorkerInTransaction(char *nodeName, int32 n
 														 char *nodeUser,
 														 List *commandList);
 
+/* metadata change log functions, see metadata_change_log.c */
+extern void StartMetadataChangeLog(int32 groupId, const char *command);
+extern void LogMetadataChangeForUnsyncedNodes(const char *command);
+extern void DropMetadataChangeLogsOfUnsyncedNodes(void);
+extern bool HasMetadataChangeLog(int32 groupId);
+extern List * MetadataChangeLogCommandList(int32 groupId);
+extern void DeleteMetadataChangeLog(int32 groupId);
+
 #define DELETE_ALL_NODES "TRUNCATE pg_dist_node CASCADE"
 #define REMOVE_ALL_CLUSTERED_TABLES_COMMAND \
 	"SELECT worker_drop_distributed_table(logicalrelid::regclass::text) FROM pg_dist_partition"
@@ -31,9 +31,40 @@ extern bool WritableStandbyCoordinator;
 extern bool ForceMaxQueryParallelization;
 extern int MaxAdaptiveExecutorPoolSize;
 extern int ExecutorSlowStartInterval;
+extern int SequentialCommandBatchSize;
 extern bool SortReturning;
 
 
+/*
+ * TaskProgressState describes how far the execution of a task is, as reported
+ * through a TaskProgress.
+ */
+typedef enum TaskProgressState
+{
+	TASK_PROGRESS_PENDING = 0,
+	TASK_PROGRESS_RUNNING = 1,
+	TASK_PROGRESS_FINISHED = 2,
+	TASK_PROGRESS_FAILED = 3
+} TaskProgressState;
+
+/*
+ * TaskProgress tracks the execution of a single task. It is typically kept in
+ * a progress monitor, such that other backends can see which tasks of a
+ * long-running command are done.
+ */
+typedef struct TaskProgress
+{
+	uint64 shardId;
+	uint64 shardSize;
+
+	/* number of placements of the shard, and on how many the task is done */
+	int placementCount;
+	int finishedPlacementCount;
+
+	TaskProgressState state;
+} TaskProgress;
+
+
 extern void CitusExecutorStart(QueryDesc *queryDesc, int eflags);
 extern void CitusExecutorRun(QueryDesc *queryDesc, ScanDirection direction, uint64 count,
 							 bool execute_once);
@@ -43,6 +74,8 @@ extern uint64 ExecuteTaskListExtended(RowModifyLevel modLevel, List *taskList,
 									  Tuplestorestate *tupleStore,
 									  bool hasReturning, int targetPoolSize);
 extern void ExecuteUtilityTaskListWithoutResults(List *taskList);
+extern void ExecuteUtilityTaskListWithProgress(List *taskList, int targetPoolSize,
+											   TaskProgress *taskProgressArray);
 extern uint64 ExecuteTaskList(RowModifyLevel modLevel, List *taskList, int
 							  targetPoolSize);
 extern TupleTableSlot * CitusExecScan(CustomScanState *node);
@@ -77,6 +77,7 @@ typedef struct JoinOrderNode
 /* Config variables managed via guc.c */
 extern bool LogMultiJoinOrder;
 extern bool EnableSingleHashRepartitioning;
+extern bool EnableCostBasedJoinOrder;
 
 
 /* Function declaration for determining table join orders */
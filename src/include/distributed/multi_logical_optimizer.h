@@ -135,6 +135,7 @@ static const char *const AggregateNames[] = {
 /* Config variable managed via guc.c */
 extern int LimitClauseRowFetchCount;
 extern double CountDistinctErrorRate;
+extern bool EnableCoordinatorDistinctAggregates;
 
 
 /* Function declaration for optimizing logical plans */
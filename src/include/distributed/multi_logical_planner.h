@@ -178,10 +178,15 @@ typedef struct MultiExtendedOp
 	List *distinctClause;
 	bool hasDistinctOn;
 	bool hasWindowFuncs;
+	bool onlyPushableWindowFunctions;
 	List *windowClause;
 } MultiExtendedOp;
 
 
+/* Config variable managed via guc.c */
+extern bool EnableCoordinatorWindowFunctions;
+
+
 /* Function declarations for building logical plans */
 extern MultiTreeRoot * MultiLogicalPlanCreate(Query *originalQuery, Query *queryTree,
 											  PlannerRestrictionContext *
@@ -189,6 +194,7 @@ extern MultiTreeRoot * MultiLogicalPlanCreate(Query *originalQuery, Query *query
 extern bool FindNodeCheck(Node *node, bool (*check)(Node *));
 extern bool SingleRelationRepartitionSubquery(Query *queryTree);
 extern bool TargetListOnPartitionColumn(Query *query, List *targetEntryList);
+extern bool SafeToPullUpWindowFunction(Query *query);
 extern bool FindNodeCheckInRangeTableList(List *rtable, bool (*check)(Node *));
 extern bool IsDistributedTableRTE(Node *node);
 extern bool QueryContainsDistributedTableRTE(Query *query);
@@ -137,9 +137,33 @@ typedef struct Job
 	bool requiresMasterEvaluation; /* only applies to modify jobs */
 	bool deferredPruning;
 	Const *partitionKeyValue;
+
+	/* local plans of the tasks, cached across executions of the same plan */
+	List *localPlannedStatements;
 } Job;
 
 
+/*
+ * LocalPlannedStatement is a local plan of a task's query on a shard that is
+ * cached in the Job, such that repeated local executions of the same plan do
+ * not need to parse and plan the shard query again.
+ */
+typedef struct LocalPlannedStatement
+{
+	CitusNode type;
+	uint64 shardId;
+	uint32 localGroupId;
+	char *queryString;
+
+	/* the plan might depend on the role, e.g. due to row level security */
+	Oid userId;
+	bool rowSecurity;
+
+	uint64 cacheGeneration;
+	PlannedStmt *localPlan;
+} LocalPlannedStatement;
+
+
 /* Defines a repartitioning job and holds additional related data. */
 typedef struct MapMergeJob
 {
@@ -223,6 +247,14 @@ typedef struct Task
 	 * the task splitted into local and remote tasks.
 	 */
 	bool partiallyLocalOrRemote;
+
+	/*
+	 * If not NIL, the query strings (as String values) to send to each of the
+	 * placements in taskPlacementList, in the same order. This is used when the
+	 * query needs to know on which placement it runs, otherwise queryString is
+	 * sent to all placements.
+	 */
+	List *perPlacementQueryStrings;
 } Task;
 
 
@@ -320,6 +352,12 @@ typedef struct DistributedPlan
 	 * or if prepared statement parameters prevented successful planning.
 	 */
 	DeferredErrorMessage *planningError;
+
+	/*
+	 * The number of times this plan has been executed, which is only above 1
+	 * when the plan is reused (e.g., a prepared statement).
+	 */
+	uint32 numberOfTimesExecuted;
 } DistributedPlan;
 
 
@@ -0,0 +1,47 @@
+/*-------------------------------------------------------------------------
+ *
+ * pg_dist_metadata_change.h
+ *	  definition of the "metadata change" relation (pg_dist_metadata_change).
+ *
+ * Copyright (c) Citus Data, Inc.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#ifndef PG_DIST_METADATA_CHANGE_H
+#define PG_DIST_METADATA_CHANGE_H
+
+
+/* ----------------
+ *		pg_dist_metadata_change definition.
+ * ----------------
+ */
+typedef struct FormData_pg_dist_metadata_change
+{
+	int32 groupid;             /* id of the group that missed the change */
+	int64 changeid;            /* order of the change */
+	text command;              /* command that applies the change */
+} FormData_pg_dist_metadata_change;
+
+
+/* ----------------
+ *      Form_pg_dist_metadata_change corresponds to a pointer to a tuple with
+ *      the format of pg_dist_metadata_change relation.
+ * ----------------
+ */
+typedef FormData_pg_dist_metadata_change *Form_pg_dist_metadata_change;
+
+
+/* ----------------
+ *      compiler constants for pg_dist_metadata_change
+ * ----------------
+ */
+#define Natts_pg_dist_metadata_change 3
+#define Anum_pg_dist_metadata_change_groupid 1
+#define Anum_pg_dist_metadata_change_changeid 2
+#define Anum_pg_dist_metadata_change_command 3
+
+#define METADATA_CHANGEID_SEQUENCE_NAME "pg_catalog.pg_dist_metadata_change_changeid_seq"
+
+
+#endif   /* PG_DIST_METADATA_CHANGE_H */
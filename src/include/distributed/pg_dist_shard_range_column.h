@@ -0,0 +1,44 @@
+/*-------------------------------------------------------------------------
+ *
+ * pg_dist_shard_range_column.h
+ *	  definition of the relation that lists the columns of which the per-shard
+ *	  value ranges are tracked (pg_dist_shard_range_column).
+ *
+ * Copyright (c) Citus Data, Inc.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#ifndef PG_DIST_SHARD_RANGE_COLUMN_H
+#define PG_DIST_SHARD_RANGE_COLUMN_H
+
+
+/* ----------------
+ *		pg_dist_shard_range_column definition.
+ * ----------------
+ */
+typedef struct FormData_pg_dist_shard_range_column
+{
+	Oid logicalrelid;          /* distributed table the column belongs to */
+	int16 attnum;              /* attribute number of the column */
+} FormData_pg_dist_shard_range_column;
+
+
+/* ----------------
+ *      Form_pg_dist_shard_range_column corresponds to a pointer to a tuple with
+ *      the format of pg_dist_shard_range_column relation.
+ * ----------------
+ */
+typedef FormData_pg_dist_shard_range_column *Form_pg_dist_shard_range_column;
+
+
+/* ----------------
+ *      compiler constants for pg_dist_shard_range_column
+ * ----------------
+ */
+#define Natts_pg_dist_shard_range_column 2
+#define Anum_pg_dist_shard_range_column_logicalrelid 1
+#define Anum_pg_dist_shard_range_column_attnum 2
+
+
+#endif   /* PG_DIST_SHARD_RANGE_COLUMN_H */
@@ -22,6 +22,12 @@
 #include "nodes/relation.h"
 #endif
 
+
+/* Config variables managed via guc.c */
+extern int BroadcastJoinThreshold;
+extern bool EnableSemiJoinReduction;
+
+
 extern List * GenerateSubplansForSubqueriesAndCTEs(uint64 planId, Query *originalQuery,
 												   PlannerRestrictionContext *
 												   plannerRestrictionContext);
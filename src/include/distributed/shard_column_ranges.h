@@ -0,0 +1,33 @@
+/*-------------------------------------------------------------------------
+ *
+ * shard_column_ranges.h
+ *	  Type and function declarations for the per-shard value ranges of
+ *	  non-distribution columns that the coordinator keeps in shared memory.
+ *
+ * Copyright (c) 2019, Citus Data, Inc.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#ifndef SHARD_COLUMN_RANGES_H
+#define SHARD_COLUMN_RANGES_H
+
+#include "distributed/multi_physical_planner.h"
+
+
+/* config variables */
+extern int MaxShardColumnRanges;
+extern int ShardColumnRangeUpdateInterval;
+
+
+extern void InitializeShardColumnRanges(void);
+extern void DeleteShardRangeColumns(Oid relationId);
+extern uint64 UpdateShardColumnRanges(void);
+extern void RecordShardModification(uint64 shardId);
+extern void RecordTaskListShardModifications(List *taskList);
+extern void PublishShardModifications(void);
+extern void InvalidateShardColumnRanges(void);
+extern List * PruneTaskListByShardColumnRanges(Job *job, List *taskList);
+
+
+#endif /* SHARD_COLUMN_RANGES_H */
@@ -41,6 +41,10 @@ extern int FindShardIntervalIndex(Datum searchedValue, DistTableCacheEntry *cach
 extern int SearchCachedShardInterval(Datum partitionColumnValue,
 									 ShardInterval **shardIntervalCache,
 									 int shardCount, FmgrInfo *compareFunction);
+extern bool IsIntegerShardIntervalType(Oid typeId);
+extern int64 ShardIntervalValueAsInt64(Datum value, Oid typeId);
+extern int SearchShardBoundaryArray(int64 searchedValue, int64 *shardMinValueArray,
+									int64 *shardMaxValueArray, int shardCount);
 extern bool SingleReplicatedTable(Oid relationId);
 
 
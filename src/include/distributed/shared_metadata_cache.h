@@ -0,0 +1,41 @@
+/*-------------------------------------------------------------------------
+ *
+ * shared_metadata_cache.h
+ *	  Type and function declarations for the shard metadata cache that is
+ *	  shared by all backends.
+ *
+ * Copyright (c) 2019, Citus Data, Inc.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#ifndef SHARED_METADATA_CACHE_H
+#define SHARED_METADATA_CACHE_H
+
+#include "distributed/master_metadata_utility.h"
+
+
+/* config variable */
+extern bool EnableSharedMetadataCache;
+
+
+extern void InitializeSharedMetadataCache(void);
+extern uint64 SharedMetadataCacheVersion(void);
+extern void MarkShardMetadataChanged(Oid relationId, uint64 shardId);
+extern bool HasPendingShardMetadataChanges(void);
+extern void RememberPreparedMetadataChanges(const char *gid);
+extern void PublishPreparedMetadataChanges(const char *gid, bool committed);
+extern void AdvanceSharedMetadataCacheVersion(void);
+extern bool ShardMetadataChangesSince(Oid relationId, uint64 metadataVersion,
+									  List **changedShardIdList);
+extern bool LoadSharedShardList(Oid relationId, uint64 metadataVersion,
+								int *shardCount, ShardInterval ***shardIntervalArray,
+								GroupShardPlacement ***arrayOfPlacementArrays,
+								int **arrayOfPlacementArrayLengths);
+extern void StoreSharedShardList(Oid relationId, uint64 metadataVersion, int shardCount,
+								 ShardInterval **shardIntervalArray,
+								 GroupShardPlacement **arrayOfPlacementArrays,
+								 int *arrayOfPlacementArrayLengths);
+
+
+#endif /* SHARED_METADATA_CACHE_H */
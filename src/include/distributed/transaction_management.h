@@ -77,6 +77,12 @@ extern bool FunctionOpensTransactionBlock;
 extern int MultiShardCommitProtocol;
 extern int SingleShardCommitProtocol;
 
+/*
+ * GUC that determines whether a transaction that asked for 2PC should use 1PC
+ * if only a single connection modified data.
+ */
+extern bool PreferOnePhaseCommit;
+
 /* state needed to restore multi-shard commit protocol during VACUUM/ANALYZE */
 extern int SavedMultiShardCommitProtocol;
 
@@ -112,6 +118,7 @@ extern StringInfo activeSetStmts;
 extern void BeginOrContinueCoordinatedTransaction(void);
 extern bool InCoordinatedTransaction(void);
 extern void CoordinatedTransactionUse2PC(void);
+extern void CoordinatedTransactionShouldUse2PC(void);
 extern bool IsMultiStatementTransaction(void);
 
 /* initialization function(s) */
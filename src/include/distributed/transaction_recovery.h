@@ -12,12 +12,32 @@
 #define TRANSACTION_RECOVERY_H
 
 
+#include "distributed/worker_manager.h"
+
+
+/* magic number of the transaction recovery progress monitor */
+#define TRANSACTION_RECOVERY_PROGRESS_MAGIC_NUMBER 1391
+
+
+/* progress of the transaction recovery on a single worker */
+typedef struct TransactionRecoveryProgress
+{
+	char nodeName[WORKER_LENGTH];
+	int nodePort;
+
+	/* prepared transactions to commit or abort, and how many are done */
+	uint64 preparedTransactionCount;
+	uint64 recoveredTransactionCount;
+} TransactionRecoveryProgress;
+
+
 /* GUC to configure interval for 2PC auto-recovery */
 extern int Recover2PCInterval;
 
 
 /* Functions declarations for worker transactions */
 extern void LogTransactionRecord(int32 groupId, char *transactionName);
+extern void LogTransactionRecordList(List *groupIdList, List *transactionNameList);
 extern int RecoverTwoPhaseCommits(void);
 
 
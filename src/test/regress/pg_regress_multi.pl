@@ -335,6 +335,7 @@ push(@pgOptions, '-c', "citus.node_connection_timeout=${connectionTimeout}");
 
 # we disable slow start by default to encourage parallelism within tests
 push(@pgOptions, '-c', "citus.executor_slow_start_interval=0ms");
+push(@pgOptions, '-c', "citus.max_shard_column_ranges=1024");
 
 if ($useMitmproxy)
 {
@@ -409,6 +409,10 @@ permutation "s1-begin" "s2-begin" "s3-begin"  "s1-update-1" "s2-update-2" "s3-up
 # similar to the above (i.e., 3 nodes), but the cycle starts from the second node 
 permutation "s1-begin" "s2-begin" "s3-begin"  "s2-update-1" "s1-update-1" "s2-update-2" "s3-update-3" "s3-update-2" "deadlock-checker-call" "s2-update-3" "deadlock-checker-call" "s3-commit" "s2-commit" "s1-commit"
 
+# the checker remembers the wait edges of its previous run and only searches the changed
+# components, so close the loop with an edge inside a component that was already searched
+permutation "s1-begin" "s2-begin" "s3-begin" "s1-update-1" "s2-update-2" "s3-update-3" "s1-update-2" "deadlock-checker-call" "s2-update-3" "deadlock-checker-call" "s3-update-1" "deadlock-checker-call" "s3-commit" "s2-commit" "s1-commit"
+
 # not connected graph
 permutation "s1-begin" "s2-begin" "s3-begin" "s4-begin" "s1-update-1" "s2-update-2" "s3-update-3" "s3-update-2" "deadlock-checker-call" "s4-update-4" "s2-update-3" "deadlock-checker-call" "s3-commit" "s2-commit" "s1-commit" "s4-commit"
 
@@ -0,0 +1,80 @@
+--
+-- BROADCAST_JOIN
+--
+-- Tests joins of distributed tables on columns other than their distribution
+-- columns, where the small tables are broadcast as intermediate results.
+--
+CREATE SCHEMA broadcast_join;
+SET search_path TO broadcast_join;
+SET citus.next_shard_id TO 2700000;
+
+SET citus.shard_count TO 4;
+CREATE TABLE large_table (a int, b int);
+SELECT create_distributed_table('large_table', 'a');
+
+SET citus.shard_count TO 2;
+CREATE TABLE small_table (x int, y int);
+SELECT create_distributed_table('small_table', 'x');
+
+CREATE TABLE other_small_table (z int, w int);
+SELECT create_distributed_table('other_small_table', 'z', colocate_with => 'none');
+
+INSERT INTO large_table SELECT i, i % 10 FROM generate_series(1, 100) i;
+INSERT INTO small_table SELECT i, i FROM generate_series(0, 9) i;
+INSERT INTO other_small_table SELECT i, i * 2 FROM generate_series(0, 9) i;
+
+-- shards of hash-distributed tables have unknown sizes until they are updated
+UPDATE pg_dist_placement SET shardlength = 1048576 WHERE shardid IN
+  (SELECT shardid FROM pg_dist_shard WHERE logicalrelid = 'large_table'::regclass);
+UPDATE pg_dist_placement SET shardlength = 8192 WHERE shardid IN
+  (SELECT shardid FROM pg_dist_shard
+   WHERE logicalrelid IN ('small_table'::regclass, 'other_small_table'::regclass));
+
+SET citus.broadcast_join_threshold TO '1MB';
+
+SELECT count(*), sum(x) FROM large_table JOIN small_table ON (b = y);
+
+SELECT count(*), sum(x), sum(z)
+FROM large_table, small_table, other_small_table
+WHERE b = y AND y = w;
+
+SELECT y, count(*) FROM large_table JOIN small_table ON (b = y)
+WHERE a > 50
+GROUP BY y
+ORDER BY y
+LIMIT 3;
+
+-- tables that are broadcast later are filtered by the join keys of earlier ones
+SET citus.enable_semi_join_reduction TO on;
+
+SELECT count(*), sum(x), sum(z)
+FROM large_table, small_table, other_small_table
+WHERE b = y AND y = w;
+
+RESET citus.enable_semi_join_reduction;
+
+-- dropped columns do not break the broadcast table
+ALTER TABLE small_table DROP COLUMN x;
+SELECT count(*), sum(y) FROM large_table JOIN small_table ON (b = y);
+
+-- only tables of known size below the threshold are broadcast, wherever they
+-- appear in the FROM clause
+SET client_min_messages TO DEBUG1;
+SELECT count(*), sum(z) FROM large_table JOIN other_small_table ON (b = w);
+SELECT count(*), sum(z) FROM other_small_table JOIN large_table ON (b = w);
+
+-- a table of unknown size is kept in place
+UPDATE pg_dist_placement SET shardlength = 0 WHERE shardid IN
+  (SELECT shardid FROM pg_dist_shard WHERE logicalrelid = 'large_table'::regclass);
+SELECT count(*), sum(z) FROM other_small_table JOIN large_table ON (b = w);
+
+-- a broadcast table that joins an earlier one is filtered by its join keys
+SET citus.enable_semi_join_reduction TO on;
+SELECT count(*), sum(o2.z)
+FROM large_table, other_small_table o1, other_small_table o2
+WHERE b = o1.w AND o1.w = o2.w;
+RESET citus.enable_semi_join_reduction;
+RESET client_min_messages;
+
+RESET citus.broadcast_join_threshold;
+DROP SCHEMA broadcast_join CASCADE;
@@ -0,0 +1,35 @@
+--
+-- COORDINATOR_WINDOW_FUNCTIONS
+--
+-- Tests window functions that cannot be pushed down to the workers and are
+-- therefore evaluated on the coordinator.
+--
+CREATE SCHEMA coordinator_window_functions;
+SET search_path TO coordinator_window_functions;
+SET citus.next_shard_id TO 2600000;
+
+CREATE TABLE window_table (a int, b int);
+SELECT create_distributed_table('window_table', 'a');
+
+INSERT INTO window_table VALUES (1, 10), (2, 10), (3, 20), (4, 20), (5, 30);
+
+-- not supported without the setting
+SELECT a, b, row_number() OVER (ORDER BY a DESC) FROM window_table ORDER BY a;
+
+SET citus.enable_coordinator_window_functions TO on;
+
+SELECT a, b, row_number() OVER (ORDER BY a DESC) FROM window_table ORDER BY a;
+
+-- multiple window clauses that do not include the distribution column
+SELECT a, b, rank() OVER (ORDER BY b), sum(a) OVER (PARTITION BY b)
+FROM window_table
+ORDER BY a;
+
+-- window functions used in expressions
+SELECT a, a * 10 + count(*) OVER (PARTITION BY b) AS c FROM window_table ORDER BY a;
+
+-- aggregates are still not supported together with such window functions
+SELECT b, count(*), rank() OVER (ORDER BY b) FROM window_table GROUP BY b ORDER BY b;
+
+RESET citus.enable_coordinator_window_functions;
+DROP SCHEMA coordinator_window_functions CASCADE;
@@ -143,4 +143,37 @@ SELECT * FROM squares ORDER BY x;
 -- empty shard interval array should raise error
 SELECT worker_hash_partition_table(42,1,'SELECT a FROM generate_series(1,100) AS a', 'a', 23, ARRAY[0]);
 
+-- multiple results can be read at once
+BEGIN;
+SELECT create_intermediate_result('squares_1', 'SELECT s, s*s FROM generate_series(1,3) s'),
+       create_intermediate_result('squares_2', 'SELECT s, s*s FROM generate_series(4,6) s');
+SELECT * FROM read_intermediate_results(ARRAY['squares_1', 'squares_2']::text[], 'binary') AS res (x int, x2 int);
+END;
+
+-- query results can be partitioned into a result per range
+BEGIN;
+SELECT partition_index, rows_written
+FROM worker_partition_query_result('squares_part', 'SELECT s, s*s FROM generate_series(1,10) s', 0,
+                                   'range', '{1,4,8}'::text[], '{3,7,10}'::text[])
+ORDER BY 1;
+SELECT * FROM read_intermediate_result('squares_part_1', 'binary') AS res (x int, x2 int);
+END;
+
+-- INSERT ... SELECT between non-colocated tables can be repartitioned on the workers
+CREATE TABLE source_table (a int, b int);
+SELECT create_distributed_table('source_table', 'a');
+CREATE TABLE target_table (a int, b int);
+SELECT create_distributed_table('target_table', 'a');
+INSERT INTO source_table SELECT s, s*s FROM generate_series(1,100) s;
+
+SET citus.enable_repartitioned_insert_select TO on;
+SET client_min_messages TO DEBUG1;
+INSERT INTO target_table (a, b) SELECT b, a FROM source_table;
+RESET client_min_messages;
+SELECT count(*), sum(a), sum(b) FROM target_table;
+SELECT * FROM target_table WHERE a = 49;
+RESET citus.enable_repartitioned_insert_select;
+
+DROP TABLE source_table, target_table;
+
 DROP SCHEMA intermediate_results CASCADE;
@@ -235,6 +235,45 @@ COMMIT;
 -- make sure that we've committed everything
 SELECT * FROM distributed_table WHERE key = 1 ORDER BY 1,2,3;
 
+-- with partial local execution, only the shards that have already been
+-- accessed locally are executed locally, the other local shards are
+-- accessed in parallel over connections
+SET citus.enable_partial_local_execution TO ON;
+BEGIN;
+	INSERT INTO distributed_table VALUES (1, '11',21) ON CONFLICT(key) DO UPDATE SET value = '23' RETURNING *;
+	SELECT count(*) FROM distributed_table WHERE value = '11';
+	DELETE FROM distributed_table WHERE value = '11';
+	SELECT count(*) FROM distributed_table WHERE value = '11';
+ROLLBACK;
+RESET citus.enable_partial_local_execution;
+
+-- enabling partial local execution in the middle of a transaction has no
+-- effect, all the local shards are still accessed locally such that the
+-- writes of the transaction are visible
+BEGIN;
+	INSERT INTO distributed_table VALUES (1, '11',21) ON CONFLICT(key) DO UPDATE SET value = '23' RETURNING *;
+	SET LOCAL citus.enable_partial_local_execution TO ON;
+	SELECT count(*) FROM distributed_table WHERE value = '11';
+ROLLBACK;
+
+-- with citus.prefer_one_phase_commit, a transaction that reads over multiple
+-- connections after a local execution, and writes to a single remote node,
+-- commits without 2PC
+SET citus.prefer_one_phase_commit TO ON;
+CREATE TEMP TABLE commit_stats_before AS
+SELECT s.*, (SELECT count(*) FROM pg_dist_transaction) AS transaction_records
+FROM citus_coordinated_transaction_stats() s;
+BEGIN;
+	SELECT count(*) FROM distributed_table WHERE key = 1;
+	SELECT count(*) FROM distributed_table WHERE value = '12';
+	UPDATE distributed_table SET value = '12' WHERE key = 11;
+COMMIT;
+SELECT s.avoided_two_phase_commits = b.avoided_two_phase_commits + 1 AS avoided_2pc,
+	   (SELECT count(*) FROM pg_dist_transaction) = b.transaction_records AS no_transaction_records
+FROM citus_coordinated_transaction_stats() s, commit_stats_before b;
+DROP TABLE commit_stats_before;
+RESET citus.prefer_one_phase_commit;
+
 -- if we start with a distributed execution, we should keep
 -- using that and never switch back to local execution 
 BEGIN;
@@ -646,6 +685,25 @@ BEGIN;
 COMMIT;
 
 
+-- the local plans of prepared statements are cached after the first execution,
+-- make sure that the cached plan is not used anymore once the shard is altered
+INSERT INTO reference_table VALUES (1);
+PREPARE local_plan_cache_insert AS INSERT INTO distributed_table (key) VALUES (1) RETURNING *;
+EXECUTE local_plan_cache_insert;
+DELETE FROM distributed_table WHERE key = 1;
+EXECUTE local_plan_cache_insert;
+DELETE FROM distributed_table WHERE key = 1;
+EXECUTE local_plan_cache_insert;
+DELETE FROM distributed_table WHERE key = 1;
+-- the default only exists on the shard, so a stale plan would not use it
+ALTER TABLE distributed_table_1470001 ALTER COLUMN value SET DEFAULT 'replanned';
+EXECUTE local_plan_cache_insert;
+DELETE FROM distributed_table WHERE key = 1;
+ALTER TABLE distributed_table_1470001 ALTER COLUMN value DROP DEFAULT;
+EXECUTE local_plan_cache_insert;
+DELETE FROM distributed_table WHERE key = 1;
+DEALLOCATE local_plan_cache_insert;
+
 \c - - - :master_port
 
 -- local execution with custom type 
@@ -11,3 +11,42 @@ TRUNCATE tab10;
 
 DROP TABLE tab9;
 DROP TABLE tab10;
+
+-- shard lists are shared between backends via the shared metadata cache
+SET citus.enable_shared_metadata_cache TO on;
+CREATE TABLE tab11 (name text NOT NULL, data int);
+SELECT create_distributed_table('tab11', 'name', 'append');
+COPY tab11 FROM STDIN WITH CSV;
+a,1
+b,2
+\.
+\c - - - :master_port
+SET citus.enable_shared_metadata_cache TO on;
+SELECT data FROM tab11 WHERE name = 'b';
+-- a new shard makes the shared shard list stale
+COPY tab11 FROM STDIN WITH CSV;
+x,3
+y,4
+\.
+\c - - - :master_port
+SET citus.enable_shared_metadata_cache TO on;
+SELECT data FROM tab11 WHERE name = 'y';
+SELECT name, data FROM tab11 ORDER BY name;
+-- a transaction that creates shards sees them before it commits
+BEGIN;
+COPY tab11 FROM STDIN WITH CSV;
+p,5
+\.
+SELECT data FROM tab11 WHERE name = 'p';
+SELECT count(*) FROM tab11;
+ROLLBACK;
+SELECT count(*) FROM tab11;
+BEGIN;
+CREATE TABLE tab12 (key int, value int);
+SELECT create_distributed_table('tab12', 'key');
+INSERT INTO tab12 VALUES (1, 1), (2, 2), (3, 3);
+SELECT count(*), sum(value) FROM tab12;
+COMMIT;
+SELECT count(*), sum(value) FROM tab12;
+DROP TABLE tab11;
+DROP TABLE tab12;
@@ -331,6 +331,23 @@ SELECT * FROM data_load_test ORDER BY col2;
 SELECT * FROM data_load_test WHERE col3 = 'world';
 DROP TABLE data_load_test;
 
+-- Test data loading using a parallel scan of the local table
+SET parallel_setup_cost TO 0;
+SET parallel_tuple_cost TO 0;
+SET min_parallel_table_scan_size TO 0;
+SET max_parallel_workers_per_gather TO 2;
+CREATE TABLE data_load_test (col1 int, col2 text);
+INSERT INTO data_load_test SELECT s, 'value-' || s FROM generate_series(1, 10000) s;
+SET client_min_messages TO DEBUG1;
+SELECT create_distributed_table('data_load_test', 'col1');
+RESET client_min_messages;
+RESET parallel_setup_cost;
+RESET parallel_tuple_cost;
+RESET min_parallel_table_scan_size;
+RESET max_parallel_workers_per_gather;
+SELECT count(*), sum(col1), max(col2) FROM data_load_test;
+DROP TABLE data_load_test;
+
 SET citus.shard_replication_factor TO default;
 SET citus.shard_count to 4;
 
@@ -107,6 +107,15 @@ SELECT load_shard_placement_array(540001, true);
 -- should see error for non-existent shard
 SELECT load_shard_placement_array(540001, false);
 
+-- placement changes only reload the placements of the changed shard
+SET citus.enable_incremental_cache_invalidation TO on;
+BEGIN;
+UPDATE pg_dist_placement SET shardstate = 1 WHERE shardid = 540001;
+SELECT load_shard_placement_array(540001, true);
+ROLLBACK;
+SELECT load_shard_placement_array(540001, true);
+RESET citus.enable_incremental_cache_invalidation;
+
 -- should see column id of 'name'
 SELECT partition_column_id('events_hash');
 
@@ -264,6 +273,11 @@ SELECT get_shard_id_for_distribution_column('get_shardid_test_table5', 3248);
 SELECT get_shard_id_for_distribution_column('get_shardid_test_table5', 4001);
 SELECT get_shard_id_for_distribution_column('get_shardid_test_table5', -999);
 
+-- test boundary values of range distributed tables
+SELECT get_shard_id_for_distribution_column('get_shardid_test_table5', 1000);
+SELECT get_shard_id_for_distribution_column('get_shardid_test_table5', 1001);
+SELECT get_shard_id_for_distribution_column('get_shardid_test_table5', 4000);
+
 
 SET citus.shard_count TO 2;
 CREATE TABLE events_table_count (user_id int, time timestamp, event_type int, value_2 int, value_3 float, value_4 bigint);
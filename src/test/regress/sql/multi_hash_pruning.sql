@@ -83,6 +83,42 @@ SELECT count(*) FROM lineitem_hash_part
 SELECT count(*) FROM lineitem_hash_part
 	WHERE l_orderkey IN (1,2,3);
 
+-- Check pruning with IN lists containing duplicate values and NULLs
+SELECT count(*) FROM lineitem_hash_part
+	WHERE l_orderkey IN (1,2,3,1,2,3,NULL);
+
+SELECT count(*) FROM lineitem_hash_part
+	WHERE l_orderkey IN (1,1);
+
+SELECT count(*) FROM lineitem_hash_part
+	WHERE l_orderkey IN (1,2,3) AND l_orderkey = ANY ('{2,3,4}');
+
+SELECT count(*) FROM lineitem_hash_part
+	WHERE l_orderkey IN (1,2) AND l_orderkey = 3;
+
+SELECT count(*) FROM lineitem_hash_part
+	WHERE l_orderkey IN (1,2) OR l_orderkey IN (3,4);
+
+-- Check that tasks only get the IN list values of their shard
+SELECT l_orderkey, count(*) FROM lineitem_hash_part
+	WHERE l_orderkey IN (1,2,3,4,5,6,7,NULL)
+	GROUP BY l_orderkey ORDER BY l_orderkey;
+
+SELECT count(*) FROM lineitem_hash_part
+	WHERE l_orderkey = ANY (ARRAY[1,2,3,4,5,6,7]) AND l_linenumber < 3;
+
+-- Show the query string of each task, which should only contain the IN list
+-- values that hash to the task's shard. We only plan the query here, so that
+-- the output does not depend on the executor.
+SET citus.task_executor_type TO 'adaptive';
+SET citus.explain_distributed_queries TO off;
+SET client_min_messages TO DEBUG4;
+EXPLAIN (COSTS OFF) SELECT count(*) FROM lineitem_hash_part
+	WHERE l_orderkey IN (1,2,3,4,5,6,7);
+SET client_min_messages TO DEFAULT;
+RESET citus.explain_distributed_queries;
+RESET citus.task_executor_type;
+
 -- Check whether we can deal with null arrays
 SELECT count(*) FROM lineitem_hash_part
 	WHERE l_orderkey IN (NULL);
@@ -41,6 +41,21 @@ CREATE INDEX lineitem_partial_index ON lineitem (l_shipdate)
 
 CREATE INDEX lineitem_colref_index ON lineitem (record_ne(lineitem.*, NULL));
 
+-- limit the number of concurrent shard index builds per node, and check that
+-- the indexes of the largest shards are built first
+UPDATE pg_dist_placement SET shardlength = 32768 WHERE shardid = 102083;
+UPDATE pg_dist_placement SET shardlength = 16384 WHERE shardid IN (102086, 102088);
+SET citus.max_index_builds_per_node TO 1;
+SET client_min_messages TO DEBUG3;
+CREATE INDEX index_test_hash_index_b ON index_test_hash (b);
+RESET client_min_messages;
+RESET citus.max_index_builds_per_node;
+UPDATE pg_dist_placement SET shardlength = 0 WHERE shardid IN (102083, 102086, 102088);
+
+-- no index build is in progress after the command finishes
+SELECT count(*) FROM get_index_build_progress();
+DROP INDEX index_test_hash_index_b;
+
 SET client_min_messages = ERROR; -- avoid version dependant warning about WAL
 CREATE INDEX lineitem_orderkey_hash_index ON lineitem USING hash (l_partkey);
 CREATE UNIQUE INDEX index_test_range_index_a ON index_test_range(a);
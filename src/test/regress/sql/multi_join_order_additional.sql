@@ -108,6 +108,52 @@ EXPLAIN SELECT count(*) FROM orders, customer_hash
 EXPLAIN SELECT count(*) FROM orders_hash, customer_append
 	WHERE c_custkey = o_custkey;
 
+-- Validate that the cost based join order keeps co-located joins, and falls
+-- back to the join rules when the estimated costs are equal.
+SET citus.enable_cost_based_join_order TO on;
+
+EXPLAIN SELECT count(*) FROM orders_hash, lineitem_hash
+	WHERE o_orderkey = l_orderkey;
+
+EXPLAIN SELECT count(*) FROM orders_hash, customer_hash
+	WHERE c_custkey = o_custkey;
+
+-- Without shard lengths in the metadata, the cost estimates use the table sizes
+-- that a distributed ANALYZE merged from the shards.
+INSERT INTO customer_hash VALUES
+	(1, 'a', 'a', 1, 'a', 1.0, 'a', 'a'), (2, 'b', 'b', 2, 'b', 2.0, 'b', 'b');
+SET citus.enable_distributed_analyze TO on;
+ANALYZE customer_hash;
+
+EXPLAIN SELECT count(*) FROM orders_hash, customer_hash
+	WHERE c_custkey = o_custkey;
+
+TRUNCATE customer_hash;
+ANALYZE customer_hash;
+RESET citus.enable_distributed_analyze;
+
+-- With known shard sizes, the cost based join order joins the large table last,
+-- whereas the join rules alone would pick the first table in the query.
+UPDATE pg_dist_placement SET shardlength = 524288 WHERE shardid IN
+	(SELECT shardid FROM pg_dist_shard WHERE logicalrelid = 'lineitem_hash'::regclass);
+UPDATE pg_dist_placement SET shardlength = 4096 WHERE shardid IN
+	(SELECT shardid FROM pg_dist_shard WHERE logicalrelid IN
+		('orders_hash'::regclass, 'customer_hash'::regclass));
+
+SET citus.enable_cost_based_join_order TO off;
+EXPLAIN SELECT count(*) FROM orders_hash, lineitem_hash, customer_hash
+	WHERE o_custkey = l_partkey AND o_custkey = c_nationkey;
+
+SET citus.enable_cost_based_join_order TO on;
+EXPLAIN SELECT count(*) FROM orders_hash, lineitem_hash, customer_hash
+	WHERE o_custkey = l_partkey AND o_custkey = c_nationkey;
+
+UPDATE pg_dist_placement SET shardlength = 0 WHERE shardid IN
+	(SELECT shardid FROM pg_dist_shard WHERE logicalrelid IN
+		('lineitem_hash'::regclass, 'orders_hash'::regclass, 'customer_hash'::regclass));
+
+RESET citus.enable_cost_based_join_order;
+
 -- Reset client logging level to its previous value
 
 SET client_min_messages TO NOTICE;
@@ -523,6 +523,35 @@ VALUES (99, 'Wayz'), (98, 'Mynt') RETURNING name, app_id;
 SELECT * FROM app_analytics_events ORDER BY id;
 DROP TABLE app_analytics_events;
 
+-- Test multi-row insert that is copied into the shards
+CREATE TABLE app_analytics_events (id int, app_id serial, name text);
+SELECT create_distributed_table('app_analytics_events', 'id');
+
+SET citus.multi_row_insert_copy_threshold TO 2;
+SET client_min_messages TO DEBUG2;
+INSERT INTO app_analytics_events (id, name)
+VALUES (99, 'Wayz'), (98, 'Mynt'), (97, NULL);
+
+-- parameters in the VALUES list are evaluated on the coordinator as well
+PREPARE copy_multi_row_insert(int, text) AS
+INSERT INTO app_analytics_events (id, name) VALUES ($1, $2), ($1 + 1, $2);
+EXECUTE copy_multi_row_insert(80, 'Uber');
+EXECUTE copy_multi_row_insert(82, 'Lyft');
+EXECUTE copy_multi_row_insert(84, 'Ola');
+EXECUTE copy_multi_row_insert(86, 'Grab');
+EXECUTE copy_multi_row_insert(88, 'Bolt');
+EXECUTE copy_multi_row_insert(90, 'Didi');
+SET client_min_messages TO DEFAULT;
+DEALLOCATE copy_multi_row_insert;
+
+-- inserts with RETURNING are not copied
+INSERT INTO app_analytics_events (id, name)
+VALUES (96, 'Foo'), (95, 'Bar') RETURNING id, name;
+RESET citus.multi_row_insert_copy_threshold;
+
+SELECT * FROM app_analytics_events ORDER BY id;
+DROP TABLE app_analytics_events;
+
 -- test UPDATE with subqueries
 CREATE TABLE raw_table (id bigint, value bigint);
 CREATE TABLE summary_table (
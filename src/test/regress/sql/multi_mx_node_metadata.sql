@@ -118,6 +118,35 @@ SELECT 1 FROM master_update_node(:nodeid_1, 'localhost', :worker_1_port);
 SELECT wait_until_metadata_sync();
 SELECT nodeid, hasmetadata, metadatasynced FROM pg_dist_node;
 
+-- with delta metadata sync, only the missed changes are sent to the node
+SET citus.enable_delta_metadata_sync TO ON;
+-- remember the pg_dist_partition rows of the node, which a snapshot recreates
+SELECT result FROM master_run_on_worker(ARRAY['localhost'], ARRAY[:worker_1_port],
+    ARRAY['CREATE TABLE partition_xmins AS SELECT logicalrelid, xmin::text AS row_xmin FROM pg_dist_partition'], false);
+SELECT 1 FROM master_update_node(:nodeid_1, 'localhost', 12345);
+SELECT count(*) FROM pg_dist_metadata_change;
+SELECT 1 FROM master_update_node(:nodeid_1, 'localhost', :worker_1_port);
+SELECT wait_until_metadata_sync();
+SELECT nodeid, hasmetadata, metadatasynced FROM pg_dist_node;
+SELECT count(*) FROM pg_dist_metadata_change;
+SELECT verify_metadata('localhost', :worker_1_port);
+SELECT result FROM master_run_on_worker(ARRAY['localhost'], ARRAY[:worker_1_port],
+    ARRAY['SELECT count(*) FROM pg_dist_partition p JOIN partition_xmins x ON (p.logicalrelid = x.logicalrelid AND p.xmin::text = x.row_xmin)'], false);
+
+-- a change log that cannot be replayed is dropped in favour of the snapshot
+SELECT 1 FROM master_update_node(:nodeid_1, 'localhost', 12345);
+UPDATE pg_dist_metadata_change SET command = 'SELECT 1/0';
+SELECT 1 FROM master_update_node(:nodeid_1, 'localhost', :worker_1_port);
+SELECT wait_until_metadata_sync();
+SELECT nodeid, hasmetadata, metadatasynced FROM pg_dist_node;
+SELECT count(*) FROM pg_dist_metadata_change;
+SELECT verify_metadata('localhost', :worker_1_port);
+SELECT result FROM master_run_on_worker(ARRAY['localhost'], ARRAY[:worker_1_port],
+    ARRAY['SELECT count(*) FROM pg_dist_partition p JOIN partition_xmins x ON (p.logicalrelid = x.logicalrelid AND p.xmin::text = x.row_xmin)'], false);
+SELECT result FROM master_run_on_worker(ARRAY['localhost'], ARRAY[:worker_1_port],
+    ARRAY['DROP TABLE partition_xmins'], false);
+RESET citus.enable_delta_metadata_sync;
+
 --------------------------------------------------------------------------
 -- Test updating a node when another node is in readonly-mode
 --------------------------------------------------------------------------
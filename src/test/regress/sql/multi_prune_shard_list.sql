@@ -145,5 +145,62 @@ SELECT * FROM coerce_hash WHERE id = 1.0;
 
 SELECT * FROM coerce_hash WHERE id = 1.0::numeric;
 
+-- shards can be skipped based on the tracked ranges of other columns
+CREATE TABLE zone_map_hash (
+	id int NOT NULL,
+	created_at date
+);
+SELECT create_distributed_table('zone_map_hash', 'id');
+
+-- each shard gets a different date
+INSERT INTO zone_map_hash
+SELECT i, '2019-01-01'::date + (get_shard_id_for_distribution_column('zone_map_hash', i) % 4)::int
+FROM generate_series(1, 100) i;
+
+SELECT citus_add_shard_range_column('zone_map_hash', 'created_at');
+SELECT citus_add_shard_range_column('zone_map_hash', 'id');
+SELECT citus_update_shard_column_ranges();
+
+SELECT min_value, max_value, is_current FROM citus_shard_column_ranges()
+WHERE table_name = 'zone_map_hash'::regclass ORDER BY min_value;
+
+SET citus.task_executor_type TO 'adaptive';
+SET client_min_messages TO DEBUG2;
+SELECT count(*) FROM zone_map_hash WHERE created_at > '2019-01-04';
+SELECT count(*) > 0 FROM zone_map_hash WHERE created_at = '2019-01-02';
+SELECT count(*) FROM zone_map_hash WHERE created_at >= '2019-01-01' AND id > 0;
+RESET client_min_messages;
+
+-- writes invalidate the range of the shard
+INSERT INTO zone_map_hash VALUES (1, '2019-01-10');
+SELECT count(*) FROM citus_shard_column_ranges()
+WHERE table_name = 'zone_map_hash'::regclass AND NOT is_current;
+SELECT count(*) FROM zone_map_hash WHERE created_at > '2019-01-04';
+
+-- shards written in the current transaction are never skipped
+BEGIN;
+INSERT INTO zone_map_hash VALUES (2, '2019-01-11');
+SELECT count(*) FROM zone_map_hash WHERE created_at > '2019-01-04';
+COMMIT;
+
+-- ranges are not refreshed from the snapshot of a transaction block
+BEGIN TRANSACTION ISOLATION LEVEL REPEATABLE READ;
+SELECT citus_update_shard_column_ranges();
+ROLLBACK;
+
+SELECT citus_update_shard_column_ranges();
+SELECT count(*) FROM citus_shard_column_ranges()
+WHERE table_name = 'zone_map_hash'::regclass AND NOT is_current;
+SELECT count(*) FROM zone_map_hash WHERE created_at > '2019-01-04';
+RESET citus.task_executor_type;
+
+SELECT citus_remove_shard_range_column('zone_map_hash', 'created_at');
+SELECT citus_remove_shard_range_column('zone_map_hash', 'created_at');
+SELECT citus_update_shard_column_ranges();
+
+SELECT citus_add_shard_range_column('zone_map_hash', 'created_at');
+DROP TABLE zone_map_hash;
+SELECT count(*) FROM pg_dist_shard_range_column;
+
 SET search_path TO public;
 DROP SCHEMA prune_shard_list CASCADE;
@@ -80,3 +80,8 @@ SELECT pg_reload_conf();
 
 DROP INDEX index_1;
 DROP INDEX index_2;
+
+-- update the sizes of the shards of hash-distributed tables in the metadata
+SELECT citus_update_shard_sizes();
+SELECT sum(shardlength) FROM pg_dist_placement JOIN pg_dist_shard USING (shardid)
+WHERE logicalrelid = 'customer_copy_hash'::regclass;
@@ -187,6 +187,70 @@ COMMIT;
 SELECT count(*) FROM pg_dist_transaction;
 
 
+-- with citus.prefer_one_phase_commit, transactions that modify data over
+-- multiple connections still use 2PC
+SELECT recover_prepared_transactions();
+SET citus.prefer_one_phase_commit TO ON;
+CREATE TEMP TABLE commit_stats_before AS SELECT * FROM citus_coordinated_transaction_stats();
+BEGIN;
+INSERT INTO test_recovery_single VALUES ('hello-0');
+INSERT INTO test_recovery_single VALUES ('hello-2');
+COMMIT;
+SELECT count(*) FROM pg_dist_transaction;
+SELECT s.two_phase_commits > b.two_phase_commits AS used_2pc,
+	   s.avoided_two_phase_commits = b.avoided_two_phase_commits AS kept_2pc
+FROM citus_coordinated_transaction_stats() s, commit_stats_before b;
+RESET citus.prefer_one_phase_commit;
+DROP TABLE commit_stats_before;
+
+-- no recovery is in progress outside of recover_prepared_transactions
+SELECT count(*) FROM get_transaction_recovery_progress();
+
+-- recover prepared transactions to commit and to abort on both workers
+SELECT recover_prepared_transactions();
+
+\c - - - :worker_1_port
+BEGIN;
+CREATE TABLE should_abort_on_workers (value int);
+PREPARE TRANSACTION 'citus_0_should_abort_on_workers';
+
+BEGIN;
+CREATE TABLE should_commit_on_workers (value int);
+PREPARE TRANSACTION 'citus_0_should_commit_on_workers';
+
+\c - - - :worker_2_port
+BEGIN;
+CREATE TABLE should_abort_on_workers (value int);
+PREPARE TRANSACTION 'citus_0_should_abort_on_workers';
+
+BEGIN;
+CREATE TABLE should_commit_on_workers (value int);
+PREPARE TRANSACTION 'citus_0_should_commit_on_workers';
+
+\c - - - :master_port
+INSERT INTO pg_dist_transaction
+SELECT groupid, 'citus_0_should_commit_on_workers' FROM pg_dist_node
+WHERE nodeport IN (:worker_1_port, :worker_2_port);
+
+-- the workers resolve one transaction each per round, and the progress of
+-- each worker is reported at the end
+SET client_min_messages TO DEBUG1;
+SELECT recover_prepared_transactions();
+RESET client_min_messages;
+SELECT count(*) FROM pg_dist_transaction;
+
+\c - - - :worker_1_port
+SELECT count(*) FROM pg_prepared_xacts WHERE gid LIKE 'citus\_0\_should\_%';
+SELECT tablename FROM pg_tables WHERE tablename LIKE 'should\_%\_on\_workers';
+DROP TABLE should_commit_on_workers;
+
+\c - - - :worker_2_port
+SELECT count(*) FROM pg_prepared_xacts WHERE gid LIKE 'citus\_0\_should\_%';
+SELECT tablename FROM pg_tables WHERE tablename LIKE 'should\_%\_on\_workers';
+DROP TABLE should_commit_on_workers;
+
+\c - - - :master_port
+
 -- Test whether auto-recovery runs
 ALTER SYSTEM SET citus.recover_2pc_interval TO 10;
 SELECT pg_reload_conf();
@@ -292,3 +292,33 @@ SELECT citus_truncate_trigger();
 
 -- confirm that citus_create_restore_point works
 SELECT 1 FROM citus_create_restore_point('regression-test');
+
+-- merge the statistics of the shards into the distributed table on ANALYZE
+SET citus.shard_count TO 4;
+CREATE TABLE analyze_stats (a int, b int, c text);
+SELECT create_distributed_table('analyze_stats', 'a');
+INSERT INTO analyze_stats
+SELECT i, i % 10, CASE WHEN i % 4 = 0 THEN NULL ELSE 'x' END FROM generate_series(1, 1000) i;
+
+SET citus.enable_distributed_analyze TO on;
+ANALYZE analyze_stats;
+RESET citus.enable_distributed_analyze;
+
+SELECT reltuples FROM pg_class WHERE oid = 'analyze_stats'::regclass;
+SELECT attname, round(null_frac::numeric, 2) AS null_frac, avg_width, n_distinct
+FROM pg_stats WHERE tablename = 'analyze_stats' ORDER BY attname;
+
+-- the most common values and frequencies are added up across the shards
+SELECT attname,
+       (SELECT array_agg(v ORDER BY v) FROM unnest(most_common_vals::text::text[]) v) AS most_common_vals,
+       round((SELECT sum(f) FROM unnest(most_common_freqs) f)::numeric, 2) AS frequency
+FROM pg_stats WHERE tablename = 'analyze_stats' AND most_common_vals IS NOT NULL
+ORDER BY attname;
+
+-- the histograms of the shards are merged into one that covers all values
+SELECT array_length(histogram_bounds::text::int[], 1) AS bounds,
+       (histogram_bounds::text::int[])[1] AS lowest,
+       (histogram_bounds::text::int[])[101] AS highest
+FROM pg_stats WHERE tablename = 'analyze_stats' AND attname = 'a';
+
+DROP TABLE analyze_stats;
@@ -332,6 +332,44 @@ COMMIT;
 SELECT distributed_2PCs_are_equal_to_worker_count();
 DROP TABLE test_seq_ddl_index;
 
+-- Check if batching the commands of sequential multi-shard modifications works
+SET citus.shard_replication_factor TO 1;
+CREATE TABLE test_seq_batch(a int, b int);
+SELECT create_distributed_table('test_seq_batch', 'a', colocate_with => 'none');
+INSERT INTO test_seq_batch SELECT i, i FROM generate_series(1, 100) i;
+BEGIN;
+    SET LOCAL citus.multi_shard_modify_mode TO 'sequential';
+    SET LOCAL citus.force_max_query_parallelization TO off;
+    SET LOCAL citus.sequential_command_batch_size TO 3;
+    UPDATE test_seq_batch SET b = b + 1;
+    DELETE FROM test_seq_batch WHERE a % 2 = 0;
+    SELECT count(*), sum(b) FROM test_seq_batch;
+COMMIT;
+SELECT count(*), sum(b) FROM test_seq_batch;
+
+-- 1 and 13 are in the first and third shard, which are both on the first
+-- worker, so their commands are sent in a single round trip
+BEGIN;
+    SET LOCAL citus.multi_shard_modify_mode TO 'sequential';
+    SET LOCAL citus.sequential_command_batch_size TO 3;
+    SET LOCAL client_min_messages TO DEBUG4;
+    UPDATE test_seq_batch SET b = b + 1 WHERE a IN (1, 13);
+    SET LOCAL client_min_messages TO DEFAULT;
+COMMIT;
+SELECT a, b FROM test_seq_batch WHERE a IN (1, 13) ORDER BY a;
+
+-- if a later command of the batch fails, the earlier ones are rolled back:
+-- the command on the shard of 1 increments b, only the one on the shard of 13
+-- divides by zero, and the statement runs outside of a transaction block
+SET citus.multi_shard_modify_mode TO 'sequential';
+SET citus.sequential_command_batch_size TO 3;
+UPDATE test_seq_batch SET b = b + 1 + 1 / (a - 13) WHERE a IN (1, 13);
+RESET citus.sequential_command_batch_size;
+RESET citus.multi_shard_modify_mode;
+SELECT a, b FROM test_seq_batch WHERE a IN (1, 13) ORDER BY a;
+DROP TABLE test_seq_batch;
+SET citus.shard_replication_factor TO DEFAULT;
+
 -- create_distributed_table should fail on relations with data in sequential mode in and out transaction block
 CREATE TABLE test_create_seq_table (a int);
 INSERT INTO test_create_seq_table VALUES (1);